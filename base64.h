@@ -0,0 +1,54 @@
+// Base64 (RFC 4648, standard alphabet, padded) for PNG data URLs.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace dwm {
+
+inline size_t Base64EncodedSize(size_t len) { return (len + 2) / 3 * 4; }
+
+// Appends the encoding of data[0, len) to out with a single allocation.
+inline void Base64EncodeAppend(const uint8_t* data, size_t len, std::string& out) {
+    static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t start = out.size();
+    out.resize(start + Base64EncodedSize(len));
+    char* dst = &out[start];
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3) {
+        uint32_t v = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | data[i + 2];
+        dst[0] = kAlphabet[v >> 18];
+        dst[1] = kAlphabet[(v >> 12) & 63];
+        dst[2] = kAlphabet[(v >> 6) & 63];
+        dst[3] = kAlphabet[v & 63];
+        dst += 4;
+    }
+    if (i < len) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)data[i + 1] << 8;
+        dst[0] = kAlphabet[v >> 18];
+        dst[1] = kAlphabet[(v >> 12) & 63];
+        dst[2] = i + 1 < len ? kAlphabet[(v >> 6) & 63] : '=';
+        dst[3] = '=';
+    }
+}
+
+inline std::string Base64Encode(const uint8_t* data, size_t len) {
+    std::string out;
+    Base64EncodeAppend(data, len, out);
+    return out;
+}
+
+// "data:<mime>;base64,<payload>" built in one allocation.
+inline std::string Base64DataUrl(const char* mime, const uint8_t* data, size_t len) {
+    std::string out = "data:";
+    out += mime;
+    out += ";base64,";
+    out.reserve(out.size() + Base64EncodedSize(len));
+    Base64EncodeAppend(data, len, out);
+    return out;
+}
+
+} // namespace dwm
@@ -0,0 +1,817 @@
+// Portable benchmarks for the image and encoding kernels the addon uses
+// (base64, PNG/deflate, area downscale, pixel conversion, negative cache and
+// latency histogram, UTF-16/UTF-8 transcoding, the shared-memory frame ring,
+// banded PNG streaming, palette-quantized PNG, multi-threaded deflate,
+// progressive thumbnail previews)
+// and of the window logic on the synthetic backend (Alt-Tab filtering, event
+// tracking). Builds on Linux/macOS/Windows without Windows headers.
+// Every result also reports heap allocations per operation (global operator new
+// is replaced with a counting one below).
+//
+//   dwm_bench [--json out.json] [--filter substr] [--min-time ms] [--corpus dir]
+//
+// Inputs are deterministic synthetic frames (window-like UI, photo-like
+// gradients, noise) plus any binary PPM (P6) files found in the corpus dir.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../base64.h"
+#include "../deflate.h"
+#include "../frame_ring.h"
+#include "../enumeration_arena.h"
+#include "../image_frame.h"
+#include "../latency_histogram.h"
+#include "../negative_cache.h"
+#include "../png_encoder.h"
+#include "../png_stream.h"
+#include "../shared_memory.h"
+#include "../string_table.h"
+#include "../synthetic_window_system.h"
+#include "../trace_writer.h"
+#include "../utf16.h"
+#include "../window_event_tracker.h"
+
+// Heap allocations made by the process, counted by the replaced operator new
+static std::atomic<uint64_t> g_heapAllocations{0};
+
+static void* CountedAlloc(std::size_t n, std::size_t alignment) {
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (n == 0) n = 1;
+    void* p = nullptr;
+    if (alignment <= alignof(std::max_align_t)) {
+        p = std::malloc(n);
+    } else {
+#if defined(_MSC_VER)
+        p = _aligned_malloc(n, alignment);
+#else
+        p = std::aligned_alloc(alignment, (n + alignment - 1) / alignment * alignment);
+#endif
+    }
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+static void CountedFree(void* p, std::size_t alignment) noexcept {
+#if defined(_MSC_VER)
+    if (alignment > alignof(std::max_align_t)) { _aligned_free(p); return; }
+#else
+    (void)alignment;
+#endif
+    std::free(p);
+}
+
+void* operator new(std::size_t n) { return CountedAlloc(n, 0); }
+void* operator new[](std::size_t n) { return CountedAlloc(n, 0); }
+void* operator new(std::size_t n, std::align_val_t al) { return CountedAlloc(n, (std::size_t)al); }
+void* operator new[](std::size_t n, std::align_val_t al) { return CountedAlloc(n, (std::size_t)al); }
+void operator delete(void* p) noexcept { CountedFree(p, 0); }
+void operator delete[](void* p) noexcept { CountedFree(p, 0); }
+void operator delete(void* p, std::size_t) noexcept { CountedFree(p, 0); }
+void operator delete[](void* p, std::size_t) noexcept { CountedFree(p, 0); }
+void operator delete(void* p, std::align_val_t al) noexcept { CountedFree(p, (std::size_t)al); }
+void operator delete[](void* p, std::align_val_t al) noexcept { CountedFree(p, (std::size_t)al); }
+void operator delete(void* p, std::size_t, std::align_val_t al) noexcept { CountedFree(p, (std::size_t)al); }
+void operator delete[](void* p, std::size_t, std::align_val_t al) noexcept { CountedFree(p, (std::size_t)al); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string jsonPath;
+    std::string filter;
+    double minTimeMs{200};
+    std::string corpusDir;
+};
+
+struct Result {
+    std::string name;
+    std::string params;
+    uint64_t iterations{0};
+    double nsPerOp{0};
+    double mbPerSec{0}; // input bytes per second, 0 if not meaningful
+    uint64_t bytesOut{0};
+    double allocsPerOp{0}; // heap allocations (operator new) per operation
+};
+
+// Kernels whose result isn't an output size feed it here so the optimizer
+// can't drop the work.
+volatile uint64_t g_sink = 0;
+
+// xorshift64*: deterministic across platforms
+struct Rng {
+    uint64_t s;
+    explicit Rng(uint64_t seed) : s(seed ? seed : 1) {}
+    uint64_t Next() { s ^= s >> 12; s ^= s << 25; s ^= s >> 27; return s * 2685821657736338717ull; }
+    uint8_t Byte() { return (uint8_t)(Next() >> 56); }
+};
+
+void SetPixel(dwm::Frame& f, int x, int y, uint8_t r, uint8_t g, uint8_t b) {
+    uint8_t* p = f.pixels.data() + ((size_t)y * f.width + x) * 4;
+    p[0] = b; p[1] = g; p[2] = r; p[3] = 255;
+}
+
+void FillRect(dwm::Frame& f, int x0, int y0, int w, int h, uint8_t r, uint8_t g, uint8_t b) {
+    int x1 = std::min(f.width, x0 + w), y1 = std::min(f.height, y0 + h);
+    for (int y = std::max(0, y0); y < y1; ++y)
+        for (int x = std::max(0, x0); x < x1; ++x) SetPixel(f, x, y, r, g, b);
+}
+
+// Title bar, toolbar, sidebar and "text" lines on a flat background: the
+// common case for Alt-Tab thumbnails.
+dwm::Frame MakeUiFrame(int w, int h, uint64_t seed) {
+    dwm::Frame f;
+    f.Allocate(w, h);
+    Rng rng(seed);
+    FillRect(f, 0, 0, w, h, 250, 250, 250);
+    FillRect(f, 0, 0, w, h / 20 + 8, 32, 32, 36);                 // title bar
+    FillRect(f, 0, h / 20 + 8, w, h / 16, 240, 240, 244);         // toolbar
+    FillRect(f, 0, h / 20 + 8 + h / 16, w / 5, h, 230, 232, 236); // sidebar
+    int lineH = std::max(3, h / 60);
+    for (int y = h / 6; y + lineH < h; y += lineH * 2) {
+        int x = w / 5 + 12;
+        while (x < w - 12) {
+            int word = 8 + (int)(rng.Next() % 60);
+            uint8_t shade = (uint8_t)(40 + rng.Byte() % 40);
+            FillRect(f, x, y, std::min(word, w - 12 - x), lineH, shade, shade, shade);
+            x += word + 6;
+        }
+    }
+    for (int i = 0; i < 6; ++i) { // a few coloured buttons / images
+        int bx = (int)(rng.Next() % (uint64_t)std::max(1, w - 80));
+        int by = (int)(rng.Next() % (uint64_t)std::max(1, h - 40));
+        FillRect(f, bx, by, 60, 24, rng.Byte(), rng.Byte(), rng.Byte());
+    }
+    return f;
+}
+
+// Smooth gradients with mild noise (video, photos, games).
+dwm::Frame MakePhotoFrame(int w, int h, uint64_t seed) {
+    dwm::Frame f;
+    f.Allocate(w, h);
+    Rng rng(seed);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) {
+            int n = (int)(rng.Byte() % 9) - 4;
+            SetPixel(f, x, y, (uint8_t)std::clamp(x * 255 / w + n, 0, 255),
+                     (uint8_t)std::clamp(y * 255 / h + n, 0, 255),
+                     (uint8_t)std::clamp(((x + y) * 128) / (w + h) + 64 + n, 0, 255));
+        }
+    return f;
+}
+
+dwm::Frame MakeNoiseFrame(int w, int h, uint64_t seed) {
+    dwm::Frame f;
+    f.Allocate(w, h);
+    Rng rng(seed);
+    for (auto& b : f.pixels) b = rng.Byte();
+    return f;
+}
+
+// Binary PPM (P6, maxval 255) -> BGRA frame. Returns false for anything else.
+bool LoadPpm(const std::string& path, dwm::Frame& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::string magic;
+    int w = 0, h = 0, maxval = 0;
+    auto skipComments = [&] {
+        in >> std::ws;
+        while (in.peek() == '#') { std::string line; std::getline(in, line); in >> std::ws; }
+    };
+    in >> magic;
+    if (magic != "P6") return false;
+    skipComments(); in >> w;
+    skipComments(); in >> h;
+    skipComments(); in >> maxval;
+    in.get();
+    if (!in || w <= 0 || h <= 0 || w > 16384 || h > 16384 || maxval != 255) return false;
+    std::vector<uint8_t> rgb((size_t)w * h * 3);
+    if (!in.read(reinterpret_cast<char*>(rgb.data()), (std::streamsize)rgb.size())) return false;
+    out.Allocate(w, h);
+    for (size_t i = 0; i < (size_t)w * h; ++i) {
+        out.pixels[i * 4 + 0] = rgb[i * 3 + 2];
+        out.pixels[i * 4 + 1] = rgb[i * 3 + 1];
+        out.pixels[i * 4 + 2] = rgb[i * 3 + 0];
+        out.pixels[i * 4 + 3] = 255;
+    }
+    return true;
+}
+
+struct NamedFrame {
+    std::string name;
+    dwm::Frame frame;
+};
+
+std::vector<NamedFrame> LoadCorpus(const std::string& dir) {
+    std::vector<NamedFrame> frames;
+    std::error_code ec;
+    if (dir.empty() || !std::filesystem::is_directory(dir, ec)) return frames;
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        if (entry.path().extension() == ".ppm") paths.push_back(entry.path());
+    }
+    std::sort(paths.begin(), paths.end());
+    for (const auto& p : paths) {
+        NamedFrame nf;
+        nf.name = "corpus/" + p.filename().string();
+        if (LoadPpm(p.string(), nf.frame)) frames.push_back(std::move(nf));
+        else std::fprintf(stderr, "skipping %s (not a P6 maxval-255 PPM)\n", p.string().c_str());
+    }
+    return frames;
+}
+
+class Runner {
+public:
+    explicit Runner(const Options& options) : options_(options) {}
+
+    // fn runs one operation and returns the bytes it produced (0 if not meaningful).
+    void Run(const std::string& name, const std::string& params, uint64_t bytesIn, const std::function<uint64_t()>& fn) {
+        std::string full = name + "/" + params;
+        if (!options_.filter.empty() && full.find(options_.filter) == std::string::npos) return;
+        uint64_t bytesOut = fn(); // warm-up
+        uint64_t iterations = 0;
+        auto minTime = std::chrono::duration<double, std::milli>(options_.minTimeMs);
+        uint64_t batch = 1;
+        uint64_t allocsBefore = g_heapAllocations.load(std::memory_order_relaxed);
+        auto start = Clock::now();
+        Clock::duration elapsed{};
+        while (elapsed < minTime) {
+            for (uint64_t i = 0; i < batch; ++i) fn();
+            iterations += batch;
+            elapsed = Clock::now() - start;
+            if (elapsed < minTime / 10) batch *= 2;
+        }
+        uint64_t allocs = g_heapAllocations.load(std::memory_order_relaxed) - allocsBefore;
+        Result r;
+        r.name = name;
+        r.params = params;
+        r.iterations = iterations;
+        double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        r.nsPerOp = ns / (double)iterations;
+        r.mbPerSec = bytesIn ? ((double)bytesIn / (1024.0 * 1024.0)) / (r.nsPerOp / 1e9) : 0;
+        r.bytesOut = bytesOut;
+        r.allocsPerOp = (double)allocs / (double)iterations;
+        std::printf("%-20s %-32s %12.0f ns/op %9.1f MB/s %10llu B out %9.1f allocs/op\n", name.c_str(), params.c_str(),
+                    r.nsPerOp, r.mbPerSec, (unsigned long long)bytesOut, r.allocsPerOp);
+        std::fflush(stdout);
+        results_.push_back(std::move(r));
+    }
+
+    bool WriteJson(const std::string& path) const {
+        std::string out = "{\n  \"version\": 1,\n  \"compiler\": \"";
+        dwm::AppendJsonEscaped(out, CompilerName());
+        out += "\",\n  \"results\": [\n";
+        char buf[256];
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const Result& r = results_[i];
+            out += "    {\"name\": \"";
+            dwm::AppendJsonEscaped(out, r.name);
+            out += "\", \"params\": \"";
+            dwm::AppendJsonEscaped(out, r.params);
+            std::snprintf(buf, sizeof(buf), "\", \"iterations\": %llu, \"nsPerOp\": %.1f, \"mbPerSec\": %.2f, \"bytesOut\": %llu, \"allocsPerOp\": %.2f}",
+                          (unsigned long long)r.iterations, r.nsPerOp, r.mbPerSec, (unsigned long long)r.bytesOut, r.allocsPerOp);
+            out += buf;
+            out += i + 1 < results_.size() ? ",\n" : "\n";
+        }
+        out += "  ]\n}\n";
+        FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f) return false;
+        bool ok = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+        return std::fclose(f) == 0 && ok;
+    }
+
+private:
+    static std::string CompilerName() {
+#if defined(__clang__)
+        return std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+        return std::string("gcc ") + __VERSION__;
+#elif defined(_MSC_VER)
+        return "msvc " + std::to_string(_MSC_VER);
+#else
+        return "unknown";
+#endif
+    }
+
+    const Options& options_;
+    std::vector<Result> results_;
+};
+
+std::string Dims(const dwm::Frame& f) { return std::to_string(f.width) + "x" + std::to_string(f.height); }
+
+void BenchEncoding(Runner& run, const std::vector<NamedFrame>& frames) {
+    static const int kLevels[] = { 0, 1, 3, 6, 9 };
+    for (const NamedFrame& nf : frames) {
+        const dwm::Frame& f = nf.frame;
+        std::string base = nf.name + " " + Dims(f);
+        uint64_t inBytes = f.pixels.size();
+        for (int level : kLevels) {
+            run.Run("png", base + " level=" + std::to_string(level), inBytes, [&f, level] {
+                std::vector<uint8_t> png;
+                dwm::PngEncodeOptions o;
+                o.level = level;
+                dwm::EncodePng(f, o, png);
+                return (uint64_t)png.size();
+            });
+        }
+        static const struct { dwm::PngFilter filter; const char* name; } kFilters[] = {
+            { dwm::PngFilter::None, "none" }, { dwm::PngFilter::Sub, "sub" }, { dwm::PngFilter::Up, "up" },
+            { dwm::PngFilter::Paeth, "paeth" }, { dwm::PngFilter::Adaptive, "adaptive" },
+        };
+        for (const auto& fl : kFilters) {
+            run.Run("pngFilter", base + " filter=" + fl.name, inBytes, [&f, &fl] {
+                std::vector<uint8_t> scanlines;
+                dwm::BuildPngScanlines(f, fl.filter, scanlines);
+                return (uint64_t)scanlines.size();
+            });
+        }
+        // Typical thumbnail payload: level-6 PNG -> data URL
+        std::vector<uint8_t> png;
+        dwm::EncodePng(f, {}, png);
+        run.Run("base64", base + " png", png.size(), [&png] {
+            return (uint64_t)dwm::Base64DataUrl("image/png", png.data(), png.size()).size();
+        });
+    }
+}
+
+void BenchImage(Runner& run, const std::vector<NamedFrame>& frames) {
+    for (const NamedFrame& nf : frames) {
+        const dwm::Frame& f = nf.frame;
+        std::string base = nf.name + " " + Dims(f);
+        uint64_t inBytes = f.pixels.size();
+        static const int kTargets[][2] = { { 320, 240 }, { 160, 120 } };
+        for (const auto& t : kTargets) {
+            int w = 0, h = 0;
+            dwm::FitWithin(f.width, f.height, t[0], t[1], w, h);
+            run.Run("downscale", base + " -> " + std::to_string(w) + "x" + std::to_string(h), inBytes, [&f, w, h] {
+                dwm::Frame dst;
+                dwm::ResampleArea(f, w, h, dst);
+                return (uint64_t)dst.pixels.size();
+            });
+            run.Run("downscaleNearest", base + " -> " + std::to_string(w) + "x" + std::to_string(h), inBytes, [&f, w, h] {
+                dwm::Frame dst;
+                dwm::ResampleNearest(f, w, h, dst);
+                return (uint64_t)dst.pixels.size();
+            });
+        }
+        std::vector<uint8_t> rgb((size_t)f.width * f.height * 3);
+        run.Run("bgraToRgb", base, inBytes, [&f, &rgb] {
+            dwm::BgraToRgb(f.pixels.data(), rgb.data(), (size_t)f.width * f.height);
+            return (uint64_t)rgb.size();
+        });
+        run.Run("isUniform", base, inBytes, [&f] { g_sink = g_sink + dwm::IsUniform(f); return (uint64_t)0; });
+        run.Run("adler32", base, inBytes, [&f] { g_sink = g_sink + dwm::Adler32(1, f.pixels.data(), f.pixels.size()); return (uint64_t)0; });
+        run.Run("crc32", base, inBytes, [&f] { g_sink = g_sink + dwm::Crc32(0, f.pixels.data(), f.pixels.size()); return (uint64_t)0; });
+    }
+}
+
+void BenchCaches(Runner& run) {
+    using namespace std::chrono;
+    static const size_t kWindowCounts[] = { 16, 256, 4096 };
+    for (size_t windows : kWindowCounts) {
+        std::string p = "windows=" + std::to_string(windows);
+        dwm::NegativeCache cache;
+        auto now = dwm::NegativeCache::Clock::now();
+        for (size_t i = 0; i < windows; ++i) cache.RecordFailure({ 0x10000 + i * 8, (uint32_t)i, (int)(i % 6) }, now);
+        uint64_t i = 0;
+        run.Run("negativeCache", "lookup " + p, 0, [&] {
+            size_t w = (size_t)(i++ % (windows * 2)); // half hits, half misses
+            g_sink = g_sink + cache.IsBackingOff({ 0x10000 + w * 8, (uint32_t)w, (int)(w % 6) }, now);
+            return (uint64_t)0;
+        });
+        run.Run("negativeCache", "failure+success " + p, 0, [&] {
+            dwm::NegativeCacheKey k{ 0x10000 + (size_t)(i++ % windows) * 8, 0, 0 };
+            cache.RecordFailure(k, now);
+            cache.RecordSuccess(k);
+            return (uint64_t)0;
+        });
+        run.Run("negativeCache", "snapshot " + p, 0, [&] { g_sink = g_sink + cache.Snapshot(now).size(); return (uint64_t)0; });
+    }
+    dwm::LatencyHistogram hist;
+    Rng rng(7);
+    run.Run("latencyHistogram", "record", 0, [&] {
+        hist.RecordUs(rng.Next() % 200000);
+        return (uint64_t)0;
+    });
+    run.Run("latencyHistogram", "p90", 0, [&] { g_sink = g_sink + hist.PercentileUs(90); return (uint64_t)0; });
+}
+
+// Window strings on their way to JS. Before: UTF-16 from Win32 encoded to
+// UTF-8, then decoded back by the engine (napi_create_string_utf8). After: the
+// UTF-16 is handed over as is (napi_create_string_utf16 copies it). Plus the
+// transcoders themselves, scalar vs SSE2 ASCII fast path.
+void BenchStrings(Runner& run) {
+    struct Sample { const char* name; std::u16string text; };
+    const Sample samples[] = {
+        { "exe path", u"C:\\Program Files\\Google\\Chrome\\Application\\chrome.exe" },
+        { "ascii title", u"dwm-windows - Visual Studio Code - README.md [Administrator]" },
+        { "german title", u"Übersicht – Straße und Größe der Fenster – Datei-Explorer" },
+        { "cjk title", u"文件资源管理器 - 下载 - 新建文本文档.txt" },
+    };
+    for (const Sample& s : samples) {
+        uint64_t bytesIn = s.text.size() * sizeof(char16_t);
+        std::string utf8;
+        std::u16string utf16;
+        run.Run("utf16", std::string("to JS via UTF-8, ") + s.name, bytesIn, [&] {
+            utf8.clear();
+            dwm::AppendUtf8Scalar(s.text.data(), s.text.size(), utf8);
+            utf16.clear();
+            dwm::AppendUtf16Scalar(utf8.data(), utf8.size(), utf16);
+            return (uint64_t)utf16.size();
+        });
+        run.Run("utf16", std::string("to JS as UTF-16, ") + s.name, bytesIn, [&] {
+            utf16.assign(s.text);
+            return (uint64_t)utf16.size();
+        });
+        run.Run("utf16", std::string("to UTF-8 scalar, ") + s.name, bytesIn, [&] {
+            utf8.clear();
+            dwm::AppendUtf8Scalar(s.text.data(), s.text.size(), utf8);
+            return (uint64_t)utf8.size();
+        });
+        run.Run("utf16", std::string("to UTF-8 simd, ") + s.name, bytesIn, [&] {
+            utf8.clear();
+            dwm::AppendUtf8(s.text.data(), s.text.size(), utf8);
+            return (uint64_t)utf8.size();
+        });
+        std::string source = dwm::Utf16ToUtf8(s.text);
+        run.Run("utf16", std::string("from UTF-8 scalar, ") + s.name, source.size(), [&] {
+            utf16.clear();
+            dwm::AppendUtf16Scalar(source.data(), source.size(), utf16);
+            return (uint64_t)utf16.size();
+        });
+        run.Run("utf16", std::string("from UTF-8 simd, ") + s.name, source.size(), [&] {
+            utf16.clear();
+            dwm::AppendUtf16(source.data(), source.size(), utf16);
+            return (uint64_t)utf16.size();
+        });
+    }
+}
+
+// Thumbnail-sized PNGs (every frame area-downscaled to fit 320x240, as the
+// capture pipeline does) at level 1: 24-bit RGB against
+// codec.palette with and without dithering. Prints the sizes side by side.
+void BenchPalette(Runner& run, const std::vector<NamedFrame>& frames) {
+    for (const NamedFrame& nf : frames) {
+        int w = 0, h = 0;
+        dwm::FitWithin(nf.frame.width, nf.frame.height, 320, 240, w, h);
+        dwm::Frame f;
+        dwm::ResampleArea(nf.frame, w, h, f);
+        std::string base = nf.name + " " + Dims(nf.frame) + " -> " + Dims(f);
+        uint64_t inBytes = f.pixels.size();
+        static const struct { bool palette, dither; const char* name; } kModes[] = {
+            { false, false, "rgb" }, { true, false, "palette" }, { true, true, "palette+dither" },
+        };
+        uint64_t sizes[3] = {};
+        for (size_t m = 0; m < 3; ++m) {
+            run.Run("pngPalette", base + " " + kModes[m].name, inBytes, [&f, m, &sizes] {
+                std::vector<uint8_t> png;
+                dwm::PngEncodeOptions o;
+                o.level = 1;
+                o.palette = kModes[m].palette;
+                o.dither = kModes[m].dither;
+                dwm::EncodePng(f, o, png);
+                sizes[m] = png.size();
+                return (uint64_t)png.size();
+            });
+        }
+        if (sizes[0]) {
+            std::printf("  %s: rgb %llu B, palette %llu B (%.0f%%), dithered %llu B (%.0f%%)\n", base.c_str(),
+                        (unsigned long long)sizes[0], (unsigned long long)sizes[1], 100.0 * sizes[1] / sizes[0],
+                        (unsigned long long)sizes[2], 100.0 * sizes[2] / sizes[0]);
+        }
+    }
+}
+
+// Progressive thumbnails: from one full-window capture to the default 200x150
+// box, the preview (nearest-neighbour, PNG level 0 with no row filter) against
+// the final image (area-averaged, level 1 with adaptive
+// filters), each through base64 as the addon delivers them.
+void BenchProgressive(Runner& run) {
+    const NamedFrame frames[] = { { "ui", MakeUiFrame(1920, 1080, 9) }, { "photo", MakePhotoFrame(1920, 1080, 10) } };
+    for (const NamedFrame& nf : frames) {
+        const dwm::Frame& f = nf.frame;
+        int w = 0, h = 0;
+        dwm::FitWithin(f.width, f.height, 200, 150, w, h);
+        std::string base = nf.name + " " + Dims(f) + " -> " + std::to_string(w) + "x" + std::to_string(h);
+        uint64_t inBytes = f.pixels.size();
+        static const struct { bool nearest; int level; dwm::PngFilter filter; const char* name; } kStages[] = {
+            { true, 0, dwm::PngFilter::None, "preview" },
+            { true, 1, dwm::PngFilter::None, "preview level=1" },
+            { false, 1, dwm::PngFilter::Adaptive, "final" },
+        };
+        for (const auto& s : kStages) {
+            run.Run("progressive", base + " " + s.name, inBytes, [&f, w, h, &s] {
+                dwm::Frame small;
+                if (s.nearest) dwm::ResampleNearest(f, w, h, small);
+                else dwm::ResampleArea(f, w, h, small);
+                std::vector<uint8_t> png;
+                dwm::PngEncodeOptions o;
+                o.level = s.level;
+                o.filter = s.filter;
+                dwm::EncodePng(small, o, png);
+                return (uint64_t)dwm::Base64DataUrl("image/png", png.data(), png.size()).size();
+            });
+        }
+    }
+}
+
+// Full-screen PNGs deflated on 1-8 threads (parallel_deflate.h, 128 KiB
+// chunks), as a full-screen overview or captureToFile band would be. Speedup
+// is bounded by the cores the machine has (printed); the size cost of the
+// chunk cuts is printed against the single-threaded stream.
+void BenchParallelDeflate(Runner& run) {
+    std::printf("  hardware threads: %u\n", std::thread::hardware_concurrency());
+    const NamedFrame frames[] = { { "ui", MakeUiFrame(2560, 1440, 7) }, { "photo", MakePhotoFrame(2560, 1440, 8) } };
+    for (const NamedFrame& nf : frames) {
+        const dwm::Frame& f = nf.frame;
+        uint64_t inBytes = f.pixels.size();
+        for (int level : { 1, 6 }) {
+            std::string base = nf.name + " " + Dims(f) + " level=" + std::to_string(level);
+            uint64_t serialBytes = 0;
+            for (size_t threads : { 1, 2, 4, 8 }) {
+                uint64_t bytes = 0;
+                run.Run("pngParallel", base + " threads=" + std::to_string(threads), inBytes, [&f, level, threads, &bytes] {
+                    std::vector<uint8_t> png;
+                    dwm::PngEncodeOptions o;
+                    o.level = level;
+                    o.parallel.threads = threads;
+                    o.parallel.minBytes = 0;
+                    dwm::EncodePng(f, o, png);
+                    bytes = png.size();
+                    return (uint64_t)png.size();
+                });
+                if (threads == 1) serialBytes = bytes;
+                else if (serialBytes && bytes) std::printf("  threads=%zu: %+.2f%% bytes\n", threads, 100.0 * ((double)bytes / serialBytes - 1));
+            }
+        }
+    }
+}
+
+// A thumbnail handed to another process. Today: PNG + base64 (then copied into
+// V8, sent over IPC and decoded). Shared frames: one copy into the ring, read in
+// place or copied out by the consumer. The last run keeps a reader copying the
+// latest frame on another thread and aborts if a copy that validated is torn.
+// Full-resolution capture to a file: the whole PNG in memory (EncodePng, what
+// a data URL needs) against PngStreamEncoder fed 64-row bands, as
+// captureToFile does. Prints the encoder buffers each keeps.
+void BenchPngStream(Runner& run) {
+    dwm::Frame f = MakeUiFrame(2560, 1440, 6);
+    std::string base = "ui " + Dims(f);
+    uint64_t inBytes = f.pixels.size();
+    size_t wholeBytes = (size_t)f.height * ((size_t)f.width * 3 + 1); // EncodePng's scanline buffer alone
+    run.Run("pngWhole", base, inBytes, [&f] {
+        std::vector<uint8_t> png;
+        dwm::EncodePng(f, {}, png);
+        return (uint64_t)png.size();
+    });
+    static const size_t kBands[] = { 64 * 1024, 256 * 1024, 1024 * 1024 };
+    for (size_t band : kBands) {
+        size_t peak = 0;
+        run.Run("pngStream", base + " band=" + std::to_string(band >> 10) + "K", inBytes, [&f, band, &peak] {
+            dwm::PngStreamEncoder encoder(band);
+            uint64_t written = 0;
+            encoder.Begin(f.width, f.height, {}, [&written](const uint8_t*, size_t n) { written += n; return true; });
+            for (int y = 0; y < f.height; y += 64) {
+                encoder.AddRows(f.pixels.data() + (size_t)y * f.Stride(), f.Stride(), std::min(64, f.height - y));
+            }
+            encoder.Finish();
+            peak = encoder.PeakBufferedBytes();
+            return written;
+        });
+        if (peak) std::printf("  band=%zuK keeps %zu KiB of encoder buffers, EncodePng over %zu KiB\n", band >> 10, peak >> 10, wholeBytes >> 10);
+    }
+}
+
+void BenchSharedFrames(Runner& run) {
+    const int w = 200, h = 150;
+    dwm::Frame frame = MakeUiFrame(w, h, 5);
+    std::string p = std::to_string(w) + "x" + std::to_string(h) + " ui";
+    uint64_t bytesIn = frame.pixels.size();
+
+    const uint32_t slots = 64;
+    dwm::SharedMemory memory;
+    std::string error;
+    std::string name = "dwm-bench-frames-" + std::to_string(Clock::now().time_since_epoch().count());
+    if (!memory.Create(name, dwm::FrameRingBytes(slots, bytesIn), &error)) {
+        std::fprintf(stderr, "sharedFrames skipped: %s\n", error.c_str());
+        return;
+    }
+    dwm::FrameRingWriter writer;
+    writer.Initialize(memory.Data(), memory.Size(), slots, bytesIn);
+    dwm::FrameRingReader reader;
+    reader.Attach(memory.Data(), memory.Size());
+
+    std::vector<uint8_t> png;
+    run.Run("sharedFrames", "png level 1 + base64, " + p, bytesIn, [&] {
+        dwm::PngEncodeOptions options;
+        options.level = 1;
+        dwm::EncodePng(frame, options, png);
+        return (uint64_t)dwm::Base64DataUrl("image/png", png.data(), png.size()).size();
+    });
+    dwm::FrameHandle last;
+    run.Run("sharedFrames", "ring write, " + p, bytesIn, [&] {
+        last = writer.Write(frame, 1, 0);
+        return (uint64_t)bytesIn;
+    });
+    run.Run("sharedFrames", "ring read in place + validate, " + p, bytesIn, [&] {
+        dwm::FrameView view;
+        uint64_t sum = 0;
+        if (reader.Acquire(last, view)) {
+            for (size_t i = 0; i < (size_t)view.stride * view.height; i += 64) sum += view.pixels[i];
+        }
+        g_sink = g_sink + sum + reader.Validate(last);
+        return (uint64_t)0;
+    });
+    dwm::Frame copy;
+    run.Run("sharedFrames", "ring read copy, " + p, bytesIn, [&] {
+        reader.Copy(last, copy);
+        return (uint64_t)copy.pixels.size();
+    });
+
+    // Every byte of frame n is (uint8_t)n from here on, so a torn copy shows up as mixed bytes
+    std::vector<uint8_t> pixels(bytesIn);
+    uint64_t next = last.sequence + 1;
+    std::memset(pixels.data(), (uint8_t)next++, pixels.size());
+    writer.Write(pixels.data(), w, h, w * 4, 1, 0);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> good{0}, refused{0};
+    std::thread consumer([&] {
+        dwm::Frame f;
+        while (!stop.load(std::memory_order_relaxed)) {
+            dwm::FrameHandle latest = reader.Latest();
+            if (!reader.Copy(latest, f)) { refused++; continue; }
+            for (uint8_t b : f.pixels) {
+                if (b != (uint8_t)latest.sequence) {
+                    std::fprintf(stderr, "sharedFrames: torn frame %llu passed validation\n", (unsigned long long)latest.sequence);
+                    std::abort();
+                }
+            }
+            good++;
+        }
+    });
+    run.Run("sharedFrames", "ring write with a concurrent reader, " + p, bytesIn, [&] {
+        std::memset(pixels.data(), (uint8_t)next++, pixels.size());
+        writer.Write(pixels.data(), w, h, w * 4, 1, 0);
+        return (uint64_t)bytesIn;
+    });
+    stop = true;
+    consumer.join();
+    std::printf("  concurrent reader: %llu consistent copies, %llu refused (overwritten while reading)\n",
+                (unsigned long long)good.load(), (unsigned long long)refused.load());
+}
+
+// Window logic over the synthetic desktop: what one getWindows enumeration and
+// one fallback-poller tick cost apart from the OS calls.
+void BenchWindowSystem(Runner& run) {
+    static const size_t kWindowCounts[] = { 50, 500 };
+    for (size_t windows : kWindowCounts) {
+        std::string p = "windows=" + std::to_string(windows);
+        dwm::SyntheticDesktopConfig config;
+        config.windows = windows;
+        dwm::SyntheticWindowSystem ws(config);
+        std::vector<dwm::WindowId> ids;
+        dwm::WindowAttributes attrs;
+        run.Run("windowFilter", "enumerate+filter " + p, 0, [&] {
+            ws.EnumerateTopLevel(ids);
+            uint64_t listed = 0;
+            for (dwm::WindowId id : ids) {
+                if (!ws.GetAttributes(id, attrs) || !dwm::IsAltTabCandidate(attrs)) continue;
+                if (!ws.IsOnCurrentDesktop(id) || dwm::DisplayTitle(attrs).empty()) continue;
+                listed++;
+            }
+            g_sink = g_sink + listed;
+            return (uint64_t)0;
+        });
+
+        // One getWindows enumeration as the addon does it: attributes per
+        // window, listed windows copied out. Before: fresh heap-backed
+        // attributes per window. After: one scratch in a per-call arena, and
+        // path and class interned instead of copied per listed window.
+        struct Listed { dwm::WindowId id; std::u16string title; std::u16string executablePath; };
+        std::vector<Listed> listed;
+        run.Run("enumerationAllocs", "per-window heap attrs " + p, 0, [&] {
+            listed.clear();
+            ws.EnumerateTopLevel(ids);
+            for (dwm::WindowId id : ids) {
+                dwm::WindowAttributes a;
+                if (!ws.GetAttributes(id, a) || !dwm::IsAltTabCandidate(a) || !ws.IsOnCurrentDesktop(id)) continue;
+                std::u16string title = dwm::DisplayTitle(a);
+                if (title.empty()) continue;
+                listed.push_back({ id, std::move(title), std::u16string(a.executablePath) });
+            }
+            return (uint64_t)listed.size();
+        });
+        run.Run("enumerationAllocs", "arena scratch " + p, 0, [&] {
+            listed.clear();
+            dwm::EnumerationArena arena;
+            dwm::WindowAttributes scratch(arena.Resource());
+            ws.EnumerateTopLevel(ids);
+            for (dwm::WindowId id : ids) {
+                if (!ws.GetAttributes(id, scratch) || !dwm::IsAltTabCandidate(scratch) || !ws.IsOnCurrentDesktop(id)) continue;
+                std::u16string title = dwm::DisplayTitle(scratch);
+                if (title.empty()) continue;
+                listed.push_back({ id, std::move(title), std::u16string(scratch.executablePath) });
+            }
+            return (uint64_t)listed.size();
+        });
+        struct ListedInterned { dwm::WindowId id; std::u16string title; dwm::StringId executablePathId, classNameId; };
+        std::vector<ListedInterned> listedInterned;
+        dwm::StringTable strings;
+        run.Run("enumerationAllocs", "arena scratch + interned " + p, 0, [&] {
+            listedInterned.clear();
+            dwm::EnumerationArena arena;
+            dwm::WindowAttributes scratch(arena.Resource());
+            ws.EnumerateTopLevel(ids);
+            for (dwm::WindowId id : ids) {
+                if (!ws.GetAttributes(id, scratch) || !dwm::IsAltTabCandidate(scratch) || !ws.IsOnCurrentDesktop(id)) continue;
+                std::u16string title = dwm::DisplayTitle(scratch);
+                if (title.empty()) continue;
+                listedInterned.push_back({ id, std::move(title), strings.Intern(scratch.executablePath), strings.Intern(scratch.className) });
+            }
+            return (uint64_t)listedInterned.size();
+        });
+
+        dwm::WindowEventTracker tracker;
+        std::vector<dwm::WindowSnapshotEntry> snapshot;
+        std::vector<dwm::WindowEvent> events;
+        run.Run("windowEventTracker", "poll tick, 1% churn " + p, 0, [&] {
+            ws.EventStorm(std::max<size_t>(1, windows / 100));
+            ws.EnumerateTopLevel(ids);
+            snapshot.clear();
+            for (dwm::WindowId id : ids) {
+                if (ws.GetAttributes(id, attrs)) snapshot.push_back({ id, attrs.minimized });
+            }
+            tracker.Update(ws.Foreground(), snapshot, true, events);
+            g_sink = g_sink + events.size();
+            return (uint64_t)0;
+        });
+    }
+    dwm::SyntheticWindowSystem ws;
+    std::vector<dwm::WindowId> ids;
+    ws.EnumerateTopLevel(ids);
+    run.Run("syntheticCapture", "fit 320x240", 0, [&] {
+        dwm::Frame frame;
+        ws.Capture(ids.front(), 320, 240, frame);
+        return (uint64_t)frame.pixels.size();
+    });
+}
+
+int Usage() {
+    std::fprintf(stderr, "usage: dwm_bench [--json out.json] [--filter substr] [--min-time ms] [--corpus dir]\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* v = nullptr;
+        if (a == "--json" && (v = value())) options.jsonPath = v;
+        else if (a == "--filter" && (v = value())) options.filter = v;
+        else if (a == "--min-time" && (v = value())) options.minTimeMs = std::atof(v);
+        else if (a == "--corpus" && (v = value())) options.corpusDir = v;
+        else return Usage();
+    }
+    if (options.minTimeMs <= 0) return Usage();
+
+    std::vector<NamedFrame> frames;
+    frames.push_back({ "ui", MakeUiFrame(1280, 800, 1) });
+    frames.push_back({ "ui", MakeUiFrame(320, 200, 2) });
+    frames.push_back({ "photo", MakePhotoFrame(1280, 800, 3) });
+    frames.push_back({ "noise", MakeNoiseFrame(320, 200, 4) });
+    std::vector<NamedFrame> corpus = LoadCorpus(options.corpusDir);
+    for (auto& nf : corpus) frames.push_back(std::move(nf));
+
+    Runner run(options);
+    BenchEncoding(run, frames);
+    BenchImage(run, frames);
+    BenchPalette(run, frames);
+    BenchProgressive(run);
+    BenchCaches(run);
+    BenchStrings(run);
+    BenchPngStream(run);
+    BenchParallelDeflate(run);
+    BenchSharedFrames(run);
+    BenchWindowSystem(run);
+
+    if (!options.jsonPath.empty() && !run.WriteJson(options.jsonPath)) {
+        std::fprintf(stderr, "cannot write %s\n", options.jsonPath.c_str());
+        return 1;
+    }
+    return 0;
+}
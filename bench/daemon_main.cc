@@ -0,0 +1,362 @@
+// End-to-end check of the thumbnail daemon (daemon_server.h, daemon_client.h)
+// over a real Unix domain socket with SyntheticWindowSystem as the desktop:
+// concurrent clients list windows and fetch thumbnails, string ids resolve
+// through the client's table, every subscriber sees every event in publish
+// order, a client that stops reading only loses its own events (and is told
+// how many), a client sending garbage is disconnected without affecting the
+// others, a client that floods requests without reading is paused at its
+// limits and still gets every reply, and a second daemon cannot take over a
+// live socket. Also checks that the string table frees strings unused for a
+// generation. Reports request
+// latency and how many captures the shared cache saved. Exits non-zero on
+// the first failed check.
+//
+//   dwm_daemon_check [--windows N] [--clients N] [--thumbs N] [--events N]
+//                    [--capture-latency-us us]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../daemon_client.h"
+#include "../daemon_server.h"
+#include "../latency_histogram.h"
+#include "../synthetic_window_system.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+#define CHECK(cond)                                                               \
+    do {                                                                          \
+        if (!(cond)) {                                                            \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1);                                                         \
+        }                                                                         \
+    } while (0)
+
+struct Options {
+    size_t windows{100};
+    size_t clients{4};
+    size_t thumbs{200};   // per client
+    size_t events{20000}; // storm size; large enough to overflow a stalled client
+    long captureLatencyUs{1000};
+};
+
+using EventLog = std::vector<std::pair<dwm::WindowEventType, dwm::WindowId>>;
+
+struct Subscriber {
+    dwm::DaemonClient client;
+    std::mutex mutex;
+    EventLog events;
+    uint32_t dropped{0};
+    size_t unresolved{0}; // events whose class name id was not known when they arrived
+};
+
+// xorshift64*, same as dwm_bench
+struct Rng {
+    uint64_t s;
+    explicit Rng(uint64_t seed) : s(seed ? seed : 1) {}
+    uint64_t Next() { s ^= s >> 12; s ^= s << 25; s ^= s >> 27; return s * 2685821657736338717ull; }
+};
+
+bool WaitFor(const std::function<bool()>& done, std::chrono::seconds limit) {
+    auto end = Clock::now() + limit;
+    while (!done()) {
+        if (Clock::now() > end) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+// A string interned in a generation survives the next sweep; one not interned
+// again by the sweep after is freed, reads as "" and comes back under a new id
+void CheckStringSweep() {
+    dwm::StringTable table;
+    dwm::StringId kept = table.Intern(u"C:\\app.exe");
+    dwm::StringId gone = table.Intern(u"HwndWrapper[app;;0c7e6e8b]");
+    CHECK(table.Sweep().empty());
+    CHECK(table.Intern(u"C:\\app.exe") == kept);
+    CHECK(table.Sweep().empty());
+    std::vector<dwm::StringId> freed = table.Sweep();
+    CHECK(freed.size() == 1 && freed[0] == gone && table.Live() == 1 && table.Sweeps() == 1);
+    freed = table.Sweep();
+    CHECK(freed.size() == 1 && freed[0] == kept && table.Live() == 0 && table.Sweeps() == 2);
+    dwm::StringId again = table.Intern(u"C:\\app.exe");
+    CHECK(again == table.Size() - 1 && again > gone && table.Get(gone).empty());
+    std::vector<std::u16string> range;
+    table.Range(0, table.Size(), range);
+    CHECK(range.size() == 4 && range[kept].empty() && range[gone].empty() && range[again] == u"C:\\app.exe");
+}
+
+void PrintLatency(const char* name, const dwm::LatencyHistogram& h) {
+    std::printf("%-10s n=%-6llu p50=%6llu us  p99=%6llu us  max=%6llu us\n", name, (unsigned long long)h.Count(),
+                (unsigned long long)h.PercentileUs(50), (unsigned long long)h.PercentileUs(99), (unsigned long long)h.MaxUs());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string a = argv[i];
+        long v = std::atol(argv[i + 1]);
+        if (a == "--windows") o.windows = (size_t)v;
+        else if (a == "--clients") o.clients = (size_t)v;
+        else if (a == "--thumbs") o.thumbs = (size_t)v;
+        else if (a == "--events") o.events = (size_t)v;
+        else if (a == "--capture-latency-us") o.captureLatencyUs = v;
+        else { std::fprintf(stderr, "unknown option %s\n", a.c_str()); return 2; }
+    }
+    CheckStringSweep();
+
+    dwm::SyntheticDesktopConfig desktop;
+    desktop.windows = o.windows;
+    desktop.captureLatency = std::chrono::microseconds(o.captureLatencyUs);
+    dwm::SyntheticWindowSystem system(desktop);
+    dwm::WindowSystemBackend backend(system);
+    dwm::DaemonServerOptions serverOptions;
+    serverOptions.outboxLimitBytes = 64 << 10;
+    serverOptions.eventQueueCapacity = o.events + 16; // the storm itself must not overflow the queue
+    serverOptions.processId = (uint32_t)getpid();
+    dwm::DaemonServer server(backend, serverOptions);
+
+    std::string path = "/tmp/dwm-daemon-check-" + std::to_string(getpid()) + ".sock";
+    std::string error;
+    CHECK(server.Start(path, &error));
+    {
+        dwm::DaemonServer second(backend);
+        CHECK(!second.Start(path, &error));
+        std::printf("second daemon refused: %s\n", error.c_str());
+    }
+
+    // Reference listing straight from the backend
+    std::vector<dwm::DaemonWindow> expected;
+    backend.ListWindows(dwm::DaemonListRequest{ false, false, false, 0, 0 }, expected);
+    CHECK(!expected.empty());
+
+    // ---- Concurrent listing and thumbnails ----
+    dwm::LatencyHistogram listLatency, thumbLatency;
+    uint64_t capturesBefore = system.Captures();
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < o.clients; ++c) {
+        threads.emplace_back([&, c] {
+            dwm::DaemonClient client;
+            std::string e;
+            CHECK(client.Connect(path, &e));
+            CHECK(client.DaemonProcessId() == (uint32_t)getpid());
+            std::vector<dwm::DaemonWindow> windows;
+            auto t0 = Clock::now();
+            CHECK(client.ListWindows(dwm::DaemonListRequest{}, windows, &e));
+            listLatency.Record(Clock::now() - t0);
+            CHECK(windows.size() == expected.size());
+            for (size_t i = 0; i < windows.size(); ++i) {
+                dwm::WindowAttributes a;
+                CHECK(windows[i].id == expected[i].id && windows[i].title == expected[i].title);
+                CHECK(system.GetAttributes(windows[i].id, a));
+                CHECK(client.String(windows[i].executablePathId) == std::u16string(a.executablePath));
+                CHECK(client.String(windows[i].classNameId) == std::u16string(a.className));
+                CHECK(windows[i].icon.rfind("data:image/png;base64,", 0) == 0);
+            }
+            Rng rng(c + 1);
+            for (size_t i = 0; i < o.thumbs; ++i) {
+                const dwm::DaemonWindow& w = windows[rng.Next() % windows.size()];
+                std::string url;
+                t0 = Clock::now();
+                CHECK(client.Thumbnail(w.id, 200, 150, url, &e));
+                thumbLatency.Record(Clock::now() - t0);
+                CHECK(url.empty() || url.rfind("data:image/png;base64,", 0) == 0);
+            }
+        });
+    }
+    for (std::thread& t : threads) t.join();
+    threads.clear();
+    uint64_t captures = system.Captures() - capturesBefore;
+    size_t asked = o.clients * (expected.size() + o.thumbs);
+    std::printf("%zu clients: %zu thumbnails asked, %llu captured (shared cache)\n", o.clients, asked, (unsigned long long)captures);
+    PrintLatency("list", listLatency);
+    PrintLatency("thumbnail", thumbLatency);
+
+    // ---- A client that floods requests and never reads is paused, not buffered ----
+    {
+        size_t largest = 0; // largest thumbnail reply the flood can cause
+        for (const dwm::DaemonWindow& w : expected) {
+            for (uint16_t dw = 0; dw < 7; ++dw) largest = std::max(largest, backend.Thumbnail(w.id, 200 + dw, 150).size());
+        }
+        const size_t kThumbnails = 600, kStrings = 200;
+        std::string requests;
+        uint32_t requestId = 1;
+        for (size_t i = 0; i < kThumbnails; ++i) {
+            // Sizes vary so most requests miss the cache and hold a worker
+            dwm::EncodeThumbnailRequest(requests, requestId++, expected[i % expected.size()].id, (uint16_t)(200 + i % 7), 150);
+            if (i % 3 == 0) dwm::EncodeGetStrings(requests, requestId++, 0); // answered on the loop thread
+        }
+        CHECK(requestId - 1 == kThumbnails + kStrings);
+        dwm::LocalSocket flood;
+        CHECK(flood.Connect(path, &error));
+        uint64_t pausesBefore = server.Stats().readPauses;
+        std::thread sender([&] { CHECK(flood.SendAll(requests)); }); // may block once the daemon stops reading
+        CHECK(WaitFor([&] { return server.Stats().readPauses > pausesBefore; }, std::chrono::seconds(10)));
+
+        // Other clients are still served while it is paused
+        dwm::DaemonClient other;
+        CHECK(other.Connect(path, &error));
+        std::vector<dwm::DaemonWindow> listed;
+        CHECK(other.ListWindows(dwm::DaemonListRequest{ false, false, false, 0, 0 }, listed, &error));
+        CHECK(listed.size() == expected.size());
+
+        // Nothing was dropped: every request gets its reply once the client reads
+        dwm::DaemonStreamReader replies;
+        std::vector<char> chunk(64 * 1024);
+        size_t thumbnails = 0, strings = 0;
+        while (thumbnails + strings < kThumbnails + kStrings) {
+            size_t n = 0;
+            CHECK(flood.Receive(chunk.data(), chunk.size(), n) == dwm::IoResult::Done);
+            replies.Append(chunk.data(), n);
+            dwm::DaemonFrame frame;
+            while (replies.Next(frame)) {
+                CHECK(frame.type == dwm::DaemonMessage::Thumbnail || frame.type == dwm::DaemonMessage::Strings);
+                (frame.type == dwm::DaemonMessage::Thumbnail ? thumbnails : strings)++;
+            }
+        }
+        sender.join();
+        CHECK(thumbnails == kThumbnails && strings == kStrings);
+
+        // Its outbox never held more than the limit plus one reply per request in flight
+        dwm::DaemonServerStats s = server.Stats();
+        size_t bound = serverOptions.outboxLimitBytes + (serverOptions.maxInFlightPerClient + 1) * (largest + 4096);
+        std::printf("flooding client: %llu read pauses, outbox peaked at %zu bytes (bound %zu)\n",
+                    (unsigned long long)(s.readPauses - pausesBefore), s.peakOutboxBytes, bound);
+        CHECK(s.peakOutboxBytes <= bound);
+    }
+
+    // ---- Events: in order for every subscriber, bounded for a stalled one ----
+    std::vector<std::unique_ptr<Subscriber>> subscribers;
+    for (size_t c = 0; c < o.clients; ++c) {
+        auto s = std::make_unique<Subscriber>();
+        CHECK(s->client.Connect(path, &error));
+        Subscriber* raw = s.get();
+        CHECK(s->client.Subscribe(dwm::kAllWindowEvents, [raw](dwm::WindowEventType type, const dwm::DaemonWindow& w, uint32_t dropped) {
+            std::lock_guard<std::mutex> lock(raw->mutex);
+            if (dropped) raw->dropped += dropped;
+            else raw->events.emplace_back(type, w.id);
+            if (w.classNameId && raw->client.String(w.classNameId).empty()) raw->unresolved++;
+        }, &error));
+        subscribers.push_back(std::move(s));
+    }
+    // Subscribes, then never reads again
+    dwm::LocalSocket stalled;
+    CHECK(stalled.Connect(path, &error));
+    std::string subscribe;
+    dwm::EncodeSubscribe(subscribe, 1, dwm::kAllWindowEvents);
+    CHECK(stalled.SendAll(subscribe));
+    CHECK(WaitFor([&] { return server.ClientCount() == o.clients + 1; }, std::chrono::seconds(5)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50)); // let the Subscribe land
+
+    EventLog published;
+    system.SetEventSink([&](const dwm::WindowEvent& e) {
+        published.emplace_back(e.type, e.window);
+        server.Publish(e.type, e.window);
+    });
+    // In bursts that fit a reading client's outbox, so only the stalled one falls behind
+    auto caughtUp = [&] {
+        for (auto& s : subscribers) {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            if (s->dropped || s->events.size() < published.size()) return s->dropped != 0;
+        }
+        return true;
+    };
+    auto t0 = Clock::now();
+    bool delivered = true;
+    for (size_t sent = 0; sent < o.events && delivered; sent += 256) {
+        system.EventStorm(std::min<size_t>(256, o.events - sent));
+        delivered = WaitFor(caughtUp, std::chrono::seconds(10));
+    }
+    double stormMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    system.SetEventSink(nullptr);
+    CHECK(delivered);
+    for (auto& s : subscribers) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        CHECK(s->dropped == 0 && s->events == published && s->unresolved == 0);
+    }
+    dwm::DaemonServerStats stats = server.Stats();
+    std::printf("%zu events to %zu subscribers in %.1f ms, in order; stalled client dropped %llu\n", published.size(),
+                o.clients, stormMs, (unsigned long long)stats.eventsDropped);
+    CHECK(stats.eventsDropped > 0);
+
+    // The stalled client, once it reads, learns how many events it lost
+    dwm::DaemonStreamReader stream;
+    std::vector<char> buffer(64 * 1024);
+    uint64_t eventsSeen = 0, droppedReported = 0;
+    bool reportedDrop = false;
+    while (!reportedDrop) {
+        size_t n = 0;
+        CHECK(stalled.Receive(buffer.data(), buffer.size(), n) == dwm::IoResult::Done);
+        stream.Append(buffer.data(), n);
+        dwm::DaemonFrame frame;
+        while (stream.Next(frame)) {
+            if (frame.type == dwm::DaemonMessage::Event) eventsSeen++;
+            if (frame.type == dwm::DaemonMessage::EventsDropped) {
+                dwm::DaemonReader in(frame.payload.data(), frame.payload.size());
+                droppedReported = in.U32();
+                reportedDrop = true;
+            }
+        }
+        // The report rides on the next event delivered to it
+        if (!reportedDrop) server.Publish(dwm::WindowEventType::Focused, expected[0].id);
+    }
+    std::printf("stalled client: %llu events before the gap, told %llu were dropped\n", (unsigned long long)eventsSeen,
+                (unsigned long long)droppedReported);
+    CHECK(droppedReported >= stats.eventsDropped); // only the stalled client dropped
+
+    // ---- Resubscribing returns only once a running call of the old callback has,
+    // even if the reply times out meanwhile ----
+    {
+        std::atomic<bool> running{false}, released{false};
+        std::atomic<int> calls{0}, lateCalls{0};
+        CHECK(subscribers[0]->client.Subscribe(dwm::kAllWindowEvents, [&](dwm::WindowEventType, const dwm::DaemonWindow&, uint32_t) {
+            if (calls++) return;
+            running = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (released) lateCalls++;
+            running = false;
+        }, &error));
+        server.Publish(dwm::WindowEventType::Focused, expected[0].id);
+        CHECK(WaitFor([&] { return running.load(); }, std::chrono::seconds(5)));
+        subscribers[0]->client.SetTimeout(std::chrono::milliseconds(10));
+        subscribers[0]->client.Subscribe(0, nullptr, &error);
+        released = true; // what the old callback used may be freed now
+        CHECK(!running && calls == 1);
+        subscribers[0]->client.SetTimeout(std::chrono::milliseconds(10000));
+        server.Publish(dwm::WindowEventType::Focused, expected[0].id);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        CHECK(calls == 1 && lateCalls == 0);
+    }
+
+    // ---- A client sending garbage is cut off; the others keep working ----
+    dwm::LocalSocket bad;
+    CHECK(bad.Connect(path, &error));
+    CHECK(bad.SendAll(std::string("\xff\xff\xff\x7f garbage", 12)));
+    CHECK(WaitFor([&] { return server.Stats().protocolErrors == 1; }, std::chrono::seconds(5)));
+    std::vector<dwm::DaemonWindow> windows;
+    CHECK(subscribers[0]->client.ListWindows(dwm::DaemonListRequest{ false, false, false, 0, 0 }, windows, &error));
+
+    // ---- Shutdown reaches the clients ----
+    server.Stop();
+    CHECK(WaitFor([&] { return !subscribers[0]->client.Connected(); }, std::chrono::seconds(5)));
+    CHECK(access(path.c_str(), F_OK) != 0);
+    std::printf("daemon check passed\n");
+    return 0;
+}
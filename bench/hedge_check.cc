@@ -0,0 +1,195 @@
+// Checks of hedged execution (hedged_attempts.h) with synthetic attempts:
+// a fast primary wins without a hedge, a slow primary is hedged and the hedge
+// wins, early failures hand over at once, every attempt failing returns no
+// winner, the per-key cap stops a second call from piling attempts onto a
+// key whose attempts hang (and frees up once they return), the executor never
+// runs more than its threads, the final timeout bounds a call whose last
+// attempt hangs, and Shutdown() joins idle workers and detaches a stuck one.
+// Exits non-zero on the first failed check.
+//
+//   dwm_hedge_check
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../hedged_attempts.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+#define CHECK(cond)                                                               \
+    do {                                                                          \
+        if (!(cond)) {                                                            \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1);                                                         \
+        }                                                                         \
+    } while (0)
+
+// Released by the test once it is done observing a hung attempt
+struct Gate {
+    std::atomic<bool> open{false};
+    void Wait() const { while (!open) std::this_thread::sleep_for(milliseconds(1)); }
+};
+
+dwm::HedgedAttempt<int> Attempt(int id, milliseconds delay, bool ok, int value) {
+    return { id, [delay, ok, value](int& out) {
+        std::this_thread::sleep_for(delay);
+        out = value;
+        return ok;
+    } };
+}
+
+dwm::HedgedAttempt<int> Hung(int id, std::shared_ptr<Gate> gate) {
+    return { id, [gate](int&) { gate->Wait(); return false; } };
+}
+
+auto Threshold(milliseconds t) {
+    return [t](int) { return std::chrono::nanoseconds(t); };
+}
+
+dwm::HedgeOptions Options(dwm::AttemptExecutor& executor, dwm::InFlightLimiter* limiter, uint64_t key) {
+    dwm::HedgeOptions o;
+    o.executor = &executor;
+    o.limiter = limiter;
+    o.key = key;
+    o.maxPerKey = 2;
+    o.timeout = milliseconds(500);
+    return o;
+}
+
+void CheckOutcomes(dwm::AttemptExecutor& executor) {
+    std::atomic<int> completions{0};
+    auto count = [&](int, std::chrono::nanoseconds, bool) { completions++; };
+    int out = 0;
+
+    // Fast primary: no hedge
+    auto o = dwm::RunHedged<int>({ Attempt(1, milliseconds(0), true, 10), Attempt(2, milliseconds(0), true, 20) },
+                                 Threshold(milliseconds(200)), count, Options(executor, nullptr, 0), out);
+    CHECK(o.winner == 1 && out == 10 && o.launched == 1 && !o.hedged && !o.throttled && !o.timedOut);
+
+    // Slow primary: the hedge starts at the threshold and wins
+    o = dwm::RunHedged<int>({ Attempt(1, milliseconds(300), true, 10), Attempt(2, milliseconds(0), true, 20) },
+                            Threshold(milliseconds(20)), count, Options(executor, nullptr, 0), out);
+    CHECK(o.winner == 2 && out == 20 && o.launched == 2 && o.hedged && !o.timedOut);
+
+    // Early failures hand over without waiting for the threshold
+    auto t0 = Clock::now();
+    o = dwm::RunHedged<int>({ Attempt(1, milliseconds(0), false, 0), Attempt(2, milliseconds(0), false, 0),
+                              Attempt(3, milliseconds(0), true, 30) },
+                            Threshold(milliseconds(1000)), count, Options(executor, nullptr, 0), out);
+    CHECK(o.winner == 3 && out == 30 && o.launched == 3 && !o.hedged);
+    CHECK(Clock::now() - t0 < milliseconds(500));
+
+    // Everything fails: no winner, and out is left alone
+    out = -1;
+    o = dwm::RunHedged<int>({ Attempt(1, milliseconds(0), false, 1), Attempt(2, milliseconds(5), false, 2) },
+                            Threshold(milliseconds(1)), count, Options(executor, nullptr, 0), out);
+    CHECK(o.winner == -1 && out == -1 && o.launched == 2 && !o.timedOut);
+
+    // Every launched attempt reports completion, including the hedge that lost
+    auto end = Clock::now() + std::chrono::seconds(5);
+    while (completions < 8 && Clock::now() < end) std::this_thread::sleep_for(milliseconds(1));
+    CHECK(completions == 8);
+}
+
+void CheckPerKeyCapAndTimeout(dwm::AttemptExecutor& executor) {
+    dwm::InFlightLimiter limiter;
+    auto gate = std::make_shared<Gate>();
+    int out = 0;
+    const uint64_t key = 42;
+
+    // Both attempts hang: the call gives up at its timeout with the key at its cap
+    auto t0 = Clock::now();
+    auto o = dwm::RunHedged<int>({ Hung(1, gate), Hung(2, gate), Attempt(3, milliseconds(0), true, 3) },
+                                 Threshold(milliseconds(10)), nullptr, Options(executor, &limiter, key), out);
+    auto elapsed = Clock::now() - t0;
+    CHECK(o.winner == -1 && o.timedOut && o.throttled && o.launched == 2);
+    CHECK(elapsed >= milliseconds(500) && elapsed < milliseconds(3000));
+    CHECK(limiter.InFlight(key) == 2);
+
+    // A second call on the same key cannot start its primary there, so it runs its
+    // attempts in turn on this thread and still gets a result
+    t0 = Clock::now();
+    o = dwm::RunHedged<int>({ Attempt(1, milliseconds(0), false, 0), Attempt(2, milliseconds(0), true, 1) },
+                            Threshold(milliseconds(10)), nullptr, Options(executor, &limiter, key), out);
+    CHECK(o.winner == 2 && out == 1 && o.throttled && o.inlined && o.launched == 2 && !o.timedOut);
+    CHECK(Clock::now() - t0 < milliseconds(100));
+    CHECK(limiter.InFlight(key) == 2);
+
+    // Other keys are unaffected
+    o = dwm::RunHedged<int>({ Attempt(1, milliseconds(0), true, 7) }, Threshold(milliseconds(10)), nullptr,
+                            Options(executor, &limiter, key + 1), out);
+    CHECK(o.winner == 1 && out == 7);
+
+    // Once the hung attempts return, the key is free again
+    gate->open = true;
+    auto end = Clock::now() + std::chrono::seconds(5);
+    while (limiter.InFlight(key) && Clock::now() < end) std::this_thread::sleep_for(milliseconds(1));
+    CHECK(limiter.InFlight(key) == 0);
+    o = dwm::RunHedged<int>({ Attempt(1, milliseconds(0), true, 9) }, Threshold(milliseconds(10)), nullptr,
+                            Options(executor, &limiter, key), out);
+    CHECK(o.winner == 1 && out == 9);
+}
+
+void CheckExecutorBound() {
+    dwm::AttemptExecutor executor(3);
+    auto gate = std::make_shared<Gate>();
+    std::atomic<int> running{0}, ran{0};
+    size_t accepted = 0;
+    for (int i = 0; i < 10; ++i) {
+        if (executor.TrySubmit([&, gate] { running++; gate->Wait(); running--; ran++; })) accepted++;
+    }
+    CHECK(accepted == 3 && executor.Threads() == 3);
+    gate->open = true;
+    auto end = Clock::now() + std::chrono::seconds(5);
+    while (ran < 3 && Clock::now() < end) std::this_thread::sleep_for(milliseconds(1));
+    CHECK(ran == 3);
+
+    // Idle workers are reused instead of starting new threads
+    std::this_thread::sleep_for(milliseconds(20));
+    for (int i = 0; i < 3; ++i) CHECK(executor.TrySubmit([&] { ran++; }));
+    CHECK(executor.Threads() == 3);
+    CHECK(executor.Shutdown(std::chrono::seconds(5)) == 0);
+    CHECK(ran == 6);
+    CHECK(!executor.TrySubmit([] {}));
+}
+
+void CheckShutdownDetachesStuck() {
+    auto gate = std::make_shared<Gate>();
+    auto finished = std::make_shared<std::atomic<bool>>(false);
+    {
+        dwm::AttemptExecutor executor(2);
+        CHECK(executor.TrySubmit([gate, finished] { gate->Wait(); *finished = true; }));
+        CHECK(executor.TrySubmit([] {}));
+        std::this_thread::sleep_for(milliseconds(20));
+        auto t0 = Clock::now();
+        CHECK(executor.Shutdown(milliseconds(50)) == 1); // the idle one is joined
+        CHECK(Clock::now() - t0 < milliseconds(1000));
+    }
+    // The detached worker outlives the executor and still finishes cleanly
+    gate->open = true;
+    auto end = Clock::now() + std::chrono::seconds(5);
+    while (!*finished && Clock::now() < end) std::this_thread::sleep_for(milliseconds(1));
+    CHECK(*finished);
+    std::this_thread::sleep_for(milliseconds(20)); // let it leave WorkerLoop before exit
+}
+
+} // namespace
+
+int main() {
+    dwm::AttemptExecutor executor(8);
+    CheckOutcomes(executor);
+    CheckPerKeyCapAndTimeout(executor);
+    CHECK(executor.Shutdown(std::chrono::seconds(5)) == 0);
+    CheckExecutorBound();
+    CheckShutdownDetachesStuck();
+    std::printf("hedge checks passed\n");
+    return 0;
+}
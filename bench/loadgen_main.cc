@@ -0,0 +1,493 @@
+// Headless load generator: drives the addon's request path (enumerate, Alt-Tab
+// filter, icon + thumbnail cache, capture -> scale -> encode pipeline) against
+// SyntheticWindowSystem while content changes and window events keep arriving,
+// and reports throughput, latency percentiles and memory over time. Answers
+// "what happens with 500 windows, 50 events/s and concurrent thumbnail calls"
+// on any OS, including Linux CI.
+//
+//   dwm_loadgen [--windows N] [--duration s] [--interval s] [--clients N]
+//               [--mix list=W,thumb=W] [--content-rate n/s] [--event-rate n/s]
+//               [--storm N@s] [--capture-latency-us us] [--capture-failure f]
+//               [--thumb WxH] [--png-level n] [--cache-ttl ms] [--seed n] [--json out.json]
+//
+// Pipeline shape, cache TTL and PNG level default to the addon's values.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "../base64.h"
+#include "../capture_pipeline.h"
+#include "../enumeration_arena.h"
+#include "../image_frame.h"
+#include "../latency_histogram.h"
+#include "../negative_cache.h"
+#include "../png_encoder.h"
+#include "../synthetic_window_system.h"
+#include "../thumbnail_cache.h"
+#include "../window_event_tracker.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    size_t windows{500};
+    double durationS{10};
+    double intervalS{1};
+    size_t clients{4};
+    unsigned listWeight{1};   // getWindows: enumerate + thumbnails for every listed window
+    unsigned thumbWeight{4};  // updateThumbnail: one window
+    double contentRate{50};   // content changes per second
+    double eventRate{50};     // window events per second
+    size_t stormSize{0};      // extra burst of events ...
+    double stormEveryS{0};    // ... every this many seconds
+    long captureLatencyUs{2000};
+    double captureFailure{0.02};
+    int thumbW{200}, thumbH{150};
+    int pngLevel{6};          // RuntimeConfig::pngLevel
+    uint64_t cacheTtlMs{1200}; // THUMB_TTL_MS
+    uint64_t seed{1};
+    std::string jsonPath;
+    // Addon pipeline shape (kCaptureStageThreads etc. in dwm_thumbnail.cc)
+    size_t captureThreads{4}, scaleThreads{1}, encodeThreads{2};
+    size_t stageQueueCapacity{8}, captureInputQueueCapacity{512};
+};
+
+// xorshift64*, same as dwm_bench
+struct Rng {
+    uint64_t s;
+    explicit Rng(uint64_t seed) : s(seed ? seed : 1) {}
+    uint64_t Next() { s ^= s >> 12; s ^= s << 25; s ^= s >> 27; return s * 2685821657736338717ull; }
+};
+
+size_t ResidentBytes() {
+#if defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (statm >> pages >> resident) return resident * (size_t)sysconf(_SC_PAGESIZE);
+#endif
+    return 0; // not available on this platform
+}
+
+// The addon's icon cache over WindowId (thumbnails use thumbnail_cache.h as the addon does)
+class IconCache {
+public:
+    std::string Icon(dwm::WindowSystem& ws, dwm::WindowId id) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = icons_.find(id);
+            if (it != icons_.end()) return it->second;
+        }
+        std::string icon = ws.IconDataUrl(id, 32);
+        std::lock_guard<std::mutex> lock(mutex_);
+        icons_[id] = icon;
+        return icon;
+    }
+
+    // Entries, and bytes of cached data URLs
+    void Usage(size_t& entries, size_t& bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries = icons_.size();
+        bytes = 0;
+        for (auto& kv : icons_) bytes += kv.second.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<dwm::WindowId, std::string> icons_;
+};
+
+struct Job {
+    dwm::WindowId window{0};
+    uint32_t pid{0};
+    dwm::WindowRect rect;
+    bool minimized{false};
+    uint64_t ts{0};
+    dwm::Frame frame;
+    std::string thumbnail;
+    bool hit{false};
+};
+
+// Counters for one reporting interval plus the whole run
+struct Metrics {
+    dwm::LatencyHistogram list, thumb;           // request latency
+    dwm::LatencyHistogram totalList, totalThumb;
+    std::atomic<uint64_t> cacheHits{0}, captures{0}, captureFailures{0}, captureSkips{0};
+    std::atomic<uint64_t> sinkEvents{0}, polledEvents{0};
+};
+
+class LoadGenerator {
+public:
+    explicit LoadGenerator(const Options& o) : o_(o), ws_(MakeConfig(o)) {
+        pngOptions_.level = o.pngLevel;
+        cachePolicy_.ttlMs = o.cacheTtlMs;
+    }
+
+    int Run() {
+        ws_.SetEventSink([this](const dwm::WindowEvent&) { metrics_.sinkEvents.fetch_add(1, std::memory_order_relaxed); });
+        start_ = Clock::now();
+        auto end = start_ + std::chrono::microseconds((long long)(o_.durationS * 1e6));
+        size_t rss0 = ResidentBytes();
+        std::printf("dwm_loadgen: %zu windows, %zu clients, mix list=%u thumb=%u, %.0f content changes/s, %.0f events/s",
+                    o_.windows, o_.clients, o_.listWeight, o_.thumbWeight, o_.contentRate, o_.eventRate);
+        if (o_.stormSize) std::printf(", storm %zu every %.1fs", o_.stormSize, o_.stormEveryS);
+        std::printf("\n%6s %8s %8s %9s %9s %9s %9s %9s %9s %7s %7s %8s %9s\n", "t(s)", "list/s", "thumb/s",
+                    "list p50", "list p99", "thumb p50", "thumb p90", "thumb p99", "captures", "hit%", "events", "cache", "rss(MB)");
+
+        std::vector<std::thread> threads;
+        threads.emplace_back([&] { DriveDesktop(end); });
+        threads.emplace_back([&] { Poll(end); });
+        for (size_t i = 0; i < o_.clients; ++i) threads.emplace_back([&, i] { Client(i, end); });
+
+        auto next = start_;
+        while (true) {
+            next += std::chrono::microseconds((long long)(o_.intervalS * 1e6));
+            if (next > end) next = end;
+            std::this_thread::sleep_until(next);
+            Report(next);
+            if (next >= end) break;
+        }
+        stop_.store(true);
+        for (auto& t : threads) t.join();
+        ws_.SetEventSink(nullptr);
+
+        size_t rss1 = ResidentBytes();
+        double elapsed = std::chrono::duration<double>(Clock::now() - start_).count();
+        std::printf("total: %llu list (p50 %.1f ms, p99 %.1f ms), %llu thumb (p50 %.1f ms, p99 %.1f ms) in %.1fs; rss %.1f -> %.1f MB\n",
+                    (unsigned long long)metrics_.totalList.Count(), metrics_.totalList.PercentileUs(50) / 1000.0,
+                    metrics_.totalList.PercentileUs(99) / 1000.0, (unsigned long long)metrics_.totalThumb.Count(),
+                    metrics_.totalThumb.PercentileUs(50) / 1000.0, metrics_.totalThumb.PercentileUs(99) / 1000.0,
+                    elapsed, rss0 / 1048576.0, rss1 / 1048576.0);
+        if (!o_.jsonPath.empty() && !WriteJson(o_.jsonPath, elapsed)) {
+            std::fprintf(stderr, "cannot write %s\n", o_.jsonPath.c_str());
+            return 1;
+        }
+        return 0;
+    }
+
+private:
+    struct Sample {
+        double t{0};
+        uint64_t list{0}, thumb{0};
+        uint64_t listP50{0}, listP99{0}, thumbP50{0}, thumbP90{0}, thumbP99{0};
+        uint64_t captures{0}, hits{0}, events{0};
+        size_t cacheEntries{0}, cacheBytes{0}, rss{0}, windows{0};
+        double intervalS{0};
+    };
+
+    static dwm::SyntheticDesktopConfig MakeConfig(const Options& o) {
+        dwm::SyntheticDesktopConfig c;
+        c.windows = o.windows;
+        c.seed = o.seed;
+        c.captureLatency = std::chrono::microseconds(o.captureLatencyUs);
+        c.captureFailureRate = o.captureFailure;
+        return c;
+    }
+
+    // Content changes and window events at the configured rates, plus storms.
+    void DriveDesktop(Clock::time_point end) {
+        const auto tick = std::chrono::milliseconds(10);
+        double contentDue = 0, eventsDue = 0;
+        auto nextStorm = start_ + std::chrono::microseconds((long long)(o_.stormEveryS * 1e6));
+        auto last = Clock::now();
+        while (!stop_.load() && Clock::now() < end) {
+            std::this_thread::sleep_for(tick);
+            auto now = Clock::now();
+            double dt = std::chrono::duration<double>(now - last).count();
+            last = now;
+            contentDue += o_.contentRate * dt;
+            eventsDue += o_.eventRate * dt;
+            if (contentDue >= 1) { ws_.ChangeContent((size_t)contentDue); contentDue -= (size_t)contentDue; }
+            if (eventsDue >= 1) { ws_.EventStorm((size_t)eventsDue); eventsDue -= (size_t)eventsDue; }
+            if (o_.stormSize && o_.stormEveryS > 0 && now >= nextStorm) {
+                ws_.EventStorm(o_.stormSize);
+                nextStorm += std::chrono::microseconds((long long)(o_.stormEveryS * 1e6));
+            }
+        }
+    }
+
+    // The addon's fallback poller (250 ms), diffing snapshots with the tracker.
+    void Poll(Clock::time_point end) {
+        dwm::WindowEventTracker tracker;
+        std::vector<dwm::WindowId> ids;
+        std::vector<dwm::WindowSnapshotEntry> snapshot;
+        std::vector<dwm::WindowEvent> events;
+        dwm::WindowAttributes attrs;
+        while (!stop_.load() && Clock::now() < end) {
+            ws_.EnumerateTopLevel(ids);
+            snapshot.clear();
+            for (dwm::WindowId id : ids) {
+                if (ws_.GetAttributes(id, attrs) && dwm::IsAltTabCandidate(attrs)) snapshot.push_back({ id, attrs.minimized });
+            }
+            tracker.Update(ws_.Foreground(), snapshot, true, events);
+            metrics_.polledEvents.fetch_add(events.size(), std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        }
+    }
+
+    void Client(size_t index, Clock::time_point end) {
+        Rng rng(o_.seed * 0x9e3779b97f4a7c15ull + index + 1);
+        unsigned total = o_.listWeight + o_.thumbWeight;
+        std::vector<dwm::WindowId> ids;
+        while (!stop_.load() && Clock::now() < end) {
+            bool list = (unsigned)(rng.Next() % total) < o_.listWeight;
+            auto t0 = Clock::now();
+            if (list) {
+                GetWindows();
+            } else {
+                ws_.EnumerateTopLevel(ids);
+                if (ids.empty()) continue;
+                UpdateThumbnail(ids[rng.Next() % ids.size()]);
+            }
+            auto d = Clock::now() - t0;
+            (list ? metrics_.list : metrics_.thumb).Record(d);
+            (list ? metrics_.totalList : metrics_.totalThumb).Record(d);
+        }
+    }
+
+    std::shared_ptr<dwm::Pipeline<Job>> CreatePipeline() {
+        auto pipeline = std::make_shared<dwm::Pipeline<Job>>();
+        pipeline->AddStage("capture", o_.captureThreads, o_.captureInputQueueCapacity, [this](Job& job) {
+            job.ts = ws_.NowMs();
+            if (cache_.TryServe(job.window, o_.thumbW, o_.thumbH, job.rect, job.minimized, job.ts, cachePolicy_, job.thumbnail)) {
+                job.hit = true;
+                return false;
+            }
+            // Failing windows back off like the addon's capture methods do
+            dwm::NegativeCacheKey key{ job.window, job.pid, 0 };
+            if (backoff_.ShouldSkip(key)) {
+                metrics_.captureSkips.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            metrics_.captures.fetch_add(1, std::memory_order_relaxed);
+            if (ws_.Capture(job.window, o_.thumbW, o_.thumbH, job.frame)) {
+                backoff_.RecordSuccess(key);
+            } else {
+                metrics_.captureFailures.fetch_add(1, std::memory_order_relaxed);
+                backoff_.RecordFailure(key);
+                job.frame.Clear();
+            }
+            return true;
+        });
+        pipeline->AddStage("scale", o_.scaleThreads, o_.stageQueueCapacity, [this](Job& job) {
+            dwm::ScaleToFit(job.frame, o_.thumbW, o_.thumbH);
+            return true;
+        });
+        pipeline->AddStage("encode", o_.encodeThreads, o_.stageQueueCapacity, [this](Job& job) {
+            std::string fresh = "data:image/png;base64,";
+            bool good = dwm::IsUsefulThumbnailFrame(job.frame, o_.thumbW, o_.thumbH);
+            if (!job.frame.Empty()) {
+                std::vector<uint8_t> png;
+                dwm::EncodePng(job.frame, pngOptions_, png);
+                fresh = dwm::Base64DataUrl("image/png", png.data(), png.size());
+            }
+            job.frame.Clear();
+            job.thumbnail = cache_.Commit(job.window, fresh, good, o_.thumbW, o_.thumbH, job.rect, job.ts, job.minimized, false);
+            return true;
+        });
+        return pipeline;
+    }
+
+    // getWindows: enumerate, filter, and push every listed window through the pipeline.
+    void GetWindows() {
+        auto pipeline = CreatePipeline();
+        std::atomic<uint64_t> hits{0};
+        pipeline->Start([&](Job&& job) { if (job.hit) hits.fetch_add(1, std::memory_order_relaxed); });
+        std::vector<dwm::WindowId> ids;
+        dwm::EnumerationArena arena; // per-call scratch, as in the addon
+        dwm::WindowAttributes attrs(arena.Resource());
+        ws_.EnumerateTopLevel(ids);
+        for (dwm::WindowId id : ids) {
+            if (!ws_.GetAttributes(id, attrs) || !dwm::IsAltTabCandidate(attrs)) continue;
+            if (!ws_.IsOnCurrentDesktop(id) || dwm::DisplayTitle(attrs).empty()) continue;
+            icons_.Icon(ws_, id);
+            Job job;
+            job.window = id;
+            job.pid = attrs.pid;
+            job.rect = attrs.rect;
+            job.minimized = attrs.minimized;
+            pipeline->Submit(std::move(job));
+        }
+        pipeline->Finish();
+        pipeline->Wait();
+        metrics_.cacheHits.fetch_add(hits.load(), std::memory_order_relaxed);
+    }
+
+    // updateThumbnail: one window, same cache and pipeline (single item).
+    void UpdateThumbnail(dwm::WindowId id) {
+        dwm::WindowAttributes attrs;
+        if (!ws_.GetAttributes(id, attrs)) return;
+        auto pipeline = CreatePipeline();
+        bool hit = false;
+        pipeline->Start([&](Job&& job) { hit = job.hit; });
+        Job job;
+        job.window = id;
+        job.pid = attrs.pid;
+        job.rect = attrs.rect;
+        job.minimized = attrs.minimized;
+        pipeline->Submit(std::move(job));
+        pipeline->Finish();
+        pipeline->Wait();
+        if (hit) metrics_.cacheHits.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Report(Clock::time_point now) {
+        Sample s;
+        s.t = std::chrono::duration<double>(now - start_).count();
+        s.intervalS = samples_.empty() ? s.t : s.t - samples_.back().t;
+        s.list = metrics_.list.Count();
+        s.thumb = metrics_.thumb.Count();
+        s.listP50 = metrics_.list.PercentileUs(50);
+        s.listP99 = metrics_.list.PercentileUs(99);
+        s.thumbP50 = metrics_.thumb.PercentileUs(50);
+        s.thumbP90 = metrics_.thumb.PercentileUs(90);
+        s.thumbP99 = metrics_.thumb.PercentileUs(99);
+        metrics_.list.Reset();
+        metrics_.thumb.Reset();
+        s.captures = metrics_.captures.exchange(0);
+        s.hits = metrics_.cacheHits.exchange(0);
+        s.events = metrics_.sinkEvents.exchange(0);
+        icons_.Usage(s.cacheEntries, s.cacheBytes);
+        s.cacheEntries += cache_.Size();
+        s.cacheBytes += cache_.Bytes();
+        s.rss = ResidentBytes();
+        s.windows = ws_.WindowCount();
+        double iv = s.intervalS > 0 ? s.intervalS : 1;
+        double lookups = (double)(s.hits + s.captures);
+        std::printf("%6.1f %8.1f %8.1f %7.1fms %7.1fms %7.1fms %7.1fms %7.1fms %9llu %6.1f%% %7.0f %8zu %9.1f\n",
+                    s.t, s.list / iv, s.thumb / iv, s.listP50 / 1000.0, s.listP99 / 1000.0, s.thumbP50 / 1000.0,
+                    s.thumbP90 / 1000.0, s.thumbP99 / 1000.0, (unsigned long long)s.captures,
+                    lookups > 0 ? 100.0 * (double)s.hits / lookups : 0.0, s.events / iv, s.cacheEntries, s.rss / 1048576.0);
+        std::fflush(stdout);
+        samples_.push_back(s);
+    }
+
+    bool WriteJson(const std::string& path, double elapsed) {
+        FILE* f = std::fopen(path.c_str(), "w");
+        if (!f) return false;
+        std::fprintf(f, "{\n  \"version\": 1,\n  \"config\": {\"windows\": %zu, \"durationS\": %g, \"clients\": %zu, "
+                        "\"listWeight\": %u, \"thumbWeight\": %u, \"contentRate\": %g, \"eventRate\": %g, "
+                        "\"stormSize\": %zu, \"stormEveryS\": %g, \"captureLatencyUs\": %ld, \"captureFailure\": %g, "
+                        "\"thumbWidth\": %d, \"thumbHeight\": %d, \"pngLevel\": %d, \"cacheTtlMs\": %llu, \"seed\": %llu},\n",
+                     o_.windows, o_.durationS, o_.clients, o_.listWeight, o_.thumbWeight, o_.contentRate, o_.eventRate,
+                     o_.stormSize, o_.stormEveryS, o_.captureLatencyUs, o_.captureFailure, o_.thumbW, o_.thumbH,
+                     o_.pngLevel, (unsigned long long)o_.cacheTtlMs, (unsigned long long)o_.seed);
+        std::fprintf(f, "  \"summary\": {\"elapsedS\": %.3f, \"list\": {\"count\": %llu, \"p50Us\": %llu, \"p90Us\": %llu, \"p99Us\": %llu, \"maxUs\": %llu}, "
+                        "\"thumb\": {\"count\": %llu, \"p50Us\": %llu, \"p90Us\": %llu, \"p99Us\": %llu, \"maxUs\": %llu}, "
+                        "\"captureFailures\": %llu, \"captureSkips\": %llu, \"polledEvents\": %llu},\n",
+                     elapsed, (unsigned long long)metrics_.totalList.Count(), (unsigned long long)metrics_.totalList.PercentileUs(50),
+                     (unsigned long long)metrics_.totalList.PercentileUs(90), (unsigned long long)metrics_.totalList.PercentileUs(99),
+                     (unsigned long long)metrics_.totalList.MaxUs(), (unsigned long long)metrics_.totalThumb.Count(),
+                     (unsigned long long)metrics_.totalThumb.PercentileUs(50), (unsigned long long)metrics_.totalThumb.PercentileUs(90),
+                     (unsigned long long)metrics_.totalThumb.PercentileUs(99), (unsigned long long)metrics_.totalThumb.MaxUs(),
+                     (unsigned long long)metrics_.captureFailures.load(), (unsigned long long)metrics_.captureSkips.load(),
+                     (unsigned long long)metrics_.polledEvents.load());
+        std::fprintf(f, "  \"samples\": [\n");
+        for (size_t i = 0; i < samples_.size(); ++i) {
+            const Sample& s = samples_[i];
+            std::fprintf(f, "    {\"t\": %.3f, \"intervalS\": %.3f, \"list\": %llu, \"thumb\": %llu, \"listP50Us\": %llu, \"listP99Us\": %llu, "
+                            "\"thumbP50Us\": %llu, \"thumbP90Us\": %llu, \"thumbP99Us\": %llu, \"captures\": %llu, \"cacheHits\": %llu, "
+                            "\"events\": %llu, \"windows\": %zu, \"cacheEntries\": %zu, \"cacheBytes\": %zu, \"rssBytes\": %zu}%s\n",
+                         s.t, s.intervalS, (unsigned long long)s.list, (unsigned long long)s.thumb, (unsigned long long)s.listP50,
+                         (unsigned long long)s.listP99, (unsigned long long)s.thumbP50, (unsigned long long)s.thumbP90,
+                         (unsigned long long)s.thumbP99, (unsigned long long)s.captures, (unsigned long long)s.hits,
+                         (unsigned long long)s.events, s.windows, s.cacheEntries, s.cacheBytes, s.rss,
+                         i + 1 < samples_.size() ? "," : "");
+        }
+        std::fprintf(f, "  ]\n}\n");
+        return std::fclose(f) == 0;
+    }
+
+    const Options o_;
+    dwm::SyntheticWindowSystem ws_;
+    dwm::ThumbnailCache cache_;
+    dwm::ThumbnailCachePolicy cachePolicy_;
+    IconCache icons_;
+    dwm::NegativeCache backoff_;
+    dwm::PngEncodeOptions pngOptions_;
+    Metrics metrics_;
+    std::atomic<bool> stop_{false};
+    Clock::time_point start_;
+    std::vector<Sample> samples_;
+};
+
+// "list=1,thumb=4"
+bool ParseMix(const std::string& s, Options& o) {
+    unsigned list = 0, thumb = 0;
+    size_t pos = 0;
+    while (pos < s.size()) {
+        size_t comma = s.find(',', pos);
+        std::string part = s.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        size_t eq = part.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = part.substr(0, eq);
+        unsigned weight = (unsigned)std::strtoul(part.c_str() + eq + 1, nullptr, 10);
+        if (key == "list") list = weight;
+        else if (key == "thumb") thumb = weight;
+        else return false;
+        if (comma == std::string::npos) break;
+        pos = comma + 1;
+    }
+    if (list + thumb == 0) return false;
+    o.listWeight = list;
+    o.thumbWeight = thumb;
+    return true;
+}
+
+int Usage() {
+    std::fprintf(stderr,
+                 "usage: dwm_loadgen [--windows N] [--duration s] [--interval s] [--clients N]\n"
+                 "                   [--mix list=W,thumb=W] [--content-rate n/s] [--event-rate n/s]\n"
+                 "                   [--storm N@s] [--capture-latency-us us] [--capture-failure f]\n"
+                 "                   [--thumb WxH] [--png-level n] [--cache-ttl ms] [--seed n] [--json out.json]\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* v = nullptr;
+        if (a == "--windows" && (v = value())) o.windows = (size_t)std::strtoul(v, nullptr, 10);
+        else if (a == "--duration" && (v = value())) o.durationS = std::atof(v);
+        else if (a == "--interval" && (v = value())) o.intervalS = std::atof(v);
+        else if (a == "--clients" && (v = value())) o.clients = (size_t)std::strtoul(v, nullptr, 10);
+        else if (a == "--mix" && (v = value())) { if (!ParseMix(v, o)) return Usage(); }
+        else if (a == "--content-rate" && (v = value())) o.contentRate = std::atof(v);
+        else if (a == "--event-rate" && (v = value())) o.eventRate = std::atof(v);
+        else if (a == "--storm" && (v = value())) {
+            if (std::sscanf(v, "%zu@%lf", &o.stormSize, &o.stormEveryS) != 2 || o.stormEveryS <= 0) return Usage();
+        }
+        else if (a == "--capture-latency-us" && (v = value())) o.captureLatencyUs = std::atol(v);
+        else if (a == "--capture-failure" && (v = value())) o.captureFailure = std::atof(v);
+        else if (a == "--thumb" && (v = value())) { if (std::sscanf(v, "%dx%d", &o.thumbW, &o.thumbH) != 2) return Usage(); }
+        else if (a == "--png-level" && (v = value())) o.pngLevel = std::atoi(v);
+        else if (a == "--cache-ttl" && (v = value())) o.cacheTtlMs = std::strtoull(v, nullptr, 10);
+        else if (a == "--seed" && (v = value())) o.seed = std::strtoull(v, nullptr, 10);
+        else if (a == "--json" && (v = value())) o.jsonPath = v;
+        else return Usage();
+    }
+    if (o.windows == 0 || o.durationS <= 0 || o.intervalS <= 0 || o.clients == 0 ||
+        o.thumbW <= 0 || o.thumbH <= 0 || o.pngLevel < 0 || o.pngLevel > 9) {
+        return Usage();
+    }
+    LoadGenerator gen(o);
+    return gen.Run();
+}
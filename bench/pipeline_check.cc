@@ -0,0 +1,223 @@
+// Checks of the staged pipeline (capture_pipeline.h) with synthetic stages:
+// BoundedQueue order, close-and-drain and push-after-close, the cost bound
+// (blocks at the limit, still admits one oversized item), and Pipeline runs
+// that keep submission order through single-worker stages, deliver every item
+// exactly once through multi-worker stages, short-circuit to the sink when a
+// stage returns false, refuse submissions after Finish() and keep the scale
+// queue's bytes under its limit; Cancel() drops queued work, and Detach()
+// lets a run with a stuck stage go. Exits non-zero on the first failed check.
+//
+//   dwm_pipeline_check [--items N]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../capture_pipeline.h"
+
+namespace {
+
+#define CHECK(cond)                                                               \
+    do {                                                                          \
+        if (!(cond)) {                                                            \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1);                                                         \
+        }                                                                         \
+    } while (0)
+
+struct Item {
+    size_t id{0};
+    size_t bytes{0};     // stand-in for a captured frame
+    bool skipped{false}; // first stage answered from "cache"
+    int stagesRun{0};
+};
+
+void CheckQueue() {
+    dwm::BoundedQueue<int> q(3);
+    for (int i = 0; i < 3; ++i) CHECK(q.Push(i));
+    CHECK(q.Size() == 3 && q.MaxDepth() == 3);
+
+    // A fourth push blocks until a pop makes room
+    std::atomic<bool> pushed{false};
+    std::thread producer([&] { CHECK(q.Push(3)); pushed = true; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(!pushed);
+    int v = -1;
+    CHECK(q.Pop(v) && v == 0);
+    producer.join();
+    CHECK(pushed);
+
+    // Close: pushes fail, the rest drains in order, then Pop reports the end
+    q.Close();
+    CHECK(!q.Push(99));
+    for (int expected = 1; expected <= 3; ++expected) CHECK(q.Pop(v) && v == expected);
+    CHECK(!q.Pop(v));
+
+    // Close wakes a producer blocked on a full queue
+    dwm::BoundedQueue<int> full(1);
+    CHECK(full.Push(0));
+    std::atomic<int> result{-1};
+    std::thread blocked([&] { result = full.Push(1) ? 1 : 0; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    full.Close();
+    blocked.join();
+    CHECK(result == 0);
+    CHECK(full.Pop(v) && v == 0 && !full.Pop(v));
+}
+
+void CheckCostBound() {
+    dwm::BoundedQueue<Item> q(16, 100, [](const Item& item) { return item.bytes; });
+    CHECK(q.Push(Item{ 0, 60 }));
+    CHECK(q.Push(Item{ 1, 40 }));
+    CHECK(q.Cost() == 100 && q.CostLimit() == 100);
+
+    std::atomic<bool> pushed{false};
+    std::thread producer([&] { CHECK(q.Push(Item{ 2, 50 })); pushed = true; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(!pushed); // 100 + 50 would pass the limit
+    Item out;
+    CHECK(q.Pop(out) && out.id == 0);
+    producer.join();
+    CHECK(pushed && q.Cost() == 90);
+    CHECK(q.Pop(out) && out.id == 1);
+    CHECK(q.Pop(out) && out.id == 2);
+    CHECK(q.Cost() == 0);
+
+    // An item over the limit still enters an empty queue
+    CHECK(q.Push(Item{ 3, 1000 }));
+    CHECK(q.Cost() == 1000);
+    CHECK(q.Pop(out) && out.id == 3 && q.Cost() == 0);
+}
+
+void CheckOrderedPipeline(size_t items) {
+    dwm::Pipeline<Item> pipeline;
+    auto work = [](Item& item) { item.stagesRun++; return true; };
+    pipeline.AddStage("capture", 1, 4, work).AddStage("scale", 1, 2, work).AddStage("encode", 1, 2, work);
+    std::mutex mutex;
+    std::vector<size_t> order;
+    pipeline.Start([&](Item&& item) {
+        CHECK(item.stagesRun == 3);
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(item.id);
+    });
+    for (size_t i = 0; i < items; ++i) CHECK(pipeline.Submit(Item{ i, 0 }));
+    pipeline.Finish();
+    CHECK(!pipeline.Submit(Item{ items, 0 })); // after Finish
+    pipeline.Wait();
+    CHECK(pipeline.IsDone());
+    CHECK(order.size() == items);
+    for (size_t i = 0; i < items; ++i) CHECK(order[i] == i);
+    for (const auto& st : pipeline.Stats()) CHECK(st.processed == items && st.queueDepth == 0);
+}
+
+void CheckParallelPipeline(size_t items) {
+    const size_t kFrameBytes = 1000, kLimit = 3500;
+    dwm::Pipeline<Item> pipeline;
+    std::atomic<size_t> maxQueued{0};
+    dwm::Pipeline<Item>* self = &pipeline;
+    pipeline.AddStage("capture", 4, 64, [](Item& item) {
+        if (item.id % 5 == 0) { item.skipped = true; return false; } // cache hit
+        item.bytes = kFrameBytes;
+        item.stagesRun++;
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        return true;
+    });
+    pipeline.AddStage("scale", 1, 16, [&maxQueued, self](Item& item) {
+        size_t queued = self->Stats()[1].queueCost;
+        size_t seen = maxQueued.load();
+        while (queued > seen && !maxQueued.compare_exchange_weak(seen, queued)) {}
+        item.bytes = 10;
+        item.stagesRun++;
+        std::this_thread::sleep_for(std::chrono::microseconds(200)); // slowest stage: the queue fills
+        return true;
+    }, kLimit, [](const Item& item) { return item.bytes; });
+    pipeline.AddStage("encode", 2, 4, [](Item& item) { item.stagesRun++; return true; });
+    std::mutex mutex;
+    std::vector<size_t> seen;
+    pipeline.Start([&](Item&& item) {
+        CHECK(item.skipped ? item.stagesRun == 0 : item.stagesRun == 3);
+        std::lock_guard<std::mutex> lock(mutex);
+        seen.push_back(item.id);
+    });
+    for (size_t i = 0; i < items; ++i) CHECK(pipeline.Submit(Item{ i, 0 }));
+    pipeline.Finish();
+    pipeline.Wait();
+    std::sort(seen.begin(), seen.end());
+    CHECK(seen.size() == items);
+    for (size_t i = 0; i < items; ++i) CHECK(seen[i] == i);
+    CHECK(maxQueued.load() <= kLimit);
+    auto stats = pipeline.Stats();
+    CHECK(stats[1].queueCostLimit == kLimit && stats[1].queueCost == 0);
+    CHECK(stats[0].processed == items && stats[1].processed == items - (items + 4) / 5);
+    std::printf("parallel: %zu items, scale queue peaked at %zu of %zu bytes\n", items, maxQueued.load(), kLimit);
+}
+
+void CheckCancelAndDetach() {
+    // Cancel: the running stage call finishes, queued items skip every stage but still reach the sink
+    std::atomic<bool> release{false};
+    std::atomic<size_t> ran{0}, sunk{0};
+    {
+        dwm::Pipeline<Item> pipeline;
+        pipeline.AddStage("capture", 1, 64, [&](Item& item) {
+            ran++;
+            if (item.id == 0) while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return true;
+        });
+        pipeline.Start([&](Item&&) { sunk++; });
+        for (size_t i = 0; i < 20; ++i) CHECK(pipeline.Submit(Item{ i, 0 }));
+        while (ran == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        pipeline.Cancel();
+        CHECK(!pipeline.WaitUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds(20)));
+        release = true;
+        pipeline.Wait();
+        CHECK(ran == 1 && sunk == 20);
+    }
+
+    // Detach: a stage that does not return within the wait is left running; the
+    // pipeline is leaked, as the addon does at unload
+    std::atomic<bool> unblock{false};
+    std::atomic<bool> finished{false}, entered{false};
+    auto* stuck = new dwm::Pipeline<Item>();
+    stuck->AddStage("capture", 1, 4, [&](Item&) {
+        entered = true;
+        while (!unblock) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return true;
+    });
+    stuck->Start([&](Item&&) { finished = true; });
+    CHECK(stuck->Submit(Item{ 0, 0 }));
+    while (!entered) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    stuck->Cancel();
+    CHECK(!stuck->WaitUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds(20)));
+    stuck->Detach();
+    stuck->Wait(); // returns at once: nothing left to join
+    unblock = true;
+    auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!finished && std::chrono::steady_clock::now() < end) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK(finished);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t items = 500;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string a = argv[i];
+        if (a == "--items") items = (size_t)std::atol(argv[i + 1]);
+        else { std::fprintf(stderr, "unknown option %s\n", a.c_str()); return 2; }
+    }
+    CheckQueue();
+    CheckCostBound();
+    CheckOrderedPipeline(items);
+    CheckParallelPipeline(items);
+    CheckCancelAndDetach();
+    // Destroying an unstarted or unfinished pipeline must not hang
+    { dwm::Pipeline<Item> idle; idle.AddStage("capture", 2, 4, [](Item&) { return true; }); }
+    std::printf("pipeline checks passed\n");
+    return 0;
+}
@@ -1,7 +1,9 @@
 {
     "variables": {
         # Toggle Windows Graphics Capture support: 1 (default)
-        "enable_wgc%": 1
+        "enable_wgc%": 1,
+        # Per-stage timing instrumentation: 1 (default), 0 compiles the timers out
+        "stage_timing%": 1
     },
     "targets": [
         {
@@ -15,7 +17,7 @@
             "libraries": [
                 "dwmapi.lib",
                 "psapi.lib",
-                "gdiplus.lib",
+                "ws2_32.lib",
                 "shell32.lib",
                 "propsys.lib",
             ],
@@ -42,6 +44,9 @@
                         "dxgi.lib",
                         "windowsapp.lib"
                     ]
+                }],
+                ["stage_timing==0", {
+                    "defines": ["DWM_STAGE_TIMING=0"]
                 }]
             ]
         }
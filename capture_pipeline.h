@@ -0,0 +1,275 @@
+// Staged work pipeline: items flow through named stages connected by bounded
+// queues. Each stage owns its own worker threads, so slow I/O-bound stages
+// (window capture) overlap with CPU-bound ones (scaling, PNG encoding).
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dwm {
+
+// Blocking FIFO with a fixed capacity. Push blocks while full, Pop blocks while
+// empty. After Close() pushes fail and Pop drains the remaining items.
+// Optionally also bounded by cost (e.g. frame bytes): Push then also blocks
+// while the queued items' cost plus its own would pass the limit, except
+// into an empty queue, so a single item larger than the limit still moves.
+template <typename T>
+class BoundedQueue {
+public:
+    using CostFn = std::function<size_t(const T&)>;
+
+    explicit BoundedQueue(size_t capacity, size_t costLimit = 0, CostFn cost = nullptr)
+        : capacity_(capacity ? capacity : 1), costLimit_(cost ? costLimit : 0), cost_(std::move(cost)) {}
+
+    bool Push(T item) {
+        size_t cost = costLimit_ ? cost_(item) : 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        notFull_.wait(lock, [&]{
+            if (closed_) return true;
+            if (items_.size() >= capacity_) return false;
+            return !costLimit_ || items_.empty() || queuedCost_ + cost <= costLimit_;
+        });
+        if (closed_) return false;
+        items_.push_back({ std::move(item), cost });
+        queuedCost_ += cost;
+        if (items_.size() > maxDepth_) maxDepth_ = items_.size();
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    bool Pop(T& out) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notEmpty_.wait(lock, [&]{ return closed_ || !items_.empty(); });
+        if (items_.empty()) return false; // closed and drained
+        out = std::move(items_.front().item);
+        queuedCost_ -= items_.front().cost;
+        items_.pop_front();
+        // Freed cost may admit several smaller items
+        if (costLimit_) notFull_.notify_all();
+        else notFull_.notify_one();
+        return true;
+    }
+
+    void Close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+    size_t Size() const { std::lock_guard<std::mutex> lock(mutex_); return items_.size(); }
+    size_t MaxDepth() const { std::lock_guard<std::mutex> lock(mutex_); return maxDepth_; }
+    size_t Capacity() const { return capacity_; }
+    size_t Cost() const { std::lock_guard<std::mutex> lock(mutex_); return queuedCost_; }
+    size_t CostLimit() const { return costLimit_; }
+
+private:
+    struct Entry {
+        T item;
+        size_t cost;
+    };
+
+    const size_t capacity_;
+    const size_t costLimit_; // 0 = count bound only
+    const CostFn cost_;
+    mutable std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::deque<Entry> items_;
+    size_t queuedCost_{0};
+    size_t maxDepth_{0};
+    bool closed_{false};
+};
+
+struct PipelineStageStats {
+    std::string name;
+    size_t concurrency{0};
+    size_t queueCapacity{0};
+    size_t queueDepth{0};    // items currently waiting in front of the stage
+    size_t queueCost{0};     // their summed cost, for a cost-bounded queue
+    size_t queueCostLimit{0};
+    size_t maxQueueDepth{0}; // high-water mark since Start()
+    uint64_t processed{0};
+    uint64_t busyNs{0};
+    double utilization{0};   // busy time / (elapsed wall time * concurrency)
+};
+
+// Pipeline<T> moves each submitted item through the stages in order. A stage
+// function returns false to skip the remaining stages (e.g. cache hit); the
+// item then goes straight to the sink. The sink may be called concurrently
+// from several workers and must synchronize itself.
+template <typename T>
+class Pipeline {
+public:
+    using StageFn = std::function<bool(T&)>;
+    using SinkFn = std::function<void(T&&)>;
+    using CostFn = typename BoundedQueue<T>::CostFn;
+
+    Pipeline() = default;
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+    ~Pipeline() { Finish(); Wait(); }
+
+    // costLimit/cost: optional cost bound of the stage's input queue (BoundedQueue)
+    Pipeline& AddStage(std::string name, size_t concurrency, size_t queueCapacity, StageFn fn,
+                       size_t costLimit = 0, CostFn cost = nullptr) {
+        auto s = std::make_unique<Stage>(queueCapacity, costLimit, std::move(cost));
+        s->name = std::move(name);
+        s->concurrency = concurrency ? concurrency : 1;
+        s->fn = std::move(fn);
+        stages_.push_back(std::move(s));
+        return *this;
+    }
+
+    void Start(SinkFn sink) {
+        sink_ = std::move(sink);
+        startTime_ = std::chrono::steady_clock::now();
+        size_t total = 0;
+        for (auto& s : stages_) total += s->concurrency;
+        runningWorkers_.store(total);
+        if (total == 0) { std::lock_guard<std::mutex> lock(doneMutex_); done_ = true; return; }
+        for (size_t i = 0; i < stages_.size(); ++i) {
+            Stage* s = stages_[i].get();
+            s->activeWorkers.store(s->concurrency);
+            for (size_t t = 0; t < s->concurrency; ++t) {
+                threads_.emplace_back([this, i]{ WorkerLoop(i); });
+            }
+        }
+    }
+
+    // Feed the first stage; blocks while its queue is full.
+    bool Submit(T item) {
+        if (stages_.empty()) { sink_(std::move(item)); return true; }
+        return stages_.front()->queue.Push(std::move(item));
+    }
+
+    // No more input. Stages drain and shut down in order.
+    void Finish() {
+        if (!stages_.empty()) stages_.front()->queue.Close();
+    }
+
+    // No more input, and items not yet processed skip their remaining stages
+    // (they still reach the sink). Stage calls already running finish first.
+    void Cancel() {
+        cancelled_.store(true);
+        Finish();
+    }
+
+    // Lets the workers run on without this object waiting for them, e.g. when
+    // one is stuck in a call that never returns. The workers still use the
+    // pipeline, so the caller must keep it alive (or leak it) from here on.
+    void Detach() {
+        std::lock_guard<std::mutex> lock(doneMutex_);
+        for (auto& t : threads_) if (t.joinable()) t.detach();
+        threads_.clear();
+    }
+
+    // Block until every worker has exited, then join them.
+    void Wait() {
+        {
+            std::unique_lock<std::mutex> lock(doneMutex_);
+            doneCv_.wait(lock, [&]{ return done_ || threads_.empty(); });
+        }
+        for (auto& t : threads_) if (t.joinable()) t.join();
+        threads_.clear();
+    }
+
+    // Wait for completion up to a deadline. Returns true if all work finished;
+    // otherwise workers keep running and Wait() must still be called later.
+    bool WaitUntil(std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(doneMutex_);
+        return doneCv_.wait_until(lock, deadline, [&]{ return done_ || threads_.empty(); });
+    }
+
+    bool IsDone() const { std::lock_guard<std::mutex> lock(doneMutex_); return done_; }
+
+    std::vector<PipelineStageStats> Stats() const {
+        std::vector<PipelineStageStats> out;
+        auto end = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(doneMutex_);
+            if (done_) end = endTime_;
+        }
+        double wallNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - startTime_).count();
+        for (auto& s : stages_) {
+            PipelineStageStats st;
+            st.name = s->name;
+            st.concurrency = s->concurrency;
+            st.queueCapacity = s->queue.Capacity();
+            st.queueDepth = s->queue.Size();
+            st.queueCost = s->queue.Cost();
+            st.queueCostLimit = s->queue.CostLimit();
+            st.maxQueueDepth = s->queue.MaxDepth();
+            st.processed = s->processed.load();
+            st.busyNs = s->busyNs.load();
+            st.utilization = wallNs > 0 ? (double)st.busyNs / (wallNs * (double)s->concurrency) : 0.0;
+            out.push_back(std::move(st));
+        }
+        return out;
+    }
+
+private:
+    struct Stage {
+        Stage(size_t cap, size_t costLimit, CostFn cost) : queue(cap, costLimit, std::move(cost)) {}
+        std::string name;
+        size_t concurrency{1};
+        StageFn fn;
+        BoundedQueue<T> queue;
+        std::atomic<size_t> activeWorkers{0};
+        std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> busyNs{0};
+    };
+
+    void WorkerLoop(size_t index) {
+        Stage* s = stages_[index].get();
+        Stage* next = (index + 1 < stages_.size()) ? stages_[index + 1].get() : nullptr;
+        T item;
+        while (s->queue.Pop(item)) {
+            auto t0 = std::chrono::steady_clock::now();
+            bool proceed = false;
+            if (!cancelled_.load()) {
+                try { proceed = s->fn(item); } catch (...) { proceed = false; }
+            }
+            auto t1 = std::chrono::steady_clock::now();
+            s->busyNs.fetch_add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+            s->processed.fetch_add(1);
+            if (proceed && next) {
+                if (!next->queue.Push(std::move(item))) break;
+            } else {
+                sink_(std::move(item));
+            }
+        }
+        // Last worker of this stage closes the downstream queue
+        if (s->activeWorkers.fetch_sub(1) == 1 && next) next->queue.Close();
+        if (runningWorkers_.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(doneMutex_);
+            done_ = true;
+            endTime_ = std::chrono::steady_clock::now();
+            doneCv_.notify_all();
+        }
+    }
+
+    std::vector<std::unique_ptr<Stage>> stages_;
+    std::vector<std::thread> threads_;
+    SinkFn sink_;
+    std::atomic<size_t> runningWorkers_{0};
+    std::atomic<bool> cancelled_{false};
+    std::chrono::steady_clock::time_point startTime_{};
+    std::chrono::steady_clock::time_point endTime_{};
+    mutable std::mutex doneMutex_;
+    std::condition_variable doneCv_;
+    bool done_{false};
+};
+
+} // namespace dwm
@@ -0,0 +1,256 @@
+// Client side of the thumbnail daemon (daemon_server.h): connects over the
+// local socket, sends requests and waits for the matching reply; a reader
+// thread routes replies by requestId and hands events to a callback. The
+// client keeps its own copy of the daemon's string table, fetching only the
+// entries added since it last asked, so listings resolve executable paths and
+// class names without resending them. Safe to call from several threads.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "daemon_protocol.h"
+#include "local_socket.h"
+
+namespace dwm {
+
+class DaemonClient {
+public:
+    // type, window (no images); EventsDropped arrives as droppedEvents > 0
+    // with a default window
+    using EventCallback = std::function<void(WindowEventType type, const DaemonWindow& window, uint32_t droppedEvents)>;
+
+    DaemonClient() = default;
+    ~DaemonClient() { Close(); }
+    DaemonClient(const DaemonClient&) = delete;
+    DaemonClient& operator=(const DaemonClient&) = delete;
+
+    bool Connect(const std::string& path, std::string* error = nullptr) {
+        Close();
+        if (!socket_.Connect(path, error)) return false;
+        closed_ = false;
+        reader_ = std::thread([this] { RunReader(); });
+        DaemonFrame reply;
+        std::string request;
+        uint32_t id = NextId();
+        EncodeHello(request, id, kDaemonProtocolVersion);
+        if (!Call(id, request, reply, error)) {
+            Close();
+            return false;
+        }
+        DaemonReader in(reply.payload.data(), reply.payload.size());
+        uint16_t version = in.U16();
+        daemonPid_ = in.U32();
+        if (!in.Done() || version != kDaemonProtocolVersion) {
+            if (error) *error = "unexpected daemon hello";
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close() {
+        socket_.ShutdownBoth();
+        if (reader_.joinable()) reader_.join();
+        socket_.Close();
+        std::lock_guard<std::mutex> lock(mutex_);
+        replies_.clear();
+    }
+
+    bool ListWindows(const DaemonListRequest& request, std::vector<DaemonWindow>& out, std::string* error = nullptr) {
+        std::string message;
+        uint32_t id = NextId();
+        EncodeListRequest(message, id, request);
+        DaemonFrame reply;
+        StringId tableSize = 0;
+        if (!Call(id, message, reply, error)) return false;
+        if (!DecodeWindowList(reply.payload, tableSize, out)) return Fail(error, "malformed window list");
+        return SyncStrings(tableSize, error);
+    }
+
+    bool Thumbnail(WindowId window, uint16_t maxWidth, uint16_t maxHeight, std::string& dataUrl, std::string* error = nullptr) {
+        std::string message;
+        uint32_t id = NextId();
+        EncodeThumbnailRequest(message, id, window, maxWidth, maxHeight);
+        DaemonFrame reply;
+        WindowId echoed = 0;
+        if (!Call(id, message, reply, error)) return false;
+        if (!DecodeThumbnail(reply.payload, echoed, dataUrl) || echoed != window) return Fail(error, "malformed thumbnail");
+        return true;
+    }
+
+    // Events from mask (EventMaskBit) go to callback on the reader thread,
+    // which must not call Close(); mask 0 unsubscribes. Once the callback is
+    // swapped, waits for a call of the previous one to return, so the caller
+    // may free what it used as soon as Subscribe returns.
+    bool Subscribe(uint8_t mask, EventCallback callback, std::string* error = nullptr) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            callback_ = std::move(callback);
+            if (std::this_thread::get_id() != reader_.get_id()) callbackIdle_.wait(lock, [&] { return !inCallback_; });
+        }
+        std::string message;
+        uint32_t id = NextId();
+        EncodeSubscribe(message, id, mask);
+        DaemonFrame reply;
+        return Call(id, message, reply, error);
+    }
+
+    // The daemon's string for id; known for every id in a listing or event received so far
+    std::u16string String(StringId id) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return id < strings_.size() ? strings_[id] : std::u16string();
+    }
+
+    bool Connected() const { return !closed_; }
+    uint32_t DaemonProcessId() const { return daemonPid_; }
+    void SetTimeout(std::chrono::milliseconds timeout) { timeout_ = timeout; }
+
+private:
+    static bool Fail(std::string* error, const char* what) {
+        if (error) *error = what;
+        return false;
+    }
+
+    uint32_t NextId() { return nextId_.fetch_add(2); } // odd, so never 0, which marks events
+
+    bool Call(uint32_t id, const std::string& message, DaemonFrame& reply, std::string* error) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (closed_) return Fail(error, "not connected to the daemon");
+        waiting_[id] = true;
+        lock.unlock();
+        bool sent;
+        {
+            std::lock_guard<std::mutex> sendLock(sendMutex_);
+            sent = socket_.SendAll(message);
+        }
+        lock.lock();
+        if (!sent) {
+            waiting_.erase(id);
+            return Fail(error, "daemon connection lost");
+        }
+        bool done = replyReady_.wait_for(lock, timeout_, [&] { return closed_ || replies_.count(id); });
+        waiting_.erase(id);
+        auto it = replies_.find(id);
+        if (it == replies_.end()) return Fail(error, done ? "daemon connection lost" : "daemon did not reply in time");
+        reply = std::move(it->second);
+        replies_.erase(it);
+        if (reply.type == DaemonMessage::Error) {
+            std::string message;
+            DaemonReader in(reply.payload.data(), reply.payload.size());
+            if (error) *error = in.Str8(message) ? message : "daemon error";
+            return false;
+        }
+        return true;
+    }
+
+    // Fetches the string table entries added since the last sync
+    bool SyncStrings(StringId size, std::string* error) {
+        StringId have;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            have = (StringId)strings_.size();
+        }
+        if (size <= have) return true;
+        std::string message;
+        uint32_t id = NextId();
+        EncodeGetStrings(message, id, have);
+        DaemonFrame reply;
+        if (!Call(id, message, reply, error)) return false;
+        StringId first = 0;
+        std::vector<std::u16string> strings;
+        if (!DecodeStrings(reply.payload, first, strings)) return Fail(error, "malformed string table");
+        Merge(first, strings);
+        return true;
+    }
+
+    // Another thread (or a push) may have added entries meanwhile; ids never
+    // change, so only the part beyond what is held now matters
+    void Merge(StringId first, std::vector<std::u16string>& strings) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < strings.size(); ++i) {
+            if (first + i == strings_.size()) strings_.push_back(std::move(strings[i]));
+        }
+    }
+
+    void RunReader() {
+        DaemonStreamReader stream;
+        std::vector<char> buffer(64 * 1024);
+        DaemonFrame frame;
+        for (;;) {
+            size_t n = 0;
+            if (socket_.Receive(buffer.data(), buffer.size(), n) != IoResult::Done) break;
+            stream.Append(buffer.data(), n);
+            while (stream.Next(frame)) Dispatch(frame);
+            if (stream.Failed()) break;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        replyReady_.notify_all();
+    }
+
+    void Dispatch(DaemonFrame& frame) {
+        if (frame.requestId == 0 && frame.type == DaemonMessage::Strings) {
+            // Pushed ahead of an event whose ids are new to this client
+            StringId first = 0;
+            std::vector<std::u16string> strings;
+            if (DecodeStrings(frame.payload, first, strings)) Merge(first, strings);
+            return;
+        }
+        if (frame.requestId == 0) {
+            DaemonWindow window;
+            WindowEventType type = WindowEventType::Created;
+            uint32_t dropped = 0;
+            if (frame.type == DaemonMessage::EventsDropped) {
+                DaemonReader in(frame.payload.data(), frame.payload.size());
+                dropped = in.U32();
+                if (!in.Done()) return;
+            } else if (frame.type != DaemonMessage::Event || !DecodeEvent(frame.payload, type, window)) {
+                return;
+            }
+            EventCallback callback;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                callback = callback_;
+                inCallback_ = (bool)callback;
+            }
+            if (!callback) return;
+            callback(type, window, dropped);
+            std::lock_guard<std::mutex> lock(mutex_);
+            inCallback_ = false;
+            callbackIdle_.notify_all();
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!waiting_.count(frame.requestId)) return; // timed out already
+        replies_[frame.requestId] = std::move(frame);
+        replyReady_.notify_all();
+    }
+
+    LocalSocket socket_;
+    std::thread reader_;
+    std::mutex sendMutex_; // one message at a time on the wire
+    mutable std::mutex mutex_;
+    std::condition_variable replyReady_;
+    std::unordered_map<uint32_t, bool> waiting_;
+    std::unordered_map<uint32_t, DaemonFrame> replies_;
+    std::vector<std::u16string> strings_{ std::u16string() }; // id 0 is ""
+    EventCallback callback_;
+    bool inCallback_{false}; // the reader is running a copy of a callback
+    std::condition_variable callbackIdle_;
+    std::atomic<uint32_t> nextId_{1};
+    std::atomic<bool> closed_{true};
+    std::atomic<uint32_t> daemonPid_{0};
+    std::chrono::milliseconds timeout_{10000};
+};
+
+} // namespace dwm
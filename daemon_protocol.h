@@ -0,0 +1,365 @@
+// Binary protocol between the thumbnail daemon (daemon_server.h) and its
+// clients (daemon_client.h) over a local stream socket. Every message is
+//
+//   [u32 size of the rest][u8 type][u32 requestId][payload]
+//
+// little-endian throughout. Replies carry the requestId of their request;
+// events and other unsolicited messages use 0. Strings from the desktop are
+// UTF-16 code units (u32 count + units), as the addon keeps them; executable
+// paths and class names travel as ids into the daemon's string table
+// (string_table.h), fetched incrementally with GetStrings like getStringTable().
+// Thumbnails and icons are PNG data URLs, encoded once by the daemon for all
+// clients. Decoders check every length against the bytes actually present
+// and fail rather than read past them.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "string_table.h"
+#include "window_system.h"
+
+namespace dwm {
+
+constexpr uint16_t kDaemonProtocolVersion = 1;
+constexpr size_t kDaemonHeaderBytes = 9;              // size + type + requestId
+constexpr size_t kDaemonMaxMessageBytes = 64u << 20; // larger sizes are a protocol error
+
+enum class DaemonMessage : uint8_t {
+    // Client -> daemon
+    Hello = 1,        // u16 version
+    ListWindows = 2,  // DaemonListRequest
+    GetThumbnail = 3, // u64 window, u16 maxWidth, u16 maxHeight
+    Subscribe = 4,    // u8 event mask (bit per WindowEventType); 0 unsubscribes
+    GetStrings = 5,   // u32 first id
+    // Daemon -> client
+    HelloReply = 0x81,    // u16 version, u32 daemon process id
+    WindowList = 0x82,    // u32 string table size, u32 count, DaemonWindow x count
+    Thumbnail = 0x83,     // u64 window, str8 data URL ("" if the capture failed)
+    Event = 0x84,         // u8 WindowEventType, DaemonWindow (no images)
+    Strings = 0x85,       // u32 first id, u32 count, str16 x count; also pushed before events
+    EventsDropped = 0x86, // u32 events not delivered because the client fell behind
+    Ack = 0x87,           // Subscribe done
+    Error = 0xFF,         // str8 message
+};
+
+inline uint8_t EventMaskBit(WindowEventType type) { return (uint8_t)(1u << (int)type); }
+constexpr uint8_t kAllWindowEvents = 0x1F;
+
+struct DaemonListRequest {
+    bool includeAllDesktops{false};
+    bool thumbnails{true};
+    bool icons{true};
+    uint16_t maxWidth{200};
+    uint16_t maxHeight{150};
+    bool orderByMru{false}; // most recently focused first (focus_history.h), if the backend tracks focus
+};
+
+struct DaemonWindow {
+    WindowId id{0};
+    std::u16string title;
+    StringId executablePathId{0};
+    StringId classNameId{0};
+    bool visible{false};
+    bool minimized{false};
+    std::string thumbnail; // data URL; empty when not requested
+    std::string icon;
+};
+
+// Appends little-endian fields to a message under construction
+class DaemonWriter {
+public:
+    // Starts a message; Finish() fills in its size
+    explicit DaemonWriter(std::string& out, DaemonMessage type, uint32_t requestId) : out_(out), start_(out.size()) {
+        U32(0);
+        U8((uint8_t)type);
+        U32(requestId);
+    }
+    void U8(uint8_t v) { out_.push_back((char)v); }
+    void U16(uint16_t v) { U8((uint8_t)v); U8((uint8_t)(v >> 8)); }
+    void U32(uint32_t v) { for (int i = 0; i < 4; ++i) U8((uint8_t)(v >> (8 * i))); }
+    void U64(uint64_t v) { for (int i = 0; i < 8; ++i) U8((uint8_t)(v >> (8 * i))); }
+    void Str8(std::string_view s) { U32((uint32_t)s.size()); out_.append(s.data(), s.size()); }
+    void Str16(std::u16string_view s) {
+        U32((uint32_t)s.size());
+        for (char16_t c : s) U16((uint16_t)c);
+    }
+    void Finish() {
+        uint32_t size = (uint32_t)(out_.size() - start_ - 4);
+        for (int i = 0; i < 4; ++i) out_[start_ + i] = (char)(uint8_t)(size >> (8 * i));
+    }
+
+private:
+    std::string& out_;
+    size_t start_;
+};
+
+// Reads fields from one message payload; any read past the end sets Failed()
+// and yields zeros, so decoders check once at the end
+class DaemonReader {
+public:
+    DaemonReader(const char* data, size_t size) : data_(data), size_(size) {}
+    uint8_t U8() { return Has(1) ? (uint8_t)data_[pos_++] : 0; }
+    uint16_t U16() { uint16_t lo = U8(); return (uint16_t)(lo | (U8() << 8)); }
+    uint32_t U32() { uint32_t v = 0; for (int i = 0; i < 4; ++i) v |= (uint32_t)U8() << (8 * i); return v; }
+    uint64_t U64() { uint64_t v = 0; for (int i = 0; i < 8; ++i) v |= (uint64_t)U8() << (8 * i); return v; }
+    bool Str8(std::string& out) {
+        uint32_t n = U32();
+        if (!Has(n)) return false;
+        out.assign(data_ + pos_, n);
+        pos_ += n;
+        return true;
+    }
+    bool Str16(std::u16string& out) {
+        uint32_t n = U32();
+        if (n > (size_ - pos_) / 2 || !Has((size_t)n * 2)) return false;
+        out.resize(n);
+        for (uint32_t i = 0; i < n; ++i) out[i] = (char16_t)U16();
+        return true;
+    }
+    bool Failed() const { return failed_; }
+    bool AtEnd() const { return pos_ == size_; }
+    // Whole payload consumed without overrun
+    bool Done() const { return !failed_ && AtEnd(); }
+
+private:
+    bool Has(size_t n) {
+        if (failed_ || n > size_ - pos_) { failed_ = true; pos_ = size_; return false; }
+        return true;
+    }
+
+    const char* data_;
+    size_t size_;
+    size_t pos_{0};
+    bool failed_{false};
+};
+
+struct DaemonFrame {
+    DaemonMessage type{DaemonMessage::Error};
+    uint32_t requestId{0};
+    std::string payload;
+};
+
+// Reassembles messages from a byte stream that arrives in arbitrary pieces
+class DaemonStreamReader {
+public:
+    void Append(const char* data, size_t n) { buffer_.append(data, n); }
+
+    // Next complete message, if any. After a protocol error (oversized
+    // message) it returns false for good and Failed() is set.
+    bool Next(DaemonFrame& out) {
+        if (failed_) return false;
+        if (buffer_.size() - pos_ < 4) return Compact();
+        uint32_t size = 0;
+        for (int i = 0; i < 4; ++i) size |= (uint32_t)(uint8_t)buffer_[pos_ + i] << (8 * i);
+        if (size < kDaemonHeaderBytes - 4 || size > kDaemonMaxMessageBytes) {
+            failed_ = true;
+            return false;
+        }
+        if (buffer_.size() - pos_ - 4 < size) return Compact();
+        const char* p = buffer_.data() + pos_ + 4;
+        out.type = (DaemonMessage)(uint8_t)p[0];
+        out.requestId = 0;
+        for (int i = 0; i < 4; ++i) out.requestId |= (uint32_t)(uint8_t)p[1 + i] << (8 * i);
+        out.payload.assign(p + 5, size - 5);
+        pos_ += 4 + size;
+        return true;
+    }
+
+    bool Failed() const { return failed_; }
+    size_t Buffered() const { return buffer_.size() - pos_; }
+
+private:
+    // Drops consumed bytes once they dominate the buffer
+    bool Compact() {
+        if (pos_ > 0 && pos_ * 2 >= buffer_.size()) {
+            buffer_.erase(0, pos_);
+            pos_ = 0;
+        }
+        return false;
+    }
+
+    std::string buffer_;
+    size_t pos_{0};
+    bool failed_{false};
+};
+
+// ---- Message bodies ----
+
+inline void EncodeHello(std::string& out, uint32_t requestId, uint16_t version) {
+    DaemonWriter w(out, DaemonMessage::Hello, requestId);
+    w.U16(version);
+    w.Finish();
+}
+
+inline void EncodeHelloReply(std::string& out, uint32_t requestId, uint32_t pid) {
+    DaemonWriter w(out, DaemonMessage::HelloReply, requestId);
+    w.U16(kDaemonProtocolVersion);
+    w.U32(pid);
+    w.Finish();
+}
+
+inline void EncodeListRequest(std::string& out, uint32_t requestId, const DaemonListRequest& r) {
+    DaemonWriter w(out, DaemonMessage::ListWindows, requestId);
+    w.U8((uint8_t)((r.includeAllDesktops ? 1 : 0) | (r.thumbnails ? 2 : 0) | (r.icons ? 4 : 0) | (r.orderByMru ? 8 : 0)));
+    w.U16(r.maxWidth);
+    w.U16(r.maxHeight);
+    w.Finish();
+}
+
+inline bool DecodeListRequest(const std::string& payload, DaemonListRequest& r) {
+    DaemonReader in(payload.data(), payload.size());
+    uint8_t flags = in.U8();
+    r.includeAllDesktops = flags & 1;
+    r.thumbnails = (flags & 2) != 0;
+    r.icons = (flags & 4) != 0;
+    r.orderByMru = (flags & 8) != 0;
+    r.maxWidth = in.U16();
+    r.maxHeight = in.U16();
+    return in.Done() && flags < 16;
+}
+
+inline void EncodeThumbnailRequest(std::string& out, uint32_t requestId, WindowId window, uint16_t maxWidth, uint16_t maxHeight) {
+    DaemonWriter w(out, DaemonMessage::GetThumbnail, requestId);
+    w.U64(window);
+    w.U16(maxWidth);
+    w.U16(maxHeight);
+    w.Finish();
+}
+
+inline bool DecodeThumbnailRequest(const std::string& payload, WindowId& window, uint16_t& maxWidth, uint16_t& maxHeight) {
+    DaemonReader in(payload.data(), payload.size());
+    window = in.U64();
+    maxWidth = in.U16();
+    maxHeight = in.U16();
+    return in.Done();
+}
+
+inline void WriteDaemonWindow(DaemonWriter& w, const DaemonWindow& win, bool images) {
+    w.U64(win.id);
+    w.Str16(win.title);
+    w.U32(win.executablePathId);
+    w.U32(win.classNameId);
+    w.U8((uint8_t)((win.visible ? 1 : 0) | (win.minimized ? 2 : 0)));
+    if (images) {
+        w.Str8(win.thumbnail);
+        w.Str8(win.icon);
+    }
+}
+
+inline bool ReadDaemonWindow(DaemonReader& in, DaemonWindow& win, bool images) {
+    win.id = in.U64();
+    if (!in.Str16(win.title)) return false;
+    win.executablePathId = in.U32();
+    win.classNameId = in.U32();
+    uint8_t flags = in.U8();
+    win.visible = flags & 1;
+    win.minimized = (flags & 2) != 0;
+    if (images && (!in.Str8(win.thumbnail) || !in.Str8(win.icon))) return false;
+    return !in.Failed() && flags < 4;
+}
+
+inline void EncodeWindowList(std::string& out, uint32_t requestId, StringId stringTableSize, const std::vector<DaemonWindow>& windows) {
+    DaemonWriter w(out, DaemonMessage::WindowList, requestId);
+    w.U32(stringTableSize);
+    w.U32((uint32_t)windows.size());
+    for (const DaemonWindow& win : windows) WriteDaemonWindow(w, win, true);
+    w.Finish();
+}
+
+inline bool DecodeWindowList(const std::string& payload, StringId& stringTableSize, std::vector<DaemonWindow>& windows) {
+    DaemonReader in(payload.data(), payload.size());
+    stringTableSize = in.U32();
+    uint32_t count = in.U32();
+    // Each window takes at least 29 bytes, so a bogus count fails before allocating
+    if (in.Failed() || count > payload.size() / 29) return false;
+    windows.resize(count);
+    for (DaemonWindow& win : windows) {
+        if (!ReadDaemonWindow(in, win, true)) return false;
+    }
+    return in.Done();
+}
+
+inline void EncodeThumbnail(std::string& out, uint32_t requestId, WindowId window, std::string_view dataUrl) {
+    DaemonWriter w(out, DaemonMessage::Thumbnail, requestId);
+    w.U64(window);
+    w.Str8(dataUrl);
+    w.Finish();
+}
+
+inline bool DecodeThumbnail(const std::string& payload, WindowId& window, std::string& dataUrl) {
+    DaemonReader in(payload.data(), payload.size());
+    window = in.U64();
+    return in.Str8(dataUrl) && in.Done();
+}
+
+inline void EncodeSubscribe(std::string& out, uint32_t requestId, uint8_t mask) {
+    DaemonWriter w(out, DaemonMessage::Subscribe, requestId);
+    w.U8(mask);
+    w.Finish();
+}
+
+inline void EncodeEvent(std::string& out, WindowEventType type, const DaemonWindow& win) {
+    DaemonWriter w(out, DaemonMessage::Event, 0);
+    w.U8((uint8_t)type);
+    WriteDaemonWindow(w, win, false);
+    w.Finish();
+}
+
+inline bool DecodeEvent(const std::string& payload, WindowEventType& type, DaemonWindow& win) {
+    DaemonReader in(payload.data(), payload.size());
+    uint8_t t = in.U8();
+    type = (WindowEventType)t;
+    return t <= (uint8_t)WindowEventType::Restored && ReadDaemonWindow(in, win, false) && in.Done();
+}
+
+inline void EncodeGetStrings(std::string& out, uint32_t requestId, StringId first) {
+    DaemonWriter w(out, DaemonMessage::GetStrings, requestId);
+    w.U32(first);
+    w.Finish();
+}
+
+inline void EncodeStrings(std::string& out, uint32_t requestId, StringId first, const std::vector<std::u16string_view>& strings) {
+    DaemonWriter w(out, DaemonMessage::Strings, requestId);
+    w.U32(first);
+    w.U32((uint32_t)strings.size());
+    for (std::u16string_view s : strings) w.Str16(s);
+    w.Finish();
+}
+
+inline bool DecodeStrings(const std::string& payload, StringId& first, std::vector<std::u16string>& strings) {
+    DaemonReader in(payload.data(), payload.size());
+    first = in.U32();
+    uint32_t count = in.U32();
+    if (in.Failed() || count > payload.size() / 4) return false;
+    strings.resize(count);
+    for (std::u16string& s : strings) {
+        if (!in.Str16(s)) return false;
+    }
+    return in.Done();
+}
+
+inline void EncodeU32Message(std::string& out, DaemonMessage type, uint32_t requestId, uint32_t value) {
+    DaemonWriter w(out, type, requestId);
+    w.U32(value);
+    w.Finish();
+}
+
+inline void EncodeU8Message(std::string& out, DaemonMessage type, uint32_t requestId, uint8_t value) {
+    DaemonWriter w(out, type, requestId);
+    w.U8(value);
+    w.Finish();
+}
+
+inline void EncodeError(std::string& out, uint32_t requestId, std::string_view message) {
+    DaemonWriter w(out, DaemonMessage::Error, requestId);
+    w.Str8(message);
+    w.Finish();
+}
+
+} // namespace dwm
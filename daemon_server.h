@@ -0,0 +1,603 @@
+// Thumbnail daemon: one process owns enumeration, hooks and captures and
+// serves any number of clients (Electron main processes, renderers, other
+// tools) over a local socket (local_socket.h) with the protocol in
+// daemon_protocol.h. Each window is captured and encoded once per TTL no
+// matter how many clients ask, and one set of WinEvent hooks feeds everyone.
+//
+// Threads: a poll loop owns the sockets (accept, read, write); workers run
+// ListWindows/GetThumbnail against the backend so a slow capture never stalls
+// other clients; an event thread describes published window events and fans
+// them out to subscribers in order, preceded by any string table entries the
+// client has not seen yet, so event ids always resolve. Every client has an outbox; events are
+// dropped (and the client told how many, with EventsDropped) once its outbox
+// holds more than outboxLimitBytes. Replies are never dropped; instead a client
+// is not read while its outbox is over the limit or it has
+// maxInFlightPerClient requests queued or running, so what it can make the
+// daemon hold is bounded by the limit plus that many replies, plus one socket
+// read of unparsed requests. A stuck client never slows the others.
+// Portable C++17, no Win32 dependencies (the backend supplies the desktop).
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "base64.h"
+#include "daemon_protocol.h"
+#include "image_frame.h"
+#include "local_socket.h"
+#include "png_encoder.h"
+#include "string_table.h"
+#include "thumbnail_cache.h"
+#include "window_system.h"
+
+namespace dwm {
+
+// What the daemon serves. All methods are called from worker/event threads,
+// possibly concurrently.
+class DaemonBackend {
+public:
+    virtual ~DaemonBackend() = default;
+    virtual void ListWindows(const DaemonListRequest& request, std::vector<DaemonWindow>& out) = 0;
+    // PNG data URL, or "" if the window cannot be captured
+    virtual std::string Thumbnail(WindowId window, int maxWidth, int maxHeight) = 0;
+    // Title, string ids and state of a live window (no images)
+    virtual bool Describe(WindowId window, DaemonWindow& out) = 0;
+    virtual StringTable& Strings() = 0;
+};
+
+// Backend over a WindowSystem (synthetic_window_system.h in tests and
+// benchmarks): Alt-Tab filter, thumbnail cache (thumbnail_cache.h) shared by
+// all clients.
+class WindowSystemBackend : public DaemonBackend {
+public:
+    WindowSystemBackend(WindowSystem& system, uint64_t ttlMs = 1200, int pngLevel = 6)
+        : system_(system), pngLevel_(pngLevel) {
+        policy_.ttlMs = ttlMs;
+    }
+
+    void ListWindows(const DaemonListRequest& request, std::vector<DaemonWindow>& out) override {
+        out.clear();
+        SweepStrings();
+        std::vector<WindowId> ids;
+        system_.EnumerateTopLevel(ids);
+        for (WindowId id : ids) {
+            WindowAttributes a;
+            if (!system_.GetAttributes(id, a) || !IsAltTabCandidate(a)) continue;
+            if (!request.includeAllDesktops && !system_.IsOnCurrentDesktop(id)) continue;
+            DaemonWindow w;
+            Fill(id, a, w);
+            if (w.title.empty()) continue;
+            if (request.thumbnails) w.thumbnail = Thumbnail(id, request.maxWidth, request.maxHeight);
+            if (request.icons) w.icon = system_.IconDataUrl(id, 32);
+            out.push_back(std::move(w));
+        }
+    }
+
+    std::string Thumbnail(WindowId window, int maxWidth, int maxHeight) override {
+        WindowRect rect;
+        if (!system_.GetRect(window, rect)) return std::string();
+        uint64_t now = system_.NowMs();
+        bool minimized = system_.IsMinimized(window);
+        std::string thumbnail;
+        if (!cache_.TryServe(window, maxWidth, maxHeight, rect, minimized, now, policy_, thumbnail)) {
+            Frame frame;
+            std::vector<uint8_t> png;
+            std::string fresh = kEmptyPngDataUrl;
+            bool good = false;
+            if (system_.Capture(window, maxWidth, maxHeight, frame) && EncodePng(frame, PngEncodeOptions{ pngLevel_ }, png)) {
+                fresh = Base64DataUrl("image/png", png.data(), png.size());
+                good = IsUsefulThumbnailFrame(frame, maxWidth, maxHeight);
+            }
+            thumbnail = cache_.Commit(window, fresh, good, maxWidth, maxHeight, rect, now, minimized, false);
+        }
+        return IsEmptyDataUrl(thumbnail) ? std::string() : thumbnail;
+    }
+
+    bool Describe(WindowId window, DaemonWindow& out) override {
+        WindowAttributes a;
+        if (!system_.GetAttributes(window, a)) return false;
+        Fill(window, a, out);
+        return true;
+    }
+
+    StringTable& Strings() override { return strings_; }
+
+private:
+    // Frees strings no window has used for a couple of sweep intervals, e.g.
+    // the per-process class names of apps that have exited. Clients are not
+    // told: a freed id is never sent again and reads as "" if fetched late.
+    void SweepStrings() {
+        uint64_t now = system_.NowMs();
+        uint64_t last = lastSweepMs_.load(std::memory_order_relaxed);
+        if (now - last < kStringSweepMs) return;
+        if (lastSweepMs_.compare_exchange_strong(last, now)) strings_.Sweep();
+    }
+
+    void Fill(WindowId id, const WindowAttributes& a, DaemonWindow& w) {
+        w.id = id;
+        w.title = DisplayTitle(a);
+        w.executablePathId = strings_.Intern(a.executablePath);
+        w.classNameId = strings_.Intern(a.className);
+        w.visible = a.visible;
+        w.minimized = a.minimized;
+    }
+
+    WindowSystem& system_;
+    ThumbnailCachePolicy policy_;
+    const int pngLevel_;
+    static constexpr uint64_t kStringSweepMs = 60000;
+    std::atomic<uint64_t> lastSweepMs_{0};
+    StringTable strings_;
+    ThumbnailCache cache_;
+};
+
+struct DaemonServerOptions {
+    size_t workerThreads{2};
+    size_t outboxLimitBytes{4u << 20}; // per client, before events are dropped and reading pauses
+    size_t maxInFlightPerClient{8};    // worker requests queued or running, before reading pauses
+    size_t eventQueueCapacity{4096};   // published, not yet fanned out
+    uint32_t processId{0};             // reported in HelloReply
+};
+
+struct DaemonServerStats {
+    uint64_t clientsAccepted{0};
+    uint64_t requests{0};
+    uint64_t eventsPublished{0};
+    uint64_t eventsDelivered{0};
+    uint64_t eventsDropped{0};    // over a client's outbox limit
+    uint64_t protocolErrors{0};   // clients disconnected for malformed input
+    uint64_t readPauses{0};       // reads stopped with input waiting because a client hit its limits
+    size_t peakOutboxBytes{0};    // largest unsent outbox of any client
+};
+
+class DaemonServer {
+public:
+    DaemonServer(DaemonBackend& backend, const DaemonServerOptions& options = DaemonServerOptions())
+        : backend_(backend), options_(options) {}
+    ~DaemonServer() { Stop(); }
+    DaemonServer(const DaemonServer&) = delete;
+    DaemonServer& operator=(const DaemonServer&) = delete;
+
+    bool Start(const std::string& path, std::string* error = nullptr) {
+        if (running_) {
+            if (error) *error = "daemon is already running";
+            return false;
+        }
+        if (!listener_.Listen(path, error) || !listener_.SetNonBlocking()) return false;
+        if (!waker_.Open(path + ".wake", error)) {
+            listener_.Close();
+            LocalSocket::Unlink(path);
+            return false;
+        }
+        path_ = path;
+        stopping_ = false;
+        running_ = true;
+        loop_ = std::thread([this] { RunLoop(); });
+        events_ = std::thread([this] { RunEvents(); });
+        for (size_t i = 0; i < (options_.workerThreads ? options_.workerThreads : 1); ++i) {
+            workers_.emplace_back([this] { RunWorker(); });
+        }
+        return true;
+    }
+
+    void Stop() {
+        if (!running_) return;
+        {
+            std::lock_guard<std::mutex> lock(workMutex_);
+            stopping_ = true;
+        }
+        workReady_.notify_all();
+        eventReady_.notify_all();
+        waker_.Wake();
+        loop_.join();
+        events_.join();
+        for (std::thread& t : workers_) t.join();
+        workers_.clear();
+        work_.clear();
+        pendingEvents_.clear();
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex_);
+            clients_.clear();
+        }
+        listener_.Close();
+        LocalSocket::Unlink(path_);
+        running_ = false;
+    }
+
+    // A window event for subscribers; cheap and non-blocking, callable from a
+    // hook thread. The window is described on the event thread.
+    void Publish(WindowEventType type, WindowId window) {
+        {
+            std::lock_guard<std::mutex> lock(workMutex_);
+            if (stopping_ || !running_) return;
+            if (pendingEvents_.size() >= options_.eventQueueCapacity) {
+                pendingEvents_.pop_front(); // oldest first; counted as dropped for everyone
+                stats_.eventsDropped++;
+            }
+            pendingEvents_.push_back({ type, window });
+            stats_.eventsPublished++;
+        }
+        eventReady_.notify_one();
+    }
+
+    bool Running() const { return running_; }
+    const std::string& Path() const { return path_; }
+
+    size_t ClientCount() const {
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        return clients_.size();
+    }
+
+    DaemonServerStats Stats() const {
+        DaemonServerStats stats;
+        {
+            std::lock_guard<std::mutex> lock(workMutex_);
+            stats = stats_;
+        }
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        stats.peakOutboxBytes = peakOutbox_;
+        return stats;
+    }
+
+private:
+    struct Client {
+        LocalSocket socket;        // loop thread only
+        DaemonStreamReader reader; // loop thread only
+        std::string outbox;        // clientsMutex_
+        size_t outboxSent{0};      // clientsMutex_
+        uint8_t eventMask{0};      // clientsMutex_
+        uint32_t droppedEvents{0}; // clientsMutex_; reported before the next delivered event
+        StringId stringsSent{1};   // clientsMutex_; entries [0, stringsSent) are known to the client
+        size_t inFlight{0};        // clientsMutex_; requests handed to workers, not yet answered
+        size_t Pending() const { return outbox.size() - outboxSent; }
+    };
+
+    struct Work {
+        uint64_t client;
+        DaemonFrame frame;
+    };
+
+    void RunLoop() {
+        std::vector<PollEntry> entries;
+        std::vector<uint64_t> ids;
+        std::vector<char> buffer(64 * 1024);
+        while (!stopping_) {
+            entries.clear();
+            ids.clear();
+            entries.push_back(PollEntry{ listener_.Handle(), POLLIN, 0 });
+            entries.push_back(PollEntry{ waker_.Reader().Handle(), POLLIN, 0 });
+            {
+                std::lock_guard<std::mutex> lock(clientsMutex_);
+                for (auto& [id, client] : clients_) {
+                    short events = 0;
+                    if (Accepting(*client)) events |= POLLIN;
+                    if (client->Pending()) events |= POLLOUT;
+                    entries.push_back(PollEntry{ client->socket.Handle(), events, 0 });
+                    ids.push_back(id);
+                }
+            }
+            if (PollSockets(entries, -1) < 0) break;
+            if (entries[1].revents) waker_.Drain();
+            if (entries[0].revents & POLLIN) AcceptClients();
+            for (size_t i = 0; i < ids.size(); ++i) {
+                short revents = entries[i + 2].revents;
+                std::shared_ptr<Client> client = Find(ids[i]);
+                if (!client) continue;
+                bool alive = true;
+                if (revents & POLLOUT) alive = Flush(*client);
+                // Also without revents: requests left buffered at the client's
+                // limits go on once a reply has been written or sent
+                if (alive) alive = ReadFrom(ids[i], *client, buffer, revents);
+                if (!alive) Drop(ids[i]);
+            }
+        }
+    }
+
+    void AcceptClients() {
+        for (;;) {
+            LocalSocket socket = listener_.Accept();
+            if (!socket.IsOpen()) return;
+            if (!socket.SetNonBlocking()) continue;
+            auto client = std::make_shared<Client>();
+            client->socket = std::move(socket);
+            std::lock_guard<std::mutex> lock(clientsMutex_);
+            clients_.emplace(nextClient_++, std::move(client));
+            std::lock_guard<std::mutex> statsLock(workMutex_);
+            stats_.clientsAccepted++;
+        }
+    }
+
+    // Under the client's limits: outbox within outboxLimitBytes and fewer than
+    // maxInFlightPerClient requests with the workers. clientsMutex_ held.
+    bool Accepting(const Client& client) const {
+        return client.Pending() <= options_.outboxLimitBytes && client.inFlight < options_.maxInFlightPerClient;
+    }
+
+    bool AcceptingNow(const Client& client) {
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        return Accepting(client);
+    }
+
+    // Handles buffered requests, then reads more, one buffer at a time, while
+    // the client stays under its limits; false if it is gone or broke the
+    // protocol
+    bool ReadFrom(uint64_t id, Client& client, std::vector<char>& buffer, short revents) {
+        if (client.reader.Buffered() && !HandleBuffered(id, client)) return false;
+        if (!(revents & (POLLIN | POLLHUP | POLLERR))) return true;
+        while (AcceptingNow(client)) {
+            size_t n = 0;
+            IoResult r = client.socket.Receive(buffer.data(), buffer.size(), n);
+            if (r == IoResult::Closed) return false;
+            if (r == IoResult::WouldBlock) return true;
+            client.reader.Append(buffer.data(), n);
+            if (!HandleBuffered(id, client)) return false;
+        }
+        // Paused with input waiting; a client that hung up will not read its replies either
+        {
+            std::lock_guard<std::mutex> lock(workMutex_);
+            stats_.readPauses++;
+        }
+        return !(revents & (POLLHUP | POLLERR));
+    }
+
+    bool HandleBuffered(uint64_t id, Client& client) {
+        DaemonFrame frame;
+        while (AcceptingNow(client) && client.reader.Next(frame)) {
+            if (!Handle(id, client, frame)) {
+                CountProtocolError();
+                return false;
+            }
+        }
+        if (client.reader.Failed()) {
+            CountProtocolError();
+            return false;
+        }
+        return true;
+    }
+
+    // Cheap requests are answered on the loop thread; the rest go to workers
+    bool Handle(uint64_t id, Client& client, DaemonFrame& frame) {
+        {
+            std::lock_guard<std::mutex> lock(workMutex_);
+            stats_.requests++;
+        }
+        std::string reply;
+        switch (frame.type) {
+            case DaemonMessage::Hello: {
+                DaemonReader in(frame.payload.data(), frame.payload.size());
+                uint16_t version = in.U16();
+                if (!in.Done()) return false;
+                if (version != kDaemonProtocolVersion) {
+                    EncodeError(reply, frame.requestId, "unsupported protocol version");
+                } else {
+                    EncodeHelloReply(reply, frame.requestId, options_.processId);
+                }
+                break;
+            }
+            case DaemonMessage::Subscribe: {
+                DaemonReader in(frame.payload.data(), frame.payload.size());
+                uint8_t mask = in.U8();
+                if (!in.Done()) return false;
+                {
+                    std::lock_guard<std::mutex> lock(clientsMutex_);
+                    client.eventMask = mask & kAllWindowEvents;
+                }
+                EncodeU8Message(reply, DaemonMessage::Ack, frame.requestId, mask & kAllWindowEvents);
+                break;
+            }
+            case DaemonMessage::GetStrings: {
+                DaemonReader in(frame.payload.data(), frame.payload.size());
+                StringId first = in.U32();
+                if (!in.Done()) return false;
+                StringTable& table = backend_.Strings();
+                StringId end = table.Size();
+                std::vector<std::u16string> owned;
+                if (first < end) table.Range(first, end, owned);
+                std::vector<std::u16string_view> strings(owned.begin(), owned.end());
+                EncodeStrings(reply, frame.requestId, first, strings);
+                std::lock_guard<std::mutex> lock(clientsMutex_);
+                if (first <= client.stringsSent) client.stringsSent = std::max(client.stringsSent, end);
+                break;
+            }
+            case DaemonMessage::ListWindows:
+            case DaemonMessage::GetThumbnail: {
+                {
+                    std::lock_guard<std::mutex> lock(clientsMutex_);
+                    client.inFlight++;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(workMutex_);
+                    work_.push_back(Work{ id, std::move(frame) });
+                }
+                workReady_.notify_one();
+                return true;
+            }
+            default:
+                return false;
+        }
+        Enqueue(client, reply);
+        return Flush(client);
+    }
+
+    void RunWorker() {
+        std::string reply;
+        std::vector<DaemonWindow> windows;
+        for (;;) {
+            Work work;
+            {
+                std::unique_lock<std::mutex> lock(workMutex_);
+                workReady_.wait(lock, [&] { return stopping_ || !work_.empty(); });
+                if (stopping_) return;
+                work = std::move(work_.front());
+                work_.pop_front();
+            }
+            reply.clear();
+            if (work.frame.type == DaemonMessage::ListWindows) {
+                DaemonListRequest request;
+                if (!DecodeListRequest(work.frame.payload, request)) {
+                    EncodeError(reply, work.frame.requestId, "malformed ListWindows");
+                } else {
+                    backend_.ListWindows(request, windows);
+                    // After listing, so every id in the reply is below the size
+                    EncodeWindowList(reply, work.frame.requestId, backend_.Strings().Size(), windows);
+                }
+            } else {
+                WindowId window;
+                uint16_t w, h;
+                if (!DecodeThumbnailRequest(work.frame.payload, window, w, h) || w == 0 || h == 0) {
+                    EncodeError(reply, work.frame.requestId, "malformed GetThumbnail");
+                } else {
+                    EncodeThumbnail(reply, work.frame.requestId, window, backend_.Thumbnail(window, w, h));
+                }
+            }
+            std::shared_ptr<Client> client = Find(work.client);
+            if (!client) continue; // disconnected meanwhile
+            {
+                std::lock_guard<std::mutex> lock(clientsMutex_);
+                client->outbox += reply;
+                client->inFlight--;
+                NotePeak(*client);
+            }
+            waker_.Wake(); // the reply to send, and maybe room to read again
+        }
+    }
+
+    void RunEvents() {
+        std::string message, dropped, strings;
+        std::vector<std::u16string> owned;
+        std::vector<std::u16string_view> views;
+        for (;;) {
+            std::pair<WindowEventType, WindowId> event;
+            {
+                std::unique_lock<std::mutex> lock(workMutex_);
+                eventReady_.wait(lock, [&] { return stopping_ || !pendingEvents_.empty(); });
+                if (stopping_) return;
+                event = pendingEvents_.front();
+                pendingEvents_.pop_front();
+            }
+            DaemonWindow window;
+            if (!backend_.Describe(event.second, window)) {
+                window = DaemonWindow{};
+                window.id = event.second; // closed: only the id is left
+            }
+            message.clear();
+            EncodeEvent(message, event.first, window);
+            StringTable& table = backend_.Strings();
+            StringId tableSize = table.Size();
+            StringId needed = std::max(window.executablePathId, window.classNameId) + 1;
+            uint8_t bit = EventMaskBit(event.first);
+            uint64_t delivered = 0, lost = 0;
+            {
+                std::lock_guard<std::mutex> lock(clientsMutex_);
+                for (auto& [id, client] : clients_) {
+                    if (!(client->eventMask & bit)) continue;
+                    if (client->Pending() > options_.outboxLimitBytes) {
+                        client->droppedEvents++;
+                        lost++;
+                        continue;
+                    }
+                    if (client->stringsSent < needed) {
+                        table.Range(client->stringsSent, tableSize, owned);
+                        views.assign(owned.begin(), owned.end());
+                        strings.clear();
+                        EncodeStrings(strings, 0, client->stringsSent, views);
+                        client->outbox += strings;
+                        client->stringsSent = tableSize;
+                    }
+                    if (client->droppedEvents) {
+                        dropped.clear();
+                        EncodeU32Message(dropped, DaemonMessage::EventsDropped, 0, client->droppedEvents);
+                        client->outbox += dropped;
+                        client->droppedEvents = 0;
+                    }
+                    client->outbox += message;
+                    NotePeak(*client);
+                    delivered++;
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(workMutex_);
+                stats_.eventsDelivered += delivered;
+                stats_.eventsDropped += lost;
+            }
+            if (delivered) waker_.Wake();
+        }
+    }
+
+    void Enqueue(Client& client, const std::string& bytes) {
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        client.outbox += bytes;
+        NotePeak(client);
+    }
+
+    // clientsMutex_ held
+    void NotePeak(const Client& client) { peakOutbox_ = std::max(peakOutbox_, client.Pending()); }
+
+    // Writes what the socket takes now; false if the client is gone
+    bool Flush(Client& client) {
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        if (!client.Pending()) return true;
+        size_t sent = 0;
+        IoResult r = client.socket.Send(client.outbox.data() + client.outboxSent, client.Pending(), sent);
+        client.outboxSent += sent;
+        if (client.outboxSent == client.outbox.size()) {
+            client.outbox.clear();
+            client.outboxSent = 0;
+        } else if (client.outboxSent > (64u << 10) && client.outboxSent * 2 > client.outbox.size()) {
+            client.outbox.erase(0, client.outboxSent);
+            client.outboxSent = 0;
+        }
+        return r != IoResult::Closed;
+    }
+
+    std::shared_ptr<Client> Find(uint64_t id) {
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        auto it = clients_.find(id);
+        return it == clients_.end() ? nullptr : it->second;
+    }
+
+    void Drop(uint64_t id) {
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        clients_.erase(id);
+    }
+
+    void CountProtocolError() {
+        std::lock_guard<std::mutex> lock(workMutex_);
+        stats_.protocolErrors++;
+    }
+
+    DaemonBackend& backend_;
+    const DaemonServerOptions options_;
+    std::string path_;
+    LocalSocket listener_;
+    SocketWaker waker_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stopping_{false};
+    std::thread loop_;
+    std::thread events_;
+    std::vector<std::thread> workers_;
+
+    mutable std::mutex workMutex_; // work_, pendingEvents_, stats_
+    std::condition_variable workReady_;
+    std::condition_variable eventReady_;
+    std::deque<Work> work_;
+    std::deque<std::pair<WindowEventType, WindowId>> pendingEvents_;
+    DaemonServerStats stats_;
+
+    mutable std::mutex clientsMutex_; // clients_ and the outbox fields of every client
+    std::unordered_map<uint64_t, std::shared_ptr<Client>> clients_;
+    uint64_t nextClient_{1};
+    size_t peakOutbox_{0};
+};
+
+} // namespace dwm
@@ -0,0 +1,454 @@
+// Small DEFLATE (RFC 1951) encoder with a zlib (RFC 1950) wrapper, plus the
+// Adler-32 and CRC-32 checksums PNG needs. Levels follow zlib's meaning:
+// 0 = stored, 1 = fastest, 9 = smallest. LZ77 uses hash chains over a 32 KiB
+// window with lazy matching from level 4; blocks use dynamic Huffman codes
+// (or fixed codes when smaller).
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace dwm {
+
+// ---------------- Checksums ----------------
+
+inline uint32_t Adler32(uint32_t adler, const uint8_t* data, size_t len) {
+    const uint32_t kMod = 65521;
+    uint32_t a = adler & 0xffff, b = adler >> 16;
+    while (len > 0) {
+        // 5552 is the largest n with 255n(n+1)/2 + (n+1)(kMod-1) < 2^32
+        size_t n = len < 5552 ? len : 5552;
+        len -= n;
+        while (n--) { a += *data++; b += a; }
+        a %= kMod; b %= kMod;
+    }
+    return (b << 16) | a;
+}
+
+inline const std::array<uint32_t, 256>& Crc32Table() {
+    static const std::array<uint32_t, 256> table = []{
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    return table;
+}
+
+// Running CRC-32 (start with 0).
+inline uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t len) {
+    const auto& t = Crc32Table();
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) crc = t[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+// ---------------- Bit output ----------------
+
+// LSB-first bit writer as DEFLATE requires.
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void Put(uint32_t bits, int count) {
+        acc_ |= (uint64_t)bits << n_;
+        n_ += count;
+        while (n_ >= 8) { out_.push_back((uint8_t)acc_); acc_ >>= 8; n_ -= 8; }
+    }
+    void AlignToByte() { if (n_ > 0) Put(0, 8 - n_); }
+    int PendingBits() const { return n_; }
+    std::vector<uint8_t>& Bytes() { return out_; }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint64_t acc_{0};
+    int n_{0};
+};
+
+namespace deflate_detail {
+
+static const uint16_t kLengthBase[29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+static const uint8_t kLengthExtra[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+static const uint16_t kDistBase[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+static const uint8_t kDistExtra[30] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+static const uint8_t kCodeLengthOrder[19] = { 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
+
+inline int LengthSymbol(int len) { // 3..258 -> 0..28
+    int s = 0;
+    while (s < 28 && kLengthBase[s + 1] <= len) ++s;
+    return s;
+}
+inline int DistSymbol(int dist) { // 1..32768 -> 0..29
+    int s = 0;
+    while (s < 29 && kDistBase[s + 1] <= dist) ++s;
+    return s;
+}
+
+struct SymbolTables {
+    uint8_t lengthSym[259];
+    uint8_t distSymLow[512];   // dist - 1 < 512
+    uint8_t distSymHigh[256];  // (dist - 1) >> 7 for larger distances
+    SymbolTables() {
+        for (int l = 3; l <= 258; ++l) lengthSym[l] = (uint8_t)LengthSymbol(l);
+        for (int d = 0; d < 512; ++d) distSymLow[d] = (uint8_t)DistSymbol(d + 1);
+        for (int h = 0; h < 256; ++h) distSymHigh[h] = (uint8_t)DistSymbol((h << 7) + 1);
+    }
+    int Dist(int dist) const {
+        int d = dist - 1;
+        return d < 512 ? distSymLow[d] : distSymHigh[d >> 7];
+    }
+};
+
+inline const SymbolTables& Tables() { static const SymbolTables t; return t; }
+
+// Code lengths for the given frequencies, limited to maxBits. Uses a Huffman
+// tree; if it is too deep, frequencies are flattened and the tree rebuilt.
+inline void BuildLengths(const uint32_t* freq, int n, int maxBits, uint8_t* lengths) {
+    std::vector<uint32_t> f(freq, freq + n);
+    for (;;) {
+        std::fill(lengths, lengths + n, (uint8_t)0);
+        struct Node { uint64_t w; int left, right; };
+        std::vector<Node> nodes;
+        std::vector<int> heap;
+        nodes.reserve((size_t)n * 2);
+        for (int i = 0; i < n; ++i) if (f[(size_t)i]) { nodes.push_back({ f[(size_t)i], -1 - i, 0 }); heap.push_back((int)nodes.size() - 1); }
+        if (heap.empty()) return;
+        if (heap.size() == 1) { lengths[-1 - nodes[(size_t)heap[0]].left] = 1; return; }
+        auto cmp = [&](int a, int b) { return nodes[(size_t)a].w > nodes[(size_t)b].w || (nodes[(size_t)a].w == nodes[(size_t)b].w && a > b); };
+        std::make_heap(heap.begin(), heap.end(), cmp);
+        while (heap.size() > 1) {
+            std::pop_heap(heap.begin(), heap.end(), cmp); int a = heap.back(); heap.pop_back();
+            std::pop_heap(heap.begin(), heap.end(), cmp); int b = heap.back(); heap.pop_back();
+            nodes.push_back({ nodes[(size_t)a].w + nodes[(size_t)b].w, a, b });
+            heap.push_back((int)nodes.size() - 1);
+            std::push_heap(heap.begin(), heap.end(), cmp);
+        }
+        // Depth-first walk for leaf depths
+        int maxDepth = 0;
+        std::vector<std::pair<int, int>> stack{ { heap[0], 0 } };
+        while (!stack.empty()) {
+            auto [idx, depth] = stack.back(); stack.pop_back();
+            const Node& nd = nodes[(size_t)idx];
+            if (nd.left < 0) { lengths[-1 - nd.left] = (uint8_t)depth; maxDepth = std::max(maxDepth, depth); continue; }
+            stack.push_back({ nd.left, depth + 1 });
+            stack.push_back({ nd.right, depth + 1 });
+        }
+        if (maxDepth <= maxBits) return;
+        for (auto& x : f) if (x) x = (x >> 1) | 1;
+    }
+}
+
+// Canonical codes from lengths (RFC 1951 3.2.2). Huffman codes are defined
+// MSB-first, so they are returned bit-reversed, ready for BitWriter::Put.
+inline void BuildCodes(const uint8_t* lengths, int n, uint16_t* codes) {
+    uint16_t count[16] = {}, next[16] = {};
+    for (int i = 0; i < n; ++i) count[lengths[i]]++;
+    count[0] = 0;
+    uint16_t code = 0;
+    for (int bits = 1; bits < 16; ++bits) { code = (uint16_t)((code + count[bits - 1]) << 1); next[bits] = code; }
+    for (int i = 0; i < n; ++i) {
+        if (!lengths[i]) { codes[i] = 0; continue; }
+        uint32_t c = next[lengths[i]]++, r = 0;
+        for (int b = 0; b < lengths[i]; ++b) { r = (r << 1) | (c & 1); c >>= 1; }
+        codes[i] = (uint16_t)r;
+    }
+}
+
+// One LZ77 symbol: literal (dist == 0) or match.
+struct Symbol { uint16_t litLen; uint16_t dist; };
+
+struct LevelParams { int goodLength, maxLazy, niceLength, maxChain; bool lazy; };
+inline LevelParams ParamsFor(int level) {
+    static const LevelParams table[10] = {
+        { 0, 0, 0, 0, false },          // 0: stored
+        { 4, 4, 8, 4, false },          // 1
+        { 4, 5, 16, 8, false },
+        { 4, 6, 32, 32, false },
+        { 4, 4, 16, 16, true },         // 4: lazy matching from here
+        { 8, 16, 32, 32, true },
+        { 8, 16, 128, 128, true },      // 6: zlib default
+        { 8, 32, 128, 256, true },
+        { 32, 128, 258, 1024, true },
+        { 32, 258, 258, 4096, true },   // 9
+    };
+    return table[std::min(9, std::max(0, level))];
+}
+
+inline void WriteStored(BitWriter& bw, const uint8_t* data, size_t len, bool final) {
+    do {
+        size_t n = std::min<size_t>(len, 65535);
+        len -= n;
+        bool last = final && len == 0;
+        bw.Put(last ? 1 : 0, 1);
+        bw.Put(0, 2);
+        bw.AlignToByte();
+        bw.Put((uint32_t)n, 16);
+        bw.Put((uint32_t)(~n & 0xffff), 16);
+        auto& out = bw.Bytes();
+        out.insert(out.end(), data, data + n);
+        data += n;
+    } while (len > 0);
+}
+
+// Emits one block for the symbols covering raw[0, rawLen): dynamic or fixed
+// Huffman, or stored when the data does not compress.
+inline void WriteBlock(BitWriter& bw, const std::vector<Symbol>& syms, const uint8_t* raw, size_t rawLen, bool final) {
+    const SymbolTables& T = Tables();
+    uint32_t litFreq[286] = {}, distFreq[30] = {};
+    for (const Symbol& s : syms) {
+        if (s.dist == 0) litFreq[s.litLen]++;
+        else { litFreq[257 + T.lengthSym[s.litLen]]++; distFreq[T.Dist(s.dist)]++; }
+    }
+    litFreq[256] = 1;
+
+    uint8_t litLen[286], distLen[30];
+    BuildLengths(litFreq, 286, 15, litLen);
+    BuildLengths(distFreq, 30, 15, distLen);
+    // At least one distance code must be present (two keep some inflaters happy)
+    int nonzeroDist = 0;
+    for (int i = 0; i < 30; ++i) if (distLen[i]) nonzeroDist++;
+    if (nonzeroDist == 0) { distLen[0] = 1; distLen[1] = 1; }
+    else if (nonzeroDist == 1) { for (int i = 0; i < 30; ++i) if (!distLen[i]) { distLen[i] = 1; break; } }
+
+    int hlit = 286; while (hlit > 257 && litLen[hlit - 1] == 0) --hlit;
+    int hdist = 30; while (hdist > 1 && distLen[hdist - 1] == 0) --hdist;
+
+    // Run-length encode the concatenated code lengths (symbols 16/17/18)
+    std::vector<uint8_t> all(litLen, litLen + hlit);
+    all.insert(all.end(), distLen, distLen + hdist);
+    struct Rle { uint8_t sym, extra; };
+    std::vector<Rle> rle;
+    uint32_t clFreq[19] = {};
+    for (size_t i = 0; i < all.size();) {
+        uint8_t v = all[i];
+        size_t run = 1;
+        while (i + run < all.size() && all[i + run] == v) ++run;
+        size_t left = run;
+        if (v == 0) {
+            while (left >= 11) { size_t r = std::min<size_t>(left, 138); rle.push_back({ 18, (uint8_t)(r - 11) }); clFreq[18]++; left -= r; }
+            if (left >= 3) { rle.push_back({ 17, (uint8_t)(left - 3) }); clFreq[17]++; left = 0; }
+        } else {
+            rle.push_back({ v, 0 }); clFreq[v]++; left--;
+            while (left >= 3) { size_t r = std::min<size_t>(left, 6); rle.push_back({ 16, (uint8_t)(r - 3) }); clFreq[16]++; left -= r; }
+        }
+        while (left > 0) { rle.push_back({ v, 0 }); clFreq[v]++; left--; }
+        i += run;
+    }
+    uint8_t clLen[19];
+    BuildLengths(clFreq, 19, 7, clLen);
+    int hclen = 19; while (hclen > 4 && clLen[kCodeLengthOrder[hclen - 1]] == 0) --hclen;
+
+    // Compare against the fixed code
+    static const uint8_t* fixedLit = []{
+        static uint8_t l[288];
+        for (int i = 0; i < 144; ++i) l[i] = 8;
+        for (int i = 144; i < 256; ++i) l[i] = 9;
+        for (int i = 256; i < 280; ++i) l[i] = 7;
+        for (int i = 280; i < 288; ++i) l[i] = 8;
+        return l;
+    }();
+    uint64_t dynBits = 5 + 5 + 4 + 3ull * (uint64_t)hclen, fixBits = 0;
+    for (const Rle& r : rle) dynBits += clLen[r.sym] + (r.sym == 16 ? 2 : r.sym == 17 ? 3 : r.sym == 18 ? 7 : 0);
+    for (int i = 0; i < 286; ++i) {
+        uint64_t extra = i >= 257 ? kLengthExtra[i - 257] : 0;
+        dynBits += (uint64_t)litFreq[i] * (litLen[i] + extra);
+        fixBits += (uint64_t)litFreq[i] * (fixedLit[i] + extra);
+    }
+    for (int i = 0; i < 30; ++i) {
+        dynBits += (uint64_t)distFreq[i] * (distLen[i] + kDistExtra[i]);
+        fixBits += (uint64_t)distFreq[i] * (5 + kDistExtra[i]);
+    }
+
+    uint64_t storedBits = (uint64_t)rawLen * 8 + ((rawLen + 65534) / 65535 + 1) * 40;
+    if (storedBits < std::min(dynBits, fixBits)) {
+        WriteStored(bw, raw, rawLen, final);
+        return;
+    }
+
+    uint16_t litCodes[288], distCodes[30];
+    const uint8_t* useLit;
+    const uint8_t* useDist;
+    static const uint8_t fixedDist[30] = { 5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5 };
+    bw.Put(final ? 1 : 0, 1);
+    if (fixBits <= dynBits) {
+        bw.Put(1, 2);
+        BuildCodes(fixedLit, 288, litCodes);
+        BuildCodes(fixedDist, 30, distCodes);
+        useLit = fixedLit; useDist = fixedDist;
+    } else {
+        bw.Put(2, 2);
+        bw.Put((uint32_t)(hlit - 257), 5);
+        bw.Put((uint32_t)(hdist - 1), 5);
+        bw.Put((uint32_t)(hclen - 4), 4);
+        for (int i = 0; i < hclen; ++i) bw.Put(clLen[kCodeLengthOrder[i]], 3);
+        uint16_t clCodes[19];
+        BuildCodes(clLen, 19, clCodes);
+        for (const Rle& r : rle) {
+            bw.Put(clCodes[r.sym], clLen[r.sym]);
+            if (r.sym == 16) bw.Put(r.extra, 2);
+            else if (r.sym == 17) bw.Put(r.extra, 3);
+            else if (r.sym == 18) bw.Put(r.extra, 7);
+        }
+        BuildCodes(litLen, 286, litCodes);
+        BuildCodes(distLen, 30, distCodes);
+        useLit = litLen; useDist = distLen;
+    }
+    for (const Symbol& s : syms) {
+        if (s.dist == 0) { bw.Put(litCodes[s.litLen], useLit[s.litLen]); continue; }
+        int ls = T.lengthSym[s.litLen];
+        bw.Put(litCodes[257 + ls], useLit[257 + ls]);
+        if (kLengthExtra[ls]) bw.Put((uint32_t)(s.litLen - kLengthBase[ls]), kLengthExtra[ls]);
+        int ds = T.Dist(s.dist);
+        bw.Put(distCodes[ds], useDist[ds]);
+        if (kDistExtra[ds]) bw.Put((uint32_t)(s.dist - kDistBase[ds]), kDistExtra[ds]);
+    }
+    bw.Put(litCodes[256], useLit[256]);
+}
+
+} // namespace deflate_detail
+
+// Raw DEFLATE of data[begin, end). Bytes in [max(0, begin - 32768), begin) are
+// used as the preset window (matches may reach back into them) but not emitted,
+// which lets callers compress a stream in pieces. With final = false the output
+// ends with an empty stored block (sync flush) so it is byte-aligned and pieces
+// can be concatenated.
+inline void DeflateRange(const uint8_t* data, size_t begin, size_t end, int level, bool final, BitWriter& bw) {
+    using namespace deflate_detail;
+    const size_t kWindow = 32768;
+    if (level <= 0) {
+        WriteStored(bw, data + begin, end - begin, final);
+        if (!final) WriteStored(bw, data + end, 0, false);
+        return;
+    }
+    const LevelParams P = ParamsFor(level);
+    const size_t base = begin > kWindow ? begin - kWindow : 0;
+    const size_t n = end - base;
+    const int kHashBits = 15;
+    const uint32_t kHashSize = 1u << kHashBits;
+    std::vector<int32_t> head(kHashSize, -1);
+    std::vector<int32_t> prev(n, -1); // chain link, indexed by position - base
+    auto hashAt = [&](size_t pos) -> uint32_t {
+        uint32_t v = (uint32_t)data[pos] | ((uint32_t)data[pos + 1] << 8) | ((uint32_t)data[pos + 2] << 16);
+        return (v * 2654435761u) >> (32 - kHashBits);
+    };
+    auto insert = [&](size_t pos) {
+        if (pos + 3 > end) return;
+        uint32_t h = hashAt(pos);
+        prev[pos - base] = head[h];
+        head[h] = (int32_t)(pos - base);
+    };
+    auto longestMatch = [&](size_t pos, int prevLen, int& bestDist) -> int {
+        if (pos + 3 > end) return 0;
+        int maxLen = (int)std::min<size_t>(258, end - pos);
+        if (prevLen >= maxLen) return 0;
+        int chain = P.maxChain;
+        if (prevLen >= P.goodLength) chain >>= 2;
+        int best = prevLen;
+        int32_t cand = head[hashAt(pos)];
+        const uint8_t* cur = data + pos;
+        while (cand >= 0 && chain-- > 0) {
+            size_t cpos = base + (size_t)cand;
+            if (cpos >= pos) { cand = prev[(size_t)cand]; continue; }
+            size_t dist = pos - cpos;
+            if (dist > kWindow) break;
+            const uint8_t* m = data + cpos;
+            if (m[best] == cur[best] && m[0] == cur[0] && m[1] == cur[1]) {
+                int len = 2;
+                while (len < maxLen && m[len] == cur[len]) ++len;
+                if (len > best) {
+                    best = len; bestDist = (int)dist;
+                    if (len >= P.niceLength || len >= maxLen) break;
+                }
+            }
+            cand = prev[(size_t)cand];
+        }
+        return best > prevLen ? best : 0;
+    };
+
+    // Seed the hash chains with the preset window
+    for (size_t p = base; p < begin; ++p) insert(p);
+
+    std::vector<Symbol> syms;
+    const size_t kBlockSymbols = 16384;
+    syms.reserve(kBlockSymbols + 2);
+    size_t blockStart = begin;
+    size_t pos = begin;
+    auto flushBlock = [&](bool last) {
+        WriteBlock(bw, syms, data + blockStart, pos - blockStart, last);
+        syms.clear();
+        blockStart = pos;
+    };
+
+    while (pos < end) {
+        int dist = 0;
+        int len = longestMatch(pos, 2, dist);
+        if (len >= 3 && P.lazy && len < P.maxLazy && pos + 1 < end) {
+            insert(pos);
+            int dist2 = 0;
+            int len2 = longestMatch(pos + 1, len, dist2);
+            if (len2 > len) {
+                // Defer: emit a literal and take the longer match at pos + 1
+                syms.push_back({ data[pos], 0 });
+                ++pos;
+                len = len2; dist = dist2;
+            } else {
+                // Already inserted pos; insert the rest of the match below
+                syms.push_back({ (uint16_t)len, (uint16_t)dist });
+                for (size_t k = 1; k < (size_t)len; ++k) insert(pos + k);
+                pos += (size_t)len;
+                if (syms.size() >= kBlockSymbols) flushBlock(false);
+                continue;
+            }
+        }
+        if (len >= 3) {
+            syms.push_back({ (uint16_t)len, (uint16_t)dist });
+            // Fast levels skip indexing inside long matches, like zlib
+            if (!P.lazy && len > P.maxLazy) {
+                insert(pos);
+            } else {
+                for (size_t k = 0; k < (size_t)len; ++k) insert(pos + k);
+            }
+            pos += (size_t)len;
+        } else {
+            syms.push_back({ data[pos], 0 });
+            insert(pos);
+            ++pos;
+        }
+        if (syms.size() >= kBlockSymbols) flushBlock(false);
+    }
+    flushBlock(final);
+    if (!final) WriteStored(bw, data + end, 0, false); // sync flush marker
+}
+
+inline void WriteZlibHeader(std::vector<uint8_t>& out, int level) {
+    uint8_t cmf = 0x78; // deflate, 32 KiB window
+    uint8_t flevel = level <= 1 ? 0 : level <= 5 ? 1 : level == 6 ? 2 : 3;
+    uint8_t flg = (uint8_t)(flevel << 6);
+    flg = (uint8_t)(flg + (31 - ((cmf * 256 + flg) % 31)) % 31);
+    out.push_back(cmf);
+    out.push_back(flg);
+}
+
+inline void WriteBigEndian32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back((uint8_t)(v >> 24)); out.push_back((uint8_t)(v >> 16));
+    out.push_back((uint8_t)(v >> 8)); out.push_back((uint8_t)v);
+}
+
+// zlib stream of data[0, len) appended to out.
+inline void ZlibCompress(const uint8_t* data, size_t len, int level, std::vector<uint8_t>& out) {
+    WriteZlibHeader(out, level);
+    BitWriter bw(out);
+    DeflateRange(data, 0, len, level, true, bw);
+    bw.AlignToByte();
+    WriteBigEndian32(out, Adler32(1, data, len));
+}
+
+} // namespace dwm
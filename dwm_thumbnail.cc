@@ -28,6 +28,7 @@
 #undef min
 #undef max
 #ifdef ENABLE_WGC
+#include <d3d10.h> // ID3D10Multithread
 #include <d3d11.h>
 #include <dxgi1_2.h>
 // C++/WinRT (Windows Graphics Capture & Imaging)
@@ -46,7 +47,37 @@
 #include <iomanip>
 #include <unordered_map>
 #include <mutex>
+#include <condition_variable>
 #include <functional>
+#include <memory>
+#include <chrono>
+#include <type_traits>
+#include <unordered_set>
+
+#include "base64.h"
+#include "capture_pipeline.h"
+#include "daemon_client.h"
+#include "daemon_server.h"
+#include "enumeration_arena.h"
+#include "focus_history.h"
+#include "frame_ring.h"
+#include "hedged_attempts.h"
+#include "image_frame.h"
+#include "latency_histogram.h"
+#include "memory_accounting.h"
+#include "negative_cache.h"
+#include "png_encoder.h"
+#include "png_stream.h"
+#include "runtime_config.h"
+#include "shared_memory.h"
+#include "stage_timing.h"
+#include "startup_timing.h"
+#include "string_table.h"
+#include "thumbnail_cache.h"
+#include "trace_writer.h"
+#include "utf16.h"
+#include "window_event_tracker.h"
+#include "window_system.h"
 
 // PrintWindow Flags definieren falls nicht verfügbar
 #ifndef PW_RENDERFULLCONTENT
@@ -80,85 +111,153 @@
 
 using namespace Napi;
 
-// ---------------- UTF-8 / UTF-16 helpers ----------------
+// Starts the module load clock during static initialization, before Init
+static const dwm::StartupTiming::Clock::time_point g_moduleLoadStart = dwm::StartupTiming::Instance().LoadStart();
+
+// ---------------- UTF-16 helpers ----------------
+// Window titles and paths stay UTF-16 from the Win32 calls to JS:
+// String::New(env, std::u16string) is napi_create_string_utf16, which V8 stores
+// without decoding. utf16.h converts where UTF-8 is needed (trace files).
+static_assert(sizeof(wchar_t) == sizeof(char16_t), "WCHAR is UTF-16 on Windows");
+static const char16_t* AsUtf16(const wchar_t* w) { return reinterpret_cast<const char16_t*>(w); }
+static const wchar_t* AsWide(const char16_t* s) { return reinterpret_cast<const wchar_t*>(s); }
+static wchar_t* AsWide(char16_t* s) { return reinterpret_cast<wchar_t*>(s); }
+
+// Copies into an existing string, which keeps its allocator (e.g. an EnumerationArena)
+template <class Str>
+static void AssignUtf16(const wchar_t* w, int len, Str& out) {
+    if (len > 0) out.assign(AsUtf16(w), (size_t)len);
+    else out.clear();
+}
+
 // Forward declarations for helpers used by event hooks
-static std::string GetWindowTitle(HWND hwnd);
-static std::string GetExecutablePath(HWND hwnd);
-static std::string WideToUtf8(const std::wstring& w) {
-    if (w.empty()) return std::string();
-    int sizeNeeded = WideCharToMultiByte(CP_UTF8, 0, w.c_str(), (int)w.size(), nullptr, 0, nullptr, nullptr);
-    if (sizeNeeded <= 0) return std::string();
-    std::string result((size_t)sizeNeeded, '\0');
-    WideCharToMultiByte(CP_UTF8, 0, w.c_str(), (int)w.size(), result.data(), sizeNeeded, nullptr, nullptr);
-    return result;
+static std::u16string GetWindowTitle(HWND hwnd);
+template <class Str> static void ReadExecutablePath(HWND hwnd, Str& out);
+template <class Str> static void ReadWindowClassName(HWND hwnd, Str& out);
+
+// ---------------- Interned strings ----------------
+// Executable paths and class names are interned (string_table.h); results and
+// events carry their ids. Each id becomes one JS string the first time it is
+// marshalled and that string is shared by every later result and event. The
+// table is swept at most once a minute, from the JS thread or a daemon worker
+// (a process that only serves the daemon never marshals strings), so strings
+// no enumeration or event has used for a couple of minutes (per-process class
+// names of exited apps) are freed. Their JS strings are dropped on the JS
+// thread's next use of the table; ids are never reused, so a stale one is
+// only memory.
+static dwm::StringTable g_stringTable;
+static std::unordered_map<dwm::StringId, Napi::Reference<Napi::String>> g_internedJsStrings; // JS thread only
+static std::mutex g_stringSweepMutex;
+static ULONGLONG g_lastStringSweepTick = 0;            // guarded by g_stringSweepMutex
+static std::vector<dwm::StringId> g_sweptStringIds;    // guarded by g_stringSweepMutex; JS strings still to drop
+static constexpr ULONGLONG kStringSweepMs = 60000;
+
+// Any thread
+static void SweepStringTable() {
+    std::lock_guard<std::mutex> lock(g_stringSweepMutex);
+    ULONGLONG now = GetTickCount64();
+    if (now - g_lastStringSweepTick < kStringSweepMs) return;
+    g_lastStringSweepTick = now;
+    std::vector<dwm::StringId> freed = g_stringTable.Sweep();
+    g_sweptStringIds.insert(g_sweptStringIds.end(), freed.begin(), freed.end());
 }
 
-static std::wstring Utf8ToWide(const std::string& s) {
-    if (s.empty()) return std::wstring();
-    int sizeNeeded = MultiByteToWideChar(CP_UTF8, 0, s.c_str(), (int)s.size(), nullptr, 0);
-    if (sizeNeeded <= 0) return std::wstring();
-    std::wstring result((size_t)sizeNeeded, L'\0');
-    MultiByteToWideChar(CP_UTF8, 0, s.c_str(), (int)s.size(), result.data(), sizeNeeded);
-    return result;
+// JS thread
+static void SweepInternedStrings() {
+    SweepStringTable();
+    std::vector<dwm::StringId> freed;
+    {
+        std::lock_guard<std::mutex> lock(g_stringSweepMutex);
+        freed.swap(g_sweptStringIds);
+    }
+    for (dwm::StringId id : freed) g_internedJsStrings.erase(id);
+}
+
+static Napi::String InternedJsString(Env env, dwm::StringId id) {
+    SweepInternedStrings();
+    auto it = g_internedJsStrings.find(id);
+    if (it != g_internedJsStrings.end()) return it->second.Value();
+    std::u16string s = g_stringTable.Get(id);
+    if (s.empty()) return String::New(env, s); // id 0 or freed: nothing to share
+    return g_internedJsStrings.emplace(id, Napi::Persistent(String::New(env, s))).first->second.Value();
 }
 
 struct WindowInfo {
     HWND hwnd;
-    std::string title;
-    std::string executablePath;
+    std::u16string title;
+    dwm::StringId executablePathId{};
+    dwm::StringId classNameId{};
     bool isVisible;
+    dwm::StageBreakdown timings; // filled only when the enumeration collects timings
 };
 
 
-// GDI+ global token
-static ULONG_PTR g_gdiplusToken = 0;
-static void GdiplusCleanup(void* /*arg*/) {
-    if (g_gdiplusToken) {
-        Gdiplus::GdiplusShutdown(g_gdiplusToken);
-        g_gdiplusToken = 0;
-    }
-}
-// WinRT apartment lifetime
+// WinRT apartment, initialized on first WGC use by the thread that captures
+// (never by require() on the Node main thread). Capture workers have no message
+// loop, so they join the multi-threaded apartment; a thread that already has a
+// COM apartment (e.g. STA from the shell icon lookup) keeps it. Threads leave
+// the apartment when they exit.
 #ifdef ENABLE_WGC
-static bool g_winrtInited = false;
-static void WinrtInitOnce() {
-    if (!g_winrtInited) {
-        try { winrt::init_apartment(winrt::apartment_type::single_threaded); g_winrtInited = true; } catch (...) { }
+struct WinrtThreadApartment {
+    bool ready{false};
+    bool owned{false};
+    ~WinrtThreadApartment() {
+        if (owned) { try { winrt::uninit_apartment(); } catch (...) {} }
     }
-}
-static void WinrtCleanup(void* /*arg*/) {
-    if (g_winrtInited) {
-        try { winrt::uninit_apartment(); } catch (...) {}
-        g_winrtInited = false;
+};
+static bool EnsureWinrtApartment() {
+    static thread_local WinrtThreadApartment apartment;
+    if (apartment.ready) return true;
+    auto start = dwm::StartupTiming::Clock::now();
+    try {
+        winrt::init_apartment(winrt::apartment_type::multi_threaded);
+        apartment.owned = true;
+    } catch (const winrt::hresult_error& e) {
+        if (e.code() != RPC_E_CHANGED_MODE) return false;
+    } catch (...) {
+        return false;
     }
+    apartment.ready = true;
+    dwm::StartupTiming::Instance().RecordInit("winrtApartment", start, dwm::StartupTiming::Clock::now());
+    return true;
 }
-// Runtime gate: use WGC only when explicitly requested via env var
-static bool ShouldUseWgc() {
-    static int cached = -1; // -1 = unknown, 0 = false, 1 = true
-    if (cached != -1) return cached == 1;
+#endif
+
+// ---------------- Runtime configuration ----------------
+// See runtime_config.h; configure()/getConfig() below. Calls take one snapshot
+// when they start and pass it down.
+static dwm::RuntimeConfig InitialRuntimeConfig() {
+    dwm::RuntimeConfig config;
+#ifdef ENABLE_WGC
+    // DWM_WINDOWS_USE_WGC=1|true still opts into WGC, as the initial configuration only
     wchar_t buf[16] = {0};
     DWORD got = GetEnvironmentVariableW(L"DWM_WINDOWS_USE_WGC", buf, (DWORD)(sizeof(buf)/sizeof(buf[0])));
-    if (got == 0) { cached = 0; return false; }
-    // Accept 1/true/TRUE/True
-    std::wstring val(buf);
+    std::wstring val(buf, got < 16 ? got : 0);
     for (auto& c : val) c = (wchar_t)towupper(c);
-    cached = (val == L"1" || val == L"TRUE") ? 1 : 0;
-    return cached == 1;
-}
+    if (val == L"1" || val == L"TRUE") config.captureMethods |= dwm::kWgcCaptureMethod;
 #endif
+    return config;
+}
+static dwm::RuntimeConfigStore g_config(InitialRuntimeConfig());
+static std::shared_ptr<const dwm::RuntimeConfig> CurrentConfig() { return g_config.Get(); }
 
 // Caches
-struct ThumbCacheEntry {
-    std::string base64;
-    RECT rect;
-    ULONGLONG ts;
-    int w;
-    int h;
+static dwm::ThumbnailCache g_thumbCache; // by ToWindowId(hwnd); thumbnail_cache.h
+struct IconCacheEntry {
+    std::string dataUrl;
+    dwm::MemoryCharge charge{ dwm::MemoryCategory::IconCache };
 };
-static std::unordered_map<HWND, ThumbCacheEntry> g_thumbCache;
-static std::unordered_map<HWND, std::string> g_iconCache;
-static const ULONGLONG THUMB_TTL_MS = 1200; // Cache thumbnails for ~1.2s to reduce recomposition bursts
-static std::mutex g_cacheMutex; // Protects g_thumbCache and g_iconCache
+static std::unordered_map<HWND, IconCacheEntry> g_iconCache;
+static std::mutex g_cacheMutex; // Protects g_iconCache
+
+// Stores charge the entry's size to its memory category; caller holds g_cacheMutex
+static void StoreIconCacheEntry(HWND hwnd, const std::string& dataUrl) {
+    IconCacheEntry& e = g_iconCache[hwnd];
+    e.dataUrl = dataUrl;
+    e.charge.Set(sizeof(HWND) + sizeof(IconCacheEntry) + e.dataUrl.capacity());
+}
+
+static void CheckMemoryThresholds();
 
 // ---------------- Window Event Hooks (Create/Destroy/Focus) ----------------
 static HWINEVENTHOOK g_hookCreate = nullptr;
@@ -173,10 +272,14 @@ static HWINEVENTHOOK g_hookMinEnd = nullptr;      // EVENT_SYSTEM_MINIMIZEEND
 static HWINEVENTHOOK g_hookState = nullptr;       // EVENT_OBJECT_STATECHANGE
 
 struct WindowEventPayload {
+    const char* type{""}; // dwm::WindowEventTypeName
     HWND hwnd{};
-    std::string title;
-    std::string exePath;
+    std::u16string title;
+    dwm::StringId exePathId{};
+    dwm::StringId classNameId{};
     bool isVisible{};
+    // Queued payloads count as event memory until the JS callback deletes them
+    dwm::MemoryCharge charge{ dwm::MemoryCategory::EventPayloads, sizeof(WindowEventPayload) };
 };
 
 static ThreadSafeFunction g_tsfnCreated;
@@ -189,7 +292,6 @@ static ThreadSafeFunction g_tsfnChange; // unified event: type in payload
 // Fallback poller when WinEvent hooks are unavailable in some environments
 #include <thread>
 #include <atomic>
-#include <unordered_set>
 static std::thread g_eventPollerThread;
 static std::atomic<bool> g_eventPollerRunning{ false };
 static std::atomic<bool> g_usingFallbackEvents{ false };
@@ -204,34 +306,98 @@ static bool IsTopLevelWindow(HWND hwnd) {
 }
 
 static WindowEventPayload MakePayload(HWND hwnd) {
+    // Path and class are only looked up in the table, so they are read into per-thread scratch
+    static thread_local std::u16string exePath, className;
     WindowEventPayload p{};
     p.hwnd = hwnd;
     p.title = GetWindowTitle(hwnd);
-    p.exePath = GetExecutablePath(hwnd);
+    ReadExecutablePath(hwnd, exePath);
+    ReadWindowClassName(hwnd, className);
+    p.exePathId = g_stringTable.Intern(exePath);
+    p.classNameId = g_stringTable.Intern(className);
     p.isVisible = IsWindowVisible(hwnd) ? true : false;
+    p.charge.Set(sizeof(WindowEventPayload) + p.title.capacity() * sizeof(char16_t));
     return p;
 }
 
+// Fields shared by every window event object
+static void SetWindowEventFields(Env env, Object& o, const WindowEventPayload& p) {
+    o.Set("id", Number::New(env, (uint64_t)(uintptr_t)p.hwnd));
+    o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)p.hwnd));
+    o.Set("title", String::New(env, p.title));
+    o.Set("executablePath", InternedJsString(env, p.exePathId));
+    o.Set("executablePathId", Number::New(env, p.exePathId));
+    o.Set("className", InternedJsString(env, p.classNameId));
+    o.Set("classNameId", Number::New(env, p.classNameId));
+    o.Set("isVisible", Boolean::New(env, p.isVisible));
+}
+
+// Thumbnail daemon (startDaemon): hook and poller events are also published to
+// its subscribers. Holds the server through the host that owns its backend.
+static std::mutex g_daemonMutex;
+static std::shared_ptr<dwm::DaemonServer> g_daemon;
+
+static void PublishToDaemon(dwm::WindowEventType type, HWND hwnd) {
+    std::shared_ptr<dwm::DaemonServer> daemon;
+    {
+        std::lock_guard<std::mutex> lock(g_daemonMutex);
+        daemon = g_daemon;
+    }
+    if (daemon) daemon->Publish(type, (dwm::WindowId)(uintptr_t)hwnd);
+}
+
+// MRU focus history (focus_history.h), recorded once focus tracking is on
+// (orderBy: 'mru' or startDaemon). Foreground changes and closed windows also
+// wake the prefetch thread that keeps the top windows' thumbnails warm.
+static dwm::FocusHistory g_focusHistory;
+static std::atomic<bool> g_focusTracking{ false };
+static std::atomic<ULONGLONG> g_lastFocusTick{ 0 };
+static std::atomic<uint64_t> g_prefetchCaptures{ 0 };
+static std::atomic<uint64_t> g_prefetchHits{ 0 }; // requests served a prefetched thumbnail
+// Prefetch WGC batches: wall time against the sum of their captures' times,
+// i.e. how much the overlapped waits saved on this machine
+static std::atomic<uint64_t> g_wgcBatches{ 0 };
+static std::atomic<uint64_t> g_wgcBatchWindows{ 0 };
+static std::atomic<uint64_t> g_wgcBatchWallUs{ 0 };
+static std::atomic<uint64_t> g_wgcBatchCaptureUs{ 0 };
+static dwm::DesktopId WindowDesktop(HWND hwnd);
+static void WakePrefetcher();
+
+static void RecordFocus(HWND hwnd) {
+    if (!g_focusTracking.load()) return;
+    g_focusHistory.Focus((dwm::WindowId)(uintptr_t)hwnd, WindowDesktop(hwnd));
+    g_lastFocusTick.store(GetTickCount64());
+    WakePrefetcher();
+}
+
+static void ForgetWindow(HWND hwnd) {
+    if (g_focusHistory.Remove((dwm::WindowId)(uintptr_t)hwnd)) WakePrefetcher();
+}
+
 static void CALLBACK WinEventProcCB(HWINEVENTHOOK hook, DWORD event, HWND hwnd, LONG idObject, LONG idChild, DWORD, DWORD) {
     g_lastHookEventTick.store(GetTickCount64());
+    dwm::TraceSpan traceSpan("hook", "winEvent");
+    if (traceSpan.Active()) {
+        dwm::TraceWriter::Instance().NameCurrentThread("WinEvent hook");
+        traceSpan.SetArgs("\"event\":" + std::to_string(event) + ",\"hwnd\":" + std::to_string((uint64_t)(uintptr_t)hwnd));
+    }
     // Filter only window object events or foreground changes
     if (event == EVENT_SYSTEM_FOREGROUND) {
         if (!IsWindow(hwnd)) return;
         // Map to top-level root to normalize hosted/UWP cases
         HWND top = GetAncestor(hwnd, GA_ROOT);
         if (top) hwnd = top;
+        RecordFocus(hwnd);
+        PublishToDaemon(dwm::WindowEventType::Focused, hwnd);
         if (g_tsfnFocused || g_tsfnChange) {
             WindowEventPayload payload = MakePayload(hwnd);
             auto* heap = new WindowEventPayload(std::move(payload));
             if (g_tsfnFocused) {
                 g_tsfnFocused.BlockingCall(new WindowEventPayload(*heap), [](Env env, Function cb, WindowEventPayload* data){
                     Object o = Object::New(env);
-                    o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("title", String::New(env, data->title));
-                    o.Set("executablePath", String::New(env, data->exePath));
-                    o.Set("isVisible", Boolean::New(env, data->isVisible));
+                    SetWindowEventFields(env, o, *data);
                     o.Set("type", String::New(env, "focused"));
+                    DWM_TRACE_SPAN("tsfn", "focused");
                     cb.Call({ o });
                     delete data;
                 });
@@ -239,12 +405,9 @@ static void CALLBACK WinEventProcCB(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
             if (g_tsfnChange) {
                 g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
                     Object o = Object::New(env);
-                    o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("title", String::New(env, data->title));
-                    o.Set("executablePath", String::New(env, data->exePath));
-                    o.Set("isVisible", Boolean::New(env, data->isVisible));
+                    SetWindowEventFields(env, o, *data);
                     o.Set("type", String::New(env, "focused"));
+                    DWM_TRACE_SPAN("tsfn", "focused");
                     cb.Call({ o });
                     delete data;
                 });
@@ -261,18 +424,16 @@ static void CALLBACK WinEventProcCB(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
         HWND top = hwnd ? GetAncestor(hwnd, GA_ROOT) : NULL;
         if (top) hwnd = top;
         if (!IsWindow(hwnd) || !IsTopLevelWindow(hwnd)) return;
+        PublishToDaemon(dwm::WindowEventType::Minimized, hwnd);
         if (g_tsfnMinimized || g_tsfnChange) {
             WindowEventPayload payload = MakePayload(hwnd);
             auto* heap = new WindowEventPayload(std::move(payload));
             if (g_tsfnMinimized) {
                 g_tsfnMinimized.BlockingCall(new WindowEventPayload(*heap), [](Env env, Function cb, WindowEventPayload* data){
                     Object o = Object::New(env);
-                    o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("title", String::New(env, data->title));
-                    o.Set("executablePath", String::New(env, data->exePath));
-                    o.Set("isVisible", Boolean::New(env, data->isVisible));
+                    SetWindowEventFields(env, o, *data);
                     o.Set("type", String::New(env, "minimized"));
+                    DWM_TRACE_SPAN("tsfn", "minimized");
                     cb.Call({ o });
                     delete data;
                 });
@@ -280,12 +441,9 @@ static void CALLBACK WinEventProcCB(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
             if (g_tsfnChange) {
                 g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
                     Object o = Object::New(env);
-                    o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("title", String::New(env, data->title));
-                    o.Set("executablePath", String::New(env, data->exePath));
-                    o.Set("isVisible", Boolean::New(env, data->isVisible));
+                    SetWindowEventFields(env, o, *data);
                     o.Set("type", String::New(env, "minimized"));
+                    DWM_TRACE_SPAN("tsfn", "minimized");
                     cb.Call({ o });
                     delete data;
                 });
@@ -303,55 +461,45 @@ static void CALLBACK WinEventProcCB(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
         if (top) hwnd = top;
         if (!IsWindow(hwnd) || !IsTopLevelWindow(hwnd)) return;
         if (IsIconic(hwnd)) {
+            PublishToDaemon(dwm::WindowEventType::Minimized, hwnd);
             if (g_tsfnMinimized || g_tsfnChange) {
                 auto payload = MakePayload(hwnd);
                 auto* heap = new WindowEventPayload(payload);
                 if (g_tsfnMinimized) g_tsfnMinimized.BlockingCall(new WindowEventPayload(payload), [](Env env, Function cb, WindowEventPayload* data){
                     Object o = Object::New(env);
-                    o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("title", String::New(env, data->title));
-                    o.Set("executablePath", String::New(env, data->exePath));
-                    o.Set("isVisible", Boolean::New(env, data->isVisible));
+                    SetWindowEventFields(env, o, *data);
                     o.Set("type", String::New(env, "minimized"));
+                    DWM_TRACE_SPAN("tsfn", "minimized");
                     cb.Call({ o });
                     delete data;
                 });
                 if (g_tsfnChange) g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
                     Object o = Object::New(env);
-                    o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("title", String::New(env, data->title));
-                    o.Set("executablePath", String::New(env, data->exePath));
-                    o.Set("isVisible", Boolean::New(env, data->isVisible));
+                    SetWindowEventFields(env, o, *data);
                     o.Set("type", String::New(env, "minimized"));
+                    DWM_TRACE_SPAN("tsfn", "minimized");
                     cb.Call({ o });
                     delete data;
                 }); else delete heap;
             }
         } else {
+            if (IsWindowVisible(hwnd)) PublishToDaemon(dwm::WindowEventType::Restored, hwnd);
             if ((g_tsfnRestored || g_tsfnChange) && IsWindowVisible(hwnd)) {
                 auto payload = MakePayload(hwnd);
                 auto* heap = new WindowEventPayload(payload);
                 if (g_tsfnRestored) g_tsfnRestored.BlockingCall(new WindowEventPayload(payload), [](Env env, Function cb, WindowEventPayload* data){
                     Object o = Object::New(env);
-                    o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("title", String::New(env, data->title));
-                    o.Set("executablePath", String::New(env, data->exePath));
-                    o.Set("isVisible", Boolean::New(env, data->isVisible));
+                    SetWindowEventFields(env, o, *data);
                     o.Set("type", String::New(env, "restored"));
+                    DWM_TRACE_SPAN("tsfn", "restored");
                     cb.Call({ o });
                     delete data;
                 });
                 if (g_tsfnChange) g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
                     Object o = Object::New(env);
-                    o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("title", String::New(env, data->title));
-                    o.Set("executablePath", String::New(env, data->exePath));
-                    o.Set("isVisible", Boolean::New(env, data->isVisible));
+                    SetWindowEventFields(env, o, *data);
                     o.Set("type", String::New(env, "restored"));
+                    DWM_TRACE_SPAN("tsfn", "restored");
                     cb.Call({ o });
                     delete data;
                 }); else delete heap;
@@ -364,28 +512,23 @@ static void CALLBACK WinEventProcCB(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
         HWND top = hwnd ? GetAncestor(hwnd, GA_ROOT) : NULL;
         if (top) hwnd = top;
         if (!IsWindow(hwnd) || !IsTopLevelWindow(hwnd)) return;
+        PublishToDaemon(dwm::WindowEventType::Restored, hwnd);
         if (g_tsfnRestored || g_tsfnChange) {
             WindowEventPayload payload = MakePayload(hwnd);
             auto* heap = new WindowEventPayload(payload);
             if (g_tsfnRestored) g_tsfnRestored.BlockingCall(new WindowEventPayload(payload), [](Env env, Function cb, WindowEventPayload* data){
                 Object o = Object::New(env);
-                o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("title", String::New(env, data->title));
-                o.Set("executablePath", String::New(env, data->exePath));
-                o.Set("isVisible", Boolean::New(env, data->isVisible));
+                SetWindowEventFields(env, o, *data);
                 o.Set("type", String::New(env, "restored"));
+                DWM_TRACE_SPAN("tsfn", "restored");
                 cb.Call({ o });
                 delete data;
             });
             if (g_tsfnChange) g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
                 Object o = Object::New(env);
-                o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("title", String::New(env, data->title));
-                o.Set("executablePath", String::New(env, data->exePath));
-                o.Set("isVisible", Boolean::New(env, data->isVisible));
+                SetWindowEventFields(env, o, *data);
                 o.Set("type", String::New(env, "restored"));
+                DWM_TRACE_SPAN("tsfn", "restored");
                 cb.Call({ o });
                 delete data;
             }); else delete heap;
@@ -398,28 +541,23 @@ static void CALLBACK WinEventProcCB(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
             HWND fg = GetForegroundWindow();
             if (fg) hwnd = GetAncestor(fg, GA_ROOT);
         }
+        if (IsWindow(hwnd) && IsTopLevelWindow(hwnd)) PublishToDaemon(dwm::WindowEventType::Minimized, hwnd);
         if (IsWindow(hwnd) && IsTopLevelWindow(hwnd) && (g_tsfnMinimized || g_tsfnChange)) {
             WindowEventPayload payload = MakePayload(hwnd);
             auto* heap = new WindowEventPayload(payload);
             if (g_tsfnMinimized) g_tsfnMinimized.BlockingCall(new WindowEventPayload(payload), [](Env env, Function cb, WindowEventPayload* data){
                 Object o = Object::New(env);
-                o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("title", String::New(env, data->title));
-                o.Set("executablePath", String::New(env, data->exePath));
-                o.Set("isVisible", Boolean::New(env, data->isVisible));
+                SetWindowEventFields(env, o, *data);
                 o.Set("type", String::New(env, "minimized"));
+                DWM_TRACE_SPAN("tsfn", "minimized");
                 cb.Call({ o });
                 delete data;
             });
             if (g_tsfnChange) g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
                 Object o = Object::New(env);
-                o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("title", String::New(env, data->title));
-                o.Set("executablePath", String::New(env, data->exePath));
-                o.Set("isVisible", Boolean::New(env, data->isVisible));
+                SetWindowEventFields(env, o, *data);
                 o.Set("type", String::New(env, "minimized"));
+                DWM_TRACE_SPAN("tsfn", "minimized");
                 cb.Call({ o });
                 delete data;
             }); else delete heap;
@@ -431,28 +569,23 @@ static void CALLBACK WinEventProcCB(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
             HWND fg = GetForegroundWindow();
             if (fg) hwnd = GetAncestor(fg, GA_ROOT);
         }
+        if (IsWindow(hwnd) && IsTopLevelWindow(hwnd)) PublishToDaemon(dwm::WindowEventType::Restored, hwnd);
         if (IsWindow(hwnd) && IsTopLevelWindow(hwnd) && (g_tsfnRestored || g_tsfnChange)) {
             WindowEventPayload payload = MakePayload(hwnd);
             auto* heap = new WindowEventPayload(payload);
             if (g_tsfnRestored) g_tsfnRestored.BlockingCall(new WindowEventPayload(payload), [](Env env, Function cb, WindowEventPayload* data){
                 Object o = Object::New(env);
-                o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("title", String::New(env, data->title));
-                o.Set("executablePath", String::New(env, data->exePath));
-                o.Set("isVisible", Boolean::New(env, data->isVisible));
+                SetWindowEventFields(env, o, *data);
                 o.Set("type", String::New(env, "restored"));
+                DWM_TRACE_SPAN("tsfn", "restored");
                 cb.Call({ o });
                 delete data;
             });
             if (g_tsfnChange) g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
                 Object o = Object::New(env);
-                o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("title", String::New(env, data->title));
-                o.Set("executablePath", String::New(env, data->exePath));
-                o.Set("isVisible", Boolean::New(env, data->isVisible));
+                SetWindowEventFields(env, o, *data);
                 o.Set("type", String::New(env, "restored"));
+                DWM_TRACE_SPAN("tsfn", "restored");
                 cb.Call({ o });
                 delete data;
             }); else delete heap;
@@ -466,28 +599,23 @@ static void CALLBACK WinEventProcCB(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
         HWND top = hwnd ? GetAncestor(hwnd, GA_ROOT) : NULL;
         if (top) hwnd = top;
         // Treat as minimized/hidden
+        PublishToDaemon(dwm::WindowEventType::Minimized, hwnd);
         if (g_tsfnMinimized || g_tsfnChange) {
             WindowEventPayload payload = MakePayload(hwnd);
             auto* heap = new WindowEventPayload(payload);
             if (g_tsfnMinimized) g_tsfnMinimized.BlockingCall(new WindowEventPayload(payload), [](Env env, Function cb, WindowEventPayload* data){
                 Object o = Object::New(env);
-                o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("title", String::New(env, data->title));
-                o.Set("executablePath", String::New(env, data->exePath));
-                o.Set("isVisible", Boolean::New(env, data->isVisible));
+                SetWindowEventFields(env, o, *data);
                 o.Set("type", String::New(env, "minimized"));
+                DWM_TRACE_SPAN("tsfn", "minimized");
                 cb.Call({ o });
                 delete data;
             });
             if (g_tsfnChange) g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
                 Object o = Object::New(env);
-                o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("title", String::New(env, data->title));
-                o.Set("executablePath", String::New(env, data->exePath));
-                o.Set("isVisible", Boolean::New(env, data->isVisible));
+                SetWindowEventFields(env, o, *data);
                 o.Set("type", String::New(env, "minimized"));
+                DWM_TRACE_SPAN("tsfn", "minimized");
                 cb.Call({ o });
                 delete data;
             }); else delete heap;
@@ -498,28 +626,23 @@ static void CALLBACK WinEventProcCB(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
         HWND top = hwnd ? GetAncestor(hwnd, GA_ROOT) : NULL;
         if (top) hwnd = top;
         // Treat as restored/shown
+        PublishToDaemon(dwm::WindowEventType::Restored, hwnd);
         if (g_tsfnRestored || g_tsfnChange) {
             WindowEventPayload payload = MakePayload(hwnd);
             auto* heap = new WindowEventPayload(payload);
             if (g_tsfnRestored) g_tsfnRestored.BlockingCall(new WindowEventPayload(payload), [](Env env, Function cb, WindowEventPayload* data){
                 Object o = Object::New(env);
-                o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("title", String::New(env, data->title));
-                o.Set("executablePath", String::New(env, data->exePath));
-                o.Set("isVisible", Boolean::New(env, data->isVisible));
+                SetWindowEventFields(env, o, *data);
                 o.Set("type", String::New(env, "restored"));
+                DWM_TRACE_SPAN("tsfn", "restored");
                 cb.Call({ o });
                 delete data;
             });
             if (g_tsfnChange) g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
                 Object o = Object::New(env);
-                o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("title", String::New(env, data->title));
-                o.Set("executablePath", String::New(env, data->exePath));
-                o.Set("isVisible", Boolean::New(env, data->isVisible));
+                SetWindowEventFields(env, o, *data);
                 o.Set("type", String::New(env, "restored"));
+                DWM_TRACE_SPAN("tsfn", "restored");
                 cb.Call({ o });
                 delete data;
             }); else delete heap;
@@ -527,56 +650,47 @@ static void CALLBACK WinEventProcCB(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
         // continue to also let CREATE/other handlers run if applicable
     }
     if (event == EVENT_OBJECT_CREATE) {
+        PublishToDaemon(dwm::WindowEventType::Created, hwnd);
         if (g_tsfnCreated || g_tsfnChange) {
             WindowEventPayload payload = MakePayload(hwnd);
             auto* heap = new WindowEventPayload(payload);
             if (g_tsfnCreated) g_tsfnCreated.BlockingCall(new WindowEventPayload(payload), [](Env env, Function cb, WindowEventPayload* data){
                 Object o = Object::New(env);
-                o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("title", String::New(env, data->title));
-                o.Set("executablePath", String::New(env, data->exePath));
-                o.Set("isVisible", Boolean::New(env, data->isVisible));
+                SetWindowEventFields(env, o, *data);
                 o.Set("type", String::New(env, "created"));
+                DWM_TRACE_SPAN("tsfn", "created");
                 cb.Call({ o });
                 delete data;
             });
             if (g_tsfnChange) g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
                 Object o = Object::New(env);
-                o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("title", String::New(env, data->title));
-                o.Set("executablePath", String::New(env, data->exePath));
-                o.Set("isVisible", Boolean::New(env, data->isVisible));
+                SetWindowEventFields(env, o, *data);
                 o.Set("type", String::New(env, "created"));
+                DWM_TRACE_SPAN("tsfn", "created");
                 cb.Call({ o });
                 delete data;
             }); else delete heap;
         }
     } else if (event == EVENT_OBJECT_DESTROY) {
+        ForgetWindow(hwnd);
+        PublishToDaemon(dwm::WindowEventType::Closed, hwnd);
         if (g_tsfnClosed || g_tsfnChange) {
             // For destroyed windows, title/path may be inaccessible; send minimal info
             WindowEventPayload payload{}; payload.hwnd = hwnd; payload.isVisible = false;
             auto* heap = new WindowEventPayload(payload);
             if (g_tsfnClosed) g_tsfnClosed.BlockingCall(new WindowEventPayload(payload), [](Env env, Function cb, WindowEventPayload* data){
                 Object o = Object::New(env);
-                o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("title", String::New(env, data->title));
-                o.Set("executablePath", String::New(env, data->exePath));
-                o.Set("isVisible", Boolean::New(env, data->isVisible));
+                SetWindowEventFields(env, o, *data);
                 o.Set("type", String::New(env, "closed"));
+                DWM_TRACE_SPAN("tsfn", "closed");
                 cb.Call({ o });
                 delete data;
             });
             if (g_tsfnChange) g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
                 Object o = Object::New(env);
-                o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                o.Set("title", String::New(env, data->title));
-                o.Set("executablePath", String::New(env, data->exePath));
-                o.Set("isVisible", Boolean::New(env, data->isVisible));
+                SetWindowEventFields(env, o, *data);
                 o.Set("type", String::New(env, "closed"));
+                DWM_TRACE_SPAN("tsfn", "closed");
                 cb.Call({ o });
                 delete data;
             }); else delete heap;
@@ -617,6 +731,45 @@ static void UninstallHooks() {
 }
 
 // --------------------- Fallback poller implementation ---------------------
+static dwm::WindowId ToWindowId(HWND hwnd) { return (dwm::WindowId)(uintptr_t)hwnd; }
+static HWND ToHwnd(dwm::WindowId id) { return (HWND)(uintptr_t)id; }
+
+static void CallWindowEventCallback(ThreadSafeFunction& tsfn, WindowEventPayload* payload) {
+    tsfn.BlockingCall(payload, [](Env env, Function cb, WindowEventPayload* data){
+        Object o = Object::New(env);
+        SetWindowEventFields(env, o, *data);
+        o.Set("type", String::New(env, data->type));
+        DWM_TRACE_SPAN("tsfn", data->type);
+        cb.Call({ o });
+        delete data;
+    });
+}
+
+// Delivers a polled event to its typed callback and to onWindowChange
+static void DispatchWindowEvent(dwm::WindowEventType type, HWND hwnd) {
+    ThreadSafeFunction* typed = nullptr;
+    switch (type) {
+        case dwm::WindowEventType::Created: typed = &g_tsfnCreated; break;
+        case dwm::WindowEventType::Closed: typed = &g_tsfnClosed; break;
+        case dwm::WindowEventType::Focused: typed = &g_tsfnFocused; break;
+        case dwm::WindowEventType::Minimized: typed = &g_tsfnMinimized; break;
+        case dwm::WindowEventType::Restored: typed = &g_tsfnRestored; break;
+    }
+    if (type == dwm::WindowEventType::Focused) RecordFocus(hwnd);
+    if (type == dwm::WindowEventType::Closed) ForgetWindow(hwnd);
+    PublishToDaemon(type, hwnd);
+    if (!*typed && !g_tsfnChange) return;
+    WindowEventPayload payload{};
+    if (type == dwm::WindowEventType::Closed) {
+        payload.hwnd = hwnd; // gone: no title or path to read
+    } else {
+        payload = MakePayload(hwnd);
+    }
+    payload.type = dwm::WindowEventTypeName(type);
+    if (*typed) CallWindowEventCallback(*typed, new WindowEventPayload(payload));
+    if (g_tsfnChange) CallWindowEventCallback(g_tsfnChange, new WindowEventPayload(payload));
+}
+
 static void EnumTopLevelWindows(std::vector<HWND>& out) {
     out.clear();
     EnumWindows([](HWND hwnd, LPARAM lParam) -> BOOL {
@@ -638,185 +791,32 @@ static void StartFallbackEventPoller() {
     if (!g_eventPollerRunning.compare_exchange_strong(expected, true)) return; // already running
     g_usingFallbackEvents = true;
     g_eventPollerThread = std::thread([](){
-        HWND lastFg = nullptr;
-        std::unordered_set<HWND> known;
-        std::unordered_map<HWND, bool> minimized;
+        dwm::WindowEventTracker tracker;
         std::vector<HWND> current;
+        std::vector<dwm::WindowSnapshotEntry> snapshot;
+        std::vector<dwm::WindowEvent> events;
         while (g_eventPollerRunning.load()) {
+            dwm::TraceSpan tick("poller", "tick");
+            if (tick.Active()) dwm::TraceWriter::Instance().NameCurrentThread("event poller");
             // Suppress if hooks have been active recently
             ULONGLONG nowTick = GetTickCount64();
             ULONGLONG lastHook = g_lastHookEventTick.load();
             bool hooksActive = (lastHook != 0 && (nowTick - lastHook) < 1000);
 
-            // Foreground change detection
             HWND fg = GetForegroundWindow();
             if (fg) {
                 HWND top = GetAncestor(fg, GA_ROOT);
                 if (top) fg = top;
             }
-            if (!hooksActive && fg && fg != lastFg && (g_tsfnFocused || g_tsfnChange)) {
-                auto* heap = new WindowEventPayload(MakePayload(fg));
-                if (g_tsfnFocused) g_tsfnFocused.BlockingCall(new WindowEventPayload(*heap), [](Env env, Function cb, WindowEventPayload* data){
-                    Object o = Object::New(env);
-                    o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("title", String::New(env, data->title));
-                    o.Set("executablePath", String::New(env, data->exePath));
-                    o.Set("isVisible", Boolean::New(env, data->isVisible));
-                    o.Set("type", String::New(env, "focused"));
-                    cb.Call({ o });
-                    delete data;
-                });
-                if (g_tsfnChange) g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
-                    Object o = Object::New(env);
-                    o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                    o.Set("title", String::New(env, data->title));
-                    o.Set("executablePath", String::New(env, data->exePath));
-                    o.Set("isVisible", Boolean::New(env, data->isVisible));
-                    o.Set("type", String::New(env, "focused"));
-                    cb.Call({ o });
-                    delete data;
-                }); else delete heap;
-            }
-            lastFg = fg;
-
             // Window set diff for created/closed + minimized/restored state
             EnumTopLevelWindows(current);
-            std::unordered_set<HWND> currSet(current.begin(), current.end());
-            // Created
-            if (!hooksActive && (g_tsfnCreated || g_tsfnChange)) {
-                for (HWND h : current) {
-                    if (known.find(h) == known.end()) {
-                        known.insert(h);
-                        auto payload = MakePayload(h);
-                        auto* heap = new WindowEventPayload(payload);
-                        if (g_tsfnCreated) g_tsfnCreated.BlockingCall(new WindowEventPayload(payload), [](Env env, Function cb, WindowEventPayload* data){
-                            Object o = Object::New(env);
-                            o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                            o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                            o.Set("title", String::New(env, data->title));
-                            o.Set("executablePath", String::New(env, data->exePath));
-                            o.Set("isVisible", Boolean::New(env, data->isVisible));
-                            o.Set("type", String::New(env, "created"));
-                            cb.Call({ o });
-                            delete data;
-                        });
-                        if (g_tsfnChange) g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
-                            Object o = Object::New(env);
-                            o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                            o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                            o.Set("title", String::New(env, data->title));
-                            o.Set("executablePath", String::New(env, data->exePath));
-                            o.Set("isVisible", Boolean::New(env, data->isVisible));
-                            o.Set("type", String::New(env, "created"));
-                            cb.Call({ o });
-                            delete data;
-                        }); else delete heap;
-                    }
-                }
-            } else {
-                // keep known in sync even if no created callback set
-                for (HWND h : current) known.insert(h);
-            }
-            // Closed
-            if (!hooksActive && (g_tsfnClosed || g_tsfnChange)) {
-                std::vector<HWND> toRemove;
-                for (auto h : known) if (currSet.find(h) == currSet.end()) toRemove.push_back(h);
-                for (auto h : toRemove) {
-                    known.erase(h);
-                    WindowEventPayload payload{}; payload.hwnd = h; payload.isVisible = false;
-                    auto* heap = new WindowEventPayload(payload);
-                    if (g_tsfnClosed) g_tsfnClosed.BlockingCall(new WindowEventPayload(payload), [](Env env, Function cb, WindowEventPayload* data){
-                        Object o = Object::New(env);
-                        o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                        o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                        o.Set("title", String::New(env, data->title));
-                        o.Set("executablePath", String::New(env, data->exePath));
-                        o.Set("isVisible", Boolean::New(env, data->isVisible));
-                        o.Set("type", String::New(env, "closed"));
-                        cb.Call({ o });
-                        delete data;
-                    });
-                    if (g_tsfnChange) g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
-                        Object o = Object::New(env);
-                        o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                        o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                        o.Set("title", String::New(env, data->title));
-                        o.Set("executablePath", String::New(env, data->exePath));
-                        o.Set("isVisible", Boolean::New(env, data->isVisible));
-                        o.Set("type", String::New(env, "closed"));
-                        cb.Call({ o });
-                        delete data;
-                    }); else delete heap;
-                }
-            } else {
-                // purge known of disappeared
-                std::vector<HWND> toRemove;
-                for (auto h : known) if (currSet.find(h) == currSet.end()) toRemove.push_back(h);
-                for (auto h : toRemove) known.erase(h);
-            }
-
-            // Minimized/restored transitions
-        for (HWND h : current) {
-                bool nowMin = IsIconic(h) ? true : false;
-                auto it = minimized.find(h);
-                bool wasKnown = (it != minimized.end());
-                if (!wasKnown) minimized[h] = nowMin;
-                else if (it->second != nowMin) {
-                    it->second = nowMin;
-                    if (!hooksActive && nowMin && (g_tsfnMinimized || g_tsfnChange)) {
-                        auto* heap = new WindowEventPayload(MakePayload(h));
-                        if (g_tsfnMinimized) g_tsfnMinimized.BlockingCall(new WindowEventPayload(*heap), [](Env env, Function cb, WindowEventPayload* data){
-                            Object o = Object::New(env);
-                            o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                            o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                            o.Set("title", String::New(env, data->title));
-                            o.Set("executablePath", String::New(env, data->exePath));
-                            o.Set("isVisible", Boolean::New(env, data->isVisible));
-                            o.Set("type", String::New(env, "minimized"));
-                            cb.Call({ o });
-                            delete data;
-                        });
-                        if (g_tsfnChange) g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
-                            Object o = Object::New(env);
-                            o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                            o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                            o.Set("title", String::New(env, data->title));
-                            o.Set("executablePath", String::New(env, data->exePath));
-                            o.Set("isVisible", Boolean::New(env, data->isVisible));
-                            o.Set("type", String::New(env, "minimized"));
-                            cb.Call({ o });
-                            delete data;
-                        }); else delete heap;
-                    } else if (!hooksActive && !nowMin && (g_tsfnRestored || g_tsfnChange)) {
-                        auto* heap = new WindowEventPayload(MakePayload(h));
-                        if (g_tsfnRestored) g_tsfnRestored.BlockingCall(new WindowEventPayload(*heap), [](Env env, Function cb, WindowEventPayload* data){
-                            Object o = Object::New(env);
-                            o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                            o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                            o.Set("title", String::New(env, data->title));
-                            o.Set("executablePath", String::New(env, data->exePath));
-                            o.Set("isVisible", Boolean::New(env, data->isVisible));
-                            o.Set("type", String::New(env, "restored"));
-                            cb.Call({ o });
-                            delete data;
-                        });
-                        if (g_tsfnChange) g_tsfnChange.BlockingCall(heap, [](Env env, Function cb, WindowEventPayload* data){
-                            Object o = Object::New(env);
-                            o.Set("id", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                            o.Set("hwnd", Number::New(env, (uint64_t)(uintptr_t)data->hwnd));
-                            o.Set("title", String::New(env, data->title));
-                            o.Set("executablePath", String::New(env, data->exePath));
-                            o.Set("isVisible", Boolean::New(env, data->isVisible));
-                            o.Set("type", String::New(env, "restored"));
-                            cb.Call({ o });
-                            delete data;
-                        }); else delete heap;
-                    }
-                }
-            }
+            snapshot.clear();
+            for (HWND h : current) snapshot.push_back({ ToWindowId(h), IsIconic(h) ? true : false });
+            tracker.Update(ToWindowId(fg), snapshot, !hooksActive, events);
+            for (const dwm::WindowEvent& e : events) DispatchWindowEvent(e.type, ToHwnd(e.window));
+            CheckMemoryThresholds();
 
+            tick.End();
             Sleep(250);
         }
     });
@@ -846,64 +846,44 @@ struct IVirtualDesktopManager : public IUnknown {
     virtual HRESULT STDMETHODCALLTYPE MoveWindowToDesktop(HWND topLevelWindow, REFGUID desktopId) = 0;
 };
 
-// Helper to locate encoder CLSID (e.g., image/png)
-int GetEncoderClsid(const WCHAR* format, CLSID* pClsid) {
-    UINT num = 0, size = 0;
-    Gdiplus::GetImageEncodersSize(&num, &size);
-    if (size == 0) return -1;
-    std::vector<BYTE> buffer(size);
-    Gdiplus::ImageCodecInfo* pImageCodecInfo = reinterpret_cast<Gdiplus::ImageCodecInfo*>(buffer.data());
-    if (Gdiplus::GetImageEncoders(num, size, pImageCodecInfo) != Gdiplus::Ok) return -1;
-    for (UINT j = 0; j < num; ++j) {
-        if (wcscmp(pImageCodecInfo[j].MimeType, format) == 0) {
-            *pClsid = pImageCodecInfo[j].Clsid;
-            return (int)j;
-        }
-    }
-    return -1;
-}
-
-// Base64 Encoding
-std::string base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len) {
-    std::string ret;
-    int i = 0;
-    int j = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
-    
-    const std::string chars_to_encode = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
-    while (in_len--) {
-        char_array_3[i++] = *(bytes_to_encode++);
-        if (i == 3) {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
-
-            for(i = 0; (i < 4); i++)
-                ret += chars_to_encode[char_array_4[i]];
-            i = 0;
+// Virtual desktops of windows for the focus history; unknown if unavailable.
+// Focus events arrive on the JS thread (the hooks) and the poller thread, and
+// EnableFocusTracking seeds the history on the JS thread, so COM is
+// initialized only for the resolver's lifetime, as the enumeration does: the
+// JS thread is never left in an apartment.
+class DesktopResolver {
+public:
+    DesktopResolver() {
+        comInitialized_ = SUCCEEDED(CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED));
+        if (FAILED(CoCreateInstance(CLSID_VirtualDesktopManager, nullptr, CLSCTX_ALL,
+                                    IID_IVirtualDesktopManager, (void**)&vdm_))) {
+            vdm_ = nullptr;
         }
     }
+    DesktopResolver(const DesktopResolver&) = delete;
+    DesktopResolver& operator=(const DesktopResolver&) = delete;
+    ~DesktopResolver() {
+        if (vdm_) vdm_->Release();
+        if (comInitialized_) CoUninitialize();
+    }
 
-    if (i) {
-        for(j = i; j < 3; j++)
-            char_array_3[j] = '\0';
-
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-        char_array_4[3] = char_array_3[2] & 0x3f;
-
-        for (j = 0; (j < i + 1); j++)
-            ret += chars_to_encode[char_array_4[j]];
-
-        while((i++ < 3))
-            ret += '=';
+    dwm::DesktopId Desktop(HWND hwnd) const {
+        GUID id{};
+        if (!vdm_ || FAILED(vdm_->GetWindowDesktopId(hwnd, &id))) return dwm::DesktopId{};
+        dwm::DesktopId desktop;
+        std::memcpy(&desktop.high, &id, sizeof(desktop.high));
+        std::memcpy(&desktop.low, reinterpret_cast<const char*>(&id) + sizeof(desktop.high), sizeof(desktop.low));
+        return desktop;
     }
 
-    return ret;
+private:
+    IVirtualDesktopManager* vdm_{nullptr};
+    bool comInitialized_{false};
+};
+
+static dwm::DesktopId WindowDesktop(HWND hwnd) {
+    DesktopResolver resolver;
+    return resolver.Desktop(hwnd);
 }
 
 // BMP Header Strukturen
@@ -932,10 +912,13 @@ struct BMPInfoHeader {
 #pragma pack(pop)
 
 // Executable Path ermitteln (mit Fallbacks und minimalen Rechten)
-std::string GetExecutablePath(HWND hwnd) {
+template <class Str>
+static void ReadExecutablePath(HWND hwnd, Str& out) {
+    DWM_TIME_STAGE(ExePath);
+    out.clear();
     DWORD processId = 0;
     GetWindowThreadProcessId(hwnd, &processId);
-    if (!processId) return "";
+    if (!processId) return;
 
     // Zuerst: minimale Rechte, funktioniert häufig auch bei erhöhten Prozessen
     HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
@@ -943,9 +926,9 @@ std::string GetExecutablePath(HWND hwnd) {
         WCHAR pathW[MAX_PATH] = {0};
         DWORD size = MAX_PATH;
         if (QueryFullProcessImageNameW(hProcess, 0, pathW, &size)) {
-            std::wstring w(pathW, size);
             CloseHandle(hProcess);
-            return WideToUtf8(w);
+            AssignUtf16(pathW, (int)size, out);
+            return;
         }
         CloseHandle(hProcess);
     }
@@ -954,48 +937,65 @@ std::string GetExecutablePath(HWND hwnd) {
     hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId);
     if (hProcess) {
         WCHAR pathW[MAX_PATH] = {0};
-        if (GetModuleFileNameExW(hProcess, NULL, pathW, MAX_PATH)) {
+        if (DWORD len = GetModuleFileNameExW(hProcess, NULL, pathW, MAX_PATH)) {
             CloseHandle(hProcess);
-            return WideToUtf8(std::wstring(pathW));
+            AssignUtf16(pathW, (int)len, out);
+            return;
         }
         CloseHandle(hProcess);
     }
-    return "";
 }
 
-// Fenster-Titel ermitteln
-std::string GetWindowTitle(HWND hwnd) {
+std::u16string GetExecutablePath(HWND hwnd) {
+    std::u16string path;
+    ReadExecutablePath(hwnd, path);
+    return path;
+}
+
+// Fenster-Titel ermitteln, directly into out (no intermediate buffer)
+template <class Str>
+static void ReadWindowTitle(HWND hwnd, Str& out) {
+    out.clear();
     int len = GetWindowTextLengthW(hwnd);
-    if (len <= 0) return "";
-    std::wstring wtitle;
-    wtitle.resize((size_t)len);
-    int got = GetWindowTextW(hwnd, &wtitle[0], len + 1);
-    if (got <= 0) return "";
-    // In case GetWindowTextW wrote a null terminator inside
-    if ((size_t)got < wtitle.size()) wtitle.resize((size_t)got);
-    return WideToUtf8(wtitle);
+    if (len <= 0) return;
+    out.resize((size_t)len + 1);
+    // got may be shorter than len if the title changed in between
+    int got = GetWindowTextW(hwnd, AsWide(&out[0]), len + 1);
+    out.resize(got > 0 ? (size_t)got : 0);
+}
+
+std::u16string GetWindowTitle(HWND hwnd) {
+    std::u16string title;
+    ReadWindowTitle(hwnd, title);
+    return title;
 }
 
 // Fensterklasse ermitteln
-std::string GetWindowClassName(HWND hwnd) {
+template <class Str>
+static void ReadWindowClassName(HWND hwnd, Str& out) {
     WCHAR className[256] = {0};
     int len = GetClassNameW(hwnd, className, (int)(sizeof(className)/sizeof(className[0])));
-    if (len > 0) return WideToUtf8(std::wstring(className, len));
-    return "";
+    AssignUtf16(className, len, out);
+}
+
+std::u16string GetWindowClassName(HWND hwnd) {
+    std::u16string className;
+    ReadWindowClassName(hwnd, className);
+    return className;
 }
 
 // Versuche, einen Kindfenster-Titel zu finden (für ApplicationFrameWindow u.ä.)
-std::string GetFirstChildTitle(HWND hwnd) {
+template <class Str>
+static void ReadFirstChildTitle(HWND hwnd, Str& out) {
+    out.clear();
     HWND child = GetWindow(hwnd, GW_CHILD);
     while (child) {
-        int len = GetWindowTextLengthW(child);
-        if (len > 0) {
-            std::string t = GetWindowTitle(child);
-            if (!t.empty()) return t;
+        if (GetWindowTextLengthW(child) > 0) {
+            ReadWindowTitle(child, out);
+            if (!out.empty()) return;
         }
         child = GetWindow(child, GW_HWNDNEXT);
     }
-    return "";
 }
 
 // Prüfe, ob ein sichtbares Kindfenster existiert (für AppFrame-Hosts)
@@ -1008,122 +1008,169 @@ bool HasVisibleChildWindow(HWND hwnd) {
     return false;
 }
 
-// Erkenne PowerToys Command Palette anhand Titel oder Prozesspfad
-bool IsPowerToysCommandPalette(HWND hwnd) {
-    std::string title = GetWindowTitle(hwnd);
-    std::string path = GetExecutablePath(hwnd);
-    auto toLower = [](std::string s){
-        std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c){ return (char)std::tolower(c); });
-        return s;
-    };
-    std::string tl = toLower(title);
-    std::string pl = toLower(path);
-    if (tl.find("befehlspalette") != std::string::npos || tl.find("command palette") != std::string::npos) return true;
-    if (pl.find("microsoft.cmdpal.ui.exe") != std::string::npos) return true;
-    return false;
-}
-
-// Erkenne Datei-Explorer Fenster
-bool IsExplorerWindow(HWND hwnd) {
-    std::string cls = GetWindowClassName(hwnd);
-    if (_stricmp(cls.c_str(), "CabinetWClass") == 0) return true;
-    std::string path = GetExecutablePath(hwnd);
-    if (!path.empty()) {
-        std::string pl = path;
-        std::transform(pl.begin(), pl.end(), pl.begin(), [](unsigned char c){ return (char)std::tolower(c); });
-        if (pl.rfind("explorer.exe") != std::string::npos) return true;
-    }
-    return false;
-}
-
 // Erkenne WhatsApp anhand Titel oder Prozesspfad
 bool IsWhatsAppWindow(HWND hwnd) {
-    std::string title = GetWindowTitle(hwnd);
-    if (!title.empty()) {
-        std::string tl = title;
-        std::transform(tl.begin(), tl.end(), tl.begin(), [](unsigned char c){ return (char)std::tolower(c); });
-        if (tl.find("whatsapp") != std::string::npos) return true;
-    }
-    std::string path = GetExecutablePath(hwnd);
-    if (!path.empty()) {
-        std::string pl = path;
-        std::transform(pl.begin(), pl.end(), pl.begin(), [](unsigned char c){ return (char)std::tolower(c); });
-        if (pl.find("\\whatsapp.exe") != std::string::npos || pl.rfind("whatsapp.exe") == pl.size() - std::string("whatsapp.exe").size()) {
-            return true;
-        }
-    }
-    return false;
+    dwm::WindowAttributes a;
+    ReadWindowTitle(hwnd, a.title);
+    ReadExecutablePath(hwnd, a.executablePath);
+    return dwm::window_rules::IsWhatsApp(a);
 }
 
-// Encode HBITMAP -> PNG (base64 data URL)
-std::string BitmapToPngBase64(HBITMAP hBitmap, int width, int height) {
+// Read an HBITMAP into a 32bpp top-down frame (bitmap must not be selected into a DC)
+static bool HBitmapToFrame(HBITMAP hBitmap, int width, int height, dwm::Frame& out) {
+    if (!hBitmap || width <= 0 || height <= 0) return false;
     HDC hdcMem = CreateCompatibleDC(NULL);
-    if (!hdcMem) return "data:image/png;base64,";
-    
-    HBITMAP hOldBitmap = (HBITMAP)SelectObject(hdcMem, hBitmap);
+    if (!hdcMem) return false;
 
     BITMAPINFO bmi = {};
     bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
     bmi.bmiHeader.biWidth = width;
     bmi.bmiHeader.biHeight = -height; // Negative für Top-Down
     bmi.bmiHeader.biPlanes = 1;
-    bmi.bmiHeader.biBitCount = 24;
+    bmi.bmiHeader.biBitCount = 32;
     bmi.bmiHeader.biCompression = BI_RGB;
 
-    // Berechne Größe der Bilddaten
-    int rowSize = ((width * 3 + 3) / 4) * 4; // 4-Byte-Alignment
-    int imageSize = rowSize * height;
-    
-    // Allokiere Speicher für Bilddaten
-    std::vector<unsigned char> pixelData(imageSize);
-    
-    // Bitmap-Daten abrufen
-    if (GetDIBits(hdcMem, hBitmap, 0, height, pixelData.data(), &bmi, DIB_RGB_COLORS) == 0) {
-        SelectObject(hdcMem, hOldBitmap);
-        DeleteDC(hdcMem);
-        return "data:image/png;base64,";
+    out.Allocate(width, height);
+    dwm::MemoryCharge frameBytes(dwm::MemoryCategory::CaptureBuffers, out.pixels.size());
+    int lines = GetDIBits(hdcMem, hBitmap, 0, height, out.pixels.data(), &bmi, DIB_RGB_COLORS);
+    DeleteDC(hdcMem);
+    if (lines == 0) {
+        out.Clear();
+        return false;
     }
+    return true;
+}
 
-    // Build a GDI+ Bitmap from our 24bpp RGB buffer
-    Gdiplus::Bitmap gdiBitmap(width, height, rowSize, PixelFormat24bppRGB, pixelData.data());
+// GDI+ PNG encoder (codec.encoder 'gdiplus', the default): started on first
+// use, shut down with the module
+static std::mutex g_gdiplusMutex;
+static ULONG_PTR g_gdiplusToken = 0; // guarded by g_gdiplusMutex
+static CLSID g_pngEncoderClsid{};
+static void GdiplusCleanup(void* /*arg*/) {
+    std::lock_guard<std::mutex> lock(g_gdiplusMutex);
+    if (g_gdiplusToken) {
+        Gdiplus::GdiplusShutdown(g_gdiplusToken);
+        g_gdiplusToken = 0;
+    }
+}
 
-    // Save to IStream as PNG
-    IStream* stream = nullptr;
-    if (FAILED(CreateStreamOnHGlobal(NULL, TRUE, &stream))) {
-        SelectObject(hdcMem, hOldBitmap);
-        DeleteDC(hdcMem);
-        return "data:image/png;base64,";
+static bool EnsureGdiplus(CLSID& pngClsid) {
+    std::lock_guard<std::mutex> lock(g_gdiplusMutex);
+    if (!g_gdiplusToken) {
+        auto start = dwm::StartupTiming::Clock::now();
+        Gdiplus::GdiplusStartupInput si;
+        if (Gdiplus::GdiplusStartup(&g_gdiplusToken, &si, nullptr) != Gdiplus::Ok) {
+            g_gdiplusToken = 0;
+            return false;
+        }
+        UINT num = 0, size = 0;
+        Gdiplus::GetImageEncodersSize(&num, &size);
+        std::vector<BYTE> buffer(size);
+        auto* codecs = reinterpret_cast<Gdiplus::ImageCodecInfo*>(buffer.data());
+        bool found = false;
+        if (size && Gdiplus::GetImageEncoders(num, size, codecs) == Gdiplus::Ok) {
+            for (UINT j = 0; j < num && !found; ++j) {
+                if (wcscmp(codecs[j].MimeType, L"image/png") == 0) {
+                    g_pngEncoderClsid = codecs[j].Clsid;
+                    found = true;
+                }
+            }
+        }
+        if (!found) {
+            Gdiplus::GdiplusShutdown(g_gdiplusToken);
+            g_gdiplusToken = 0;
+            return false;
+        }
+        dwm::StartupTiming::Instance().RecordInit("gdiplus", start, dwm::StartupTiming::Clock::now());
     }
+    pngClsid = g_pngEncoderClsid;
+    return true;
+}
+
+// Frame -> PNG through GDI+ from 24bpp rows, as the addon always encoded
+// thumbnails and icons
+static bool EncodePngGdiplus(const dwm::Frame& frame, std::vector<uint8_t>& png) {
     CLSID pngClsid{};
-    if (GetEncoderClsid(L"image/png", &pngClsid) < 0) {
-        stream->Release();
-        SelectObject(hdcMem, hOldBitmap);
-        DeleteDC(hdcMem);
-        return "data:image/png;base64,";
-    }
-    if (gdiBitmap.Save(stream, &pngClsid, NULL) != Gdiplus::Ok) {
-        stream->Release();
-        SelectObject(hdcMem, hOldBitmap);
-        DeleteDC(hdcMem);
-        return "data:image/png;base64,";
+    if (frame.Empty() || !EnsureGdiplus(pngClsid)) return false;
+    const int rowSize = ((frame.width * 3 + 3) / 4) * 4; // 4-byte aligned
+    std::vector<uint8_t> rows((size_t)rowSize * frame.height);
+    for (int y = 0; y < frame.height; ++y) {
+        const uint8_t* src = frame.pixels.data() + (size_t)y * frame.width * 4;
+        uint8_t* dst = rows.data() + (size_t)y * rowSize;
+        for (int x = 0; x < frame.width; ++x, src += 4, dst += 3) {
+            dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2];
+        }
     }
+    Gdiplus::Bitmap bitmap(frame.width, frame.height, rowSize, PixelFormat24bppRGB, rows.data());
+    IStream* stream = nullptr;
+    if (FAILED(CreateStreamOnHGlobal(NULL, TRUE, &stream))) return false;
+    bool ok = bitmap.Save(stream, &pngClsid, NULL) == Gdiplus::Ok;
     HGLOBAL hMem = NULL;
-    if (FAILED(GetHGlobalFromStream(stream, &hMem)) || !hMem) {
-        stream->Release();
-        SelectObject(hdcMem, hOldBitmap);
-        DeleteDC(hdcMem);
-        return "data:image/png;base64,";
+    if (ok) ok = SUCCEEDED(GetHGlobalFromStream(stream, &hMem)) && hMem;
+    if (ok) {
+        // The HGLOBAL may be larger than what was written; the stream position is the PNG's size
+        ULARGE_INTEGER end{};
+        LARGE_INTEGER zero{};
+        ok = SUCCEEDED(stream->Seek(zero, STREAM_SEEK_CUR, &end));
+        const void* data = ok ? GlobalLock(hMem) : nullptr;
+        if (data) {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            png.assign(bytes, bytes + (size_t)end.QuadPart);
+            GlobalUnlock(hMem);
+        }
+        ok = data && !png.empty();
     }
-    SIZE_T sz = GlobalSize(hMem);
-    void* pData = GlobalLock(hMem);
-    std::string base64 = pData && sz ? base64_encode(reinterpret_cast<unsigned char*>(pData), (unsigned int)sz) : std::string();
-    if (pData) GlobalUnlock(hMem);
     stream->Release();
+    return ok;
+}
 
-    SelectObject(hdcMem, hOldBitmap);
-    DeleteDC(hdcMem);
+// PNG settings for window thumbnails (RuntimeConfig codec group)
+static dwm::PngEncodeOptions ThumbnailPngOptions(const dwm::RuntimeConfig& config) {
+    dwm::PngEncodeOptions options;
+    options.level = config.pngLevel;
+    options.palette = config.pngPalette;
+    options.dither = config.pngDither;
+    options.parallel.threads = config.pngThreads;
+    options.parallel.minBytes = config.parallelPngBytes;
+    return options;
+}
 
-    return "data:image/png;base64," + base64;
+// Encode frame -> PNG (base64 data URL)
+std::string FrameToPngBase64(const dwm::Frame& frame, const dwm::PngEncodeOptions& options) {
+    if (frame.Empty()) return "data:image/png;base64,";
+
+    std::vector<uint8_t> png;
+    {
+        DWM_TIME_STAGE(PngEncode);
+        if (!dwm::EncodePng(frame, options, png)) return "data:image/png;base64,";
+    }
+    DWM_TIME_STAGE(Base64);
+    return dwm::Base64DataUrl("image/png", png.data(), png.size());
+}
+
+// Encode a window thumbnail with the configured encoder (codec.encoder)
+static std::string ThumbnailToPngBase64(const dwm::Frame& frame, const dwm::RuntimeConfig& config) {
+    if (config.builtinPng) return FrameToPngBase64(frame, ThumbnailPngOptions(config));
+    if (frame.Empty()) return "data:image/png;base64,";
+    std::vector<uint8_t> png;
+    {
+        DWM_TIME_STAGE(PngEncode);
+        if (!EncodePngGdiplus(frame, png)) return "data:image/png;base64,";
+    }
+    DWM_TIME_STAGE(Base64);
+    return dwm::Base64DataUrl("image/png", png.data(), png.size());
+}
+
+// Encode HBITMAP -> PNG (base64 data URL). Icons stay RGB whatever
+// codec.palette says: they are tiny, and antialiased edges band.
+std::string BitmapToPngBase64(HBITMAP hBitmap, int width, int height) {
+    dwm::Frame frame;
+    if (!HBitmapToFrame(hBitmap, width, height, frame)) return "data:image/png;base64,";
+    const auto config = CurrentConfig();
+    if (!config->builtinPng) return ThumbnailToPngBase64(frame, *config);
+    dwm::PngEncodeOptions options;
+    options.level = config->pngLevel;
+    return FrameToPngBase64(frame, options);
 }
 
 // Get size of HBITMAP
@@ -1178,32 +1225,41 @@ std::string IconToBase64(HICON hIcon, int size) {
     HBRUSH brush = (HBRUSH)GetStockObject(WHITE_BRUSH);
     FillRect(hdc, &rc, brush);
     DrawIconEx(hdc, 0, 0, hIcon, size, size, 0, NULL, DI_NORMAL);
-    std::string b64 = BitmapToPngBase64(hbm, size, size);
     SelectObject(hdc, old);
+    std::string b64 = BitmapToPngBase64(hbm, size, size);
     DeleteObject(hbm);
     DeleteDC(hdc);
     ReleaseDC(NULL, hdcScreen);
     return b64;
 }
 
+// WM_GETICON is answered by the window's own thread: a hung app must not stall
+// the worker asking for its icon, so give up after a short wait
+static const UINT kIconMessageTimeoutMs = 100;
+
+static HICON QueryWindowIcon(HWND hwnd, WPARAM type) {
+    DWORD_PTR result = 0;
+    if (!SendMessageTimeoutW(hwnd, WM_GETICON, type, 0, SMTO_ABORTIFHUNG | SMTO_BLOCK, kIconMessageTimeoutMs, &result)) return NULL;
+    return (HICON)result;
+}
+
 // Get a reasonable HICON for a window (caller may need to DestroyIcon if extracted)
-static HICON GetBestIconHandle(HWND hwnd, const std::string& exePath, int desired) {
-    HICON hIcon = (HICON)SendMessage(hwnd, WM_GETICON, ICON_BIG, 0);
-    if (!hIcon) hIcon = (HICON)SendMessage(hwnd, WM_GETICON, ICON_SMALL2, 0);
-    if (!hIcon) hIcon = (HICON)SendMessage(hwnd, WM_GETICON, ICON_SMALL, 0);
+static HICON GetBestIconHandle(HWND hwnd, const std::u16string& exePath, int desired) {
+    HICON hIcon = QueryWindowIcon(hwnd, ICON_BIG);
+    if (!hIcon) hIcon = QueryWindowIcon(hwnd, ICON_SMALL2);
+    if (!hIcon) hIcon = QueryWindowIcon(hwnd, ICON_SMALL);
     if (!hIcon) hIcon = (HICON)GetClassLongPtr(hwnd, GCLP_HICON);
     if (!hIcon) hIcon = (HICON)GetClassLongPtr(hwnd, GCLP_HICONSM);
     if (!hIcon && !exePath.empty()) {
-        std::wstring wpath = Utf8ToWide(exePath);
         HICON extracted = NULL;
-        ExtractIconExW(wpath.c_str(), 0, &extracted, NULL, 1);
+        ExtractIconExW(AsWide(exePath.c_str()), 0, &extracted, NULL, 1);
         if (extracted) return extracted; // caller will DestroyIcon
     }
     return hIcon;
 }
 
 // Create a placeholder thumbnail (w x h) with centered app icon
-static std::string CreateIconPlaceholderThumbnail(HWND hwnd, const std::string& exePath, int w, int h) {
+static std::string CreateIconPlaceholderThumbnail(HWND hwnd, const std::u16string& exePath, int w, int h) {
     HDC hdcScreen = GetDC(NULL);
     if (!hdcScreen) return "data:image/png;base64,";
     HDC hdc = CreateCompatibleDC(hdcScreen);
@@ -1222,8 +1278,8 @@ static std::string CreateIconPlaceholderThumbnail(HWND hwnd, const std::string&
         if (icon) {
             DrawIconEx(hdc, x, y, icon, iconSize, iconSize, 0, NULL, DI_NORMAL);
         }
-        result = BitmapToPngBase64(hbm, w, h);
         SelectObject(hdc, old);
+        result = BitmapToPngBase64(hbm, w, h);
         if (icon) DestroyIcon(icon);
     }
     if (hbm) DeleteObject(hbm);
@@ -1245,6 +1301,7 @@ static LRESULT CALLBACK CaptureWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
 
 static bool EnsureCaptureWindowClass() {
     if (g_CaptureWndClass) return true;
+    auto start = dwm::StartupTiming::Clock::now();
     WNDCLASSEXW wc{}; wc.cbSize = sizeof(wc);
     wc.style = CS_HREDRAW | CS_VREDRAW;
     wc.lpfnWndProc = CaptureWndProc;
@@ -1252,29 +1309,32 @@ static bool EnsureCaptureWindowClass() {
     wc.hCursor = LoadCursor(NULL, IDC_ARROW);
     wc.lpszClassName = kCaptureWndClassName;
     g_CaptureWndClass = RegisterClassExW(&wc);
+    if (g_CaptureWndClass) dwm::StartupTiming::Instance().RecordInit("captureWindowClass", start, dwm::StartupTiming::Clock::now());
     return g_CaptureWndClass != 0;
 }
 
-static std::string CaptureWithDwmThumbnail(HWND srcHwnd, int maxWidth, int maxHeight) {
-    if (!EnsureCaptureWindowClass()) return "data:image/png;base64,";
+// Renders the DWM thumbnail into an off-screen window and reads it back; the
+// frame is already scaled to fit maxWidth x maxHeight.
+static bool CaptureWithDwmThumbnail(HWND srcHwnd, int maxWidth, int maxHeight, dwm::Frame& out) {
+    if (!EnsureCaptureWindowClass()) return false;
     // Create off-screen toolwindow
     HWND dest = CreateWindowExW(WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE, kCaptureWndClassName, L"",
         WS_POPUP, 0, 0, maxWidth, maxHeight, NULL, NULL, GetModuleHandleW(NULL), NULL);
-    if (!dest) return "data:image/png;base64,";
+    if (!dest) return false;
 
     // Register DWM thumbnail
     HTHUMBNAIL hThumb = NULL;
     HRESULT hr = DwmRegisterThumbnail(dest, srcHwnd, &hThumb);
     if (FAILED(hr) || !hThumb) {
         DestroyWindow(dest);
-        return "data:image/png;base64,";
+        return false;
     }
 
     SIZE srcSize{};
     if (FAILED(DwmQueryThumbnailSourceSize(hThumb, &srcSize)) || srcSize.cx <= 0 || srcSize.cy <= 0) {
         DwmUnregisterThumbnail(hThumb);
         DestroyWindow(dest);
-        return "data:image/png;base64,";
+        return false;
     }
 
     // Compute destination rect preserving aspect ratio
@@ -1306,12 +1366,13 @@ static std::string CaptureWithDwmThumbnail(HWND srcHwnd, int maxWidth, int maxHe
     HDC hdcWindow = GetDC(dest);
     HDC hdcMem = CreateCompatibleDC(hdcWindow);
     HBITMAP hbm = CreateCompatibleBitmap(hdcWindow, outW, outH);
-    std::string result = "data:image/png;base64,";
+    dwm::MemoryCharge bitmapBytes(dwm::MemoryCategory::CaptureBuffers, hbm ? (size_t)outW * outH * 4 : 0);
+    bool ok = false;
     if (hdcWindow && hdcMem && hbm) {
         HGDIOBJ old = SelectObject(hdcMem, hbm);
-    BitBlt(hdcMem, 0, 0, outW, outH, hdcWindow, 0, 0, SRCCOPY | CAPTUREBLT);
+        BitBlt(hdcMem, 0, 0, outW, outH, hdcWindow, 0, 0, SRCCOPY | CAPTUREBLT);
         SelectObject(hdcMem, old);
-        result = BitmapToPngBase64(hbm, outW, outH);
+        ok = HBitmapToFrame(hbm, outW, outH, out);
     }
     if (hbm) DeleteObject(hbm);
     if (hdcMem) DeleteDC(hdcMem);
@@ -1320,7 +1381,7 @@ static std::string CaptureWithDwmThumbnail(HWND srcHwnd, int maxWidth, int maxHe
     ShowWindow(dest, SW_HIDE);
     DwmUnregisterThumbnail(hThumb);
     DestroyWindow(dest);
-    return result;
+    return ok;
 }
 
 // Ensure COM for the current thread; returns true if we initialized and must uninit later
@@ -1383,20 +1444,18 @@ static std::string GetUwpIconFromAumid(const std::wstring& aumid, int size) {
 }
 
 // Icon für ein Fenster abrufen (mit Cache)
-std::string GetWindowIconBase64(HWND hwnd, const std::string& exePath, int size = 32) {
+std::string GetWindowIconBase64(HWND hwnd, const std::u16string& exePath, int size = 32) {
+    DWM_TIME_STAGE(Icon);
     {
         std::lock_guard<std::mutex> lock(g_cacheMutex);
         auto it = g_iconCache.find(hwnd);
-        if (it != g_iconCache.end()) return it->second;
+        if (it != g_iconCache.end()) return it->second.dataUrl;
     }
 
     // Special handling for UWP-hosted windows (ApplicationFrameHost, WhatsApp, etc.)
-    std::string cls = GetWindowClassName(hwnd);
-    std::string clsLower = cls; std::transform(clsLower.begin(), clsLower.end(), clsLower.begin(), [](unsigned char c){ return (char)std::tolower(c); });
-    std::string exeLower = exePath; std::transform(exeLower.begin(), exeLower.end(), exeLower.begin(), [](unsigned char c){ return (char)std::tolower(c); });
-    bool isAppFrame = (clsLower == "applicationframewindow");
-    bool isFrameHost = exeLower.find("\\applicationframehost.exe") != std::string::npos ||
-                       (exeLower.size() >= 24 && exeLower.rfind("applicationframehost.exe") == exeLower.size() - strlen("applicationframehost.exe"));
+    bool isAppFrame = dwm::window_rules::EqualsNoCase(GetWindowClassName(hwnd), "applicationframewindow");
+    bool isFrameHost = dwm::window_rules::ContainsNoCase(exePath, "\\applicationframehost.exe") ||
+                       dwm::window_rules::EndsWithNoCase(exePath, "applicationframehost.exe");
     bool uwpCandidate = isAppFrame || isFrameHost || IsWhatsAppWindow(hwnd);
     if (uwpCandidate) {
         std::wstring aumid = GetAumidForWindow(hwnd);
@@ -1404,23 +1463,22 @@ std::string GetWindowIconBase64(HWND hwnd, const std::string& exePath, int size
             std::string uwpIcon = GetUwpIconFromAumid(aumid, size);
             if (uwpIcon.size() > strlen("data:image/png;base64,")) {
                 std::lock_guard<std::mutex> lock(g_cacheMutex);
-                g_iconCache[hwnd] = uwpIcon;
+                StoreIconCacheEntry(hwnd, uwpIcon);
                 return uwpIcon;
             }
         }
     }
 
-    HICON hIcon = (HICON)SendMessage(hwnd, WM_GETICON, ICON_SMALL2, 0);
-    if (!hIcon) hIcon = (HICON)SendMessage(hwnd, WM_GETICON, ICON_SMALL, 0);
-    if (!hIcon) hIcon = (HICON)SendMessage(hwnd, WM_GETICON, ICON_BIG, 0);
+    HICON hIcon = QueryWindowIcon(hwnd, ICON_SMALL2);
+    if (!hIcon) hIcon = QueryWindowIcon(hwnd, ICON_SMALL);
+    if (!hIcon) hIcon = QueryWindowIcon(hwnd, ICON_BIG);
     if (!hIcon) hIcon = (HICON)GetClassLongPtr(hwnd, GCLP_HICONSM);
     if (!hIcon) hIcon = (HICON)GetClassLongPtr(hwnd, GCLP_HICON);
 
     HICON extracted = NULL;
     if (!hIcon && !exePath.empty()) {
         // Let Windows pick the best icon from the file
-        std::wstring wpath = Utf8ToWide(exePath);
-        ExtractIconExW(wpath.c_str(), 0, NULL, &extracted, 1);
+        ExtractIconExW(AsWide(exePath.c_str()), 0, NULL, &extracted, 1);
         if (extracted) hIcon = extracted;
     }
 
@@ -1428,326 +1486,1005 @@ std::string GetWindowIconBase64(HWND hwnd, const std::string& exePath, int size
     if (extracted) DestroyIcon(extracted);
     {
         std::lock_guard<std::mutex> lock(g_cacheMutex);
-        g_iconCache[hwnd] = b64;
+        StoreIconCacheEntry(hwnd, b64);
     }
     return b64;
 }
 
-#ifdef ENABLE_WGC
-// Windows Graphics Capture (WinRT) one-shot capture for an HWND
-// Returns PNG data URL or empty PNG URL if unsupported/failure.
-std::string CaptureWindowScreenshotWGC(HWND hwnd, int maxWidth = 200, int maxHeight = 150) {
-    using namespace winrt;
-    namespace WG = winrt::Windows::Graphics;
-    namespace WGC = winrt::Windows::Graphics::Capture;
-    namespace WGD = winrt::Windows::Graphics::DirectX;
-    namespace WGD11 = winrt::Windows::Graphics::DirectX::Direct3D11;
-    namespace WGI = winrt::Windows::Graphics::Imaging;
-    namespace WSS = winrt::Windows::Storage::Streams;
-
-    WinrtInitOnce();
-    if (!g_winrtInited) return "data:image/png;base64,";
+// Hedged attempts run on a capped set of threads, at most kHedgeAttemptsPerWindow
+// at a time per window across calls; a hedged capture returns within kHedgeTimeout.
+// WGC captures asked for on an STA thread run there too. The executor is shut
+// down at env cleanup.
+static const size_t kHedgeThreads = 8;
+static const size_t kHedgeAttemptsPerWindow = 2;
+static const std::chrono::seconds kHedgeTimeout{ 5 };
+static dwm::AttemptExecutor g_hedgeExecutor{ kHedgeThreads };
+static dwm::InFlightLimiter g_hedgeInFlight;
 
-    // Check support
-    if (!WGC::GraphicsCaptureSession::IsSupported()) {
-        return "data:image/png;base64,";
-    }
+#ifdef ENABLE_WGC
+// Windows Graphics Capture (WinRT), as coroutines: a capture waits for its
+// first frame and for the surface copy without holding a thread (the frame
+// pool is free-threaded and signals an event, CreateCopyFromSurfaceAsync is
+// awaited), so one thread can start many captures and wait for all of them
+// once (CaptureWindowFramesWGC). Only the prefetcher batches, though:
+// CaptureWindowFrameWGC, the one-window form behind on-demand captures, still
+// holds its calling capture worker until the frame is in (up to
+// kWgcFrameTimeout plus the copy), so on-demand WGC concurrency stays bounded
+// by the capture threads and the hedge executor. A batch gives up on captures
+// still running at kWgcBatchTimeout. C++/WinRT must not block an STA thread
+// (e.g. the JS thread after another module made it one), so captures asked
+// for there run on a hedge executor thread instead.
+namespace WGC = winrt::Windows::Graphics::Capture;
+namespace WGD11 = winrt::Windows::Graphics::DirectX::Direct3D11;
+static constexpr std::chrono::milliseconds kWgcFrameTimeout{ 300 };
+static constexpr std::chrono::milliseconds kWgcBatchTimeout{ 2000 };
+
+struct WgcCapture {
+    HWND hwnd{ nullptr };
+    dwm::Frame frame; // full-size BGRA; scaling happens in the scale stage
+    bool ok{ false };
+    std::chrono::nanoseconds elapsed{ 0 };
+    uint64_t peakBytes{ 0 }; // transient bytes held at once (charged on pool threads)
+};
 
-    // Create D3D11 device with BGRA support
+// WinRT Direct3D device (BGRA support) for frame pools; null on failure. One
+// serves a whole batch, whose captures copy surfaces from several pool
+// threads at once: ID3D11Device is free-threaded but its immediate context
+// is not, so the device is made multithread-protected, which serializes
+// context use internally.
+static WGD11::IDirect3DDevice CreateWgcDevice() {
     winrt::com_ptr<ID3D11Device> d3dDevice;
     winrt::com_ptr<ID3D11DeviceContext> d3dContext;
     UINT flags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
     D3D_FEATURE_LEVEL fl;
     HRESULT hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, flags, nullptr, 0, D3D11_SDK_VERSION, d3dDevice.put(), &fl, d3dContext.put());
-    if (FAILED(hr)) return "data:image/png;base64,";
-
-    // Wrap as WinRT Direct3D device
+    if (FAILED(hr)) return nullptr;
+    winrt::com_ptr<ID3D10Multithread> multithread;
+    hr = d3dDevice->QueryInterface(__uuidof(ID3D10Multithread), multithread.put_void());
+    if (FAILED(hr) || !multithread) return nullptr;
+    multithread->SetMultithreadProtected(TRUE);
     winrt::com_ptr<IDXGIDevice> dxgiDevice;
     hr = d3dDevice->QueryInterface(__uuidof(IDXGIDevice), dxgiDevice.put_void());
-    if (FAILED(hr) || !dxgiDevice) return "data:image/png;base64,";
-    WGD11::IDirect3DDevice winrtDevice{ nullptr };
-    {
-        winrt::com_ptr<IInspectable> inspectable;
-        HRESULT hrDev = CreateDirect3D11DeviceFromDXGIDevice(dxgiDevice.get(), inspectable.put());
-        if (FAILED(hrDev) || !inspectable) return "data:image/png;base64,";
-    winrtDevice = inspectable.as<WGD11::IDirect3DDevice>();
-    }
+    if (FAILED(hr) || !dxgiDevice) return nullptr;
+    winrt::com_ptr<IInspectable> inspectable;
+    hr = CreateDirect3D11DeviceFromDXGIDevice(dxgiDevice.get(), inspectable.put());
+    if (FAILED(hr) || !inspectable) return nullptr;
+    return inspectable.as<WGD11::IDirect3DDevice>();
+}
 
-    // Create GraphicsCaptureItem from HWND via interop
-    auto factory = winrt::get_activation_factory<WGC::GraphicsCaptureItem>();
-    auto interop = factory.as<IGraphicsCaptureItemInterop>();
-    WGC::GraphicsCaptureItem item{ nullptr };
-    hr = interop->CreateForWindow(hwnd, winrt::guid_of<WGC::GraphicsCaptureItem>(), reinterpret_cast<void**>(winrt::put_abi(item)));
-    if (FAILED(hr) || !item) return "data:image/png;base64,";
+// One capture into *out. Runs on the thread pool from its first line, so the
+// starting thread returns at once and the MemoryCharges below never land in
+// its AllocationScope; out and peakBytes must outlive the operation.
+static winrt::Windows::Foundation::IAsyncOperation<bool> CaptureWgcFrameAsync(WGD11::IDirect3DDevice device, HWND hwnd,
+                                                                              dwm::Frame* out, uint64_t* peakBytes) {
+    namespace WGD = winrt::Windows::Graphics::DirectX;
+    namespace WGI = winrt::Windows::Graphics::Imaging;
+    namespace WSS = winrt::Windows::Storage::Streams;
+    co_await winrt::resume_background();
 
-    // Determine size
+    // GraphicsCaptureItem from the HWND via interop
+    auto interop = winrt::get_activation_factory<WGC::GraphicsCaptureItem>().as<IGraphicsCaptureItemInterop>();
+    WGC::GraphicsCaptureItem item{ nullptr };
+    HRESULT hr = interop->CreateForWindow(hwnd, winrt::guid_of<WGC::GraphicsCaptureItem>(), reinterpret_cast<void**>(winrt::put_abi(item)));
+    if (FAILED(hr) || !item) co_return false;
     auto sz = item.Size();
-    if (sz.Width <= 0 || sz.Height <= 0) return "data:image/png;base64,";
+    if (sz.Width <= 0 || sz.Height <= 0) co_return false;
 
-    // Frame pool and session
-    WGC::Direct3D11CaptureFramePool pool = WGC::Direct3D11CaptureFramePool::Create(winrtDevice, WGD::DirectXPixelFormat::B8G8R8A8UIntNormalized, 1, sz);
+    // Free-threaded pool: FrameArrived fires on a pool thread and sets the
+    // event, which the handler keeps alive past this coroutine
+    auto arrived = std::make_shared<winrt::handle>(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+    if (!*arrived) co_return false;
+    WGC::Direct3D11CaptureFramePool pool = WGC::Direct3D11CaptureFramePool::CreateFreeThreaded(device, WGD::DirectXPixelFormat::B8G8R8A8UIntNormalized, 1, sz);
     WGC::GraphicsCaptureSession session = pool.CreateCaptureSession(item);
+    struct CloseOnExit {
+        WGC::GraphicsCaptureSession& session;
+        WGC::Direct3D11CaptureFramePool& pool;
+        ~CloseOnExit() { try { session.Close(); pool.Close(); } catch (...) {} }
+    } closer{ session, pool };
+    dwm::MemoryCharge poolBytes(dwm::MemoryCategory::WgcCapture, (size_t)sz.Width * sz.Height * 4);
+    pool.FrameArrived([arrived](const WGC::Direct3D11CaptureFramePool&, const winrt::Windows::Foundation::IInspectable&) {
+        SetEvent(arrived->get());
+    });
     // Optional: Hide capture border and cursor if available
     try { session.IsBorderRequired(false); } catch (...) {}
     try { session.IsCursorCaptureEnabled(false); } catch (...) {}
     session.StartCapture();
 
-    WGC::Direct3D11CaptureFrame frame{ nullptr };
-    // Poll a few times for a frame
-    for (int i = 0; i < 30; ++i) {
-        frame = pool.TryGetNextFrame();
-        if (frame) break;
-        Sleep(10);
-    }
-    if (!frame) {
-        try { session.Close(); pool.Close(); } catch (...) {}
-        return "data:image/png;base64,";
-    }
-
-    WGD11::IDirect3DSurface surface = frame.Surface();
+    if (!co_await winrt::resume_on_signal(arrived->get(), kWgcFrameTimeout)) co_return false;
+    WGC::Direct3D11CaptureFrame frame = pool.TryGetNextFrame();
+    if (!frame) co_return false;
+    WGI::SoftwareBitmap sbmp = co_await WGI::SoftwareBitmap::CreateCopyFromSurfaceAsync(frame.Surface(), WGI::BitmapAlphaMode::Premultiplied);
+    if (!sbmp) co_return false;
+    dwm::MemoryCharge bitmapBytes(dwm::MemoryCategory::WgcCapture, (size_t)sbmp.PixelWidth() * sbmp.PixelHeight() * 4);
 
-    // Copy to SoftwareBitmap
-    auto op = WGI::SoftwareBitmap::CreateCopyFromSurfaceAsync(surface, WGI::BitmapAlphaMode::Premultiplied);
-    WGI::SoftwareBitmap sbmp = nullptr;
-    try { sbmp = op.get(); } catch (...) { sbmp = nullptr; }
-    if (!sbmp) {
-        try { session.Close(); pool.Close(); } catch (...) {}
-        return "data:image/png;base64,";
-    }
-
-    // Scale if larger than requested
-    int32_t w = sbmp.PixelWidth();
-    int32_t h = sbmp.PixelHeight();
-    double sx = (double)maxWidth / (double)w;
-    double sy = (double)maxHeight / (double)h;
-    double s = std::min(sx, sy);
-    uint32_t outW = (uint32_t)std::max(1, (int)std::round(w * s));
-    uint32_t outH = (uint32_t)std::max(1, (int)std::round(h * s));
-
-    WSS::InMemoryRandomAccessStream stream;
-    WGI::BitmapEncoder encoder = nullptr;
-    try { encoder = WGI::BitmapEncoder::CreateAsync(WGI::BitmapEncoder::PngEncoderId(), stream).get(); } catch (...) { encoder = nullptr; }
-    if (!encoder) {
-        try { session.Close(); pool.Close(); } catch (...) {}
-        return "data:image/png;base64,";
+    // Normalize to BGRA8 and copy the pixels out
+    if (sbmp.BitmapPixelFormat() != WGI::BitmapPixelFormat::Bgra8) {
+        sbmp = WGI::SoftwareBitmap::Convert(sbmp, WGI::BitmapPixelFormat::Bgra8);
     }
-    encoder.SetSoftwareBitmap(sbmp);
-    auto transform = encoder.BitmapTransform();
-    transform.ScaledWidth(outW);
-    transform.ScaledHeight(outH);
-    try { encoder.FlushAsync().get(); } catch (...) {}
+    out->Allocate(sbmp.PixelWidth(), sbmp.PixelHeight());
+    dwm::MemoryCharge frameBytes(dwm::MemoryCategory::CaptureBuffers, out->pixels.size());
+    WSS::Buffer buffer((uint32_t)out->pixels.size());
+    dwm::MemoryCharge bufferBytes(dwm::MemoryCategory::WgcCapture, out->pixels.size());
+    *peakBytes = poolBytes.Bytes() + bitmapBytes.Bytes() + frameBytes.Bytes() + bufferBytes.Bytes();
+    sbmp.CopyToBuffer(buffer);
+    size_t n = std::min<size_t>(buffer.Length(), out->pixels.size());
+    memcpy(out->pixels.data(), buffer.data(), n);
+    co_return !out->Empty();
+}
 
-    // Read back bytes
-    uint64_t size = stream.Size();
-    std::string base64;
+// Shares the capture, so one the batch gave up on can still finish into it
+static winrt::Windows::Foundation::IAsyncAction CaptureWgcAsync(WGD11::IDirect3DDevice device, std::shared_ptr<WgcCapture> capture) {
+    auto start = std::chrono::steady_clock::now();
     try {
-        auto input = stream.GetInputStreamAt(0);
-        WSS::DataReader reader(input);
-        reader.LoadAsync((uint32_t)size).get();
-        std::vector<uint8_t> bytes((size_t)size);
-        reader.ReadBytes(winrt::array_view<uint8_t>(bytes));
-        base64 = base64_encode(bytes.data(), (unsigned int)bytes.size());
+        capture->ok = co_await CaptureWgcFrameAsync(device, capture->hwnd, &capture->frame, &capture->peakBytes);
     } catch (...) {
-        base64.clear();
+        capture->ok = false;
     }
+    if (!capture->ok) capture->frame.Clear();
+    capture->elapsed = std::chrono::steady_clock::now() - start;
+}
 
-    try { session.Close(); pool.Close(); } catch (...) {}
-
-    return std::string("data:image/png;base64,") + base64;
+static bool IsStaThread() {
+    APTTYPE type;
+    APTTYPEQUALIFIER qualifier;
+    if (FAILED(CoGetApartmentType(&type, &qualifier))) return false; // no apartment yet
+    return type == APTTYPE_STA || type == APTTYPE_MAINSTA;
 }
-#endif // ENABLE_WGC
 
-// Screenshot eines Fensters erstellen
-std::string CaptureWindowScreenshot(HWND hwnd, int maxWidth = 200, int maxHeight = 150) {
-    if (!IsWindow(hwnd)) {
-        return "data:image/png;base64,";
-    }
+static void CaptureWindowFramesWGC(std::vector<WgcCapture>& captures);
 
-    auto isGoodPngSize = [](const std::string& data) {
-        // Heuristic: a 200x150 PNG is typically > ~8KB base64
-        return data.size() > strlen("data:image/png;base64,") + 8000;
+// CaptureWindowFramesWGC on a hedge executor thread; entries stay failed if
+// none is free or it does not finish in time
+static void CaptureWindowFramesWGCOffThread(std::vector<WgcCapture>& captures) {
+    struct Handoff {
+        std::mutex mutex;
+        std::condition_variable finished;
+        bool done{ false };
+        std::vector<WgcCapture> captures;
     };
+    auto handoff = std::make_shared<Handoff>();
+    handoff->captures.resize(captures.size());
+    for (size_t i = 0; i < captures.size(); ++i) handoff->captures[i].hwnd = captures[i].hwnd;
+    bool started = g_hedgeExecutor.TrySubmit([handoff] {
+        CaptureWindowFramesWGC(handoff->captures);
+        std::lock_guard<std::mutex> lock(handoff->mutex);
+        handoff->done = true;
+        handoff->finished.notify_all();
+    });
+    if (!started) return;
+    std::unique_lock<std::mutex> lock(handoff->mutex);
+    if (!handoff->finished.wait_for(lock, 2 * kWgcBatchTimeout, [&] { return handoff->done; })) return;
+    for (size_t i = 0; i < captures.size(); ++i) captures[i] = std::move(handoff->captures[i]);
+}
 
-    // If minimized, avoid mutating OS iconic thumbnails; use off-screen DWM thumbnail capture instead
-    if (IsIconic(hwnd)) {
-        // Prefer DwmRegisterThumbnail-based off-screen capture first
-        {
-            std::string dwmTn = CaptureWithDwmThumbnail(hwnd, maxWidth, maxHeight);
-            if (isGoodPngSize(dwmTn)) return dwmTn;
+// Captures every entry's hwnd at once: all captures are started on one
+// device, then the calling thread waits for them together, for at most
+// kWgcBatchTimeout. Entries that fail or are still running then (or all of
+// them, without WGC support) come back with ok == false.
+static void CaptureWindowFramesWGC(std::vector<WgcCapture>& captures) {
+    if (captures.empty()) return;
+    if (IsStaThread()) {
+        CaptureWindowFramesWGCOffThread(captures);
+        return;
+    }
+    if (!EnsureWinrtApartment() || !WGC::GraphicsCaptureSession::IsSupported()) return;
+    WGD11::IDirect3DDevice device = CreateWgcDevice();
+    if (!device) return;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::shared_ptr<WgcCapture>> running;
+    std::vector<winrt::Windows::Foundation::IAsyncAction> inFlight;
+    running.reserve(captures.size());
+    inFlight.reserve(captures.size());
+    for (WgcCapture& capture : captures) {
+        running.push_back(std::make_shared<WgcCapture>());
+        running.back()->hwnd = capture.hwnd;
+        inFlight.push_back(CaptureWgcAsync(device, running.back()));
+    }
+    auto giveUpAt = start + kWgcBatchTimeout;
+    for (size_t i = 0; i < inFlight.size(); ++i) {
+        auto left = std::max<std::chrono::steady_clock::duration>(giveUpAt - std::chrono::steady_clock::now(), std::chrono::steady_clock::duration::zero());
+        bool done = false;
+        try {
+            done = inFlight[i].wait_for(std::chrono::duration_cast<winrt::Windows::Foundation::TimeSpan>(left)) ==
+                   winrt::Windows::Foundation::AsyncStatus::Completed;
+        } catch (...) {}
+        if (done) {
+            captures[i] = std::move(*running[i]);
+            continue;
         }
-        // If that failed, continue to non-iconic fallbacks below
+        try { inFlight[i].Cancel(); } catch (...) {}
+        captures[i].ok = false;
+        captures[i].elapsed = std::chrono::steady_clock::now() - start;
     }
+}
 
-    // Preferred path for non-minimized windows (optional): Windows Graphics Capture
-#ifdef ENABLE_WGC
-    if (!IsIconic(hwnd) && ShouldUseWgc()) {
-        std::string wgc = CaptureWindowScreenshotWGC(hwnd, maxWidth, maxHeight);
-        if (wgc.size() > strlen("data:image/png;base64,")) {
-            return wgc;
-        }
+// One-shot capture for an HWND
+// Fills a full-size BGRA frame; returns false if unsupported/failure.
+static bool CaptureWindowFrameWGC(HWND hwnd, dwm::Frame& out) {
+    std::vector<WgcCapture> captures(1);
+    captures[0].hwnd = hwnd;
+    CaptureWindowFramesWGC(captures);
+    // The charges were made on pool threads: report their peak to this thread's scope
+    if (dwm::AllocationScope* scope = dwm::AllocationScope::Current()) {
+        scope->Add((int64_t)captures[0].peakBytes);
+        scope->Add(-(int64_t)captures[0].peakBytes);
     }
-#endif
+    if (!captures[0].ok) return false;
+    out = std::move(captures[0].frame);
+    return true;
+}
+#endif // ENABLE_WGC
 
-    // Fenstergrößen ermitteln (für minimierte Fenster: normale Größe verwenden)
-    RECT windowRect{};
+// ---------------- Capture methods (ordered fallbacks, optionally hedged) ----------------
+enum CaptureMethod {
+    kCaptureDwmThumbnail = 0, // off-screen DwmRegisterThumbnail, already box-sized
+    kCaptureWgc,              // Windows Graphics Capture (ENABLE_WGC builds, opt-in via configure)
+    kCapturePrintFull,        // PrintWindow(PW_RENDERFULLCONTENT)
+    kCapturePrintClient,      // PrintWindow(PW_CLIENTONLY)
+    kCapturePrintDefault,     // PrintWindow(0)
+    kCaptureDesktopBlt,       // BitBlt from the screen DC
+    kCaptureMethodCount
+};
+static_assert(kCaptureMethodCount == dwm::kCaptureMethodCount, "names and masks in runtime_config.h");
+using dwm::kCaptureMethodNames;
+
+struct CaptureMethodStats {
+    dwm::LatencyHistogram latency; // every attempt, including hedges that lost
+    std::atomic<uint64_t> failures{ 0 };
+    std::atomic<uint64_t> wins{ 0 };  // attempts whose frame was used
+};
+static CaptureMethodStats g_captureMethodStats[kCaptureMethodCount];
+static std::atomic<uint64_t> g_hedgedCaptures{ 0 }; // captures that started at least one hedge
+static std::atomic<uint64_t> g_hedgeWins{ 0 };      // ... and were won by a method other than the primary
+static std::atomic<uint64_t> g_hedgeThrottled{ 0 }; // captures that could not start an attempt
+static std::atomic<uint64_t> g_hedgeTimeouts{ 0 };  // captures that gave up at kHedgeTimeout
+
+struct CaptureOptions {
+    bool hedge{ false };
+    double hedgePercentile{ 90 }; // hedge when a method runs longer than this percentile of its history
+    uint32_t methods{ dwm::RuntimeConfig().captureMethods }; // enabled methods (RuntimeConfig::captureMethods)
+};
+
+// Until a method has enough samples its threshold is a fixed default
+static const uint64_t kHedgeMinSamples = 20;
+static const std::chrono::milliseconds kHedgeDefaultThreshold{ 50 };
+static const std::chrono::milliseconds kHedgeMinThreshold{ 5 };
+
+static std::chrono::nanoseconds HedgeThresholdFor(int method, double percentile) {
+    const dwm::LatencyHistogram& h = g_captureMethodStats[method].latency;
+    if (h.Count() < kHedgeMinSamples) return kHedgeDefaultThreshold;
+    std::chrono::nanoseconds t = std::chrono::microseconds(h.PercentileUs(percentile));
+    return std::max<std::chrono::nanoseconds>(t, kHedgeMinThreshold);
+}
+
+static void RecordCaptureAttempt(int method, std::chrono::nanoseconds elapsed, bool ok) {
+    g_captureMethodStats[method].latency.Record(elapsed);
+    if (!ok) g_captureMethodStats[method].failures.fetch_add(1);
+}
+
+// Methods that keep failing for a window (DRM video, elevated processes, cloaked hosts)
+// back off exponentially per (window, pid, method) instead of being retried every call.
+static dwm::NegativeCache g_negativeCache;
+
+static dwm::NegativeCacheKey CaptureFailureKey(HWND hwnd, int method) {
+    DWORD pid = 0;
+    GetWindowThreadProcessId(hwnd, &pid);
+    return dwm::NegativeCacheKey{ (uint64_t)(uintptr_t)hwnd, (uint32_t)pid, method };
+}
+
+static void RecordCaptureOutcome(HWND hwnd, int method, std::chrono::nanoseconds elapsed, bool ok) {
+    RecordCaptureAttempt(method, elapsed, ok);
+    dwm::TraceWriter& tracer = dwm::TraceWriter::Instance();
+    if (tracer.Enabled()) {
+        auto end = std::chrono::steady_clock::now();
+        tracer.Complete("captureMethod", kCaptureMethodNames[method], end - elapsed, end,
+            "\"hwnd\":" + std::to_string((uint64_t)(uintptr_t)hwnd) + ",\"ok\":" + (ok ? "true" : "false"));
+    }
+    dwm::NegativeCacheKey key = CaptureFailureKey(hwnd, method);
+    if (ok) g_negativeCache.RecordSuccess(key);
+    else g_negativeCache.RecordFailure(key);
+}
+
+// Fenstergrößen ermitteln (für minimierte Fenster: normale Größe verwenden)
+static bool GetCaptureRect(HWND hwnd, RECT& windowRect) {
     if (IsIconic(hwnd)) {
-        // Already attempted DWM thumbnail above; if we get here, fall back to window placement size and PrintWindow/BitBlt
         WINDOWPLACEMENT wp{}; wp.length = sizeof(WINDOWPLACEMENT);
         if (GetWindowPlacement(hwnd, &wp)) {
             windowRect = wp.rcNormalPosition;
-        } else if (!GetWindowRect(hwnd, &windowRect)) {
-            return "data:image/png;base64,";
-        }
-    } else {
-        if (!GetWindowRect(hwnd, &windowRect)) {
-            return "data:image/png;base64,";
+            return true;
         }
     }
+    return GetWindowRect(hwnd, &windowRect) ? true : false;
+}
 
+// Full-size capture into a fresh bitmap via PrintWindow (flags) or, with
+// fromDesktop, a BitBlt of the window's screen area.
+static bool CaptureWindowBitmapFrame(HWND hwnd, UINT printFlags, bool fromDesktop, dwm::Frame& out) {
+    RECT windowRect{};
+    if (!GetCaptureRect(hwnd, windowRect)) return false;
     int windowWidth = windowRect.right - windowRect.left;
     int windowHeight = windowRect.bottom - windowRect.top;
-
-    if (windowWidth <= 0 || windowHeight <= 0) {
-        return "data:image/png;base64,";
-    }
-
-    // Skalierungsfaktor berechnen
-    double scaleX = (double)maxWidth / windowWidth;
-    double scaleY = (double)maxHeight / windowHeight;
-    double scale = (std::min)(scaleX, scaleY);
-    
-    int thumbnailWidth = (int)(windowWidth * scale);
-    int thumbnailHeight = (int)(windowHeight * scale);
+    if (windowWidth <= 0 || windowHeight <= 0) return false;
 
     // Device Contexts erstellen
     HDC hdcWindow = GetDC(hwnd);
-    if (!hdcWindow) return "data:image/png;base64,";
-    
+    if (!hdcWindow) return false;
     HDC hdcMemDC = CreateCompatibleDC(hdcWindow);
-    HDC hdcThumbnail = CreateCompatibleDC(hdcWindow);
-
-    if (!hdcMemDC || !hdcThumbnail) {
-        if (hdcMemDC) DeleteDC(hdcMemDC);
-        if (hdcThumbnail) DeleteDC(hdcThumbnail);
-    ReleaseDC(hwnd, hdcWindow);
-    return "data:image/png;base64,";
+    if (!hdcMemDC) {
+        ReleaseDC(hwnd, hdcWindow);
+        return false;
     }
-
-    // Bitmaps erstellen
+    // Bitmap in voller Fenstergröße erstellen; skaliert wird in der Scale-Stufe
     HBITMAP hbmScreen = CreateCompatibleBitmap(hdcWindow, windowWidth, windowHeight);
-    HBITMAP hbmThumbnail = CreateCompatibleBitmap(hdcWindow, thumbnailWidth, thumbnailHeight);
-
-    if (!hbmScreen || !hbmThumbnail) {
-        if (hbmScreen) DeleteObject(hbmScreen);
-        if (hbmThumbnail) DeleteObject(hbmThumbnail);
+    if (!hbmScreen) {
         DeleteDC(hdcMemDC);
-        DeleteDC(hdcThumbnail);
-    ReleaseDC(hwnd, hdcWindow);
-    return "data:image/png;base64,";
+        ReleaseDC(hwnd, hdcWindow);
+        return false;
     }
+    dwm::MemoryCharge bitmapBytes(dwm::MemoryCategory::CaptureBuffers, (size_t)windowWidth * windowHeight * 4);
+    HBITMAP hOldBitmap = (HBITMAP)SelectObject(hdcMemDC, hbmScreen);
 
-    // Original Bitmap auswählen
-    HBITMAP hOldBitmap1 = (HBITMAP)SelectObject(hdcMemDC, hbmScreen);
-    HBITMAP hOldBitmap2 = (HBITMAP)SelectObject(hdcThumbnail, hbmThumbnail);
-
-    // Fenster-Screenshot aufnehmen - versuche verschiedene Methoden
     BOOL result = FALSE;
-    
-    // Methode 1: PrintWindow mit PW_RENDERFULLCONTENT
-    result = PrintWindow(hwnd, hdcMemDC, PW_RENDERFULLCONTENT);
-    
-    if (!result) {
-        // Methode 2: PrintWindow mit PW_CLIENTONLY
-        result = PrintWindow(hwnd, hdcMemDC, PW_CLIENTONLY);
-    }
-    
-    if (!result) {
-        // Methode 3: PrintWindow ohne Flags
-        result = PrintWindow(hwnd, hdcMemDC, 0);
-    }
-    
-    if (!result) {
-        // Methode 4: Fallback - BitBlt vom Desktop
+    if (fromDesktop) {
         HDC hdcDesktop = GetDC(NULL);
         if (hdcDesktop) {
-            BitBlt(hdcMemDC, 0, 0, windowWidth, windowHeight, 
-                   hdcDesktop, windowRect.left, windowRect.top, SRCCOPY | CAPTUREBLT);
+            result = BitBlt(hdcMemDC, 0, 0, windowWidth, windowHeight,
+                            hdcDesktop, windowRect.left, windowRect.top, SRCCOPY | CAPTUREBLT);
             ReleaseDC(NULL, hdcDesktop);
         }
+    } else {
+        result = PrintWindow(hwnd, hdcMemDC, printFlags);
     }
 
-    // Thumbnail erstellen (skalieren)
-    SetStretchBltMode(hdcThumbnail, HALFTONE);
-    StretchBlt(hdcThumbnail, 0, 0, thumbnailWidth, thumbnailHeight,
-               hdcMemDC, 0, 0, windowWidth, windowHeight, SRCCOPY);
-
-    // Bitmap -> PNG (base64)
-    std::string base64Result = BitmapToPngBase64(hbmThumbnail, thumbnailWidth, thumbnailHeight);
+    SelectObject(hdcMemDC, hOldBitmap);
+    bool ok = result && HBitmapToFrame(hbmScreen, windowWidth, windowHeight, out);
 
     // Cleanup
-    SelectObject(hdcMemDC, hOldBitmap1);
-    SelectObject(hdcThumbnail, hOldBitmap2);
     DeleteObject(hbmScreen);
-    DeleteObject(hbmThumbnail);
     DeleteDC(hdcMemDC);
-    DeleteDC(hdcThumbnail);
     ReleaseDC(hwnd, hdcWindow);
+    return ok;
+}
+
+// ---------------- Full-resolution capture to a file or stream ----------------
+// captureToFile/captureToStream: rows go to PngStreamEncoder straight from a
+// top-down DIB section, band by band, and the PNG leaves through the sink as
+// each band is compressed; no Frame copy, whole PNG or base64 string of the
+// image exists. PrintWindow renders the whole window in one call, so its DIB
+// section is the one full-size buffer; the desktop BitBlt fallback copies one
+// band at a time into a band-sized section. The DWM thumbnail and WGC paths
+// produce box-sized or whole frames and are not used here.
+struct FullCaptureOptions {
+    int level{6};      // PNG deflate level
+    int bandRows{64};  // rows per capture band and per AddRows call
+    uint32_t methods{dwm::kAllCaptureMethods};
+    dwm::ParallelDeflateOptions parallel; // codec.threads / codec.parallelMinBytes
+};
+
+struct DibSection {
+    HDC dc{NULL};
+    HBITMAP bitmap{NULL};
+    HGDIOBJ old{NULL};
+    uint8_t* bits{nullptr};
+
+    bool Create(HDC reference, int width, int height) {
+        BITMAPINFO bmi = {};
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = width;
+        bmi.bmiHeader.biHeight = -height; // top-down
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+        dc = CreateCompatibleDC(reference);
+        if (!dc) return false;
+        void* pixels = nullptr;
+        bitmap = CreateDIBSection(dc, &bmi, DIB_RGB_COLORS, &pixels, NULL, 0);
+        if (!bitmap) return false;
+        bits = static_cast<uint8_t*>(pixels);
+        old = SelectObject(dc, bitmap);
+        return true;
+    }
+    ~DibSection() {
+        if (old) SelectObject(dc, old);
+        if (bitmap) DeleteObject(bitmap);
+        if (dc) DeleteDC(dc);
+    }
+};
+
+static bool StreamWindowPng(HWND hwnd, const FullCaptureOptions& options, const dwm::PngSink& sink,
+                            int& width, int& height, std::string& error) {
+    DWM_TRACE_SPAN("capture", "fullResolution");
+    RECT rect{};
+    if (!IsWindow(hwnd) || !GetWindowRect(hwnd, &rect)) { error = "Window ID not found or invalid"; return false; }
+    if (IsIconic(hwnd)) { error = "Window is minimized"; return false; }
+    width = rect.right - rect.left;
+    height = rect.bottom - rect.top;
+    if (width <= 0 || height <= 0) { error = "Window has no area"; return false; }
+    const size_t stride = (size_t)width * 4;
+    const int bandRows = std::clamp(options.bandRows, 1, height);
+    dwm::PngEncodeOptions png;
+    png.level = options.level;
+    png.parallel = options.parallel;
+    // With several deflate threads, compressed bands are collected up to the
+    // parallel threshold so each one is split across them
+    size_t bandBytes = std::max<size_t>(stride * (size_t)bandRows, 64 * 1024);
+    if (dwm::ParallelDeflateThreads(options.parallel) > 1) bandBytes = std::max(bandBytes, options.parallel.minBytes);
+    dwm::PngStreamEncoder encoder(bandBytes);
+
+    HDC hdcWindow = GetDC(hwnd);
+    if (!hdcWindow) { error = "GetDC failed"; return false; }
+    bool rendered = false, ok = false, bltFailed = false;
+    static const struct { int method; UINT flags; } kPrintMethods[] = {
+        { kCapturePrintFull, PW_RENDERFULLCONTENT }, { kCapturePrintDefault, 0 },
+    };
+    for (const auto& m : kPrintMethods) {
+        if (!(options.methods & (1u << m.method))) continue;
+        DibSection dib;
+        if (!dib.Create(hdcWindow, width, height)) {
+            error = "Cannot allocate a " + std::to_string(width) + "x" + std::to_string(height) + " capture surface";
+            break;
+        }
+        dwm::MemoryCharge surfaceBytes(dwm::MemoryCategory::CaptureBuffers, stride * (size_t)height);
+        if (!PrintWindow(hwnd, dib.dc, m.flags)) continue;
+        GdiFlush();
+        rendered = true;
+        ok = encoder.Begin(width, height, png, sink);
+        for (int y = 0; ok && y < height; y += bandRows) {
+            ok = encoder.AddRows(dib.bits + (size_t)y * stride, stride, std::min(bandRows, height - y));
+        }
+        ok = ok && encoder.Finish();
+        break;
+    }
+    if (!rendered && error.empty() && (options.methods & (1u << kCaptureDesktopBlt))) {
+        DibSection band;
+        HDC hdcDesktop = GetDC(NULL);
+        if (hdcDesktop && band.Create(hdcWindow, width, bandRows)) {
+            dwm::MemoryCharge bandBytes(dwm::MemoryCategory::CaptureBuffers, stride * (size_t)bandRows);
+            rendered = true;
+            ok = encoder.Begin(width, height, png, sink);
+            for (int y = 0; ok && y < height; y += bandRows) {
+                int rows = std::min(bandRows, height - y);
+                bltFailed = !BitBlt(band.dc, 0, 0, width, rows, hdcDesktop, rect.left, rect.top + y, SRCCOPY | CAPTUREBLT);
+                GdiFlush();
+                ok = !bltFailed && encoder.AddRows(band.bits, stride, rows);
+            }
+            ok = ok && encoder.Finish();
+        }
+        if (hdcDesktop) ReleaseDC(NULL, hdcDesktop);
+    }
+    ReleaseDC(hwnd, hdcWindow);
+    if (!rendered && error.empty()) error = "No enabled capture method could render the window";
+    else if (bltFailed) error = "BitBlt failed partway through the window";
+    else if (rendered && !ok) error = "Capture stopped: the output could not be written";
+    return rendered && ok;
+}
+
+// Largest transient allocation (bitmaps + frame) of each capture attempt
+static dwm::AllocationPeaks g_captureAllocationPeaks;
+
+static bool RunCaptureMethod(int method, HWND hwnd, int maxWidth, int maxHeight, dwm::Frame& out) {
+    out.Clear();
+    dwm::AllocationScope scope;
+    bool ok = false;
+    switch (method) {
+        case kCaptureDwmThumbnail:
+            ok = CaptureWithDwmThumbnail(hwnd, maxWidth, maxHeight, out) && dwm::IsUsefulThumbnailFrame(out, maxWidth, maxHeight);
+            break;
+#ifdef ENABLE_WGC
+        case kCaptureWgc: ok = CaptureWindowFrameWGC(hwnd, out); break;
+#endif
+        case kCapturePrintFull: ok = CaptureWindowBitmapFrame(hwnd, PW_RENDERFULLCONTENT, false, out); break;
+        case kCapturePrintClient: ok = CaptureWindowBitmapFrame(hwnd, PW_CLIENTONLY, false, out); break;
+        case kCapturePrintDefault: ok = CaptureWindowBitmapFrame(hwnd, 0, false, out); break;
+        case kCaptureDesktopBlt: ok = CaptureWindowBitmapFrame(hwnd, 0, true, out); break;
+        default: break;
+    }
+    // A blank frame is a failure whatever the method reported: PrintWindow and
+    // BitBlt "succeed" with a black frame on DRM-protected or unrendered
+    // content, and only a failure counts toward the method's backoff
+    if (ok && dwm::IsUniform(out)) ok = false;
+    if (!ok) out.Clear();
+    if (scope.PeakBytes()) g_captureAllocationPeaks.Record(scope.PeakBytes());
+    return ok;
+}
+
+// Methods to try, in order. Minimized windows start with the off-screen DWM thumbnail
+// to avoid mutating OS iconic thumbnails. When hedging, the DWM thumbnail also backs up
+// PrintWindow(PW_RENDERFULLCONTENT) for normal windows: it is composed by DWM and does not
+// wait on the target's message loop, which is what stalls slow PrintWindow calls.
+// Only enabled methods (mask of 1 << method) are included.
+static std::vector<int> CaptureMethodOrder(HWND hwnd, bool hedge, uint32_t methods) {
+    std::vector<int> order;
+    bool iconic = IsIconic(hwnd) ? true : false;
+    if (iconic) order.push_back(kCaptureDwmThumbnail);
+#ifdef ENABLE_WGC
+    if (!iconic) order.push_back(kCaptureWgc);
+#endif
+    order.push_back(kCapturePrintFull);
+    if (!iconic && hedge) order.push_back(kCaptureDwmThumbnail);
+    order.push_back(kCapturePrintClient);
+    order.push_back(kCapturePrintDefault);
+    order.push_back(kCaptureDesktopBlt);
+    order.erase(std::remove_if(order.begin(), order.end(), [methods](int method) {
+        return (methods & (1u << method)) == 0;
+    }), order.end());
+    return order;
+}
+
+// True if every enabled capture method for this window is currently backing off
+static bool IsCaptureBackedOff(HWND hwnd, uint32_t methods) {
+    if (!IsWindow(hwnd)) return false;
+    for (int method : CaptureMethodOrder(hwnd, false, methods)) {
+        if (!g_negativeCache.IsBackingOff(CaptureFailureKey(hwnd, method))) return false;
+    }
+    return true;
+}
+
+// Fensterinhalt als Frame aufnehmen (noch nicht auf Thumbnail-Größe skaliert,
+// außer beim DWM-Thumbnail-Pfad, der bereits passend liefert)
+static bool CaptureWindowFrame(HWND hwnd, int maxWidth, int maxHeight, dwm::Frame& out,
+                               const CaptureOptions& options = CaptureOptions()) {
+    DWM_TIME_STAGE(Capture);
+    out.Clear();
+    if (!IsWindow(hwnd)) {
+        return false;
+    }
+    std::vector<int> order = CaptureMethodOrder(hwnd, options.hedge, options.methods);
+    order.erase(std::remove_if(order.begin(), order.end(), [hwnd](int method) {
+        return g_negativeCache.ShouldSkip(CaptureFailureKey(hwnd, method));
+    }), order.end());
+    if (order.empty()) return false; // all methods backing off: caller serves a placeholder
+
+    if (options.hedge) {
+        std::vector<dwm::HedgedAttempt<dwm::Frame>> attempts;
+        for (int method : order) {
+            attempts.push_back({ method, [method, hwnd, maxWidth, maxHeight](dwm::Frame& f) {
+                return RunCaptureMethod(method, hwnd, maxWidth, maxHeight, f);
+            } });
+        }
+        double percentile = options.hedgePercentile;
+        dwm::HedgeOptions hedgeOptions;
+        hedgeOptions.executor = &g_hedgeExecutor;
+        hedgeOptions.limiter = &g_hedgeInFlight;
+        hedgeOptions.key = (uint64_t)(uintptr_t)hwnd;
+        hedgeOptions.maxPerKey = kHedgeAttemptsPerWindow;
+        hedgeOptions.timeout = kHedgeTimeout;
+        dwm::HedgeOutcome outcome = dwm::RunHedged<dwm::Frame>(std::move(attempts),
+            [percentile](int method) { return HedgeThresholdFor(method, percentile); },
+            [hwnd](int method, std::chrono::nanoseconds elapsed, bool ok) {
+                RecordCaptureOutcome(hwnd, method, elapsed, ok);
+            }, hedgeOptions, out);
+        if (outcome.hedged) {
+            g_hedgedCaptures.fetch_add(1);
+            if (outcome.winner >= 0 && outcome.winner != order.front()) g_hedgeWins.fetch_add(1);
+        }
+        if (outcome.throttled) g_hedgeThrottled.fetch_add(1);
+        if (outcome.timedOut) g_hedgeTimeouts.fetch_add(1);
+        if (outcome.winner < 0) return false;
+        g_captureMethodStats[outcome.winner].wins.fetch_add(1);
+        return true;
+    }
+
+    for (int method : order) {
+        auto t0 = std::chrono::steady_clock::now();
+        bool ok = RunCaptureMethod(method, hwnd, maxWidth, maxHeight, out);
+        RecordCaptureOutcome(hwnd, method, std::chrono::steady_clock::now() - t0, ok);
+        if (ok) {
+            g_captureMethodStats[method].wins.fetch_add(1);
+            return true;
+        }
+    }
+    out.Clear();
+    return false;
+}
+
+// Screenshot eines Fensters erstellen (capture -> scale -> encode in one go)
+// At the configured default size; *good tells whether the frame was worth
+// keeping for a minimized window (dwm::IsUsefulThumbnailFrame)
+std::string CaptureWindowScreenshot(HWND hwnd, const dwm::RuntimeConfig& config, bool* good = nullptr) {
+    int maxWidth = config.defaultWidth, maxHeight = config.defaultHeight;
+    CaptureOptions options;
+    options.methods = config.captureMethods;
+    dwm::Frame frame;
+    if (good) *good = false;
+    if (!CaptureWindowFrame(hwnd, maxWidth, maxHeight, frame, options)) {
+        return "data:image/png;base64,";
+    }
+    {
+        DWM_TIME_STAGE(Scale);
+        dwm::ScaleToFit(frame, maxWidth, maxHeight);
+    }
+    if (good) *good = dwm::IsUsefulThumbnailFrame(frame, maxWidth, maxHeight);
+    return ThumbnailToPngBase64(frame, config);
+}
+
+// ---------------- The desktop as a dwm::WindowSystem ----------------
+// Enumeration and the thumbnail cache go through this adapter (see
+// window_system.h), so the listing and caching policy is the one the daemon's
+// WindowSystemBackend and dwm_loadgen run; capture methods, icons and events
+// stay Win32-specific. Events reach JS through the WinEvent hooks and the
+// fallback poller, so there is no push sink here.
+static bool GetWin32WindowAttributes(HWND hwnd, dwm::WindowAttributes& a);
+static bool IsOnCurrentVirtualDesktop(HWND hwnd, IUnknown* vdmUnknown, bool includeAllDesktops);
+
+class Win32WindowSystem : public dwm::WindowSystem {
+public:
+    // vdmUnknown: IVirtualDesktopManager of the calling thread, or nullptr to skip desktop checks
+    explicit Win32WindowSystem(IUnknown* vdmUnknown = nullptr) : vdm_(vdmUnknown) {}
+
+    void EnumerateTopLevel(std::vector<dwm::WindowId>& out) override {
+        out.clear();
+        EnumWindows([](HWND hwnd, LPARAM lParam) -> BOOL {
+            reinterpret_cast<std::vector<dwm::WindowId>*>(lParam)->push_back(ToWindowId(hwnd));
+            return TRUE;
+        }, reinterpret_cast<LPARAM>(&out));
+    }
+    bool IsAlive(dwm::WindowId window) override { return IsWindow(ToHwnd(window)) ? true : false; }
+    bool GetAttributes(dwm::WindowId window, dwm::WindowAttributes& out) override {
+        return GetWin32WindowAttributes(ToHwnd(window), out);
+    }
+    bool GetRect(dwm::WindowId window, dwm::WindowRect& out) override {
+        RECT rect{};
+        if (!GetWindowRect(ToHwnd(window), &rect)) return false;
+        out = dwm::WindowRect{ rect.left, rect.top, rect.right, rect.bottom };
+        return true;
+    }
+    bool IsMinimized(dwm::WindowId window) override { return IsIconic(ToHwnd(window)) ? true : false; }
+    bool IsOnCurrentDesktop(dwm::WindowId window) override {
+        return IsOnCurrentVirtualDesktop(ToHwnd(window), vdm_, false);
+    }
+    dwm::WindowId Foreground() override {
+        HWND fg = GetForegroundWindow();
+        HWND top = fg ? GetAncestor(fg, GA_ROOT) : NULL;
+        return ToWindowId(top ? top : fg);
+    }
+    bool Capture(dwm::WindowId window, int maxW, int maxH, dwm::Frame& out) override {
+        CaptureOptions options;
+        options.methods = CurrentConfig()->captureMethods;
+        if (!CaptureWindowFrame(ToHwnd(window), maxW, maxH, out, options)) return false;
+        dwm::ScaleToFit(out, maxW, maxH);
+        return true;
+    }
+    std::string IconDataUrl(dwm::WindowId window, int size) override {
+        HWND hwnd = ToHwnd(window);
+        return GetWindowIconBase64(hwnd, GetExecutablePath(hwnd), size);
+    }
+    bool SetEventSink(dwm::WindowEventSink) override { return false; }
+    uint64_t NowMs() override { return GetTickCount64(); }
+
+private:
+    IUnknown* vdm_;
+};
+
+// Without a desktop manager: cache checks and other per-window queries
+static Win32WindowSystem g_windowSystem;
+
+static dwm::ThumbnailCachePolicy CachePolicy(const dwm::RuntimeConfig& config) {
+    dwm::ThumbnailCachePolicy policy;
+    policy.ttlMs = config.ttlMs;
+    return policy;
+}
+
+// Cache lookup half of GetOrCaptureWindowThumbnail. Returns true if `out` was
+// served without a capture; otherwise rect/now are filled for CommitCapturedThumbnail.
+static bool TryServeCachedThumbnail(HWND hwnd, int maxWidth, int maxHeight, const dwm::RuntimeConfig& config,
+                                    dwm::WindowRect& rect, uint64_t& now, std::string& out) {
+    dwm::WindowId id = ToWindowId(hwnd);
+    if (!g_windowSystem.GetRect(id, rect)) {
+        out = "data:image/png;base64,";
+        return true;
+    }
+    now = g_windowSystem.NowMs();
+    bool prefetched = false;
+    if (!g_thumbCache.TryServe(id, maxWidth, maxHeight, rect, g_windowSystem.IsMinimized(id), now, CachePolicy(config), out,
+                               &prefetched)) {
+        return false;
+    }
+    if (prefetched) g_prefetchHits.fetch_add(1);
+    return true;
+}
+
+// Store half of GetOrCaptureWindowThumbnail: the fresh capture (good: its
+// frame passed dwm::IsUsefulThumbnailFrame), an older good cache entry or an
+// icon placeholder (thumbnail_cache.h decides).
+static std::string CommitCapturedThumbnail(HWND hwnd, const std::string& fresh, bool good, const dwm::WindowRect& rect,
+                                           uint64_t now, int maxWidth, int maxHeight, const dwm::RuntimeConfig& config) {
+    dwm::WindowId id = ToWindowId(hwnd);
+    bool backedOff = dwm::IsEmptyDataUrl(fresh) && IsCaptureBackedOff(hwnd, config.captureMethods);
+    return g_thumbCache.Commit(id, fresh, good, maxWidth, maxHeight, rect, now, g_windowSystem.IsMinimized(id), backedOff,
+                               [&] {
+        return CreateIconPlaceholderThumbnail(hwnd, GetExecutablePath(hwnd), maxWidth, maxHeight);
+    });
+}
 
-    return base64Result;
+// Stores a capture taken outside the pipeline (updateThumbnail and friends),
+// unless it is a minimized sliver that would replace a good thumbnail
+static void StoreCapturedThumbnail(HWND hwnd, const std::string& thumbnail, bool good, int maxWidth, int maxHeight) {
+    dwm::WindowId id = ToWindowId(hwnd);
+    dwm::WindowRect rect;
+    if (!g_windowSystem.GetRect(id, rect)) return;
+    if (g_windowSystem.IsMinimized(id) && !good) return;
+    g_thumbCache.Store(id, thumbnail, good, rect, g_windowSystem.NowMs(), maxWidth, maxHeight);
 }
 
 // Thumbnail aus Cache oder neu erzeugen
-std::string GetOrCaptureWindowThumbnail(HWND hwnd, int maxWidth = 200, int maxHeight = 150) {
-    RECT rect;
-    if (!GetWindowRect(hwnd, &rect)) {
-    return "data:image/png;base64,";
+std::string GetOrCaptureWindowThumbnail(HWND hwnd, const dwm::RuntimeConfig& config) {
+    int maxWidth = config.defaultWidth, maxHeight = config.defaultHeight;
+    dwm::WindowRect rect;
+    uint64_t now = 0;
+    std::string cached;
+    if (TryServeCachedThumbnail(hwnd, maxWidth, maxHeight, config, rect, now, cached)) return cached;
+    bool good = false;
+    std::string fresh = CaptureWindowScreenshot(hwnd, config, &good);
+    return CommitCapturedThumbnail(hwnd, fresh, good, rect, now, maxWidth, maxHeight, config);
+}
+
+// ---------------- Background prefetch of the top MRU thumbnails ----------------
+// One pipeline capture per window at a time, across calls: a job owns its
+// window's flight from the cache check until its thumbnail is committed. A job
+// that finds the window in flight waits for the owner (until its call's
+// deadline, if any) and then normally finds the owner's result in the cache,
+// so a hung window ties up one capture worker instead of one per call. The
+// prefetcher takes flights too, but skips a window in flight instead of waiting.
+static std::mutex g_captureFlightsMutex;
+static std::condition_variable g_captureFlightsChanged;
+static std::unordered_set<HWND> g_captureFlights;
+
+class CaptureFlight {
+public:
+    CaptureFlight() = default;
+    CaptureFlight(CaptureFlight&& o) noexcept : hwnd_(o.hwnd_) { o.hwnd_ = nullptr; }
+    CaptureFlight& operator=(CaptureFlight&& o) noexcept {
+        if (this != &o) { Release(); hwnd_ = o.hwnd_; o.hwnd_ = nullptr; }
+        return *this;
     }
-    ULONGLONG now = GetTickCount64();
-    auto isGoodPng = [](const std::string& data) {
-        // Heuristic: a 200x150 PNG is typically > 8KB (base64). Avoid caching tiny title-only captures.
-        return data.size() > strlen("data:image/png;base64,") + 8000;
-    };
+    ~CaptureFlight() { Release(); }
+
+    // True once this job owns hwnd's capture; false if another job still owned it at the deadline
+    bool Acquire(HWND hwnd, bool hasDeadline, std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(g_captureFlightsMutex);
+        auto free = [hwnd] { return g_captureFlights.count(hwnd) == 0; };
+        if (!hasDeadline) g_captureFlightsChanged.wait(lock, free);
+        else if (!g_captureFlightsChanged.wait_until(lock, deadline, free)) return false;
+        g_captureFlights.insert(hwnd);
+        hwnd_ = hwnd;
+        return true;
+    }
+
+    // Acquire without waiting
+    bool TryAcquire(HWND hwnd) { return Acquire(hwnd, true, std::chrono::steady_clock::now()); }
+
+    void Release() {
+        if (!hwnd_) return;
+        {
+            std::lock_guard<std::mutex> lock(g_captureFlightsMutex);
+            g_captureFlights.erase(hwnd_);
+        }
+        g_captureFlightsChanged.notify_all();
+        hwnd_ = nullptr;
+    }
+
+private:
+    HWND hwnd_{ nullptr };
+};
+
+// Keeps the default-size thumbnails of the current desktop's most recently
+// used windows fresh in the cache (PlanPrefetch, RuntimeConfig::prefetch*), so
+// a switcher opening with orderBy: 'mru' is served its likely targets without
+// capturing. The thread sleeps until the plan's next refresh, a focus change
+// or a closed window.
+static std::mutex g_prefetchMutex;
+static std::condition_variable g_prefetchWake;
+static bool g_prefetchWoken = false;
+static bool g_prefetchStop = false;
+static bool g_prefetchRunning = false; // until PrefetchLoop returns
+static std::condition_variable g_prefetchExited;
+static std::thread g_prefetchThread;
+// Module unload waits this long for background runs and the prefetch thread,
+// then leaves the stuck ones behind
+static const std::chrono::milliseconds kBackgroundShutdownGrace{ 2000 };
+
+static void WakePrefetcher() {
     {
-        std::lock_guard<std::mutex> lock(g_cacheMutex);
-        auto it = g_thumbCache.find(hwnd);
-        if (it != g_thumbCache.end()) {
-            const ThumbCacheEntry& e = it->second;
-            if (e.w == maxWidth && e.h == maxHeight &&
-                e.rect.left == rect.left && e.rect.top == rect.top &&
-                e.rect.right == rect.right && e.rect.bottom == rect.bottom &&
-                (now - e.ts) < THUMB_TTL_MS) {
-                return e.base64;
-            }
+        std::lock_guard<std::mutex> lock(g_prefetchMutex);
+        g_prefetchWoken = true;
+    }
+    g_prefetchWake.notify_one();
+}
+
+// Age of the thumbnail a default-size request for hwnd would be served, if there is one
+static bool CachedThumbnailAge(HWND hwnd, const dwm::RuntimeConfig& config, uint64_t now, dwm::PrefetchDuration& age) {
+    dwm::WindowRect rect;
+    uint64_t ageMs = 0;
+    if (!g_windowSystem.GetRect(ToWindowId(hwnd), rect) ||
+        !g_thumbCache.Age(ToWindowId(hwnd), config.defaultWidth, config.defaultHeight, rect, now, ageMs)) {
+        return false;
+    }
+    age = dwm::PrefetchDuration(ageMs);
+    return true;
+}
+
+// Stores a prefetched capture (taken for rect at now) and marks it as prefetched
+static void CommitPrefetchedThumbnail(HWND hwnd, const std::string& fresh, bool good, const dwm::WindowRect& rect,
+                                      uint64_t now, const dwm::RuntimeConfig& config) {
+    CommitCapturedThumbnail(hwnd, fresh, good, rect, now, config.defaultWidth, config.defaultHeight, config);
+    g_prefetchCaptures.fetch_add(1);
+    g_thumbCache.MarkPrefetched(ToWindowId(hwnd), now);
+}
+
+// Captures even if the cached thumbnail is still within its TTL; the caller owns hwnd's flight
+static void PrefetchFlightThumbnail(HWND hwnd, const dwm::RuntimeConfig& config) {
+    dwm::WindowRect rect;
+    if (!g_windowSystem.GetRect(ToWindowId(hwnd), rect)) return;
+    uint64_t now = g_windowSystem.NowMs();
+    bool good = false;
+    std::string fresh = CaptureWindowScreenshot(hwnd, config, &good);
+    CommitPrefetchedThumbnail(hwnd, fresh, good, rect, now, config);
+}
+
+// Skipped while a request captures the window: its result lands in the cache anyway
+static void PrefetchWindowThumbnail(HWND hwnd, const dwm::RuntimeConfig& config) {
+    CaptureFlight flight;
+    if (flight.TryAcquire(hwnd)) PrefetchFlightThumbnail(hwnd, config);
+}
+
+// PrefetchWindowThumbnail for each window. With WGC enabled, the windows WGC
+// would be tried first for all go through CaptureWindowFramesWGC together, so
+// their waits overlap on this one thread; the others, and any WGC failure,
+// take the usual method order without WGC.
+static void PrefetchWindowThumbnails(const std::vector<HWND>& windows, const dwm::RuntimeConfig& config) {
+#ifdef ENABLE_WGC
+    std::vector<WgcCapture> captures;
+    std::vector<dwm::WindowRect> rects;
+    std::vector<CaptureFlight> flights; // held until each batched window is committed
+    uint64_t now = g_windowSystem.NowMs();
+    if (config.captureMethods & dwm::kWgcCaptureMethod) {
+        for (HWND hwnd : windows) {
+            dwm::WindowRect rect;
+            if (g_windowSystem.IsMinimized(ToWindowId(hwnd)) || !g_windowSystem.GetRect(ToWindowId(hwnd), rect)) continue;
+            if (g_negativeCache.ShouldSkip(CaptureFailureKey(hwnd, kCaptureWgc))) continue;
+            CaptureFlight flight;
+            if (!flight.TryAcquire(hwnd)) continue;
+            captures.emplace_back().hwnd = hwnd;
+            rects.push_back(rect);
+            flights.push_back(std::move(flight));
         }
     }
-    // If minimized, prefer returning last good cached image if available to mimic Alt+Tab behavior
-    if (IsIconic(hwnd)) {
-        std::lock_guard<std::mutex> lock(g_cacheMutex);
-        auto it = g_thumbCache.find(hwnd);
-        if (it != g_thumbCache.end() && isGoodPng(it->second.base64)) {
-            return it->second.base64;
+    if (captures.size() > 1) {
+        auto batchStart = std::chrono::steady_clock::now();
+        {
+            DWM_TRACE_SPAN("prefetch", "wgcBatch");
+            CaptureWindowFramesWGC(captures);
+        }
+        auto toUs = [](std::chrono::steady_clock::duration d) {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+        };
+        uint64_t captureUs = 0;
+        for (const WgcCapture& capture : captures) captureUs += toUs(capture.elapsed);
+        g_wgcBatches.fetch_add(1);
+        g_wgcBatchWindows.fetch_add(captures.size());
+        g_wgcBatchWallUs.fetch_add(toUs(std::chrono::steady_clock::now() - batchStart));
+        g_wgcBatchCaptureUs.fetch_add(captureUs);
+        dwm::RuntimeConfig withoutWgc = config;
+        withoutWgc.captureMethods &= ~dwm::kWgcCaptureMethod;
+        for (size_t i = 0; i < captures.size(); ++i) {
+            WgcCapture& capture = captures[i];
+            capture.ok = capture.ok && !dwm::IsUniform(capture.frame); // as in RunCaptureMethod
+            RecordCaptureOutcome(capture.hwnd, kCaptureWgc, capture.elapsed, capture.ok);
+            if (capture.peakBytes) g_captureAllocationPeaks.Record(capture.peakBytes);
+            if (!capture.ok) {
+                if (withoutWgc.captureMethods) PrefetchFlightThumbnail(capture.hwnd, withoutWgc);
+                else CommitPrefetchedThumbnail(capture.hwnd, "data:image/png;base64,", false, rects[i], now, config);
+                flights[i].Release();
+                continue;
+            }
+            g_captureMethodStats[kCaptureWgc].wins.fetch_add(1);
+            {
+                DWM_TIME_STAGE(Scale);
+                dwm::ScaleToFit(capture.frame, config.defaultWidth, config.defaultHeight);
+            }
+            bool good = dwm::IsUsefulThumbnailFrame(capture.frame, config.defaultWidth, config.defaultHeight);
+            CommitPrefetchedThumbnail(capture.hwnd, ThumbnailToPngBase64(capture.frame, config), good, rects[i], now, config);
+            flights[i].Release();
         }
+        for (HWND hwnd : windows) {
+            bool batched = std::any_of(captures.begin(), captures.end(), [hwnd](const WgcCapture& c) { return c.hwnd == hwnd; });
+            if (!batched) PrefetchWindowThumbnail(hwnd, config);
+        }
+        return;
     }
+#endif
+    for (HWND hwnd : windows) PrefetchWindowThumbnail(hwnd, config);
+}
 
-    std::string fresh = CaptureWindowScreenshot(hwnd, maxWidth, maxHeight);
-    if (IsIconic(hwnd) && !isGoodPng(fresh)) {
-        // Do not overwrite a good cache with a tiny minimized capture
-        std::lock_guard<std::mutex> lock(g_cacheMutex);
-        auto it = g_thumbCache.find(hwnd);
-        if (it != g_thumbCache.end() && isGoodPng(it->second.base64)) {
-            return it->second.base64;
+static void PrefetchLoop() {
+    dwm::PrefetchDuration waitFor = dwm::kPrefetchNever;
+    std::unique_lock<std::mutex> lock(g_prefetchMutex);
+    for (;;) {
+        auto woken = [] { return g_prefetchWoken || g_prefetchStop; };
+        if (waitFor == dwm::kPrefetchNever) g_prefetchWake.wait(lock, woken);
+        else g_prefetchWake.wait_for(lock, waitFor, woken);
+        if (g_prefetchStop) {
+            g_prefetchRunning = false;
+            g_prefetchExited.notify_all();
+            return;
         }
-        // No good cache exists; create an icon placeholder instead of tiny minimized capture
-        // Need the exe path to fetch an icon; recompute cheaply
-        std::string exePath = GetExecutablePath(hwnd);
-        std::string placeholder = CreateIconPlaceholderThumbnail(hwnd, exePath, maxWidth, maxHeight);
-        return placeholder.size() > strlen("data:image/png;base64,") ? placeholder : fresh;
+        g_prefetchWoken = false;
+        lock.unlock();
+
+        DWM_TRACE_SPAN("prefetch", "plan");
+        auto config = CurrentConfig();
+        dwm::PrefetchSettings settings;
+        settings.count = config->prefetchCount;
+        settings.ahead = dwm::PrefetchDuration(config->prefetchAheadMs);
+        settings.settle = dwm::PrefetchDuration(config->prefetchSettleMs);
+        settings.idle = dwm::PrefetchDuration(config->prefetchIdleMs);
+        ULONGLONG now = GetTickCount64();
+        std::vector<dwm::PrefetchCandidate> candidates;
+        for (dwm::WindowId window : g_focusHistory.Top(g_focusHistory.CurrentDesktop(), settings.count)) {
+            HWND hwnd = ToHwnd(window);
+            if (!IsWindow(hwnd)) {
+                g_focusHistory.Remove(window); // closed without an event reaching us
+                continue;
+            }
+            dwm::PrefetchCandidate c;
+            c.window = window;
+            c.minimized = IsIconic(hwnd) ? true : false;
+            c.cached = CachedThumbnailAge(hwnd, *config, now, c.age);
+            candidates.push_back(c);
+        }
+        ULONGLONG lastFocus = g_lastFocusTick.load();
+        dwm::PrefetchPlan plan = dwm::PlanPrefetch(settings, dwm::PrefetchDuration(config->ttlMs),
+                                                   dwm::PrefetchDuration(now > lastFocus ? now - lastFocus : 0), candidates);
+        std::vector<HWND> capture;
+        for (dwm::WindowId window : plan.capture) capture.push_back(ToHwnd(window));
+        PrefetchWindowThumbnails(capture, *config);
+        waitFor = plan.wakeIn;
+        lock.lock();
+    }
+}
+
+// Turns on focus tracking (JS thread): the hooks, a history seeded from the
+// current z-order, which is close to MRU order already, and the prefetch thread
+static void EnableFocusTracking() {
+    if (g_focusTracking.exchange(true)) return;
+    std::vector<HWND> windows;
+    EnumTopLevelWindows(windows); // topmost first
+    {
+        DesktopResolver resolver;
+        for (auto it = windows.rbegin(); it != windows.rend(); ++it) g_focusHistory.Focus(ToWindowId(*it), resolver.Desktop(*it));
+        HWND fg = GetForegroundWindow();
+        HWND top = fg ? GetAncestor(fg, GA_ROOT) : NULL;
+        if (top) g_focusHistory.Focus(ToWindowId(top), resolver.Desktop(top));
     }
+    g_lastFocusTick.store(GetTickCount64());
+    EnsureHooksInstalled();
     {
-        std::lock_guard<std::mutex> lock(g_cacheMutex);
-        g_thumbCache[hwnd] = ThumbCacheEntry{ fresh, rect, now, maxWidth, maxHeight };
+        std::lock_guard<std::mutex> lock(g_prefetchMutex);
+        g_prefetchStop = false;
+        g_prefetchWoken = true;
+        g_prefetchRunning = true;
+    }
+    g_prefetchThread = std::thread(PrefetchLoop);
+}
+
+// Env cleanup: stops the prefetch thread, joining it if it returns within the
+// grace period. A thread stuck in a capture that never returns is detached,
+// like a stuck background pipeline run, so Node's exit does not hang on it.
+static void DisableFocusTracking() {
+    if (!g_focusTracking.exchange(false)) return;
+    bool exited;
+    {
+        std::unique_lock<std::mutex> lock(g_prefetchMutex);
+        g_prefetchStop = true;
+        g_prefetchWake.notify_one();
+        exited = g_prefetchExited.wait_for(lock, kBackgroundShutdownGrace, [] { return !g_prefetchRunning; });
+    }
+    if (g_prefetchThread.joinable()) {
+        if (exited) g_prefetchThread.join();
+        else g_prefetchThread.detach();
     }
-    return fresh;
+    g_focusHistory.Clear();
 }
 
 // Callback für EnumWindows
@@ -1758,85 +2495,69 @@ static bool IsWindowCloaked(HWND hwnd) {
     return SUCCEEDED(hr) && cloaked;
 }
 
-static bool IsAltTabEligible(HWND hwnd, bool includeAllDesktops) {
+// Reads everything the Alt-Tab rules (window_system.h) need in one pass. Every
+// field is overwritten, so one WindowAttributes can be reused across windows;
+// its strings keep their capacity and allocator.
+static bool GetWin32WindowAttributes(HWND hwnd, dwm::WindowAttributes& a) {
     if (!IsWindow(hwnd)) return false;
-    // PowerToys Command Palette nie anzeigen
-    if (IsPowerToysCommandPalette(hwnd)) return false;
-    // Immer nur sichtbare Fenster berücksichtigen
-    if (!IsWindowVisible(hwnd)) return false;
-    // Minimized windows should still appear in Task View (beide Fälle)
+    ReadWindowTitle(hwnd, a.title);
+    ReadWindowClassName(hwnd, a.className);
+    ReadExecutablePath(hwnd, a.executablePath);
+    if (a.title.empty()) ReadFirstChildTitle(hwnd, a.childTitle);
+    else a.childTitle.clear();
+    DWORD pid = 0;
+    GetWindowThreadProcessId(hwnd, &pid);
+    a.pid = pid;
+    a.visible = IsWindowVisible(hwnd) ? true : false;
+    a.minimized = IsIconic(hwnd) ? true : false;
 
-    // Toolwindows nicht anzeigen
     LONG exStyle = GetWindowLongPtr(hwnd, GWL_EXSTYLE);
-    if (exStyle & WS_EX_TOOLWINDOW) return false;
-    if (exStyle & WS_EX_NOACTIVATE) return false;
+    LONG style = GetWindowLongPtr(hwnd, GWL_STYLE);
+    a.toolWindow = (exStyle & WS_EX_TOOLWINDOW) != 0;
+    a.noActivate = (exStyle & WS_EX_NOACTIVATE) != 0;
+    a.appWindow = (exStyle & WS_EX_APPWINDOW) != 0;
+    a.transparent = false;
     if (exStyle & WS_EX_LAYERED) {
         COLORREF cr = 0; BYTE alpha = 255; DWORD flags = 0;
         if (GetLayeredWindowAttributes(hwnd, &cr, &alpha, &flags)) {
-            if ((flags & LWA_ALPHA) && alpha == 0) return false; // komplett transparent
-        }
-    }
-
-    // Fenster ohne Titel normalerweise nicht in Alt-Tab, außer für UWP-Host/Explorer/WhatsApp
-    if (GetWindowTextLengthW(hwnd) <= 0) {
-        std::string cls = GetWindowClassName(hwnd);
-        if (_stricmp(cls.c_str(), "ApplicationFrameWindow") != 0 &&
-            !IsExplorerWindow(hwnd) && !IsWhatsAppWindow(hwnd)) {
-            return false;
+            a.transparent = (flags & LWA_ALPHA) && alpha == 0; // komplett transparent
         }
     }
+    a.child = (style & WS_CHILD) != 0;
+    a.popup = (style & WS_POPUP) != 0;
+    a.hasOwner = GetWindow(hwnd, GW_OWNER) != NULL;
+    // Cloaking only matters for ApplicationFrameWindow hosts; skip the DWM call otherwise
+    a.cloaked = dwm::window_rules::IsAppFrameHost(a) && IsWindowCloaked(hwnd);
 
-    // Hinweis: TITLEBARINFO-Unsichtbarkeit nicht als hartes Kriterium verwenden (moderne Apps ohne klassische Titelleiste)
-
-    // Root/Child/Popup-Logik: Alt-Tab zeigt i.d.R. keine Child/Popup-Fenster (außer mit WS_EX_APPWINDOW)
-    LONG style = GetWindowLongPtr(hwnd, GWL_STYLE);
-    if (style & WS_CHILD) return false;
-    BOOL hasOwner = GetWindow(hwnd, GW_OWNER) != NULL;
-    bool appWindow = (exStyle & WS_EX_APPWINDOW) != 0;
-    if ((style & WS_POPUP) && !appWindow) {
-        if (!IsWhatsAppWindow(hwnd)) return false; // erlauben für WhatsApp
-    }
-    if (!appWindow && hasOwner) return false;
-
-    // Kein harter Check auf Systemmenü/Min/Max: manche modernen Apps haben diese Stile nicht
-
-    // Cloaked ApplicationFrameWindow-Hosts ausschließen (verhindert doppelte/unsichtbare UWP-Hosts)
-    std::string cls = GetWindowClassName(hwnd);
-    if (_stricmp(cls.c_str(), "ApplicationFrameWindow") == 0) {
-        if (IsWindowCloaked(hwnd)) return false;
-    }
-
-    // Größe muss sinnvoll sein. Für minimierte Fenster nutze die normale (restored) Größe.
+    // Für minimierte Fenster die normale (restored) Größe verwenden
     RECT rect{};
-    bool haveRect = false;
-    if (IsIconic(hwnd)) {
+    a.hasRect = false;
+    if (a.minimized) {
         WINDOWPLACEMENT wp{};
         wp.length = sizeof(WINDOWPLACEMENT);
         if (GetWindowPlacement(hwnd, &wp)) {
             rect = wp.rcNormalPosition;
-            haveRect = true;
+            a.hasRect = true;
         }
     }
-    if (!haveRect) {
-        if (!GetWindowRect(hwnd, &rect)) return false;
-        haveRect = true;
-    }
-    int rectW = rect.right - rect.left;
-    int rectH = rect.bottom - rect.top;
-    if (rectW < 50 || rectH < 50) return false;
-
+    if (!a.hasRect) a.hasRect = GetWindowRect(hwnd, &rect) ? true : false;
+    a.rect = dwm::WindowRect{ rect.left, rect.top, rect.right, rect.bottom };
     return true;
 }
 
 struct EnumContext {
     std::vector<WindowInfo>* windows;
-    IUnknown* vdmUnknown; // IVirtualDesktopManager, aber als IUnknown um Headerabhängigkeit zu minimieren
+    dwm::WindowSystem* system; // Win32WindowSystem with the calling thread's desktop manager
     bool includeAllDesktops;
+    std::function<void(WindowInfo&)> onWindow; // optional: stream windows out as they are found (may move from them)
+    bool collectTimings{false}; // per-window stage breakdown into WindowInfo::timings
+    dwm::WindowAttributes* scratch{nullptr}; // arena-backed, reused for every window of the enumeration
 };
 
 static bool IsOnCurrentVirtualDesktop(HWND hwnd, IUnknown* vdmUnknown, bool includeAllDesktops) {
     if (includeAllDesktops) return true;
     if (!vdmUnknown) return true; // Falls nicht verfügbar, nicht filtern
+    DWM_TIME_STAGE(VirtualDesktop);
     // Bestimme ein für Alt-Tab relevantes Fenster (RootOwner -> LastActivePopup sichtbar)
     HWND testHwnd = hwnd;
     HWND rootOwner = GetAncestor(hwnd, GA_ROOTOWNER);
@@ -1865,63 +2586,323 @@ static bool IsOnCurrentVirtualDesktop(HWND hwnd, IUnknown* vdmUnknown, bool incl
     return false;
 }
 
-BOOL CALLBACK EnumWindowsProc(HWND hwnd, LPARAM lParam) {
-    EnumContext* ctx = reinterpret_cast<EnumContext*>(lParam);
+// Filter + metadata for one top-level window; false if it should not be listed.
+// attrs is scratch space; only the listed title is copied into info, path and
+// class are interned.
+static bool BuildWindowInfo(dwm::WindowSystem& system, dwm::WindowId id, bool includeAllDesktops, dwm::WindowAttributes& attrs,
+                            WindowInfo& info) {
+    {
+        DWM_TIME_STAGE(Predicate);
+        if (!system.GetAttributes(id, attrs) || !dwm::IsAltTabCandidate(attrs)) return false;
+    }
+    if (!includeAllDesktops && !system.IsOnCurrentDesktop(id)) return false;
+
+    // Untitled UWP hosts, Explorer and WhatsApp fall back to a child title or a default name
+    std::u16string title = dwm::DisplayTitle(attrs);
+    if (title.empty()) return false;
 
-    if (!IsAltTabEligible(hwnd, ctx->includeAllDesktops)) return TRUE;
-    if (!IsOnCurrentVirtualDesktop(hwnd, ctx->vdmUnknown, ctx->includeAllDesktops)) return TRUE;
+    info.hwnd = ToHwnd(id);
+    info.title = std::move(title);
+    info.executablePathId = g_stringTable.Intern(attrs.executablePath);
+    info.classNameId = g_stringTable.Intern(attrs.className);
+    // Consider minimized windows as visible for Task View-like behavior
+    info.isVisible = attrs.visible;
+    return true;
+}
 
-    std::string title = GetWindowTitle(hwnd);
-    if (title.empty()) {
-        // Fallback für UWP-Hosts: versuche, einen Kindfenster-Titel zu verwenden
-        std::string cls = GetWindowClassName(hwnd);
-        if (_stricmp(cls.c_str(), "ApplicationFrameWindow") == 0) {
-            title = GetFirstChildTitle(hwnd);
+// Lists the Alt-Tab windows in z-order through ctx.system
+static void EnumerateWindows(EnumContext& ctx) {
+    std::vector<dwm::WindowId> ids;
+    ctx.system->EnumerateTopLevel(ids);
+    for (dwm::WindowId id : ids) {
+        WindowInfo info;
+        {
+            DWM_BIND_BREAKDOWN(ctx.collectTimings ? &info.timings : nullptr);
+            if (!BuildWindowInfo(*ctx.system, id, ctx.includeAllDesktops, *ctx.scratch, info)) continue;
         }
-        // Fallback für Explorer: versuche Kindtitel; sonst Standardnamen
-        if (title.empty() && IsExplorerWindow(hwnd)) {
-            title = GetFirstChildTitle(hwnd);
-            if (title.empty()) title = "Datei-Explorer";
+        if (ctx.windows) ctx.windows->push_back(info);
+        if (ctx.onWindow) ctx.onWindow(info);
+    }
+}
+
+// ---------------- Thumbnail pipeline: enumerate → capture → scale → encode → marshal ----------------
+struct WindowResultEntry {
+    HWND hwnd{};
+    std::u16string title;
+    dwm::StringId executablePathId{};
+    dwm::StringId classNameId{};
+    bool isVisible{};
+    std::string thumbnail;
+    std::string icon;
+    bool pending{false}; // deadline hit before capture finished; thumbnail is stale or a placeholder
+    dwm::FrameHandle frame; // fresh capture written to the shared frame ring instead of a PNG
+    int frameWidth{}, frameHeight{};
+    bool hasTimings{false};
+    dwm::StageBreakdown timings;
+};
+
+// Shared-memory frame export (enableSharedFrames). Jobs hold the export they
+// started with, so disabling or replacing it never pulls the mapping from
+// under a running write.
+struct SharedFrameExport {
+    dwm::SharedMemory memory;
+    dwm::FrameRingWriter writer;
+    dwm::MemoryCharge charge{ dwm::MemoryCategory::SharedFrames };
+};
+static std::mutex g_sharedFramesMutex;
+static std::shared_ptr<SharedFrameExport> g_sharedFrames;
+
+static std::shared_ptr<SharedFrameExport> CurrentSharedFrames() {
+    std::lock_guard<std::mutex> lock(g_sharedFramesMutex);
+    return g_sharedFrames;
+}
+
+// One call's share of the ring: at most one frame per slot, so a call never
+// overwrites a handle it is about to return. Captures past that take the PNG
+// path.
+struct SharedFrameBatch {
+    std::shared_ptr<SharedFrameExport> ring;
+    std::atomic<uint32_t> slotsLeft{0};
+
+    explicit SharedFrameBatch(std::shared_ptr<SharedFrameExport> r)
+        : ring(std::move(r)), slotsLeft(ring->writer.SlotCount()) {}
+
+    bool TakeSlot() {
+        uint32_t n = slotsLeft.load(std::memory_order_relaxed);
+        while (n && !slotsLeft.compare_exchange_weak(n, n - 1, std::memory_order_relaxed)) {}
+        return n != 0;
+    }
+};
+
+struct ThumbnailJob {
+    size_t index{};
+    int maxWidth{};
+    int maxHeight{};
+    bool thumbnails{true}; // false: no capture, the entry keeps an empty thumbnail
+    bool icons{true};
+    bool hasDeadline{false}; // the call's deadline bounds the wait for another call's capture
+    std::chrono::steady_clock::time_point deadline{};
+    CaptureFlight flight;
+    CaptureOptions capture;
+    std::shared_ptr<SharedFrameBatch> sharedFrames; // set if the caller asked for shared frames
+    dwm::WindowRect rect;
+    uint64_t ts{};
+    dwm::Frame frame;
+    dwm::MemoryCharge frameCharge{ dwm::MemoryCategory::CaptureBuffers }; // frame while in flight
+    WindowResultEntry entry;
+};
+
+static std::mutex g_pipelineMutex;
+static std::shared_ptr<dwm::Pipeline<ThumbnailJob>> g_lastPipeline; // most recent run, for getCaptureStats
+// Runs abandoned at their deadline; they keep feeding the thumbnail cache and are joined once done.
+// Past kMaxBackgroundPipelines, newly abandoned runs are cancelled: only their running stage calls finish.
+static std::vector<std::shared_ptr<dwm::Pipeline<ThumbnailJob>>> g_backgroundPipelines;
+static const size_t kMaxBackgroundPipelines = 4;
+
+static void ReapBackgroundPipelines() {
+    std::vector<std::shared_ptr<dwm::Pipeline<ThumbnailJob>>> finished;
+    {
+        std::lock_guard<std::mutex> lock(g_pipelineMutex);
+        auto it = g_backgroundPipelines.begin();
+        while (it != g_backgroundPipelines.end()) {
+            if ((*it)->IsDone()) { finished.push_back(*it); it = g_backgroundPipelines.erase(it); }
+            else ++it;
         }
-        // Fallback für WhatsApp: setze Standardtitel
-        if (title.empty() && IsWhatsAppWindow(hwnd)) {
-            title = "WhatsApp";
+    }
+    for (auto& p : finished) p->Wait();
+}
+
+// Env cleanup: cancels the background runs and joins those whose running
+// captures return within the grace period. A run stuck in a capture that
+// never returns (a hung PrintWindow) is detached and deliberately leaked,
+// since its workers still use it, so Node's exit does not hang on it.
+static void ShutdownBackgroundPipelines() {
+    std::vector<std::shared_ptr<dwm::Pipeline<ThumbnailJob>>> runs;
+    {
+        std::lock_guard<std::mutex> lock(g_pipelineMutex);
+        runs.swap(g_backgroundPipelines);
+    }
+    for (auto& p : runs) p->Cancel();
+    auto until = std::chrono::steady_clock::now() + kBackgroundShutdownGrace;
+    for (auto& p : runs) {
+        if (p->WaitUntil(until)) {
+            p->Wait();
+        } else {
+            p->Detach();
+            new std::shared_ptr<dwm::Pipeline<ThumbnailJob>>(p);
         }
-        if (title.empty()) return TRUE;
     }
+}
 
-    std::string execPath = GetExecutablePath(hwnd);
+// Shared between a pipeline run and its caller; outlives the caller when a deadline hits
+struct PipelineRun {
+    std::mutex mutex;
+    std::vector<WindowResultEntry> results; // metadata at submit time, full entry once completed
+    std::vector<bool> completed;
+};
 
-    WindowInfo info;
-    info.hwnd = hwnd;
-    info.title = title;
-    info.executablePath = execPath;
-    // Sichtbarkeit separat bestimmen (kann auf anderem Desktop false sein)
-    // Consider minimized windows as visible for Task View-like behavior
-    info.isVisible = IsWindowVisible(hwnd);
+// Any cached thumbnail for the window, ignoring TTL and size (deadline fill-in)
+static bool TryGetStaleThumbnail(HWND hwnd, std::string& out) {
+    return g_thumbCache.TryGetStale(ToWindowId(hwnd), out);
+}
 
-    ctx->windows->push_back(info);
-    return TRUE;
+static bool TryGetCachedIcon(HWND hwnd, std::string& out) {
+    std::lock_guard<std::mutex> lock(g_cacheMutex);
+    auto it = g_iconCache.find(hwnd);
+    if (it == g_iconCache.end()) return false;
+    out = it->second.dataUrl;
+    return true;
 }
 
-// Hauptfunktion: Alle Fenster mit Thumbnails ermitteln
-Value GetWindows(const CallbackInfo& info) {
-    Env env = info.Env();
-    
-    // Option includeAllDesktops ermitteln (bool oder { includeAllDesktops: boolean })
-    bool includeAllDesktops = false;
-    if (info.Length() >= 1) {
-        if (info[0].IsBoolean()) {
-            includeAllDesktops = info[0].As<Boolean>().Value();
-        } else if (info[0].IsObject()) {
-            Object opts = info[0].As<Object>();
-            if (opts.Has("includeAllDesktops") && opts.Get("includeAllDesktops").IsBoolean()) {
-                includeAllDesktops = opts.Get("includeAllDesktops").As<Boolean>().Value();
+// Plain window-colour thumbnail, encoded once per size. Unlike CreateIconPlaceholderThumbnail
+// it never touches the target window, so it is safe to use under a deadline.
+static std::string GetBlankPlaceholderThumbnail(int w, int h) {
+    static std::map<std::pair<int, int>, std::string> placeholders;
+    {
+        std::lock_guard<std::mutex> lock(g_cacheMutex);
+        auto it = placeholders.find({ w, h });
+        if (it != placeholders.end()) return it->second;
+    }
+    dwm::Frame frame;
+    frame.Allocate(w, h);
+    COLORREF c = GetSysColor(COLOR_WINDOW);
+    for (size_t i = 0; i + 3 < frame.pixels.size(); i += 4) {
+        frame.pixels[i] = GetBValue(c);
+        frame.pixels[i + 1] = GetGValue(c);
+        frame.pixels[i + 2] = GetRValue(c);
+        frame.pixels[i + 3] = 255;
+    }
+    std::string png = ThumbnailToPngBase64(frame, *CurrentConfig());
+    std::lock_guard<std::mutex> lock(g_cacheMutex);
+    placeholders[{ w, h }] = png;
+    return png;
+}
+
+// Deadline fill-in for a window whose capture has not finished: its stale
+// cached thumbnail or a blank placeholder, flagged pending
+static void FillPendingEntry(WindowResultEntry& e, int maxWidth, int maxHeight) {
+    e.pending = true;
+    if (!TryGetStaleThumbnail(e.hwnd, e.thumbnail)) e.thumbnail = GetBlankPlaceholderThumbnail(maxWidth, maxHeight);
+    if (e.icon.empty() && !TryGetCachedIcon(e.hwnd, e.icon)) e.icon = "data:image/png;base64,";
+}
+
+static std::string TraceWindowArgs(HWND hwnd) {
+    return "\"hwnd\":" + std::to_string((uint64_t)(uintptr_t)hwnd);
+}
+
+// Threads, queue sizes and every stage's settings come from one configuration
+// snapshot, kept by the stages for the whole run
+static std::shared_ptr<dwm::Pipeline<ThumbnailJob>> CreateThumbnailPipeline(std::shared_ptr<const dwm::RuntimeConfig> config) {
+    auto pipeline = std::make_shared<dwm::Pipeline<ThumbnailJob>>();
+    pipeline->AddStage("capture", config->captureThreads, config->captureQueueCapacity, [config](ThumbnailJob& job) {
+        DWM_BIND_BREAKDOWN(job.entry.hasTimings ? &job.entry.timings : nullptr);
+        dwm::TraceSpan span("pipeline", "capture");
+        if (span.Active()) {
+            dwm::TraceWriter::Instance().NameCurrentThread("capture worker");
+            std::string args = TraceWindowArgs(job.entry.hwnd) + ",\"title\":\"";
+            dwm::AppendJsonEscaped(args, dwm::Utf16ToUtf8(job.entry.title));
+            span.SetArgs(args + "\"");
+        }
+        if (!job.thumbnails) {
+            if (job.icons) job.entry.icon = GetWindowIconBase64(job.entry.hwnd, g_stringTable.Get(job.entry.executablePathId));
+            return false; // metadata only: nothing to capture, scale or encode
+        }
+        if (!job.flight.Acquire(job.entry.hwnd, job.hasDeadline, job.deadline)) {
+            FillPendingEntry(job.entry, job.maxWidth, job.maxHeight); // another call's capture outlived our deadline; cached icon only
+            return false;
+        }
+        if (job.icons) job.entry.icon = GetWindowIconBase64(job.entry.hwnd, g_stringTable.Get(job.entry.executablePathId));
+        if (TryServeCachedThumbnail(job.entry.hwnd, job.maxWidth, job.maxHeight, *config, job.rect, job.ts, job.entry.thumbnail)) {
+            return false; // cache hit: skip scale/encode
+        }
+        CaptureWindowFrame(job.entry.hwnd, job.maxWidth, job.maxHeight, job.frame, job.capture);
+        job.frameCharge.Set(job.frame.pixels.capacity());
+        return true;
+    });
+    pipeline->AddStage("scale", config->scaleThreads, config->stageQueueCapacity, [](ThumbnailJob& job) {
+        DWM_BIND_BREAKDOWN(job.entry.hasTimings ? &job.entry.timings : nullptr);
+        dwm::TraceSpan span("pipeline", "scale");
+        if (span.Active()) {
+            dwm::TraceWriter::Instance().NameCurrentThread("scale worker");
+            span.SetArgs(TraceWindowArgs(job.entry.hwnd));
+        }
+        DWM_TIME_STAGE(Scale);
+        dwm::ScaleToFit(job.frame, job.maxWidth, job.maxHeight);
+        job.frameCharge.Set(job.frame.pixels.capacity());
+        return true;
+    }, config->stageQueueBytes, [](const ThumbnailJob& job) { return job.frame.pixels.size(); });
+    pipeline->AddStage("encode", config->encodeThreads, config->stageQueueCapacity, [config](ThumbnailJob& job) {
+        DWM_BIND_BREAKDOWN(job.entry.hasTimings ? &job.entry.timings : nullptr);
+        dwm::TraceSpan span("pipeline", "encode");
+        if (span.Active()) {
+            dwm::TraceWriter::Instance().NameCurrentThread("encode worker");
+            span.SetArgs(TraceWindowArgs(job.entry.hwnd));
+        }
+        // Fresh captures of normal windows go to the ring while the call has
+        // slots left; minimized and failed captures keep the PNG path and its
+        // cache/placeholder rules
+        if (job.sharedFrames && !job.frame.Empty() && !IsIconic(job.entry.hwnd) && job.sharedFrames->TakeSlot()) {
+            uint64_t nowUs = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+            job.entry.frame = job.sharedFrames->ring->writer.Write(job.frame, (uint64_t)(uintptr_t)job.entry.hwnd, nowUs);
+            if (job.entry.frame) {
+                job.entry.frameWidth = job.frame.width;
+                job.entry.frameHeight = job.frame.height;
+                job.frame.Clear();
+                job.frameCharge.Release();
+                return true;
             }
         }
-    }
+        bool good = dwm::IsUsefulThumbnailFrame(job.frame, job.maxWidth, job.maxHeight);
+        std::string fresh = ThumbnailToPngBase64(job.frame, *config);
+        job.frame.Clear();
+        job.frameCharge.Release();
+        job.entry.thumbnail = CommitCapturedThumbnail(job.entry.hwnd, fresh, good, job.rect, job.ts, job.maxWidth, job.maxHeight,
+                                                      *config);
+        return true;
+    });
+    return pipeline;
+}
 
-    std::vector<WindowInfo> windows;
+struct WindowQuery {
+    bool includeAllDesktops{false};
+    bool collectTimings{false}; // per-window stage breakdown in the results
+    bool interned{false}; // results carry only the string ids of path and class
+    bool sharedFrames{false}; // fresh captures go to the shared frame ring, if enabled
+    bool hasDeadline{false};
+    std::chrono::steady_clock::time_point deadline{};
+    CaptureOptions capture;
+    int maxWidth{0}, maxHeight{0}; // thumbnail size; 0 takes the configured default
+    bool orderByMru{false}; // most recently focused first instead of EnumWindows order
+    bool thumbnails{true}; // false skips capture and encode; results carry no thumbnail
+    bool icons{true};
+};
+
+// Enumerate windows and push each one through the thumbnail pipeline as soon as
+// it is found. Results keep EnumWindows order, or MRU order with orderByMru
+// (windows never focused since tracking started follow in z-order). With a deadline, windows whose
+// capture has not finished by then get a stale cached thumbnail or a placeholder
+// and are flagged pending; their captures keep running and refresh the cache.
+static void CollectWindowResults(const WindowQuery& query, std::vector<WindowResultEntry>& results) {
+    results.clear();
+    ReapBackgroundPipelines();
+    auto config = CurrentConfig();
+    std::shared_ptr<SharedFrameBatch> sharedFrames;
+    if (query.sharedFrames) {
+        if (auto ring = CurrentSharedFrames()) sharedFrames = std::make_shared<SharedFrameBatch>(std::move(ring));
+    }
+    auto pipeline = CreateThumbnailPipeline(config);
+    auto run = std::make_shared<PipelineRun>();
+    pipeline->Start([run](ThumbnailJob&& job) {
+        job.flight.Release(); // the thumbnail is committed (or the capture skipped) by now
+        std::lock_guard<std::mutex> lock(run->mutex);
+        run->results[job.index] = std::move(job.entry);
+        run->completed[job.index] = true;
+    });
+    {
+        std::lock_guard<std::mutex> lock(g_pipelineMutex);
+        g_lastPipeline = pipeline;
+    }
 
     // COM initialisieren und VirtualDesktopManager erstellen (optional)
     IUnknown* vdmUnknown = nullptr;
@@ -1935,321 +2916,1844 @@ Value GetWindows(const CallbackInfo& info) {
         }
     }
 
-    EnumContext ctx{ &windows, vdmUnknown, includeAllDesktops };
-    EnumWindows(EnumWindowsProc, reinterpret_cast<LPARAM>(&ctx));
-
-    if (vdmUnknown) {
-        vdmUnknown->Release();
+    dwm::EnumerationArena arena;
+    dwm::WindowAttributes scratch(arena.Resource());
+    Win32WindowSystem system(vdmUnknown);
+    EnumContext ctx{ nullptr, &system, query.includeAllDesktops };
+    ctx.collectTimings = dwm::kStageTimingEnabled && query.collectTimings;
+    ctx.scratch = &scratch;
+    ctx.onWindow = [&](WindowInfo& w) {
+        ThumbnailJob job;
+        job.capture = query.capture;
+        job.capture.methods = config->captureMethods;
+        job.sharedFrames = sharedFrames;
+        job.maxWidth = query.maxWidth ? query.maxWidth : config->defaultWidth;
+        job.maxHeight = query.maxHeight ? query.maxHeight : config->defaultHeight;
+        job.thumbnails = query.thumbnails;
+        job.icons = query.icons;
+        job.hasDeadline = query.hasDeadline;
+        job.deadline = query.deadline;
+        job.entry.hwnd = w.hwnd;
+        job.entry.title = std::move(w.title);
+        job.entry.executablePathId = w.executablePathId;
+        job.entry.classNameId = w.classNameId;
+        job.entry.isVisible = w.isVisible;
+        job.entry.hasTimings = ctx.collectTimings;
+        job.entry.timings = w.timings;
+        {
+            std::lock_guard<std::mutex> lock(run->mutex);
+            job.index = run->results.size();
+            // Submit-time metadata is only read back for windows still pending at a deadline
+            if (query.hasDeadline) run->results.push_back(job.entry);
+            else run->results.emplace_back();
+            run->completed.push_back(false);
+        }
+        pipeline->Submit(std::move(job));
+    };
+    {
+        DWM_TIME_STAGE(Enumerate);
+        DWM_TRACE_SPAN("enumerate", "EnumWindows");
+        EnumerateWindows(ctx);
+    }
+
+    if (vdmUnknown) vdmUnknown->Release();
+    if (comInitialized) CoUninitialize();
+
+    pipeline->Finish();
+    if (!query.hasDeadline || pipeline->WaitUntil(query.deadline)) {
+        pipeline->Wait();
+        {
+            std::lock_guard<std::mutex> lock(run->mutex);
+            results = std::move(run->results);
+        }
+        if (query.orderByMru) g_focusHistory.SortByRecency(results, [](const WindowResultEntry& e) { return ToWindowId(e.hwnd); });
+        CheckMemoryThresholds();
+        return;
+    }
+
+    // Deadline hit: snapshot what is done, fill in the rest, let the run finish in the background
+    std::vector<bool> completed;
+    {
+        std::lock_guard<std::mutex> lock(run->mutex);
+        results = run->results;
+        completed = run->completed;
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_pipelineMutex);
+        if (g_backgroundPipelines.size() >= kMaxBackgroundPipelines) pipeline->Cancel();
+        g_backgroundPipelines.push_back(pipeline);
+    }
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (completed[i]) continue;
+        FillPendingEntry(results[i], query.maxWidth ? query.maxWidth : config->defaultWidth,
+                         query.maxHeight ? query.maxHeight : config->defaultHeight);
+    }
+    if (query.orderByMru) g_focusHistory.SortByRecency(results, [](const WindowResultEntry& e) { return ToWindowId(e.hwnd); });
+    CheckMemoryThresholds();
+}
+
+// Marshal stage: native result -> JS object (JS thread only). interned leaves
+// out the path and class strings; callers resolve the ids via getStringTable.
+static Object WindowResultToObject(Env env, const WindowResultEntry& r, bool interned = false) {
+    dwm::StageBreakdown timings = r.timings;
+    Object o = Object::New(env);
+    {
+        DWM_BIND_BREAKDOWN(r.hasTimings ? &timings : nullptr);
+        DWM_TIME_STAGE(Marshal);
+        // Use HWND value as id
+        uint64_t id = (uint64_t)(uintptr_t)r.hwnd;
+        o.Set("id", Number::New(env, id));
+        o.Set("title", String::New(env, r.title));
+        if (!interned) {
+            o.Set("executablePath", InternedJsString(env, r.executablePathId));
+            o.Set("className", InternedJsString(env, r.classNameId));
+        }
+        o.Set("executablePathId", Number::New(env, r.executablePathId));
+        o.Set("classNameId", Number::New(env, r.classNameId));
+        o.Set("isVisible", Boolean::New(env, r.isVisible));
+        o.Set("hwnd", Number::New(env, (uintptr_t)r.hwnd));
+        o.Set("thumbnail", String::New(env, r.thumbnail));
+        o.Set("icon", String::New(env, r.icon));
+        if (r.pending) o.Set("pending", Boolean::New(env, true));
+        if (r.frame) {
+            Object frame = Object::New(env);
+            frame.Set("slot", Number::New(env, r.frame.slot));
+            frame.Set("sequence", Number::New(env, (double)r.frame.sequence));
+            frame.Set("width", Number::New(env, r.frameWidth));
+            frame.Set("height", Number::New(env, r.frameHeight));
+            o.Set("frame", frame);
+        }
+    }
+    if (r.hasTimings) {
+        // { stageMs: number } per stage this window went through
+        Object t = Object::New(env);
+        for (int s = 0; s < (int)dwm::TimedStage::Count; ++s) {
+            if (s == (int)dwm::TimedStage::Enumerate || !timings.ns[s]) continue;
+            t.Set(std::string(dwm::TimedStageName((dwm::TimedStage)s)) + "Ms", Number::New(env, timings.ns[s] / 1e6));
+        }
+        o.Set("timings", t);
+    }
+    return o;
+}
+
+// Option includeAllDesktops ermitteln (bool oder { includeAllDesktops: boolean })
+static bool ReadIncludeAllDesktops(const Napi::Value& arg) {
+    if (arg.IsBoolean()) return arg.As<Boolean>().Value();
+    if (arg.IsObject()) {
+        Object opts = arg.As<Object>();
+        if (opts.Has("includeAllDesktops") && opts.Get("includeAllDesktops").IsBoolean()) {
+            return opts.Get("includeAllDesktops").As<Boolean>().Value();
+        }
+    }
+    return false;
+}
+
+// Options shared by getWindows/getWindowsAsync (JS thread):
+// bool | { includeAllDesktops?, hedge?, hedgePercentile?, timings?, interned?, sharedFrames?, orderBy? }
+static void ReadWindowQuery(const Napi::Value& arg, WindowQuery& out) {
+    out.includeAllDesktops = ReadIncludeAllDesktops(arg);
+    if (!arg.IsObject()) return;
+    Object opts = arg.As<Object>();
+    if (opts.Has("hedge") && opts.Get("hedge").IsBoolean()) {
+        out.capture.hedge = opts.Get("hedge").As<Boolean>().Value();
+    }
+    if (opts.Has("hedgePercentile") && opts.Get("hedgePercentile").IsNumber()) {
+        double p = opts.Get("hedgePercentile").As<Number>().DoubleValue();
+        if (p > 0 && p <= 100) out.capture.hedgePercentile = p;
+    }
+    if (opts.Has("timings") && opts.Get("timings").IsBoolean()) {
+        out.collectTimings = opts.Get("timings").As<Boolean>().Value();
+    }
+    if (opts.Has("interned") && opts.Get("interned").IsBoolean()) {
+        out.interned = opts.Get("interned").As<Boolean>().Value();
+    }
+    if (opts.Has("sharedFrames") && opts.Get("sharedFrames").IsBoolean()) {
+        out.sharedFrames = opts.Get("sharedFrames").As<Boolean>().Value();
+    }
+    if (opts.Has("orderBy") && opts.Get("orderBy").IsString()) {
+        out.orderByMru = opts.Get("orderBy").As<String>().Utf8Value() == "mru";
+        // The first MRU query starts tracking; its order comes from the seeded z-order
+        if (out.orderByMru) EnableFocusTracking();
+    }
+}
+
+// Hauptfunktion: Alle Fenster mit Thumbnails ermitteln
+Value GetWindows(const CallbackInfo& info) {
+    DWM_FIRST_CALL("getWindows");
+    Env env = info.Env();
+    
+    // Option includeAllDesktops ermitteln (bool oder { includeAllDesktops: boolean })
+    WindowQuery query;
+    if (info.Length() >= 1) ReadWindowQuery(info[0], query);
+
+    std::vector<WindowResultEntry> results;
+    CollectWindowResults(query, results);
+
+    Array result = Array::New(env, results.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        result.Set(i, WindowResultToObject(env, results[i], query.interned));
+    }
+
+    return result;
+}
+
+// ---------------------- Chunked sync enumeration (time-budgeted) ----------------------
+// beginEnumeration() only snapshots the top-level HWNDs. Each nextEnumeration(handle, budgetMs)
+// call then filters and captures as many of them as fit into the budget, so a caller can spread
+// the work of getWindows across animation frames without async machinery.
+// An enumeration that JS drops without finishing or cancelling it is released
+// once it has been idle for kEnumerationIdleMs, or earlier when more than
+// kMaxEnumerations are open (least recently used first).
+struct ChunkedEnumeration {
+    std::vector<dwm::WindowId> candidates;
+    size_t cursor{0};
+    bool includeAllDesktops{false};
+    ULONGLONG lastUsed{0};
+};
+static std::unordered_map<uint32_t, ChunkedEnumeration> g_chunkedEnumerations; // JS thread only
+static uint32_t g_nextEnumerationHandle = 1;
+static const ULONGLONG kEnumerationIdleMs = 60000;
+static const size_t kMaxEnumerations = 64;
+
+static void SweepChunkedEnumerations(ULONGLONG now) {
+    for (auto it = g_chunkedEnumerations.begin(); it != g_chunkedEnumerations.end();) {
+        if (now - it->second.lastUsed > kEnumerationIdleMs) it = g_chunkedEnumerations.erase(it);
+        else ++it;
+    }
+    while (g_chunkedEnumerations.size() >= kMaxEnumerations) {
+        auto oldest = std::min_element(g_chunkedEnumerations.begin(), g_chunkedEnumerations.end(),
+            [](const auto& a, const auto& b) { return a.second.lastUsed < b.second.lastUsed; });
+        g_chunkedEnumerations.erase(oldest);
+    }
+}
+
+Value BeginEnumeration(const CallbackInfo& info) {
+    DWM_FIRST_CALL("beginEnumeration");
+    Env env = info.Env();
+    ChunkedEnumeration en;
+    en.includeAllDesktops = info.Length() >= 1 && ReadIncludeAllDesktops(info[0]);
+    en.lastUsed = GetTickCount64();
+    SweepChunkedEnumerations(en.lastUsed);
+    g_windowSystem.EnumerateTopLevel(en.candidates);
+    uint32_t handle = g_nextEnumerationHandle++;
+    g_chunkedEnumerations[handle] = std::move(en);
+    return Number::New(env, handle);
+}
+
+Value NextEnumeration(const CallbackInfo& info) {
+    DWM_FIRST_CALL("nextEnumeration");
+    Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        TypeError::New(env, "Expected enumeration handle").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    uint32_t handle = info[0].As<Number>().Uint32Value();
+    auto config = CurrentConfig();
+    double budgetMs = config->enumerationBudgetMs;
+    if (info.Length() >= 2 && info[1].IsNumber()) budgetMs = std::max(0.0, info[1].As<Number>().DoubleValue());
+    auto it = g_chunkedEnumerations.find(handle);
+    if (it == g_chunkedEnumerations.end()) {
+        Error::New(env, "Enumeration handle not found or already finished").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    ChunkedEnumeration& en = it->second;
+    en.lastUsed = GetTickCount64();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds((int64_t)(budgetMs * 1000.0));
+
+    IUnknown* vdmUnknown = nullptr;
+    bool comInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED));
+    if (comInitialized) {
+        IVirtualDesktopManager* vdm = nullptr;
+        HRESULT hr = CoCreateInstance(CLSID_VirtualDesktopManager, nullptr, CLSCTX_ALL,
+                                      IID_IVirtualDesktopManager, (void**)&vdm);
+        if (SUCCEEDED(hr) && vdm) vdmUnknown = vdm;
+    }
+
+    std::vector<WindowResultEntry> completed;
+    dwm::EnumerationArena arena;
+    dwm::WindowAttributes scratch(arena.Resource());
+    Win32WindowSystem system(vdmUnknown);
+    // Always make progress on at least one candidate, even with a zero budget
+    bool first = true;
+    while (en.cursor < en.candidates.size() && (first || std::chrono::steady_clock::now() < deadline)) {
+        first = false;
+        dwm::WindowId id = en.candidates[en.cursor++];
+        WindowInfo w;
+        if (!system.IsAlive(id) || !BuildWindowInfo(system, id, en.includeAllDesktops, scratch, w)) continue;
+        WindowResultEntry e;
+        e.hwnd = w.hwnd;
+        e.icon = GetWindowIconBase64(w.hwnd, g_stringTable.Get(w.executablePathId));
+        e.title = std::move(w.title);
+        e.executablePathId = w.executablePathId;
+        e.classNameId = w.classNameId;
+        e.isVisible = w.isVisible;
+        e.thumbnail = GetOrCaptureWindowThumbnail(w.hwnd, *config);
+        completed.push_back(std::move(e));
+    }
+
+    if (vdmUnknown) vdmUnknown->Release();
+    if (comInitialized) CoUninitialize();
+
+    bool done = en.cursor >= en.candidates.size();
+    if (done) g_chunkedEnumerations.erase(it);
+
+    Array windows = Array::New(env, completed.size());
+    for (size_t i = 0; i < completed.size(); ++i) {
+        windows.Set(i, WindowResultToObject(env, completed[i]));
+    }
+    Object chunk = Object::New(env);
+    chunk.Set("windows", windows);
+    chunk.Set("done", Boolean::New(env, done));
+    return chunk;
+}
+
+Value EndEnumeration(const CallbackInfo& info) {
+    Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        TypeError::New(env, "Expected enumeration handle").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    bool erased = g_chunkedEnumerations.erase(info[0].As<Number>().Uint32Value()) > 0;
+    return Boolean::New(env, erased);
+}
+
+// Thumbnail aktualisieren
+Value UpdateThumbnail(const CallbackInfo& info) {
+    DWM_FIRST_CALL("updateThumbnail");
+    Env env = info.Env();
+    
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        TypeError::New(env, "Expected window ID").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    
+    uint64_t windowId = info[0].As<Number>().Int64Value();
+    HWND hwnd = (HWND)(uintptr_t)windowId;
+    if (!hwnd || !IsWindow(hwnd)) {
+        Error::New(env, "Window ID not found or invalid").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Neuen Screenshot erstellen
+    auto config = CurrentConfig();
+    bool good = false;
+    std::string newThumbnail = CaptureWindowScreenshot(hwnd, *config, &good);
+    // Cache aktualisieren
+    StoreCapturedThumbnail(hwnd, newThumbnail, good, config->defaultWidth, config->defaultHeight);
+    CheckMemoryThresholds();
+    
+    return String::New(env, newThumbnail);
+}
+
+// Fenster wieder öffnen/fokussieren
+Value OpenWindow(const CallbackInfo& info) {
+    DWM_FIRST_CALL("openWindow");
+    Env env = info.Env();
+    
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        TypeError::New(env, "Expected window ID").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    
+    uint64_t windowId = info[0].As<Number>().Int64Value();
+    HWND hwnd = (HWND)(uintptr_t)windowId;
+    if (!hwnd) {
+        Error::New(env, "Window ID not found or invalid").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    
+    if (!IsWindow(hwnd)) {
+        Error::New(env, "Window no longer exists").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    
+    // Fenster in den Vordergrund bringen
+    if (IsIconic(hwnd)) {
+        ShowWindow(hwnd, SW_RESTORE);
+    }
+    
+    // Fenster aktivieren
+    SetForegroundWindow(hwnd);
+    BringWindowToTop(hwnd);
+    SetActiveWindow(hwnd);
+    
+    return Boolean::New(env, true);
+}
+
+// ---------------------- Async Promise-based APIs ----------------------
+// Workers are deleted after resolving, so firstCall covers call -> resolve
+class PromiseWorker : public AsyncWorker {
+public:
+    PromiseWorker(Napi::Env env, dwm::FirstCallSite& site)
+        : AsyncWorker(env), deferred(Napi::Promise::Deferred::New(env)), firstCall(site) {}
+    Napi::Promise GetPromise() { return deferred.Promise(); }
+protected:
+    Napi::Promise::Deferred deferred;
+    void OnError(const Napi::Error& e) override { deferred.Reject(e.Value()); }
+private:
+    dwm::FirstCallTimer firstCall;
+};
+
+class GetWindowsAsyncWorker : public PromiseWorker {
+public:
+    GetWindowsAsyncWorker(Napi::Env env, dwm::FirstCallSite& site, const WindowQuery& q)
+        : PromiseWorker(env, site), query(q) {}
+
+    void Execute() override {
+        // Same pipeline as GetWindows, driven from the worker thread
+        DWM_TRACE_SPAN("api", "getWindowsAsync");
+        CollectWindowResults(query, results);
+    }
+
+    void OnOK() override {
+        Napi::Env env = this->Env();
+        DWM_TRACE_SPAN("api", "marshal");
+        Array arr = Array::New(env, results.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            arr.Set(i, WindowResultToObject(env, results[i], query.interned));
+        }
+        deferred.Resolve(arr);
+    }
+
+private:
+    WindowQuery query;
+    std::vector<WindowResultEntry> results;
+};
+
+class UpdateThumbnailAsyncWorker : public PromiseWorker {
+public:
+    UpdateThumbnailAsyncWorker(Napi::Env env, dwm::FirstCallSite& site, uint64_t id)
+        : PromiseWorker(env, site), windowId(id), config(CurrentConfig()) {}
+
+    void Execute() override {
+    // Interpret windowId as HWND directly
+    HWND hwndLocal = (HWND)(uintptr_t)windowId;
+        if (!hwndLocal || !IsWindow(hwndLocal)) {
+            SetError("Window ID not found or invalid");
+            return;
+        }
+        // Capture thumbnail
+        bool good = false;
+        thumbnail = CaptureWindowScreenshot(hwndLocal, *config, &good);
+        // Update cache meta
+        StoreCapturedThumbnail(hwndLocal, thumbnail, good, config->defaultWidth, config->defaultHeight);
+        CheckMemoryThresholds();
+    }
+
+    void OnOK() override {
+        deferred.Resolve(String::New(this->Env(), thumbnail));
+    }
+
+private:
+    uint64_t windowId;
+    std::shared_ptr<const dwm::RuntimeConfig> config;
+    std::string thumbnail;
+};
+
+// updateThumbnailAsync(id, { progressive: true }): one capture, two images.
+// The preview is the captured frame shrunk nearest-neighbour and stored as a
+// level-0 PNG (no filter, no deflate), ~20x quicker than the final image
+// (bench/: progressive); it goes to onPreview through a thread-safe function
+// while the same frame is area-averaged and encoded with the configured codec
+// for the promise. Only the final image is cached. The promise reports
+// whether a preview was sent, since the two reach the JS thread through
+// different queues and the caller restores their order.
+class ProgressiveThumbnailAsyncWorker : public PromiseWorker {
+public:
+    ProgressiveThumbnailAsyncWorker(Napi::Env env, dwm::FirstCallSite& site, uint64_t id, Function onPreview)
+        : PromiseWorker(env, site), windowId(id), config(CurrentConfig()),
+          preview(ThreadSafeFunction::New(env, onPreview, "thumbnailPreview", 0, 1)) {}
+    ~ProgressiveThumbnailAsyncWorker() { preview.Release(); }
+
+    void Execute() override {
+        HWND hwnd = ToHwnd(windowId);
+        if (!hwnd || !IsWindow(hwnd)) {
+            SetError("Window ID not found or invalid");
+            return;
+        }
+        int maxWidth = config->defaultWidth, maxHeight = config->defaultHeight;
+        CaptureOptions options;
+        options.methods = config->captureMethods;
+        dwm::Frame frame;
+        if (!CaptureWindowFrame(hwnd, maxWidth, maxHeight, frame, options)) {
+            thumbnail = "data:image/png;base64,";
+            return;
+        }
+        int w = 0, h = 0;
+        dwm::FitWithin(frame.width, frame.height, maxWidth, maxHeight, w, h);
+        {
+            DWM_TRACE_SPAN("capture", "preview");
+            dwm::Frame coarse;
+            dwm::ResampleNearest(frame, w, h, coarse);
+            dwm::PngEncodeOptions fastest;
+            fastest.level = 0;
+            fastest.filter = dwm::PngFilter::None;
+            auto* data = new std::string(FrameToPngBase64(coarse, fastest));
+            previewSent = preview.NonBlockingCall(data, [](Env env, Function cb, std::string* s) {
+                cb.Call({ String::New(env, *s) });
+                delete s;
+            }) == napi_ok;
+            if (!previewSent) delete data;
+        }
+        {
+            DWM_TIME_STAGE(Scale);
+            dwm::ScaleToFit(frame, maxWidth, maxHeight);
+        }
+        bool good = dwm::IsUsefulThumbnailFrame(frame, maxWidth, maxHeight);
+        thumbnail = ThumbnailToPngBase64(frame, *config);
+        StoreCapturedThumbnail(hwnd, thumbnail, good, maxWidth, maxHeight);
+        CheckMemoryThresholds();
+    }
+
+    void OnOK() override {
+        Napi::Env env = this->Env();
+        Object o = Object::New(env);
+        o.Set("thumbnail", String::New(env, thumbnail));
+        o.Set("preview", Boolean::New(env, previewSent));
+        deferred.Resolve(o);
+    }
+
+private:
+    uint64_t windowId;
+    std::shared_ptr<const dwm::RuntimeConfig> config;
+    ThreadSafeFunction preview;
+    bool previewSent{false};
+    std::string thumbnail;
+};
+
+class OpenWindowAsyncWorker : public PromiseWorker {
+public:
+    OpenWindowAsyncWorker(Napi::Env env, dwm::FirstCallSite& site, uint64_t id)
+        : PromiseWorker(env, site), windowId(id) {}
+
+    void Execute() override {
+    HWND hwndLocal = (HWND)(uintptr_t)windowId;
+        if (!hwndLocal || !IsWindow(hwndLocal)) {
+            SetError("Window ID not found or invalid");
+            return;
+        }
+        if (IsIconic(hwndLocal)) {
+            ShowWindow(hwndLocal, SW_RESTORE);
+        }
+        SetForegroundWindow(hwndLocal);
+        BringWindowToTop(hwndLocal);
+        SetActiveWindow(hwndLocal);
+        success = true;
+    }
+
+    void OnOK() override { deferred.Resolve(Boolean::New(this->Env(), success)); }
+
+private:
+    uint64_t windowId;
+    bool success{false};
+};
+
+// { level?, bandRows? } for captureToFile/captureToStream (JS thread). False
+// after throwing for an out-of-range level.
+static bool ReadFullCaptureOptions(Env env, const Napi::Value& arg, FullCaptureOptions& out) {
+    std::shared_ptr<const dwm::RuntimeConfig> config = CurrentConfig();
+    out.methods = config->captureMethods;
+    out.parallel.threads = config->pngThreads;
+    out.parallel.minBytes = config->parallelPngBytes;
+    if (!arg.IsObject()) return true;
+    Object opts = arg.As<Object>();
+    if (opts.Get("level").IsNumber()) {
+        int level = opts.Get("level").As<Number>().Int32Value();
+        if (level < 0 || level > 9) {
+            RangeError::New(env, "level must be 0-9").ThrowAsJavaScriptException();
+            return false;
+        }
+        out.level = level;
+    }
+    if (opts.Get("bandRows").IsNumber()) out.bandRows = std::clamp(opts.Get("bandRows").As<Number>().Int32Value(), 1, 4096);
+    return true;
+}
+
+// Writes go through AsyncChunkWriter, so encoding the next band overlaps with
+// the disk; a failed capture or write removes the partial file.
+class CaptureToFileAsyncWorker : public PromiseWorker {
+public:
+    CaptureToFileAsyncWorker(Napi::Env env, dwm::FirstCallSite& site, uint64_t id, std::u16string p, const FullCaptureOptions& o)
+        : PromiseWorker(env, site), windowId(id), path(std::move(p)), options(o) {}
+
+    void Execute() override {
+        const wchar_t* file = reinterpret_cast<const wchar_t*>(path.c_str());
+        FILE* f = _wfopen(file, L"wb");
+        if (!f) {
+            SetError("Cannot open the output file");
+            return;
+        }
+        std::string error;
+        bool captured;
+        bool written;
+        {
+            dwm::AsyncChunkWriter writer(4, [this, f](const uint8_t* data, size_t len) {
+                bytes += len;
+                return std::fwrite(data, 1, len, f) == len;
+            });
+            captured = StreamWindowPng(ToHwnd(windowId), options, writer.Sink(), width, height, error);
+            written = writer.Close();
+        }
+        written = std::fclose(f) == 0 && written;
+        if (!captured || !written) {
+            _wremove(file);
+            SetError(captured ? "Cannot write the output file" : error);
+        }
+    }
+
+    void OnOK() override {
+        Napi::Env env = this->Env();
+        Object o = Object::New(env);
+        o.Set("path", String::New(env, path));
+        o.Set("width", Number::New(env, width));
+        o.Set("height", Number::New(env, height));
+        o.Set("bytes", Number::New(env, (double)bytes));
+        deferred.Resolve(o);
+    }
+
+private:
+    uint64_t windowId;
+    std::u16string path;
+    FullCaptureOptions options;
+    int width{0}, height{0};
+    uint64_t bytes{0}; // written on the writer thread, read after it is joined
+};
+
+// captureStream*: a capture thread encodes the PNG and hands each chunk to
+// the stream's callback through a thread-safe function. It sends a chunk only
+// against a credit, which captureStreamRead grants when the Readable wants
+// more, so the consumer's pace bounds memory and no pool thread waits on it.
+// The function keeps the event loop alive only while a credit is outstanding,
+// so an abandoned stream does not hold the process. Closing the handle stops
+// the encode at its next chunk. The thread is detached and keeps the stream
+// alive, so closing never waits on a slow PrintWindow; a closed stream stays
+// registered until its thread is done, and env cleanup closes every stream
+// and leaves threads still stuck after the grace period behind. Handles are
+// used on the JS thread only.
+struct CaptureStream {
+    std::mutex mutex;
+    std::condition_variable changed;
+    ThreadSafeFunction chunks; // (chunk: Buffer | null, error?: string)
+    size_t credits{0};         // chunks asked for and not yet sent
+    bool closed{false};        // no more chunks wanted
+    bool finished{false};      // the capture thread has released chunks
+    bool abandoned{false};     // env cleanup gave up on the thread: chunks is not to be touched
+};
+static std::unordered_map<uint32_t, std::shared_ptr<CaptureStream>> g_captureStreams;
+static uint32_t g_nextCaptureStream = 1;
+
+struct CaptureStreamChunk {
+    std::vector<uint8_t> bytes;
+    bool end{false};
+    std::string error; // with end: the capture failed
+};
+
+// Capture thread, under stream->mutex
+static bool SendCaptureStreamChunk(const std::shared_ptr<CaptureStream>& stream, CaptureStreamChunk* chunk) {
+    napi_status status = stream->chunks.NonBlockingCall(chunk, [stream](Env env, Function cb, CaptureStreamChunk* data) {
+        if (!data->end) cb.Call({ Buffer<uint8_t>::Copy(env, data->bytes.data(), data->bytes.size()) });
+        else if (data->error.empty()) cb.Call({ env.Null() });
+        else cb.Call({ env.Null(), String::New(env, data->error) });
+        delete data;
+        // Nothing asked for (the callback may have asked again): nothing to keep the process alive for
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        if (!stream->finished && !stream->closed && stream->credits == 0) stream->chunks.Unref(env);
+    });
+    if (status != napi_ok) delete chunk;
+    return status == napi_ok;
+}
+
+// Drops the handles of closed streams whose threads are done (JS thread)
+static void ReapCaptureStreams() {
+    for (auto it = g_captureStreams.begin(); it != g_captureStreams.end();) {
+        std::lock_guard<std::mutex> lock(it->second->mutex);
+        if (it->second->closed && it->second->finished) it = g_captureStreams.erase(it);
+        else ++it;
+    }
+}
+
+// JS thread; a no-op for an unknown or already closed handle
+static void CloseCaptureStream(Env env, uint32_t handle) {
+    auto it = g_captureStreams.find(handle);
+    if (it == g_captureStreams.end()) return;
+    CaptureStream& stream = *it->second;
+    {
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        if (!stream.finished && !stream.closed) stream.chunks.Unref(env); // a stuck capture must not hold the process
+        stream.closed = true;
+        stream.changed.notify_all(); // the capture thread stops at its next chunk
+    }
+    ReapCaptureStreams();
+}
+
+// Env cleanup: closes every stream and waits up to the grace period for their
+// threads; a thread still stuck in a capture is left behind and never
+// touches the function again
+static void ShutdownCaptureStreams() {
+    auto until = std::chrono::steady_clock::now() + kBackgroundShutdownGrace;
+    for (auto& [handle, stream] : g_captureStreams) {
+        std::unique_lock<std::mutex> lock(stream->mutex);
+        stream->closed = true;
+        stream->changed.notify_all();
+        if (!stream->changed.wait_until(lock, until, [&] { return stream->finished; })) stream->abandoned = true;
+    }
+    g_captureStreams.clear();
+}
+
+Value GetWindowsAsync(const CallbackInfo& info) {
+    Env env = info.Env();
+    WindowQuery query;
+    if (info.Length() >= 1) {
+        ReadWindowQuery(info[0], query);
+        if (info[0].IsObject()) {
+            Object opts = info[0].As<Object>();
+            if (opts.Has("deadlineMs") && opts.Get("deadlineMs").IsNumber()) {
+                double deadlineMs = std::max(0.0, opts.Get("deadlineMs").As<Number>().DoubleValue());
+                // Measured from the call, so time spent queued for a worker thread counts too
+                query.hasDeadline = true;
+                query.deadline = std::chrono::steady_clock::now() + std::chrono::microseconds((int64_t)(deadlineMs * 1000.0));
+            }
+        }
+    }
+    static dwm::FirstCallSite site("getWindowsAsync");
+    auto* worker = new GetWindowsAsyncWorker(env, site, query);
+    Promise promise = worker->GetPromise();
+    worker->Queue();
+    return promise;
+}
+
+Value UpdateThumbnailAsync(const CallbackInfo& info) {
+    Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        TypeError::New(env, "Expected window ID").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    uint64_t id = info[0].As<Number>().Int64Value();
+    static dwm::FirstCallSite site("updateThumbnailAsync");
+    auto* worker = new UpdateThumbnailAsyncWorker(env, site, id);
+    Promise promise = worker->GetPromise();
+    worker->Queue();
+    return promise;
+}
+
+// updateThumbnailProgressive(id, onPreview) -> Promise<{ thumbnail, preview }>
+Value UpdateThumbnailProgressive(const CallbackInfo& info) {
+    Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsFunction()) {
+        TypeError::New(env, "Expected window ID and preview callback").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    uint64_t id = info[0].As<Number>().Int64Value();
+    static dwm::FirstCallSite site("updateThumbnailProgressive");
+    auto* worker = new ProgressiveThumbnailAsyncWorker(env, site, id, info[1].As<Function>());
+    Promise promise = worker->GetPromise();
+    worker->Queue();
+    return promise;
+}
+
+// captureToFile(id, path, { level?, bandRows? }) -> Promise<{ path, width, height, bytes }>
+Value CaptureToFile(const CallbackInfo& info) {
+    Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsString()) {
+        TypeError::New(env, "Expected window ID and output path").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    FullCaptureOptions options;
+    if (!ReadFullCaptureOptions(env, info.Length() >= 3 ? info[2] : env.Undefined(), options)) return env.Null();
+    static dwm::FirstCallSite site("captureToFile");
+    auto* worker = new CaptureToFileAsyncWorker(env, site, info[0].As<Number>().Int64Value(),
+                                                info[1].As<String>().Utf16Value(), options);
+    Promise promise = worker->GetPromise();
+    worker->Queue();
+    return promise;
+}
+
+// captureStreamOpen(id, { level?, bandRows? }, onChunk) -> handle; starts the
+// capture thread. onChunk(buffer) per chunk read, then onChunk(null) once the
+// PNG is complete or onChunk(null, error) if the capture failed.
+Value CaptureStreamOpen(const CallbackInfo& info) {
+    DWM_FIRST_CALL("captureToStream");
+    Env env = info.Env();
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[2].IsFunction()) {
+        TypeError::New(env, "Expected window ID, options and chunk callback").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    FullCaptureOptions options;
+    if (!ReadFullCaptureOptions(env, info[1], options)) return env.Null();
+    ReapCaptureStreams();
+    HWND hwnd = ToHwnd((dwm::WindowId)info[0].As<Number>().Int64Value());
+    auto stream = std::make_shared<CaptureStream>();
+    stream->chunks = ThreadSafeFunction::New(env, info[2].As<Function>(), "capture-stream", 0, 1);
+    stream->chunks.Unref(env); // until the first read
+    std::thread([stream, hwnd, options] {
+        int width = 0, height = 0;
+        std::string error;
+        bool ok = StreamWindowPng(hwnd, options, [&stream](const uint8_t* data, size_t len) {
+            std::unique_lock<std::mutex> lock(stream->mutex);
+            stream->changed.wait(lock, [&] { return stream->closed || stream->credits > 0; });
+            if (stream->closed) return false;
+            stream->credits--;
+            return SendCaptureStreamChunk(stream, new CaptureStreamChunk{ std::vector<uint8_t>(data, data + len) });
+        }, width, height, error);
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        if (!stream->abandoned) {
+            if (!stream->closed) SendCaptureStreamChunk(stream, new CaptureStreamChunk{ {}, true, ok ? std::string() : error });
+            stream->chunks.Release();
+        }
+        stream->finished = true;
+        stream->changed.notify_all();
+    }).detach();
+    uint32_t handle = g_nextCaptureStream++;
+    g_captureStreams[handle] = std::move(stream);
+    return Number::New(env, handle);
+}
+
+// captureStreamRead(handle): asks for the next chunk, delivered to onChunk
+Value CaptureStreamRead(const CallbackInfo& info) {
+    Env env = info.Env();
+    auto it = info.Length() >= 1 && info[0].IsNumber() ? g_captureStreams.find(info[0].As<Number>().Uint32Value()) : g_captureStreams.end();
+    bool open = it != g_captureStreams.end();
+    if (open) {
+        CaptureStream& stream = *it->second;
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        open = !stream.closed;
+        if (open && !stream.finished) {
+            stream.credits++;
+            stream.chunks.Ref(env); // a read in progress keeps the process alive
+            stream.changed.notify_all();
+        }
+    }
+    if (!open) {
+        Error::New(env, "Unknown or closed capture stream").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    return env.Undefined();
+}
+
+// captureStreamClose(handle): stops an unfinished capture and releases the handle
+Value CaptureStreamClose(const CallbackInfo& info) {
+    Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber()) return env.Undefined();
+    CloseCaptureStream(env, info[0].As<Number>().Uint32Value());
+    return env.Undefined();
+}
+
+Value OpenWindowAsync(const CallbackInfo& info) {
+    Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        TypeError::New(env, "Expected window ID").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    uint64_t id = info[0].As<Number>().Int64Value();
+    static dwm::FirstCallSite site("openWindowAsync");
+    auto* worker = new OpenWindowAsyncWorker(env, site, id);
+    Promise promise = worker->GetPromise();
+    worker->Queue();
+    return promise;
+}
+
+// Diagnostics: per-stage queue depth and utilization of the most recent pipeline run
+Value GetCaptureStats(const CallbackInfo& info) {
+    Env env = info.Env();
+    std::vector<dwm::PipelineStageStats> stages;
+    {
+        std::lock_guard<std::mutex> lock(g_pipelineMutex);
+        if (g_lastPipeline) stages = g_lastPipeline->Stats();
+    }
+    Array pipeline = Array::New(env, stages.size());
+    for (size_t i = 0; i < stages.size(); ++i) {
+        const auto& st = stages[i];
+        Object o = Object::New(env);
+        o.Set("name", String::New(env, st.name));
+        o.Set("concurrency", Number::New(env, (double)st.concurrency));
+        o.Set("queueCapacity", Number::New(env, (double)st.queueCapacity));
+        o.Set("queueDepth", Number::New(env, (double)st.queueDepth));
+        o.Set("maxQueueDepth", Number::New(env, (double)st.maxQueueDepth));
+        if (st.queueCostLimit) {
+            o.Set("queueBytes", Number::New(env, (double)st.queueCost));
+            o.Set("queueBytesLimit", Number::New(env, (double)st.queueCostLimit));
+        }
+        o.Set("processed", Number::New(env, (double)st.processed));
+        o.Set("busyMs", Number::New(env, (double)st.busyNs / 1e6));
+        o.Set("utilization", Number::New(env, st.utilization));
+        pipeline.Set(i, o);
+    }
+    Array methods = Array::New(env, kCaptureMethodCount);
+    for (int m = 0; m < kCaptureMethodCount; ++m) {
+        const CaptureMethodStats& ms = g_captureMethodStats[m];
+        Object o = Object::New(env);
+        o.Set("name", String::New(env, kCaptureMethodNames[m]));
+        o.Set("attempts", Number::New(env, (double)ms.latency.Count()));
+        o.Set("failures", Number::New(env, (double)ms.failures.load()));
+        o.Set("wins", Number::New(env, (double)ms.wins.load()));
+        o.Set("p50Ms", Number::New(env, ms.latency.PercentileUs(50) / 1000.0));
+        o.Set("p90Ms", Number::New(env, ms.latency.PercentileUs(90) / 1000.0));
+        o.Set("p99Ms", Number::New(env, ms.latency.PercentileUs(99) / 1000.0));
+        o.Set("maxMs", Number::New(env, ms.latency.MaxUs() / 1000.0));
+        o.Set("hedgeThresholdMs", Number::New(env, std::chrono::duration<double, std::milli>(HedgeThresholdFor(m, 90)).count()));
+        methods.Set((uint32_t)m, o);
+    }
+    Object hedging = Object::New(env);
+    hedging.Set("hedged", Number::New(env, (double)g_hedgedCaptures.load()));
+    hedging.Set("hedgeWins", Number::New(env, (double)g_hedgeWins.load()));
+    hedging.Set("throttled", Number::New(env, (double)g_hedgeThrottled.load()));
+    hedging.Set("timeouts", Number::New(env, (double)g_hedgeTimeouts.load()));
+    Object prefetch = Object::New(env);
+    prefetch.Set("tracking", Boolean::New(env, g_focusTracking.load()));
+    prefetch.Set("trackedWindows", Number::New(env, (double)g_focusHistory.Size()));
+    prefetch.Set("captures", Number::New(env, (double)g_prefetchCaptures.load()));
+    prefetch.Set("hits", Number::New(env, (double)g_prefetchHits.load()));
+    Object wgcBatches = Object::New(env);
+    wgcBatches.Set("batches", Number::New(env, (double)g_wgcBatches.load()));
+    wgcBatches.Set("windows", Number::New(env, (double)g_wgcBatchWindows.load()));
+    wgcBatches.Set("wallMs", Number::New(env, g_wgcBatchWallUs.load() / 1000.0));
+    wgcBatches.Set("captureMs", Number::New(env, g_wgcBatchCaptureUs.load() / 1000.0));
+    prefetch.Set("wgcBatches", wgcBatches);
+
+    g_negativeCache.Prune([](uint64_t window) { return IsWindow((HWND)(uintptr_t)window) ? true : false; });
+    std::vector<dwm::NegativeCacheEntry> failing = g_negativeCache.Snapshot();
+    Array negEntries = Array::New(env, failing.size());
+    for (size_t i = 0; i < failing.size(); ++i) {
+        const dwm::NegativeCacheEntry& e = failing[i];
+        Object o = Object::New(env);
+        o.Set("hwnd", Number::New(env, (double)e.key.window));
+        o.Set("pid", Number::New(env, (double)e.key.pid));
+        o.Set("method", String::New(env, kCaptureMethodNames[e.key.method]));
+        o.Set("failures", Number::New(env, (double)e.failures));
+        o.Set("retryInMs", Number::New(env, (double)e.retryIn.count()));
+        negEntries.Set((uint32_t)i, o);
+    }
+    Object negativeCache = Object::New(env);
+    negativeCache.Set("entries", negEntries);
+    negativeCache.Set("skipped", Number::New(env, (double)g_negativeCache.Skipped()));
+
+    // Empty when built with DWM_STAGE_TIMING=0
+    Array stages = Array::New(env);
+    if (dwm::kStageTimingEnabled) {
+        for (int s = 0; s < (int)dwm::TimedStage::Count; ++s) {
+            const dwm::LatencyHistogram& h = dwm::StageHistogram((dwm::TimedStage)s);
+            Object o = Object::New(env);
+            o.Set("name", String::New(env, dwm::TimedStageName((dwm::TimedStage)s)));
+            o.Set("count", Number::New(env, (double)h.Count()));
+            o.Set("meanMs", Number::New(env, h.MeanUs() / 1000.0));
+            o.Set("p50Ms", Number::New(env, h.PercentileUs(50) / 1000.0));
+            o.Set("p90Ms", Number::New(env, h.PercentileUs(90) / 1000.0));
+            o.Set("p99Ms", Number::New(env, h.PercentileUs(99) / 1000.0));
+            o.Set("maxMs", Number::New(env, h.MaxUs() / 1000.0));
+            stages.Set((uint32_t)s, o);
+        }
+    }
+
+    Object stats = Object::New(env);
+    stats.Set("pipeline", pipeline);
+    stats.Set("stages", stages);
+    stats.Set("methods", methods);
+    stats.Set("hedging", hedging);
+    stats.Set("negativeCache", negativeCache);
+    stats.Set("prefetch", prefetch);
+    return stats;
+}
+
+// ---------------- Memory accounting ----------------
+#ifndef GR_GDIOBJECTS_PEAK
+#define GR_GDIOBJECTS_PEAK 2
+#endif
+#ifndef GR_USEROBJECTS_PEAK
+#define GR_USEROBJECTS_PEAK 4
+#endif
+
+struct ProcessMemorySample {
+    uint64_t privateBytes{0};
+    uint64_t workingSetBytes{0};
+    uint64_t peakWorkingSetBytes{0};
+    uint32_t gdiObjects{0};
+    uint32_t gdiObjectsPeak{0};
+    uint32_t userObjects{0};
+    uint32_t userObjectsPeak{0};
+};
+
+static ProcessMemorySample SampleProcessMemory() {
+    ProcessMemorySample s;
+    HANDLE process = GetCurrentProcess();
+    PROCESS_MEMORY_COUNTERS_EX pmc{};
+    pmc.cb = sizeof(pmc);
+    if (GetProcessMemoryInfo(process, (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) {
+        s.privateBytes = pmc.PrivateUsage;
+        s.workingSetBytes = pmc.WorkingSetSize;
+        s.peakWorkingSetBytes = pmc.PeakWorkingSetSize;
+    }
+    s.gdiObjects = GetGuiResources(process, GR_GDIOBJECTS);
+    s.gdiObjectsPeak = GetGuiResources(process, GR_GDIOBJECTS_PEAK);
+    s.userObjects = GetGuiResources(process, GR_USEROBJECTS);
+    s.userObjectsPeak = GetGuiResources(process, GR_USEROBJECTS_PEAK);
+    return s;
+}
+
+// Limits by metric: a category name, "total" (all accounted bytes), "privateBytes",
+// "gdiObjects" or "userObjects"
+static dwm::ThresholdMonitor g_memoryThresholds;
+static ThreadSafeFunction g_tsfnMemoryWarning;
+
+// Reports metrics that reached their threshold to onMemoryWarning; no-op without thresholds
+static void CheckMemoryThresholds() {
+    if (!g_memoryThresholds.HasLimits()) return;
+    ProcessMemorySample s = SampleProcessMemory();
+    std::vector<dwm::ThresholdCrossing> crossed;
+    for (int c = 0; c < (int)dwm::MemoryCategory::Count; ++c) {
+        g_memoryThresholds.Observe(dwm::MemoryCategoryName((dwm::MemoryCategory)c), dwm::AccountFor((dwm::MemoryCategory)c).Bytes(), crossed);
+    }
+    g_memoryThresholds.Observe("total", dwm::TotalAccountedBytes(), crossed);
+    g_memoryThresholds.Observe("privateBytes", s.privateBytes, crossed);
+    g_memoryThresholds.Observe("gdiObjects", s.gdiObjects, crossed);
+    g_memoryThresholds.Observe("userObjects", s.userObjects, crossed);
+    if (!g_tsfnMemoryWarning) return;
+    for (const dwm::ThresholdCrossing& c : crossed) {
+        g_tsfnMemoryWarning.NonBlockingCall(new dwm::ThresholdCrossing(c), [](Env env, Function cb, dwm::ThresholdCrossing* data) {
+            Object o = Object::New(env);
+            o.Set("metric", String::New(env, data->metric));
+            o.Set("value", Number::New(env, (double)data->value));
+            o.Set("threshold", Number::New(env, (double)data->limit));
+            cb.Call({ o });
+            delete data;
+        });
+    }
+}
+
+// getMemoryStats(): bytes held per subsystem, capture peaks, process and GDI/USER counts
+Value GetMemoryStats(const CallbackInfo& info) {
+    Env env = info.Env();
+    size_t thumbEntries = 0, iconEntries = 0;
+    {
+        thumbEntries = g_thumbCache.Size();
+        std::lock_guard<std::mutex> lock(g_cacheMutex);
+        iconEntries = g_iconCache.size();
+    }
+    Object categories = Object::New(env);
+    for (int c = 0; c < (int)dwm::MemoryCategory::Count; ++c) {
+        const dwm::MemoryAccount& a = dwm::AccountFor((dwm::MemoryCategory)c);
+        Object o = Object::New(env);
+        o.Set("bytes", Number::New(env, (double)a.Bytes()));
+        o.Set("peakBytes", Number::New(env, (double)a.PeakBytes()));
+        o.Set("allocations", Number::New(env, (double)a.Allocations()));
+        categories.Set(dwm::MemoryCategoryName((dwm::MemoryCategory)c), o);
+    }
+    categories.Get("thumbnailCache").As<Object>().Set("entries", Number::New(env, (double)thumbEntries));
+    categories.Get("iconCache").As<Object>().Set("entries", Number::New(env, (double)iconEntries));
+
+    Object capture = Object::New(env);
+    capture.Set("attempts", Number::New(env, (double)g_captureAllocationPeaks.Count()));
+    capture.Set("peakBytes", Number::New(env, (double)g_captureAllocationPeaks.MaxBytes()));
+    capture.Set("meanPeakBytes", Number::New(env, g_captureAllocationPeaks.MeanBytes()));
+
+    ProcessMemorySample s = SampleProcessMemory();
+    Object process = Object::New(env);
+    process.Set("privateBytes", Number::New(env, (double)s.privateBytes));
+    process.Set("workingSetBytes", Number::New(env, (double)s.workingSetBytes));
+    process.Set("peakWorkingSetBytes", Number::New(env, (double)s.peakWorkingSetBytes));
+    process.Set("gdiObjects", Number::New(env, (double)s.gdiObjects));
+    process.Set("gdiObjectsPeak", Number::New(env, (double)s.gdiObjectsPeak));
+    process.Set("userObjects", Number::New(env, (double)s.userObjects));
+    process.Set("userObjectsPeak", Number::New(env, (double)s.userObjectsPeak));
+
+    Object thresholds = Object::New(env);
+    for (const auto& kv : g_memoryThresholds.Limits()) thresholds.Set(kv.first, Number::New(env, (double)kv.second));
+
+    Object stats = Object::New(env);
+    stats.Set("totalBytes", Number::New(env, (double)dwm::TotalAccountedBytes()));
+    stats.Set("categories", categories);
+    stats.Set("capture", capture);
+    stats.Set("process", process);
+    stats.Set("thresholds", thresholds);
+    CheckMemoryThresholds();
+    return stats;
+}
+
+// setMemoryThresholds({ metric: limit, ... }) replaces all thresholds; {} or null clears them.
+// Limits are bytes, or object counts for gdiObjects/userObjects.
+Value SetMemoryThresholds(const CallbackInfo& info) {
+    Env env = info.Env();
+    if (info.Length() >= 1 && !info[0].IsObject() && !info[0].IsNull() && !info[0].IsUndefined()) {
+        TypeError::New(env, "Expected thresholds object").ThrowAsJavaScriptException();
+        return env.Null();
     }
-    if (comInitialized) {
-        CoUninitialize();
+    std::vector<std::pair<std::string, uint64_t>> limits;
+    if (info.Length() >= 1 && info[0].IsObject()) {
+        Object opts = info[0].As<Object>();
+        Array keys = opts.GetPropertyNames();
+        for (uint32_t i = 0; i < keys.Length(); ++i) {
+            std::string key = keys.Get(i).As<String>().Utf8Value();
+            bool known = key == "total" || key == "privateBytes" || key == "gdiObjects" || key == "userObjects";
+            for (int c = 0; c < (int)dwm::MemoryCategory::Count && !known; ++c) {
+                known = key == dwm::MemoryCategoryName((dwm::MemoryCategory)c);
+            }
+            Napi::Value v = opts.Get(key);
+            if (!known || !v.IsNumber() || v.As<Number>().DoubleValue() < 0) {
+                TypeError::New(env, "Unknown memory metric or invalid limit: " + key).ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            limits.push_back({ key, (uint64_t)v.As<Number>().DoubleValue() });
+        }
     }
-    
-    Array result = Array::New(env);
-    
-    for (size_t i = 0; i < windows.size(); i++) {
-        const WindowInfo& window = windows[i];
-        // Use HWND as the public id
-        uint64_t hwndId = (uint64_t)(uintptr_t)window.hwnd;
-
-        Object windowObj = Object::New(env);
-        windowObj.Set("id", Number::New(env, hwndId));
-        windowObj.Set("title", String::New(env, window.title));
-        windowObj.Set("executablePath", String::New(env, window.executablePath));
-        windowObj.Set("isVisible", Boolean::New(env, window.isVisible));
-        windowObj.Set("hwnd", Number::New(env, (uintptr_t)window.hwnd));
-        
-    // Icon und Screenshot (mit Cache)
-    std::string iconBase64 = GetWindowIconBase64(window.hwnd, window.executablePath);
-    std::string thumbnailBase64 = GetOrCaptureWindowThumbnail(window.hwnd);
-        windowObj.Set("thumbnail", String::New(env, thumbnailBase64));
-    windowObj.Set("icon", String::New(env, iconBase64));
-        
-        result.Set(i, windowObj);
+    g_memoryThresholds.Clear();
+    for (const auto& l : limits) g_memoryThresholds.SetLimit(l.first, l.second);
+    return env.Undefined();
+}
+
+// getConfig(): the current runtime configuration, in configure()'s shape
+static Object RuntimeConfigToObject(Env env, const dwm::RuntimeConfig& c) {
+    Array methods = Array::New(env);
+    for (int i = 0; i < dwm::kCaptureMethodCount; ++i) {
+        if (c.captureMethods & (1u << i)) methods.Set(methods.Length(), String::New(env, dwm::kCaptureMethodNames[i]));
     }
-    
-    return result;
+    Object size = Object::New(env);
+    size.Set("width", Number::New(env, c.defaultWidth));
+    size.Set("height", Number::New(env, c.defaultHeight));
+    Object codec = Object::New(env);
+    codec.Set("encoder", String::New(env, c.builtinPng ? "builtin" : "gdiplus"));
+    codec.Set("pngLevel", Number::New(env, c.pngLevel));
+    codec.Set("palette", Boolean::New(env, c.pngPalette));
+    codec.Set("dither", Boolean::New(env, c.pngDither));
+    codec.Set("threads", Number::New(env, (double)c.pngThreads));
+    codec.Set("parallelMinBytes", Number::New(env, (double)c.parallelPngBytes));
+    Object threads = Object::New(env);
+    threads.Set("capture", Number::New(env, (double)c.captureThreads));
+    threads.Set("scale", Number::New(env, (double)c.scaleThreads));
+    threads.Set("encode", Number::New(env, (double)c.encodeThreads));
+    Object budgets = Object::New(env);
+    budgets.Set("enumerationMs", Number::New(env, c.enumerationBudgetMs));
+    budgets.Set("captureQueue", Number::New(env, (double)c.captureQueueCapacity));
+    budgets.Set("stageQueue", Number::New(env, (double)c.stageQueueCapacity));
+    budgets.Set("stageQueueBytes", Number::New(env, (double)c.stageQueueBytes));
+    Object prefetch = Object::New(env);
+    prefetch.Set("count", Number::New(env, (double)c.prefetchCount));
+    prefetch.Set("aheadMs", Number::New(env, c.prefetchAheadMs));
+    prefetch.Set("settleMs", Number::New(env, c.prefetchSettleMs));
+    prefetch.Set("idleMs", Number::New(env, c.prefetchIdleMs));
+    Object o = Object::New(env);
+    o.Set("captureMethods", methods);
+    o.Set("ttlMs", Number::New(env, c.ttlMs));
+    o.Set("defaultSize", size);
+    o.Set("codec", codec);
+    o.Set("threads", threads);
+    o.Set("budgets", budgets);
+    o.Set("prefetch", prefetch);
+    return o;
 }
 
-// Thumbnail aktualisieren
-Value UpdateThumbnail(const CallbackInfo& info) {
+Value GetConfig(const CallbackInfo& info) {
+    return RuntimeConfigToObject(info.Env(), *CurrentConfig());
+}
+
+// configure(options) merges the given fields into the current configuration
+// and swaps it in whole; on any bad field it throws and nothing changes.
+// Calls already running keep the configuration they started with.
+Value Configure(const CallbackInfo& info) {
     Env env = info.Env();
-    
-    if (info.Length() < 1 || !info[0].IsNumber()) {
-        TypeError::New(env, "Expected window ID").ThrowAsJavaScriptException();
-        return env.Null();
-    }
-    
-    uint64_t windowId = info[0].As<Number>().Int64Value();
-    HWND hwnd = (HWND)(uintptr_t)windowId;
-    if (!hwnd || !IsWindow(hwnd)) {
-        Error::New(env, "Window ID not found or invalid").ThrowAsJavaScriptException();
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        TypeError::New(env, "Expected configuration object").ThrowAsJavaScriptException();
         return env.Null();
     }
-
-    // Neuen Screenshot erstellen
-    std::string newThumbnail = CaptureWindowScreenshot(hwnd);
-    auto isGoodPng = [](const std::string& data) {
-        return data.size() > strlen("data:image/png;base64,") + 8000;
+    Object opts = info[0].As<Object>();
+    dwm::RuntimeConfig next = *CurrentConfig();
+    std::string typeError;
+    // Optional number field; integer fields take whole numbers only, ranges are ValidateRuntimeConfig's
+    auto readNumber = [&](Object obj, const char* key, const std::string& path, auto& out) {
+        using T = std::decay_t<decltype(out)>;
+        Napi::Value v = obj.Get(key);
+        if (v.IsUndefined() || !typeError.empty()) return;
+        double d = v.IsNumber() ? v.As<Number>().DoubleValue() : NAN;
+        if (std::is_integral<T>::value ? !(d >= 0 && d <= 1e9 && d == std::floor(d)) : !std::isfinite(d)) {
+            typeError = path + (std::is_integral<T>::value ? " must be a non-negative integer" : " must be a number");
+            return;
+        }
+        out = (T)d;
     };
-    // Cache aktualisieren
-    RECT rect;
-    if (GetWindowRect(hwnd, &rect)) {
-        std::lock_guard<std::mutex> lock(g_cacheMutex);
-        // Avoid overwriting good cache with tiny minimized captures
-        if (!(IsIconic(hwnd) && !isGoodPng(newThumbnail))) {
-            g_thumbCache[hwnd] = ThumbCacheEntry{ newThumbnail, rect, GetTickCount64(), 200, 150 };
+    auto readBool = [&](Object obj, const char* key, const std::string& path, bool& out) {
+        Napi::Value v = obj.Get(key);
+        if (v.IsUndefined() || !typeError.empty()) return;
+        if (!v.IsBoolean()) {
+            typeError = path + " must be a boolean";
+            return;
+        }
+        out = v.As<Boolean>().Value();
+    };
+    auto readGroup = [&](const char* key) {
+        Napi::Value v = opts.Get(key);
+        if (v.IsUndefined() || !typeError.empty()) return Object();
+        if (!v.IsObject()) {
+            typeError = std::string(key) + " must be an object";
+            return Object();
+        }
+        return v.As<Object>();
+    };
+
+    Napi::Value methods = opts.Get("captureMethods");
+    if (!methods.IsUndefined()) {
+        if (!methods.IsArray()) typeError = "captureMethods must be an array of method names";
+        uint32_t mask = 0;
+        Array arr = methods.IsArray() ? methods.As<Array>() : Array::New(env);
+        for (uint32_t i = 0; i < arr.Length() && typeError.empty(); ++i) {
+            Napi::Value m = arr.Get(i);
+            std::string name = m.IsString() ? m.As<String>().Utf8Value() : std::string();
+            int index = dwm::CaptureMethodIndex(name);
+#ifndef ENABLE_WGC
+            // Built without WGC support: the method exists but can never capture
+            if (index >= 0 && (1u << index) == dwm::kWgcCaptureMethod) index = -1;
+#endif
+            if (index < 0) typeError = "captureMethods: unknown or unavailable method '" + name + "'";
+            else mask |= 1u << index;
         }
+        next.captureMethods = mask;
     }
-    
-    return String::New(env, newThumbnail);
+    readNumber(opts, "ttlMs", "ttlMs", next.ttlMs);
+    if (Object g = readGroup("defaultSize"); !g.IsEmpty()) {
+        readNumber(g, "width", "defaultSize.width", next.defaultWidth);
+        readNumber(g, "height", "defaultSize.height", next.defaultHeight);
+    }
+    if (Object g = readGroup("codec"); !g.IsEmpty()) {
+        Napi::Value encoder = g.Get("encoder");
+        if (!encoder.IsUndefined() && typeError.empty()) {
+            std::string name = encoder.IsString() ? encoder.As<String>().Utf8Value() : std::string();
+            if (name == "gdiplus" || name == "builtin") next.builtinPng = name == "builtin";
+            else typeError = "codec.encoder must be 'gdiplus' or 'builtin'";
+        }
+        readNumber(g, "pngLevel", "codec.pngLevel", next.pngLevel);
+        readBool(g, "palette", "codec.palette", next.pngPalette);
+        readBool(g, "dither", "codec.dither", next.pngDither);
+        readNumber(g, "threads", "codec.threads", next.pngThreads);
+        readNumber(g, "parallelMinBytes", "codec.parallelMinBytes", next.parallelPngBytes);
+    }
+    if (Object g = readGroup("threads"); !g.IsEmpty()) {
+        readNumber(g, "capture", "threads.capture", next.captureThreads);
+        readNumber(g, "scale", "threads.scale", next.scaleThreads);
+        readNumber(g, "encode", "threads.encode", next.encodeThreads);
+    }
+    if (Object g = readGroup("budgets"); !g.IsEmpty()) {
+        readNumber(g, "enumerationMs", "budgets.enumerationMs", next.enumerationBudgetMs);
+        readNumber(g, "captureQueue", "budgets.captureQueue", next.captureQueueCapacity);
+        readNumber(g, "stageQueue", "budgets.stageQueue", next.stageQueueCapacity);
+        readNumber(g, "stageQueueBytes", "budgets.stageQueueBytes", next.stageQueueBytes);
+    }
+    if (Object g = readGroup("prefetch"); !g.IsEmpty()) {
+        readNumber(g, "count", "prefetch.count", next.prefetchCount);
+        readNumber(g, "aheadMs", "prefetch.aheadMs", next.prefetchAheadMs);
+        readNumber(g, "settleMs", "prefetch.settleMs", next.prefetchSettleMs);
+        readNumber(g, "idleMs", "prefetch.idleMs", next.prefetchIdleMs);
+    }
+    if (!typeError.empty()) {
+        TypeError::New(env, "configure: " + typeError).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    std::string error;
+    if (!g_config.Set(next, &error)) {
+        RangeError::New(env, "configure: " + error).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    return RuntimeConfigToObject(env, next);
 }
 
-// Fenster wieder öffnen/fokussieren
-Value OpenWindow(const CallbackInfo& info) {
+// enableSharedFrames({ name?, slots?, slotBytes? }) -> { name, slots, slotBytes, bytes }:
+// creates the shared-memory frame ring (frame_ring.h) that getWindows({ sharedFrames: true })
+// writes fresh captures into. Consumers map it by name. Replaces a previous ring; frames
+// already handed out from it stay readable by consumers that mapped it.
+Value EnableSharedFrames(const CallbackInfo& info) {
     Env env = info.Env();
-    
-    if (info.Length() < 1 || !info[0].IsNumber()) {
-        TypeError::New(env, "Expected window ID").ThrowAsJavaScriptException();
+    auto config = CurrentConfig();
+    std::string name = "dwm-windows-frames-" + std::to_string(GetCurrentProcessId());
+    double slots = 32;
+    double slotBytes = (double)config->defaultWidth * config->defaultHeight * 4;
+    if (info.Length() >= 1 && info[0].IsObject()) {
+        Object opts = info[0].As<Object>();
+        if (opts.Get("name").IsString()) name = opts.Get("name").As<String>().Utf8Value();
+        if (opts.Get("slots").IsNumber()) slots = opts.Get("slots").As<Number>().DoubleValue();
+        if (opts.Get("slotBytes").IsNumber()) slotBytes = opts.Get("slotBytes").As<Number>().DoubleValue();
+    }
+    if (name.empty() || name.find_first_of("\\/") != std::string::npos) {
+        TypeError::New(env, "enableSharedFrames: name must be non-empty and contain no slashes").ThrowAsJavaScriptException();
         return env.Null();
     }
-    
-    uint64_t windowId = info[0].As<Number>().Int64Value();
-    HWND hwnd = (HWND)(uintptr_t)windowId;
-    if (!hwnd) {
-        Error::New(env, "Window ID not found or invalid").ThrowAsJavaScriptException();
+    if (!(slots >= 1 && slots <= 1024) || !(slotBytes >= 64 && slotBytes <= (64 << 20))) {
+        RangeError::New(env, "enableSharedFrames: slots must be 1-1024 and slotBytes 64 to 64 MiB").ThrowAsJavaScriptException();
         return env.Null();
     }
-    
-    if (!IsWindow(hwnd)) {
-        Error::New(env, "Window no longer exists").ThrowAsJavaScriptException();
+    // A replaced ring is released first, so its name can be reused
+    {
+        std::lock_guard<std::mutex> lock(g_sharedFramesMutex);
+        g_sharedFrames.reset();
+    }
+    auto ring = std::make_shared<SharedFrameExport>();
+    size_t bytes = dwm::FrameRingBytes((uint32_t)slots, (size_t)slotBytes);
+    std::string error;
+    if (!ring->memory.Create(name, bytes, &error) ||
+        !ring->writer.Initialize(ring->memory.Data(), ring->memory.Size(), (uint32_t)slots, (size_t)slotBytes, &error)) {
+        Error::New(env, "enableSharedFrames failed: " + error).ThrowAsJavaScriptException();
         return env.Null();
     }
-    
-    // Fenster in den Vordergrund bringen
-    if (IsIconic(hwnd)) {
-        ShowWindow(hwnd, SW_RESTORE);
+    ring->charge.Set(bytes);
+    {
+        std::lock_guard<std::mutex> lock(g_sharedFramesMutex);
+        g_sharedFrames = ring;
     }
-    
-    // Fenster aktivieren
-    SetForegroundWindow(hwnd);
-    BringWindowToTop(hwnd);
-    SetActiveWindow(hwnd);
-    
-    return Boolean::New(env, true);
+    Object o = Object::New(env);
+    o.Set("name", String::New(env, name));
+    o.Set("slots", Number::New(env, ring->writer.SlotCount()));
+    o.Set("slotBytes", Number::New(env, (double)ring->writer.SlotBytes()));
+    o.Set("bytes", Number::New(env, (double)bytes));
+    return o;
 }
 
-// ---------------------- Async Promise-based APIs ----------------------
-class PromiseWorker : public AsyncWorker {
+// disableSharedFrames(): later calls fall back to PNG thumbnails; the mapping
+// goes away once running captures are done with it
+Value DisableSharedFrames(const CallbackInfo& info) {
+    std::lock_guard<std::mutex> lock(g_sharedFramesMutex);
+    g_sharedFrames.reset();
+    return info.Env().Undefined();
+}
+
+// ---------------------- Thumbnail daemon ----------------------
+// startDaemon() makes this process the daemon (daemon_server.h): other
+// processes connect over a local socket and share its enumeration, hooks,
+// thumbnail cache and string table, so each window is captured once per TTL
+// however many clients ask. The backend runs the getWindows/updateThumbnail paths.
+class AddonDaemonBackend : public dwm::DaemonBackend {
 public:
-    explicit PromiseWorker(Napi::Env env) : AsyncWorker(env), deferred(Napi::Promise::Deferred::New(env)) {}
-    Napi::Promise GetPromise() { return deferred.Promise(); }
-protected:
-    Napi::Promise::Deferred deferred;
-    void OnError(const Napi::Error& e) override { deferred.Reject(e.Value()); }
+    void ListWindows(const dwm::DaemonListRequest& request, std::vector<dwm::DaemonWindow>& out) override {
+        WindowQuery query;
+        query.includeAllDesktops = request.includeAllDesktops;
+        query.maxWidth = std::clamp<int>(request.maxWidth, 16, 4096);
+        query.maxHeight = std::clamp<int>(request.maxHeight, 16, 4096);
+        query.orderByMru = request.orderByMru; // startDaemon turned focus tracking on
+        query.thumbnails = request.thumbnails;
+        query.icons = request.icons;
+        SweepStringTable();
+        std::vector<WindowResultEntry> results;
+        CollectWindowResults(query, results);
+        out.clear();
+        out.reserve(results.size());
+        for (WindowResultEntry& r : results) {
+            dwm::DaemonWindow w;
+            w.id = ToWindowId(r.hwnd);
+            w.title = std::move(r.title);
+            w.executablePathId = r.executablePathId;
+            w.classNameId = r.classNameId;
+            w.visible = r.isVisible;
+            w.minimized = IsIconic(r.hwnd) ? true : false;
+            if (request.thumbnails) w.thumbnail = std::move(r.thumbnail);
+            if (request.icons) w.icon = std::move(r.icon);
+            out.push_back(std::move(w));
+        }
+    }
+
+    std::string Thumbnail(dwm::WindowId window, int maxWidth, int maxHeight) override {
+        HWND hwnd = ToHwnd(window);
+        if (!IsWindow(hwnd)) return std::string();
+        dwm::RuntimeConfig config = *CurrentConfig();
+        config.defaultWidth = std::clamp(maxWidth, 16, 4096);
+        config.defaultHeight = std::clamp(maxHeight, 16, 4096);
+        std::string thumbnail = GetOrCaptureWindowThumbnail(hwnd, config);
+        CheckMemoryThresholds();
+        return thumbnail;
+    }
+
+    bool Describe(dwm::WindowId window, dwm::DaemonWindow& out) override {
+        HWND hwnd = ToHwnd(window);
+        if (!IsWindow(hwnd)) return false;
+        SweepStringTable();
+        WindowEventPayload p = MakePayload(hwnd);
+        out.id = window;
+        out.title = std::move(p.title);
+        out.executablePathId = p.exePathId;
+        out.classNameId = p.classNameId;
+        out.visible = p.isVisible;
+        out.minimized = IsIconic(hwnd) ? true : false;
+        return true;
+    }
+
+    dwm::StringTable& Strings() override { return g_stringTable; }
 };
 
-struct WindowResultEntry {
-    HWND hwnd{};
-    std::string title;
-    std::string executablePath;
-    bool isVisible{};
-    std::string thumbnail;
-    std::string icon;
+struct DaemonHost {
+    explicit DaemonHost(const dwm::DaemonServerOptions& options) : server(backend, options) {}
+    AddonDaemonBackend backend;
+    dwm::DaemonServer server;
 };
 
-class GetWindowsAsyncWorker : public PromiseWorker {
-public:
-    GetWindowsAsyncWorker(Napi::Env env, bool includeAll)
-        : PromiseWorker(env), includeAllDesktops(includeAll) {}
+static std::string DefaultDaemonPath() {
+    wchar_t temp[MAX_PATH + 1] = {};
+    DWORD n = GetTempPathW(MAX_PATH + 1, temp);
+    std::string dir = n ? dwm::Utf16ToUtf8(std::u16string_view(AsUtf16(temp), n)) : std::string();
+    return dir + "dwm-windows.sock";
+}
 
-    void Execute() override {
-        // Similar to GetWindows but performed on worker thread
-        // COM init for this thread
-        bool comInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED));
-        IUnknown* vdmUnknown = nullptr;
-        if (comInitialized) {
-            IVirtualDesktopManager* vdm = nullptr;
-            HRESULT hr = CoCreateInstance(CLSID_VirtualDesktopManager, nullptr, CLSCTX_ALL,
-                                          IID_IVirtualDesktopManager, (void**)&vdm);
-            if (SUCCEEDED(hr) && vdm) {
-                vdmUnknown = vdm;
-            }
+static std::string ReadDaemonPath(const Napi::Value& arg) {
+    if (arg.IsString()) return arg.As<String>().Utf8Value();
+    if (arg.IsObject() && arg.As<Object>().Get("path").IsString()) return arg.As<Object>().Get("path").As<String>().Utf8Value();
+    return DefaultDaemonPath();
+}
+
+// startDaemon({ path?, workers? }) -> { path, pid }: serves this process's
+// windows and events to connectDaemon() clients. Installs the window hooks
+// and tracks focus, so clients can list in MRU order from warm thumbnails.
+Value StartDaemon(const CallbackInfo& info) {
+    DWM_FIRST_CALL("startDaemon");
+    Env env = info.Env();
+    std::string path = ReadDaemonPath(info.Length() >= 1 ? info[0] : env.Undefined());
+    dwm::DaemonServerOptions options;
+    options.processId = GetCurrentProcessId();
+    if (info.Length() >= 1 && info[0].IsObject() && info[0].As<Object>().Get("workers").IsNumber()) {
+        double workers = info[0].As<Object>().Get("workers").As<Number>().DoubleValue();
+        if (!(workers >= 1 && workers <= 32)) {
+            RangeError::New(env, "startDaemon: workers must be between 1 and 32").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        options.workerThreads = (size_t)workers;
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_daemonMutex);
+        if (g_daemon) {
+            Error::New(env, "startDaemon: daemon is already running on " + g_daemon->Path()).ThrowAsJavaScriptException();
+            return env.Null();
         }
+    }
+    auto host = std::make_shared<DaemonHost>(options);
+    std::string error;
+    if (!host->server.Start(path, &error)) {
+        Error::New(env, "startDaemon failed: " + error).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_daemonMutex);
+        g_daemon = std::shared_ptr<dwm::DaemonServer>(host, &host->server);
+    }
+    EnableFocusTracking();
+    Object o = Object::New(env);
+    o.Set("path", String::New(env, path));
+    o.Set("pid", Number::New(env, (double)GetCurrentProcessId()));
+    return o;
+}
 
-        std::vector<WindowInfo> windows;
-        EnumContext ctx{ &windows, vdmUnknown, includeAllDesktops };
-        EnumWindows(EnumWindowsProc, reinterpret_cast<LPARAM>(&ctx));
+// stopDaemon(): disconnects all clients and removes the socket
+Value StopDaemon(const CallbackInfo& info) {
+    std::shared_ptr<dwm::DaemonServer> daemon;
+    {
+        std::lock_guard<std::mutex> lock(g_daemonMutex);
+        daemon.swap(g_daemon);
+    }
+    if (daemon) daemon->Stop();
+    return info.Env().Undefined();
+}
 
-        if (vdmUnknown) vdmUnknown->Release();
-        if (comInitialized) CoUninitialize();
+// Thin client side: connections to a daemon, by handle (JS thread only).
+// Requests block a worker thread, not the JS thread.
+struct DaemonConnection {
+    dwm::DaemonClient client;
+    std::mutex eventsMutex;     // one subscribe at a time; guards events and closed
+    ThreadSafeFunction events;  // the subscribed callback; released once the client no longer calls it
+    bool closed{false};
+};
+static std::unordered_map<uint32_t, std::shared_ptr<DaemonConnection>> g_daemonConnections;
+static uint32_t g_nextDaemonConnection = 1;
+
+static std::shared_ptr<DaemonConnection> FindDaemonConnection(Env env, const Napi::Value& handle) {
+    auto it = handle.IsNumber() ? g_daemonConnections.find(handle.As<Number>().Uint32Value()) : g_daemonConnections.end();
+    if (it == g_daemonConnections.end()) {
+        Error::New(env, "Unknown or closed daemon connection").ThrowAsJavaScriptException();
+        return nullptr;
+    }
+    return it->second;
+}
 
-        // Build results and capture icon/thumbnail (may be expensive)
-        for (const auto& w : windows) {
-            WindowResultEntry e;
-            e.hwnd = w.hwnd;
-            e.title = w.title;
-            e.executablePath = w.executablePath;
-            e.isVisible = w.isVisible;
-            e.icon = GetWindowIconBase64(w.hwnd, w.executablePath);
-            e.thumbnail = GetOrCaptureWindowThumbnail(w.hwnd);
-            results.push_back(std::move(e));
-        }
+static Object DaemonWindowToObject(Env env, const dwm::DaemonWindow& w, dwm::DaemonClient& client, bool images) {
+    Object o = Object::New(env);
+    o.Set("id", Number::New(env, (double)w.id));
+    o.Set("title", String::New(env, w.title));
+    o.Set("executablePath", String::New(env, client.String(w.executablePathId)));
+    o.Set("executablePathId", Number::New(env, w.executablePathId));
+    o.Set("className", String::New(env, client.String(w.classNameId)));
+    o.Set("classNameId", Number::New(env, w.classNameId));
+    o.Set("isVisible", Boolean::New(env, w.visible));
+    o.Set("hwnd", Number::New(env, (double)w.id));
+    if (images) {
+        o.Set("thumbnail", String::New(env, w.thumbnail));
+        o.Set("icon", String::New(env, w.icon));
+    }
+    return o;
+}
+
+class DaemonConnectAsyncWorker : public PromiseWorker {
+public:
+    DaemonConnectAsyncWorker(Napi::Env env, dwm::FirstCallSite& site, std::string p)
+        : PromiseWorker(env, site), path(std::move(p)), connection(std::make_shared<DaemonConnection>()) {}
+
+    void Execute() override {
+        std::string error;
+        if (!connection->client.Connect(path, &error)) SetError("connectDaemon failed: " + error);
     }
 
     void OnOK() override {
-        Napi::Env env = this->Env();
-        Array arr = Array::New(env, results.size());
-        for (size_t i = 0; i < results.size(); ++i) {
-            // Use HWND value as id
-            uint64_t id = (uint64_t)(uintptr_t)results[i].hwnd;
-            Object o = Object::New(env);
-            o.Set("id", Number::New(env, id));
-            o.Set("title", String::New(env, results[i].title));
-            o.Set("executablePath", String::New(env, results[i].executablePath));
-            o.Set("isVisible", Boolean::New(env, results[i].isVisible));
-            o.Set("hwnd", Number::New(env, (uintptr_t)results[i].hwnd));
-            o.Set("thumbnail", String::New(env, results[i].thumbnail));
-            o.Set("icon", String::New(env, results[i].icon));
-            arr.Set(i, o);
-        }
-        deferred.Resolve(arr);
+        uint32_t handle = g_nextDaemonConnection++;
+        g_daemonConnections[handle] = connection;
+        deferred.Resolve(Number::New(this->Env(), handle));
     }
 
 private:
-    bool includeAllDesktops;
-    std::vector<WindowResultEntry> results;
+    std::string path;
+    std::shared_ptr<DaemonConnection> connection;
 };
 
-class UpdateThumbnailAsyncWorker : public PromiseWorker {
+class DaemonGetWindowsAsyncWorker : public PromiseWorker {
 public:
-    UpdateThumbnailAsyncWorker(Napi::Env env, uint64_t id)
-        : PromiseWorker(env), windowId(id) {}
+    DaemonGetWindowsAsyncWorker(Napi::Env env, dwm::FirstCallSite& site, std::shared_ptr<DaemonConnection> c,
+                                const dwm::DaemonListRequest& r)
+        : PromiseWorker(env, site), connection(std::move(c)), request(r) {}
 
     void Execute() override {
-    // Interpret windowId as HWND directly
-    HWND hwndLocal = (HWND)(uintptr_t)windowId;
-        if (!hwndLocal || !IsWindow(hwndLocal)) {
-            SetError("Window ID not found or invalid");
-            return;
-        }
-        // Capture thumbnail
-        thumbnail = CaptureWindowScreenshot(hwndLocal);
-        // Update cache meta
-        RECT rect;
-        if (GetWindowRect(hwndLocal, &rect)) {
-            std::lock_guard<std::mutex> lock(g_cacheMutex);
-            g_thumbCache[hwndLocal] = ThumbCacheEntry{ thumbnail, rect, GetTickCount64(), 200, 150 };
-        }
+        std::string error;
+        if (!connection->client.ListWindows(request, windows, &error)) SetError("daemon getWindows failed: " + error);
     }
 
     void OnOK() override {
-        deferred.Resolve(String::New(this->Env(), thumbnail));
+        Napi::Env env = this->Env();
+        Array arr = Array::New(env, windows.size());
+        for (size_t i = 0; i < windows.size(); ++i) arr.Set(i, DaemonWindowToObject(env, windows[i], connection->client, true));
+        deferred.Resolve(arr);
     }
 
 private:
-    uint64_t windowId;
-    std::string thumbnail;
+    std::shared_ptr<DaemonConnection> connection;
+    dwm::DaemonListRequest request;
+    std::vector<dwm::DaemonWindow> windows;
 };
 
-class OpenWindowAsyncWorker : public PromiseWorker {
+class DaemonThumbnailAsyncWorker : public PromiseWorker {
 public:
-    OpenWindowAsyncWorker(Napi::Env env, uint64_t id)
-        : PromiseWorker(env), windowId(id) {}
+    DaemonThumbnailAsyncWorker(Napi::Env env, dwm::FirstCallSite& site, std::shared_ptr<DaemonConnection> c,
+                               uint64_t id, uint16_t w, uint16_t h)
+        : PromiseWorker(env, site), connection(std::move(c)), windowId(id), width(w), height(h) {}
 
     void Execute() override {
-    HWND hwndLocal = (HWND)(uintptr_t)windowId;
-        if (!hwndLocal || !IsWindow(hwndLocal)) {
-            SetError("Window ID not found or invalid");
-            return;
-        }
-        if (IsIconic(hwndLocal)) {
-            ShowWindow(hwndLocal, SW_RESTORE);
-        }
-        SetForegroundWindow(hwndLocal);
-        BringWindowToTop(hwndLocal);
-        SetActiveWindow(hwndLocal);
-        success = true;
+        std::string error;
+        if (!connection->client.Thumbnail(windowId, width, height, thumbnail, &error)) SetError("daemon updateThumbnail failed: " + error);
     }
 
-    void OnOK() override { deferred.Resolve(Boolean::New(this->Env(), success)); }
+    void OnOK() override { deferred.Resolve(String::New(this->Env(), thumbnail)); }
 
 private:
+    std::shared_ptr<DaemonConnection> connection;
     uint64_t windowId;
-    bool success{false};
+    uint16_t width, height;
+    std::string thumbnail;
 };
 
-Value GetWindowsAsync(const CallbackInfo& info) {
+// { width?, height? } -> size within the configured limits, default size otherwise
+static void ReadDaemonSize(const Napi::Value& arg, uint16_t& width, uint16_t& height) {
+    auto config = CurrentConfig();
+    width = (uint16_t)config->defaultWidth;
+    height = (uint16_t)config->defaultHeight;
+    if (!arg.IsObject()) return;
+    Object opts = arg.As<Object>();
+    if (opts.Get("width").IsNumber()) width = (uint16_t)std::clamp(opts.Get("width").As<Number>().Int32Value(), 16, 4096);
+    if (opts.Get("height").IsNumber()) height = (uint16_t)std::clamp(opts.Get("height").As<Number>().Int32Value(), 16, 4096);
+}
+
+// daemonConnect(path?) -> Promise<handle>
+Value DaemonConnect(const CallbackInfo& info) {
     Env env = info.Env();
-    bool includeAllDesktops = false;
-    if (info.Length() >= 1) {
-        if (info[0].IsBoolean()) includeAllDesktops = info[0].As<Boolean>().Value();
-        else if (info[0].IsObject()) {
-            Object opts = info[0].As<Object>();
-            if (opts.Has("includeAllDesktops") && opts.Get("includeAllDesktops").IsBoolean()) {
-                includeAllDesktops = opts.Get("includeAllDesktops").As<Boolean>().Value();
-            }
-        }
-    }
-    auto* worker = new GetWindowsAsyncWorker(env, includeAllDesktops);
+    static dwm::FirstCallSite site("connectDaemon");
+    auto* worker = new DaemonConnectAsyncWorker(env, site, ReadDaemonPath(info.Length() >= 1 ? info[0] : env.Undefined()));
     Promise promise = worker->GetPromise();
     worker->Queue();
     return promise;
 }
 
-Value UpdateThumbnailAsync(const CallbackInfo& info) {
+// daemonGetWindows(handle, { includeAllDesktops?, width?, height?, orderBy? }) -> Promise<WindowInfo[]>
+Value DaemonGetWindows(const CallbackInfo& info) {
     Env env = info.Env();
-    if (info.Length() < 1 || !info[0].IsNumber()) {
-        TypeError::New(env, "Expected window ID").ThrowAsJavaScriptException();
-        return env.Null();
-    }
-    uint64_t id = info[0].As<Number>().Int64Value();
-    auto* worker = new UpdateThumbnailAsyncWorker(env, id);
+    auto connection = FindDaemonConnection(env, info[0]);
+    if (!connection) return env.Null();
+    dwm::DaemonListRequest request;
+    Napi::Value opts = info.Length() >= 2 ? info[1] : env.Undefined();
+    request.includeAllDesktops = ReadIncludeAllDesktops(opts);
+    request.orderByMru = opts.IsObject() && opts.As<Object>().Get("orderBy").IsString() &&
+                         opts.As<Object>().Get("orderBy").As<String>().Utf8Value() == "mru";
+    ReadDaemonSize(opts, request.maxWidth, request.maxHeight);
+    static dwm::FirstCallSite site("daemonGetWindows");
+    auto* worker = new DaemonGetWindowsAsyncWorker(env, site, connection, request);
     Promise promise = worker->GetPromise();
     worker->Queue();
     return promise;
 }
 
-Value OpenWindowAsync(const CallbackInfo& info) {
+// daemonUpdateThumbnail(handle, id, { width?, height? }) -> Promise<string>
+Value DaemonUpdateThumbnail(const CallbackInfo& info) {
     Env env = info.Env();
-    if (info.Length() < 1 || !info[0].IsNumber()) {
+    auto connection = FindDaemonConnection(env, info[0]);
+    if (!connection) return env.Null();
+    if (info.Length() < 2 || !info[1].IsNumber()) {
         TypeError::New(env, "Expected window ID").ThrowAsJavaScriptException();
         return env.Null();
     }
-    uint64_t id = info[0].As<Number>().Int64Value();
-    auto* worker = new OpenWindowAsyncWorker(env, id);
+    uint16_t width, height;
+    ReadDaemonSize(info.Length() >= 3 ? info[2] : env.Undefined(), width, height);
+    static dwm::FirstCallSite site("daemonUpdateThumbnail");
+    auto* worker = new DaemonThumbnailAsyncWorker(env, site, connection,
+                                                  (uint64_t)info[1].As<Number>().Int64Value(), width, height);
     Promise promise = worker->GetPromise();
     worker->Queue();
     return promise;
 }
 
-Object Init(Env env, Object exports) {
-    if (!g_gdiplusToken) {
-        Gdiplus::GdiplusStartupInput si;
-        if (Gdiplus::GdiplusStartup(&g_gdiplusToken, &si, nullptr) == Gdiplus::Ok) {
-            napi_env ne = env;
-            napi_add_env_cleanup_hook(ne, GdiplusCleanup, nullptr);
+struct DaemonEventPayload {
+    dwm::WindowEventType type;
+    dwm::DaemonWindow window;
+    std::u16string executablePath, className;
+    uint32_t dropped;
+};
+
+static dwm::DaemonClient::EventCallback DaemonEventCallback(ThreadSafeFunction tsfn, dwm::DaemonClient* client) {
+    // Never blocks the client's reader thread: the queue is unbounded
+    return [tsfn, client](dwm::WindowEventType type, const dwm::DaemonWindow& w, uint32_t dropped) mutable {
+        auto* payload = new DaemonEventPayload{ type, w, client->String(w.executablePathId), client->String(w.classNameId), dropped };
+        napi_status status = tsfn.NonBlockingCall(payload, [](Env env, Function cb, DaemonEventPayload* data) {
+            Object o = Object::New(env);
+            if (data->dropped) {
+                o.Set("type", String::New(env, "dropped"));
+                o.Set("count", Number::New(env, data->dropped));
+            } else {
+                o.Set("id", Number::New(env, (double)data->window.id));
+                o.Set("hwnd", Number::New(env, (double)data->window.id));
+                o.Set("title", String::New(env, data->window.title));
+                o.Set("executablePath", String::New(env, data->executablePath));
+                o.Set("executablePathId", Number::New(env, data->window.executablePathId));
+                o.Set("className", String::New(env, data->className));
+                o.Set("classNameId", Number::New(env, data->window.classNameId));
+                o.Set("isVisible", Boolean::New(env, data->window.visible));
+                o.Set("type", String::New(env, dwm::WindowEventTypeName(data->type)));
+            }
+            cb.Call({ o });
+            delete data;
+        });
+        if (status != napi_ok) delete payload;
+    };
+}
+
+// Swaps the client's callback on a worker thread. The previous function is
+// released only after Subscribe returned, i.e. once the reader can no longer
+// be calling it; a subscribe that loses the race with daemonClose releases
+// its own function instead.
+class DaemonSubscribeAsyncWorker : public PromiseWorker {
+public:
+    DaemonSubscribeAsyncWorker(Napi::Env env, dwm::FirstCallSite& site, std::shared_ptr<DaemonConnection> c, ThreadSafeFunction t)
+        : PromiseWorker(env, site), connection(std::move(c)), tsfn(std::move(t)) {}
+
+    void Execute() override {
+        std::string error;
+        ThreadSafeFunction previous;
+        {
+            std::lock_guard<std::mutex> lock(connection->eventsMutex);
+            if (connection->closed) {
+                if (tsfn) tsfn.Release();
+                SetError("daemonSubscribe failed: connection closed");
+                return;
+            }
+            bool ok = tsfn ? connection->client.Subscribe(dwm::kAllWindowEvents, DaemonEventCallback(tsfn, &connection->client), &error)
+                           : connection->client.Subscribe(0, nullptr, &error);
+            // The client holds the new callback even if the daemon did not confirm it
+            previous = connection->events;
+            connection->events = tsfn;
+            if (!ok) SetError("daemonSubscribe failed: " + error);
         }
+        if (previous) previous.Release();
     }
-#ifdef ENABLE_WGC
-    if (!g_winrtInited) {
-        WinrtInitOnce();
-        if (g_winrtInited) {
-            napi_env ne = env;
-            napi_add_env_cleanup_hook(ne, WinrtCleanup, nullptr);
-        }
+
+    void OnOK() override { deferred.Resolve(this->Env().Undefined()); }
+
+private:
+    std::shared_ptr<DaemonConnection> connection;
+    ThreadSafeFunction tsfn; // empty to unsubscribe
+};
+
+// daemonSubscribe(handle, callback | null) -> Promise<void>: the daemon's window
+// events, shaped like onWindowChange events; { type: 'dropped', count } if this
+// client fell behind
+Value DaemonSubscribe(const CallbackInfo& info) {
+    Env env = info.Env();
+    auto connection = FindDaemonConnection(env, info[0]);
+    if (!connection) return env.Null();
+    ThreadSafeFunction tsfn;
+    if (info.Length() >= 2 && info[1].IsFunction()) tsfn = ThreadSafeFunction::New(env, info[1].As<Function>(), "daemon-events", 0, 1);
+    static dwm::FirstCallSite site("daemonSubscribe");
+    auto* worker = new DaemonSubscribeAsyncWorker(env, site, connection, tsfn);
+    Promise promise = worker->GetPromise();
+    worker->Queue();
+    return promise;
+}
+
+// daemonClose(handle): in-flight requests fail, events stop
+Value DaemonClose(const CallbackInfo& info) {
+    Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber()) return env.Undefined();
+    auto it = g_daemonConnections.find(info[0].As<Number>().Uint32Value());
+    if (it == g_daemonConnections.end()) return env.Undefined();
+    std::shared_ptr<DaemonConnection> connection = std::move(it->second);
+    g_daemonConnections.erase(it);
+    connection->client.Close(); // joins the reader, so no event is delivered after this
+    ThreadSafeFunction events;
+    {
+        // A subscribe still in flight fails at once on the closed client
+        std::lock_guard<std::mutex> lock(connection->eventsMutex);
+        connection->closed = true;
+        events = connection->events;
+        connection->events = ThreadSafeFunction();
     }
-#endif
+    if (events) events.Release();
+    return env.Undefined();
+}
+
+// getStartupStats(): module load time, first-call latency per API and the
+// cost of lazily initialized subsystems, each in order of first use
+static Array StartupEntriesToArray(Env env, const std::vector<dwm::StartupEntry>& entries, bool withCount) {
+    Array arr = Array::New(env, entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        Object o = Object::New(env);
+        o.Set("name", String::New(env, entries[i].name));
+        o.Set(withCount ? "initMs" : "latencyMs", Number::New(env, entries[i].latencyMs));
+        o.Set("sinceLoadMs", Number::New(env, entries[i].sinceLoadMs));
+        if (withCount) o.Set("count", Number::New(env, (double)entries[i].count));
+        arr.Set(i, o);
+    }
+    return arr;
+}
+
+Value GetStartupStats(const CallbackInfo& info) {
+    Env env = info.Env();
+    dwm::StartupTiming& t = dwm::StartupTiming::Instance();
+    Object o = Object::New(env);
+    o.Set("loadMs", Number::New(env, t.LoadMs()));
+    o.Set("firstCalls", StartupEntriesToArray(env, t.Apis(), false));
+    o.Set("subsystems", StartupEntriesToArray(env, t.Subsystems(), true));
+    return o;
+}
+
+// getStringTable(sinceId = 0) -> { size, strings, sweeps }: the interned
+// executable paths and class names with ids sinceId..size-1, in id order; freed
+// ids are ''. Ids are stable, so a caller keeps what it has and passes its
+// current size next time, unless sweeps changed: then entries it holds were
+// freed and it refetches from 0.
+Value GetStringTable(const CallbackInfo& info) {
+    Env env = info.Env();
+    dwm::StringId since = 0;
+    if (info.Length() >= 1 && info[0].IsNumber()) since = info[0].As<Number>().Uint32Value();
+    dwm::StringId size = g_stringTable.Size();
+    if (since > size) since = size;
+    Array arr = Array::New(env, size - since);
+    for (dwm::StringId id = since; id < size; ++id) {
+        arr.Set(id - since, InternedJsString(env, id));
+    }
+    Object o = Object::New(env);
+    o.Set("size", Number::New(env, size));
+    o.Set("strings", arr);
+    o.Set("sweeps", Number::New(env, g_stringTable.Sweeps()));
+    return o;
+}
+
+// Tracing: startTracing(path) begins writing a Chrome/Perfetto trace-event JSON file;
+// stopTracing() flushes and closes it and returns { events, dropped }.
+Value StartTracing(const CallbackInfo& info) {
+    Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) {
+        TypeError::New(env, "Expected trace file path").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    std::string error;
+    if (!dwm::TraceWriter::Instance().Start(info[0].As<String>().Utf8Value(), &error)) {
+        Error::New(env, "startTracing failed: " + error).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    dwm::TraceWriter::Instance().NameCurrentThread("JS main");
+    return Boolean::New(env, true);
+}
+
+Value StopTracing(const CallbackInfo& info) {
+    Env env = info.Env();
+    uint64_t dropped = dwm::TraceWriter::Instance().Dropped();
+    uint64_t events = dwm::TraceWriter::Instance().Stop();
+    Object o = Object::New(env);
+    o.Set("events", Number::New(env, (double)events));
+    o.Set("dropped", Number::New(env, (double)dropped));
+    return o;
+}
+
+// Nothing here initializes a subsystem; see startup_timing.h
+Object Init(Env env, Object exports) {
+    // Registered first so it runs last, after the hooks that stop encoding threads
+    napi_add_env_cleanup_hook((napi_env)env, GdiplusCleanup, nullptr);
+    // Stop deadline-abandoned pipeline runs before the module goes away
+    napi_add_env_cleanup_hook((napi_env)env, [](void*) { ShutdownBackgroundPipelines(); }, nullptr);
+    // Close capture streams nobody closed; stuck capture threads get the same grace
+    napi_add_env_cleanup_hook((napi_env)env, [](void*) { ShutdownCaptureStreams(); }, nullptr);
+    // Hedge attempts still running get the same grace; stuck ones are detached
+    napi_add_env_cleanup_hook((napi_env)env, [](void*) { g_hedgeExecutor.Shutdown(kBackgroundShutdownGrace); }, nullptr);
+    // Close an active trace file so it stays valid JSON
+    napi_add_env_cleanup_hook((napi_env)env, [](void*) { dwm::TraceWriter::Instance().Stop(); }, nullptr);
+    // Interned JS strings are references into this env
+    napi_add_env_cleanup_hook((napi_env)env, [](void*) { g_internedJsStrings.clear(); }, nullptr);
+    // Release the shared frame mapping with the module (and its POSIX name)
+    napi_add_env_cleanup_hook((napi_env)env, [](void*) {
+        std::lock_guard<std::mutex> lock(g_sharedFramesMutex);
+        g_sharedFrames.reset();
+    }, nullptr);
+    // Disconnect daemon clients and stop serving, which removes the socket
+    napi_add_env_cleanup_hook((napi_env)env, [](void*) {
+        for (auto& [handle, connection] : g_daemonConnections) connection->client.Close();
+        g_daemonConnections.clear();
+        std::shared_ptr<dwm::DaemonServer> daemon;
+        {
+            std::lock_guard<std::mutex> lock(g_daemonMutex);
+            daemon.swap(g_daemon);
+        }
+        if (daemon) daemon->Stop();
+    }, nullptr);
+    // Stop the prefetch thread before the caches it writes go away; a stuck one is detached
+    napi_add_env_cleanup_hook((napi_env)env, [](void*) { DisableFocusTracking(); }, nullptr);
     exports.Set("getWindows", Function::New(env, GetWindows));
     exports.Set("updateThumbnail", Function::New(env, UpdateThumbnail));
     exports.Set("openWindow", Function::New(env, OpenWindow));
     // Async variants (Promise-based)
     exports.Set("getWindowsAsync", Function::New(env, GetWindowsAsync));
     exports.Set("updateThumbnailAsync", Function::New(env, UpdateThumbnailAsync));
+    exports.Set("updateThumbnailProgressive", Function::New(env, UpdateThumbnailProgressive));
     exports.Set("openWindowAsync", Function::New(env, OpenWindowAsync));
+    exports.Set("captureToFile", Function::New(env, CaptureToFile));
+    exports.Set("captureStreamOpen", Function::New(env, CaptureStreamOpen));
+    exports.Set("captureStreamRead", Function::New(env, CaptureStreamRead));
+    exports.Set("captureStreamClose", Function::New(env, CaptureStreamClose));
+    exports.Set("getCaptureStats", Function::New(env, GetCaptureStats));
+    exports.Set("getMemoryStats", Function::New(env, GetMemoryStats));
+    exports.Set("setMemoryThresholds", Function::New(env, SetMemoryThresholds));
+    exports.Set("configure", Function::New(env, Configure));
+    exports.Set("getConfig", Function::New(env, GetConfig));
+    exports.Set("enableSharedFrames", Function::New(env, EnableSharedFrames));
+    exports.Set("disableSharedFrames", Function::New(env, DisableSharedFrames));
+    exports.Set("getStringTable", Function::New(env, GetStringTable));
+    exports.Set("startDaemon", Function::New(env, StartDaemon));
+    exports.Set("stopDaemon", Function::New(env, StopDaemon));
+    exports.Set("daemonConnect", Function::New(env, DaemonConnect));
+    exports.Set("daemonGetWindows", Function::New(env, DaemonGetWindows));
+    exports.Set("daemonUpdateThumbnail", Function::New(env, DaemonUpdateThumbnail));
+    exports.Set("daemonSubscribe", Function::New(env, DaemonSubscribe));
+    exports.Set("daemonClose", Function::New(env, DaemonClose));
+    exports.Set("getStartupStats", Function::New(env, GetStartupStats));
+    exports.Set("startTracing", Function::New(env, StartTracing));
+    exports.Set("stopTracing", Function::New(env, StopTracing));
+    // Chunked sync enumeration (time-budgeted)
+    exports.Set("beginEnumeration", Function::New(env, BeginEnumeration));
+    exports.Set("nextEnumeration", Function::New(env, NextEnumeration));
+    exports.Set("endEnumeration", Function::New(env, EndEnumeration));
 
     // Event registration: onWindowCreated/onWindowClosed/onWindowFocused
     exports.Set("onWindowCreated", Function::New(env, [](const CallbackInfo& info){
+        DWM_FIRST_CALL("onWindowCreated");
         Env e = info.Env();
         if (info.Length() < 1 || !info[0].IsFunction()) {
             TypeError::New(e, "Expected callback function").ThrowAsJavaScriptException();
@@ -2266,6 +4770,7 @@ Object Init(Env env, Object exports) {
     }));
 
     exports.Set("onWindowClosed", Function::New(env, [](const CallbackInfo& info){
+        DWM_FIRST_CALL("onWindowClosed");
         Env e = info.Env();
         if (info.Length() < 1 || !info[0].IsFunction()) {
             TypeError::New(e, "Expected callback function").ThrowAsJavaScriptException();
@@ -2281,6 +4786,7 @@ Object Init(Env env, Object exports) {
     }));
 
     exports.Set("onWindowFocused", Function::New(env, [](const CallbackInfo& info){
+        DWM_FIRST_CALL("onWindowFocused");
         Env e = info.Env();
         if (info.Length() < 1 || !info[0].IsFunction()) {
             TypeError::New(e, "Expected callback function").ThrowAsJavaScriptException();
@@ -2297,6 +4803,7 @@ Object Init(Env env, Object exports) {
 
     // Minimized/Restored events
     exports.Set("onWindowMinimized", Function::New(env, [](const CallbackInfo& info){
+        DWM_FIRST_CALL("onWindowMinimized");
         Env e = info.Env();
         if (info.Length() < 1 || !info[0].IsFunction()) {
             TypeError::New(e, "Expected callback function").ThrowAsJavaScriptException();
@@ -2312,6 +4819,7 @@ Object Init(Env env, Object exports) {
     }));
 
     exports.Set("onWindowRestored", Function::New(env, [](const CallbackInfo& info){
+        DWM_FIRST_CALL("onWindowRestored");
         Env e = info.Env();
         if (info.Length() < 1 || !info[0].IsFunction()) {
             TypeError::New(e, "Expected callback function").ThrowAsJavaScriptException();
@@ -2328,6 +4836,7 @@ Object Init(Env env, Object exports) {
 
     // Unified: onWindowChange
     exports.Set("onWindowChange", Function::New(env, [](const CallbackInfo& info){
+        DWM_FIRST_CALL("onWindowChange");
         Env e = info.Env();
         if (info.Length() < 1 || !info[0].IsFunction()) {
             TypeError::New(e, "Expected callback function").ThrowAsJavaScriptException();
@@ -2342,9 +4851,30 @@ Object Init(Env env, Object exports) {
         EnsureHooksInstalled();
     }));
 
+    // Memory warnings: callback({ metric, value, threshold }) when a threshold is reached; null unsubscribes
+    exports.Set("onMemoryWarning", Function::New(env, [](const CallbackInfo& info){
+        Env e = info.Env();
+        if (info.Length() < 1 || (!info[0].IsFunction() && !info[0].IsNull())) {
+            TypeError::New(e, "Expected callback function").ThrowAsJavaScriptException();
+            return;
+        }
+        if (g_tsfnMemoryWarning) { g_tsfnMemoryWarning.Release(); g_tsfnMemoryWarning = ThreadSafeFunction(); }
+        if (info[0].IsFunction()) {
+            g_tsfnMemoryWarning = ThreadSafeFunction::New(e, info[0].As<Function>(), "memory-warning", 0, 1);
+            // Don't keep the event loop alive just for warnings
+            g_tsfnMemoryWarning.Unref(e);
+        }
+    }));
+
     exports.Set("stopWindowEvents", Function::New(env, [](const CallbackInfo& info){
         (void)info;
-        UninstallHooks();
+        // A running daemon keeps the hooks for its subscribers, focus tracking for the MRU order
+        bool daemonRunning;
+        {
+            std::lock_guard<std::mutex> lock(g_daemonMutex);
+            daemonRunning = g_daemon != nullptr;
+        }
+        if (!daemonRunning && !g_focusTracking.load()) UninstallHooks();
         if (g_tsfnCreated) { g_tsfnCreated.Release(); g_tsfnCreated = ThreadSafeFunction(); }
         if (g_tsfnClosed) { g_tsfnClosed.Release(); g_tsfnClosed = ThreadSafeFunction(); }
         if (g_tsfnFocused) { g_tsfnFocused.Release(); g_tsfnFocused = ThreadSafeFunction(); }
@@ -2355,7 +4885,8 @@ Object Init(Env env, Object exports) {
     exports.Set("isUsingFallbackEvents", Function::New(env, [](const CallbackInfo& info){
         (void)info; return Boolean::New(info.Env(), g_usingFallbackEvents.load());
     }));
+    dwm::StartupTiming::Instance().MarkLoaded();
     return exports;
 }
 
-NODE_API_MODULE(dwm_windows, Init)
\ No newline at end of file
+NODE_API_MODULE(dwm_windows, Init)
\ No newline at end of file
@@ -0,0 +1,59 @@
+// Scratch memory for one window enumeration. Every top-level window gets its
+// attributes read (title, class, exe path, child title) and most of them are
+// rejected by the Alt-Tab rules a few microseconds later; those strings come
+// from a per-call monotonic arena instead of the general heap, and are all
+// released together when the call returns. Only what is returned to the
+// caller (listed titles/paths, thumbnails, icons) is heap-allocated.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+namespace dwm {
+
+class EnumerationArena {
+public:
+    // Covers the attributes of ~50 windows before the first upstream block;
+    // the arena then grows geometrically, so a 500-window desktop costs a
+    // handful of upstream allocations.
+    static constexpr size_t kInlineBytes = 8 * 1024;
+
+    explicit EnumerationArena(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : resource_(buffer_, sizeof(buffer_), upstream) {}
+    EnumerationArena(const EnumerationArena&) = delete;
+    EnumerationArena& operator=(const EnumerationArena&) = delete;
+
+    std::pmr::memory_resource* Resource() { return &resource_; }
+
+private:
+    alignas(std::max_align_t) unsigned char buffer_[kInlineBytes];
+    std::pmr::monotonic_buffer_resource resource_;
+};
+
+// Forwards to upstream and counts what reaches it, e.g. to see how many heap
+// allocations an arena still makes.
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) : upstream_(upstream) {}
+
+    uint64_t Allocations() const { return allocations_.load(std::memory_order_relaxed); }
+    uint64_t Bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        allocations_.fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_add(bytes, std::memory_order_relaxed);
+        return upstream_->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override { upstream_->deallocate(p, bytes, alignment); }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    std::pmr::memory_resource* upstream_;
+    std::atomic<uint64_t> allocations_{0};
+    std::atomic<uint64_t> bytes_{0};
+};
+
+} // namespace dwm
@@ -0,0 +1,203 @@
+// Most-recently-used focus history per virtual desktop, fed by foreground
+// events, and the policy that decides which of the top MRU windows to
+// re-capture in the background so an Alt-Tab style switcher opens on a warm
+// thumbnail cache. A window belongs to the desktop it was last focused on;
+// the desktop of the latest focus is the one the user is on. Every focus also
+// gets a sequence number from one counter, so recency compares across
+// desktops (includeAllDesktops listings). Thread-safe.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "window_system.h"
+
+namespace dwm {
+
+// A virtual desktop GUID as two halves; all zero when it could not be determined
+struct DesktopId {
+    uint64_t high{0};
+    uint64_t low{0};
+    bool operator==(const DesktopId& o) const { return high == o.high && low == o.low; }
+    bool operator!=(const DesktopId& o) const { return !(*this == o); }
+    bool Known() const { return high || low; }
+};
+
+class FocusHistory {
+public:
+    // Windows beyond capacityPerDesktop fall off the end of their desktop's list
+    explicit FocusHistory(size_t capacityPerDesktop = 256) : capacity_(capacityPerDesktop ? capacityPerDesktop : 1) {}
+
+    // window became the foreground window on desktop: front of that desktop's
+    // list, out of any other. An unknown desktop does not change the current one.
+    void Focus(WindowId window, const DesktopId& desktop) {
+        if (!window) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = windows_.find(window);
+        if (it != windows_.end()) Unlink(window, it->second.desktop);
+        windows_[window] = Entry{ desktop, ++sequence_ };
+        std::vector<WindowId>& list = List(desktop);
+        list.insert(list.begin(), window);
+        if (list.size() > capacity_) {
+            windows_.erase(list.back());
+            list.pop_back();
+        }
+        if (desktop.Known()) current_ = desktop;
+    }
+
+    // A closed window; false if it was not in the history
+    bool Remove(WindowId window) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = windows_.find(window);
+        if (it == windows_.end()) return false;
+        Unlink(window, it->second.desktop);
+        windows_.erase(it);
+        return true;
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        windows_.clear();
+        desktops_.clear();
+        current_ = DesktopId{};
+    }
+
+    DesktopId CurrentDesktop() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return current_;
+    }
+
+    // Up to count windows of desktop, most recent first
+    std::vector<WindowId> Top(const DesktopId& desktop, size_t count) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& d : desktops_) {
+            if (d.first != desktop) continue;
+            return std::vector<WindowId>(d.second.begin(), d.second.begin() + std::min(count, d.second.size()));
+        }
+        return {};
+    }
+
+    // Focus sequence number of window (larger is more recent), 0 if not in the history
+    uint64_t LastFocus(WindowId window) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = windows_.find(window);
+        return it == windows_.end() ? 0 : it->second.sequence;
+    }
+
+    size_t Size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return windows_.size();
+    }
+
+    // Reorders items most recently focused first. Windows not in the history
+    // follow in their current relative order (EnumWindows' z-order).
+    template <typename T, typename IdOf>
+    void SortByRecency(std::vector<T>& items, IdOf idOf) const {
+        std::vector<std::pair<uint64_t, size_t>> keys(items.size());
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < items.size(); ++i) {
+                auto it = windows_.find(idOf(items[i]));
+                keys[i] = { it == windows_.end() ? 0 : it->second.sequence, i };
+            }
+        }
+        std::stable_sort(keys.begin(), keys.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+        std::vector<T> sorted;
+        sorted.reserve(items.size());
+        for (const auto& k : keys) sorted.push_back(std::move(items[k.second]));
+        items = std::move(sorted);
+    }
+
+private:
+    struct Entry {
+        DesktopId desktop;
+        uint64_t sequence{0};
+    };
+
+    std::vector<WindowId>& List(const DesktopId& desktop) {
+        for (auto& d : desktops_) {
+            if (d.first == desktop) return d.second;
+        }
+        desktops_.emplace_back(desktop, std::vector<WindowId>());
+        return desktops_.back().second;
+    }
+
+    void Unlink(WindowId window, const DesktopId& desktop) {
+        std::vector<WindowId>& list = List(desktop);
+        auto it = std::find(list.begin(), list.end(), window);
+        if (it != list.end()) list.erase(it);
+    }
+
+    mutable std::mutex mutex_;
+    size_t capacity_;
+    uint64_t sequence_{0};
+    DesktopId current_;
+    std::unordered_map<WindowId, Entry> windows_;
+    // Most recent first; a handful of desktops, so a vector of lists
+    std::vector<std::pair<DesktopId, std::vector<WindowId>>> desktops_;
+};
+
+// ---------------- Background prefetch of the top MRU thumbnails ----------------
+
+using PrefetchDuration = std::chrono::milliseconds;
+constexpr PrefetchDuration kPrefetchNever = PrefetchDuration::max();
+// Refreshes of one window are at least this far apart, whatever the TTL
+constexpr PrefetchDuration kMinPrefetchInterval{ 100 };
+
+struct PrefetchSettings {
+    size_t count{4}; // top MRU windows of the current desktop kept warm; 0 disables
+    PrefetchDuration ahead{250}; // re-capture this long before a cached thumbnail expires
+    PrefetchDuration settle{150}; // wait after a focus change, so rapid Alt-Tab cycling settles first
+    PrefetchDuration idle{30000}; // stop refreshing this long after the last focus change; 0 never stops
+};
+
+struct PrefetchCandidate {
+    WindowId window{0};
+    bool cached{false}; // a thumbnail the next request would be served from
+    PrefetchDuration age{0}; // of that thumbnail
+    bool minimized{false};
+};
+
+struct PrefetchPlan {
+    std::vector<WindowId> capture; // now, most recent first
+    PrefetchDuration wakeIn{kPrefetchNever}; // plan again after this long, or on the next focus change
+};
+
+// mru: the current desktop's top windows, most recent first. ttl is the
+// thumbnail cache lifetime; sinceFocus the time since the last focus change.
+// Minimized windows are skipped: they are served their last good thumbnail
+// whatever its age, and a capture would only see a title bar. Windows
+// captured now are assumed fresh when the plan's wake-up time is computed.
+inline PrefetchPlan PlanPrefetch(const PrefetchSettings& settings, PrefetchDuration ttl, PrefetchDuration sinceFocus,
+                                 const std::vector<PrefetchCandidate>& mru) {
+    PrefetchPlan plan;
+    if (settings.count == 0 || ttl.count() <= 0 || mru.empty()) return plan;
+    if (settings.idle.count() > 0 && sinceFocus >= settings.idle) return plan;
+    if (sinceFocus < settings.settle) {
+        plan.wakeIn = settings.settle - sinceFocus;
+        return plan;
+    }
+    PrefetchDuration refreshAt = std::max(ttl - std::min(settings.ahead, ttl / 2), kMinPrefetchInterval);
+    size_t n = std::min(settings.count, mru.size());
+    for (size_t i = 0; i < n; ++i) {
+        const PrefetchCandidate& c = mru[i];
+        if (c.minimized) continue;
+        if (!c.cached || c.age >= refreshAt) {
+            plan.capture.push_back(c.window);
+            plan.wakeIn = std::min(plan.wakeIn, refreshAt);
+        } else {
+            plan.wakeIn = std::min(plan.wakeIn, refreshAt - c.age);
+        }
+    }
+    if (settings.idle.count() > 0 && plan.wakeIn != kPrefetchNever) plan.wakeIn = std::min(plan.wakeIn, settings.idle - sinceFocus);
+    return plan;
+}
+
+} // namespace dwm
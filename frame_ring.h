@@ -0,0 +1,256 @@
+// Ring of fixed-size frame slots in shared memory (shared_memory.h), so other
+// processes (e.g. Electron renderers) read captured pixels in place instead of
+// receiving a base64 PNG over IPC. The writer copies each frame into the next
+// slot once and hands out a FrameHandle (slot id + sequence number); the handle
+// is small enough to send over any channel. A slot is reused after slotCount
+// later writes, so a handle stays readable until then.
+//
+// Each slot is a seqlock: its state is 2*sequence while published and
+// 2*sequence+1 while being written. A reader checks the state before and after
+// using the pixels (Acquire/Validate); if the writer lapped it in between the
+// data may be torn and must be dropped. Readers never block or write, so they
+// can map the ring read-only and a crashed reader cannot stall the writer.
+//
+// Layout: [FrameRingHeader][FrameSlotHeader x slotCount][slot data x slotCount],
+// each part 64-byte aligned. One writer process; readers any number.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+
+#include "image_frame.h"
+
+namespace dwm {
+
+constexpr uint32_t kFrameRingMagic = 0x464D5744; // "DWMF"
+constexpr uint32_t kFrameRingVersion = 1;
+constexpr uint32_t kFrameFormatBgra8 = 1; // image_frame.h layout, alpha ignored
+
+// Identifies one written frame; sequence 0 is never written
+struct FrameHandle {
+    uint32_t slot{0};
+    uint64_t sequence{0};
+    explicit operator bool() const { return sequence != 0; }
+};
+
+struct FrameRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t reserved;
+    uint64_t slotBytes;  // pixel capacity of one slot
+    uint64_t dataOffset; // first slot's pixels, from the start of the mapping
+    std::atomic<uint64_t> lastSequence; // most recently published frame
+    uint8_t pad[24];
+};
+
+struct FrameSlotHeader {
+    std::atomic<uint64_t> state; // 0: never written
+    std::atomic<uint64_t> windowId;
+    std::atomic<uint64_t> timestampUs;
+    std::atomic<uint32_t> width;
+    std::atomic<uint32_t> height;
+    std::atomic<uint32_t> stride;
+    std::atomic<uint32_t> format;
+    uint8_t pad[24];
+};
+
+static_assert(sizeof(FrameRingHeader) == 64 && sizeof(FrameSlotHeader) == 64, "ring layout is shared across processes");
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "ring atomics must be address-free to work across processes");
+
+// A published frame in place; pixels are only trustworthy if Validate() still
+// succeeds after they were used
+struct FrameView {
+    const uint8_t* pixels{nullptr};
+    uint32_t width{0};
+    uint32_t height{0};
+    uint32_t stride{0};
+    uint32_t format{0};
+    uint64_t windowId{0};
+    uint64_t timestampUs{0};
+};
+
+namespace frame_ring_detail {
+inline size_t Align64(size_t n) { return (n + 63) & ~(size_t)63; }
+} // namespace frame_ring_detail
+
+inline size_t FrameRingBytes(uint32_t slotCount, size_t slotBytes) {
+    using frame_ring_detail::Align64;
+    return sizeof(FrameRingHeader) + (size_t)slotCount * sizeof(FrameSlotHeader) + (size_t)slotCount * Align64(slotBytes);
+}
+
+class FrameRingWriter {
+public:
+    // Formats base[0..size) as an empty ring
+    bool Initialize(uint8_t* base, size_t size, uint32_t slotCount, size_t slotBytes, std::string* error = nullptr) {
+        if (!base || slotCount == 0 || slotBytes == 0 || FrameRingBytes(slotCount, slotBytes) > size) {
+            if (error) *error = "shared memory is too small for the ring";
+            return false;
+        }
+        auto* header = new (base) FrameRingHeader{};
+        header->magic = kFrameRingMagic;
+        header->version = kFrameRingVersion;
+        header->slotCount = slotCount;
+        header->slotBytes = slotBytes;
+        header->dataOffset = sizeof(FrameRingHeader) + (size_t)slotCount * sizeof(FrameSlotHeader);
+        header->lastSequence.store(0, std::memory_order_relaxed);
+        slots_ = reinterpret_cast<FrameSlotHeader*>(base + sizeof(FrameRingHeader));
+        for (uint32_t i = 0; i < slotCount; ++i) new (&slots_[i]) FrameSlotHeader{};
+        base_ = base;
+        header_ = header;
+        next_ = 1;
+        return true;
+    }
+
+    // Copies the frame into the next slot; an empty handle if it does not fit
+    FrameHandle Write(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t stride,
+                      uint64_t windowId, uint64_t timestampUs) {
+        size_t rowBytes = (size_t)width * 4;
+        if (!header_ || !pixels || width == 0 || height == 0 || stride < rowBytes ||
+            rowBytes * height > header_->slotBytes) {
+            return {};
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t sequence = next_++;
+        uint32_t slot = (uint32_t)((sequence - 1) % header_->slotCount);
+        FrameSlotHeader& s = slots_[slot];
+        s.state.store(sequence * 2 + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.windowId.store(windowId, std::memory_order_relaxed);
+        s.timestampUs.store(timestampUs, std::memory_order_relaxed);
+        s.width.store(width, std::memory_order_relaxed);
+        s.height.store(height, std::memory_order_relaxed);
+        s.stride.store((uint32_t)rowBytes, std::memory_order_relaxed);
+        s.format.store(kFrameFormatBgra8, std::memory_order_relaxed);
+        uint8_t* dst = SlotData(slot);
+        if (stride == rowBytes) {
+            std::memcpy(dst, pixels, rowBytes * height);
+        } else {
+            for (uint32_t y = 0; y < height; ++y) std::memcpy(dst + y * rowBytes, pixels + (size_t)y * stride, rowBytes);
+        }
+        s.state.store(sequence * 2, std::memory_order_release);
+        header_->lastSequence.store(sequence, std::memory_order_release);
+        return FrameHandle{ slot, sequence };
+    }
+
+    FrameHandle Write(const Frame& frame, uint64_t windowId, uint64_t timestampUs) {
+        if (frame.Empty()) return {};
+        return Write(frame.pixels.data(), (uint32_t)frame.width, (uint32_t)frame.height, (uint32_t)frame.Stride(),
+                     windowId, timestampUs);
+    }
+
+    uint32_t SlotCount() const { return header_ ? header_->slotCount : 0; }
+    size_t SlotBytes() const { return header_ ? (size_t)header_->slotBytes : 0; }
+
+private:
+    uint8_t* SlotData(uint32_t slot) const {
+        return base_ + header_->dataOffset + (size_t)slot * frame_ring_detail::Align64(header_->slotBytes);
+    }
+
+    std::mutex mutex_; // writer threads of the one writer process
+    uint8_t* base_{nullptr};
+    FrameRingHeader* header_{nullptr};
+    FrameSlotHeader* slots_{nullptr};
+    uint64_t next_{1};
+};
+
+// The consumer side: attach to a mapped ring (read-only is enough) and read
+// frames by handle
+class FrameRingReader {
+public:
+    // Checks the header against the mapping; false for anything that is not a
+    // ring of this version or does not fit in size
+    bool Attach(const uint8_t* base, size_t size, std::string* error = nullptr) {
+        header_ = nullptr;
+        const auto* header = reinterpret_cast<const FrameRingHeader*>(base);
+        const char* problem = nullptr;
+        if (!base || size < sizeof(FrameRingHeader)) problem = "mapping is too small";
+        else if (header->magic != kFrameRingMagic) problem = "not a frame ring";
+        else if (header->version != kFrameRingVersion) problem = "unsupported frame ring version";
+        else if (header->slotCount == 0 || header->slotCount > size / sizeof(FrameSlotHeader) ||
+                 header->slotBytes == 0 || header->slotBytes > size ||
+                 header->dataOffset != sizeof(FrameRingHeader) + (size_t)header->slotCount * sizeof(FrameSlotHeader) ||
+                 FrameRingBytes(header->slotCount, (size_t)header->slotBytes) > size) {
+            problem = "frame ring header does not match the mapping";
+        }
+        if (problem) {
+            if (error) *error = problem;
+            return false;
+        }
+        base_ = base;
+        header_ = header;
+        slots_ = reinterpret_cast<const FrameSlotHeader*>(base + sizeof(FrameRingHeader));
+        return true;
+    }
+
+    // The published frame for handle, in place. False if the slot has moved on
+    // (or the handle was never written); check Validate() after using the view.
+    bool Acquire(FrameHandle handle, FrameView& out) const {
+        if (!InRange(handle)) return false;
+        const FrameSlotHeader& s = slots_[handle.slot];
+        if (s.state.load(std::memory_order_acquire) != handle.sequence * 2) return false;
+        out.width = s.width.load(std::memory_order_relaxed);
+        out.height = s.height.load(std::memory_order_relaxed);
+        out.stride = s.stride.load(std::memory_order_relaxed);
+        out.format = s.format.load(std::memory_order_relaxed);
+        out.windowId = s.windowId.load(std::memory_order_relaxed);
+        out.timestampUs = s.timestampUs.load(std::memory_order_relaxed);
+        out.pixels = base_ + header_->dataOffset + (size_t)handle.slot * frame_ring_detail::Align64(header_->slotBytes);
+        // A lapping writer can leave any values here; never describe more than the slot
+        if (!Validate(handle) || (uint64_t)out.stride * out.height > header_->slotBytes || out.stride < (uint64_t)out.width * 4) {
+            out = FrameView{};
+            return false;
+        }
+        return true;
+    }
+
+    // True if the slot still holds handle's frame, i.e. whatever was read from
+    // an Acquire()d view since is intact
+    bool Validate(FrameHandle handle) const {
+        if (!InRange(handle)) return false;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slots_[handle.slot].state.load(std::memory_order_relaxed) == handle.sequence * 2;
+    }
+
+    // Acquire + copy + Validate: a private, consistent copy or false
+    bool Copy(FrameHandle handle, Frame& out) const {
+        FrameView view;
+        if (!Acquire(handle, view)) return false;
+        out.width = (int)view.width;
+        out.height = (int)view.height;
+        out.pixels.assign(view.pixels, view.pixels + (size_t)view.stride * view.height);
+        if (Validate(handle)) return true;
+        out.Clear();
+        return false;
+    }
+
+    // The most recently published frame (empty before the first write)
+    FrameHandle Latest() const {
+        if (!header_) return {};
+        uint64_t sequence = header_->lastSequence.load(std::memory_order_acquire);
+        if (sequence == 0) return {};
+        return FrameHandle{ (uint32_t)((sequence - 1) % header_->slotCount), sequence };
+    }
+
+    uint32_t SlotCount() const { return header_ ? header_->slotCount : 0; }
+
+private:
+    bool InRange(FrameHandle handle) const {
+        return header_ && handle.sequence != 0 && handle.slot == (handle.sequence - 1) % header_->slotCount;
+    }
+
+    const uint8_t* base_{nullptr};
+    const FrameRingHeader* header_{nullptr};
+    const FrameSlotHeader* slots_{nullptr};
+};
+
+} // namespace dwm
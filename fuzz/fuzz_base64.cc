@@ -0,0 +1,36 @@
+// base64.h: output length, alphabet/padding, and decode(encode(x)) == x, for
+// both Base64Encode and the data-URL form.
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../base64.h"
+#include "fuzz_common.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string encoded = dwm::Base64Encode(data, size);
+    FUZZ_CHECK(encoded.size() == dwm::Base64EncodedSize(size));
+    size_t padding = (3 - size % 3) % 3;
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        char c = encoded[i];
+        bool alphabet = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '+' || c == '/';
+        FUZZ_CHECK(i + padding >= encoded.size() ? c == '=' : alphabet);
+    }
+
+    std::vector<uint8_t> decoded;
+    FUZZ_CHECK(fuzz::ReferenceBase64Decode(encoded, decoded));
+    FUZZ_CHECK(decoded.size() == size);
+    FUZZ_CHECK(size == 0 || std::memcmp(decoded.data(), data, size) == 0);
+
+    static const char kPrefix[] = "data:image/png;base64,";
+    std::string url = dwm::Base64DataUrl("image/png", data, size);
+    FUZZ_CHECK(url.compare(0, sizeof(kPrefix) - 1, kPrefix) == 0);
+    FUZZ_CHECK(url.compare(sizeof(kPrefix) - 1, std::string::npos, encoded) == 0);
+
+    // Appending keeps what is already there
+    std::string appended = "xyz";
+    dwm::Base64EncodeAppend(data, size, appended);
+    FUZZ_CHECK(appended == "xyz" + encoded);
+    return 0;
+}
@@ -0,0 +1,78 @@
+// Shared helpers for the fuzz harnesses: a byte reader over the fuzzer input,
+// a check macro that aborts (so libFuzzer and the standalone driver both
+// report the input), and independent reference decoders for the round-trip
+// properties. Reference code favours obviousness over speed.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#define FUZZ_CHECK(cond)                                                              \
+    do {                                                                              \
+        if (!(cond)) {                                                                \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::abort();                                                             \
+        }                                                                             \
+    } while (0)
+
+namespace fuzz {
+
+// Consumes the input front to back; reads past the end yield zeros.
+class Reader {
+public:
+    Reader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    uint8_t Byte() { return pos_ < size_ ? data_[pos_++] : 0; }
+    uint16_t U16() { uint16_t hi = Byte(); return (uint16_t)((hi << 8) | Byte()); }
+    bool Bool() { return (Byte() & 1) != 0; }
+    // Up to max bytes (fewer if the input runs out)
+    std::string String(size_t max) {
+        size_t n = std::min<size_t>(Byte() % (max + 1), Remaining());
+        std::string s((const char*)data_ + pos_, n);
+        pos_ += n;
+        return s;
+    }
+    const uint8_t* Rest() const { return data_ + pos_; }
+    size_t Remaining() const { return size_ - pos_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_{0};
+};
+
+// RFC 4648 decoder; false on any malformed input (bad length, alphabet or padding).
+inline bool ReferenceBase64Decode(const std::string& in, std::vector<uint8_t>& out) {
+    out.clear();
+    if (in.size() % 4) return false;
+    auto value = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+') return 62;
+        if (c == '/') return 63;
+        return -1;
+    };
+    for (size_t i = 0; i < in.size(); i += 4) {
+        bool last = i + 4 == in.size();
+        int pad = 0;
+        if (last && in[i + 3] == '=') pad = (in[i + 2] == '=') ? 2 : 1;
+        uint32_t v = 0;
+        for (int k = 0; k < 4; ++k) {
+            int d = (k >= 4 - pad) ? 0 : value(in[i + k]);
+            if (d < 0) return false;
+            v = (v << 6) | (uint32_t)d;
+        }
+        out.push_back((uint8_t)(v >> 16));
+        if (pad < 2) out.push_back((uint8_t)(v >> 8));
+        if (pad < 1) out.push_back((uint8_t)v);
+    }
+    return true;
+}
+
+} // namespace fuzz
@@ -0,0 +1,169 @@
+// daemon_protocol.h: arbitrary bytes fed to DaemonStreamReader in arbitrary
+// pieces never read out of bounds, and every message body decoder either
+// refuses a payload or decodes one that re-encodes to the same bytes. Messages
+// built from the input round-trip exactly, however the stream is split.
+// Input: [split seed] then bytes, used both as a raw stream and as fields for
+// generated messages
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../daemon_protocol.h"
+#include "fuzz_common.h"
+
+namespace {
+
+// Strict decode of one frame's payload; if it decodes, it must re-encode identically
+void CheckPayload(const dwm::DaemonFrame& frame) {
+    std::string again;
+    switch (frame.type) {
+        case dwm::DaemonMessage::ListWindows: {
+            dwm::DaemonListRequest r;
+            if (!dwm::DecodeListRequest(frame.payload, r)) return;
+            dwm::EncodeListRequest(again, frame.requestId, r);
+            break;
+        }
+        case dwm::DaemonMessage::GetThumbnail: {
+            dwm::WindowId id;
+            uint16_t w, h;
+            if (!dwm::DecodeThumbnailRequest(frame.payload, id, w, h)) return;
+            dwm::EncodeThumbnailRequest(again, frame.requestId, id, w, h);
+            break;
+        }
+        case dwm::DaemonMessage::WindowList: {
+            dwm::StringId size;
+            std::vector<dwm::DaemonWindow> windows;
+            if (!dwm::DecodeWindowList(frame.payload, size, windows)) return;
+            dwm::EncodeWindowList(again, frame.requestId, size, windows);
+            break;
+        }
+        case dwm::DaemonMessage::Thumbnail: {
+            dwm::WindowId id;
+            std::string url;
+            if (!dwm::DecodeThumbnail(frame.payload, id, url)) return;
+            dwm::EncodeThumbnail(again, frame.requestId, id, url);
+            break;
+        }
+        case dwm::DaemonMessage::Event: {
+            if (frame.requestId != 0) return;
+            dwm::WindowEventType type;
+            dwm::DaemonWindow window;
+            if (!dwm::DecodeEvent(frame.payload, type, window)) return;
+            dwm::EncodeEvent(again, type, window);
+            break;
+        }
+        case dwm::DaemonMessage::Strings: {
+            dwm::StringId first;
+            std::vector<std::u16string> strings;
+            if (!dwm::DecodeStrings(frame.payload, first, strings)) return;
+            std::vector<std::u16string_view> views(strings.begin(), strings.end());
+            dwm::EncodeStrings(again, frame.requestId, first, views);
+            break;
+        }
+        default:
+            return;
+    }
+    FUZZ_CHECK(again.size() == frame.payload.size() + dwm::kDaemonHeaderBytes);
+    FUZZ_CHECK(std::memcmp(again.data() + dwm::kDaemonHeaderBytes, frame.payload.data(), frame.payload.size()) == 0);
+}
+
+std::u16string String16(fuzz::Reader& in) {
+    std::string bytes = in.String(24);
+    return std::u16string(bytes.begin(), bytes.end());
+}
+
+dwm::DaemonWindow MakeWindow(fuzz::Reader& in, bool images) {
+    dwm::DaemonWindow w;
+    w.id = ((uint64_t)in.U16() << 32) | in.U16();
+    w.title = String16(in);
+    w.executablePathId = in.U16();
+    w.classNameId = in.Byte();
+    w.visible = in.Bool();
+    w.minimized = in.Bool();
+    if (images) {
+        w.thumbnail = in.String(40);
+        w.icon = in.String(8);
+    }
+    return w;
+}
+
+bool SameWindow(const dwm::DaemonWindow& a, const dwm::DaemonWindow& b) {
+    return a.id == b.id && a.title == b.title && a.executablePathId == b.executablePathId &&
+           a.classNameId == b.classNameId && a.visible == b.visible && a.minimized == b.minimized &&
+           a.thumbnail == b.thumbnail && a.icon == b.icon;
+}
+
+// Feeds stream to a reader in pieces whose sizes come from seed
+std::vector<dwm::DaemonFrame> Split(const std::string& stream, uint32_t seed, bool& failed) {
+    dwm::DaemonStreamReader reader;
+    std::vector<dwm::DaemonFrame> frames;
+    dwm::DaemonFrame frame;
+    size_t pos = 0;
+    while (pos < stream.size()) {
+        seed = seed * 1103515245u + 12345u;
+        size_t n = std::min<size_t>(stream.size() - pos, 1 + (seed >> 16) % 37);
+        reader.Append(stream.data() + pos, n);
+        pos += n;
+        while (reader.Next(frame)) frames.push_back(frame);
+    }
+    failed = reader.Failed();
+    return frames;
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    fuzz::Reader in(data, size);
+    uint32_t seed = in.Byte();
+
+    // Raw stream: whatever frames come out are bounded by the input and decode strictly
+    std::string raw((const char*)in.Rest(), in.Remaining());
+    bool failed = false;
+    size_t total = 0;
+    for (const dwm::DaemonFrame& frame : Split(raw, seed, failed)) {
+        total += frame.payload.size() + dwm::kDaemonHeaderBytes;
+        CheckPayload(frame);
+    }
+    FUZZ_CHECK(total <= raw.size());
+
+    // Generated messages round-trip field for field
+    std::string stream;
+    std::vector<dwm::DaemonWindow> windows;
+    size_t count = in.Byte() % 4;
+    for (size_t i = 0; i < count; ++i) windows.push_back(MakeWindow(in, true));
+    dwm::EncodeWindowList(stream, 7, 42, windows);
+    dwm::DaemonWindow eventWindow = MakeWindow(in, false);
+    auto eventType = (dwm::WindowEventType)(in.Byte() % 5);
+    dwm::EncodeEvent(stream, eventType, eventWindow);
+    std::u16string s1 = String16(in), s2 = String16(in);
+    dwm::EncodeStrings(stream, 9, 3, { s1, s2 });
+    dwm::EncodeError(stream, 11, in.String(16));
+
+    std::vector<dwm::DaemonFrame> frames = Split(stream, seed + 1, failed);
+    FUZZ_CHECK(!failed && frames.size() == 4);
+    FUZZ_CHECK(frames[0].type == dwm::DaemonMessage::WindowList && frames[0].requestId == 7);
+    dwm::StringId tableSize = 0;
+    std::vector<dwm::DaemonWindow> decoded;
+    FUZZ_CHECK(dwm::DecodeWindowList(frames[0].payload, tableSize, decoded));
+    FUZZ_CHECK(tableSize == 42 && decoded.size() == windows.size());
+    for (size_t i = 0; i < windows.size(); ++i) FUZZ_CHECK(SameWindow(decoded[i], windows[i]));
+
+    dwm::WindowEventType type;
+    dwm::DaemonWindow window;
+    FUZZ_CHECK(frames[1].requestId == 0 && dwm::DecodeEvent(frames[1].payload, type, window));
+    FUZZ_CHECK(type == eventType && SameWindow(window, eventWindow));
+
+    dwm::StringId first = 0;
+    std::vector<std::u16string> strings;
+    FUZZ_CHECK(dwm::DecodeStrings(frames[2].payload, first, strings));
+    FUZZ_CHECK(first == 3 && strings.size() == 2 && strings[0] == s1 && strings[1] == s2);
+    FUZZ_CHECK(frames[3].type == dwm::DaemonMessage::Error && frames[3].requestId == 11);
+
+    // Truncated payloads are refused, never over-read (ASan)
+    for (size_t cut = 0; cut < frames[0].payload.size(); cut += 1 + cut / 4) {
+        std::string shortened = frames[0].payload.substr(0, cut);
+        FUZZ_CHECK(!dwm::DecodeWindowList(shortened, tableSize, decoded));
+    }
+    return 0;
+}
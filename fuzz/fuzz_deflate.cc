@@ -0,0 +1,61 @@
+// deflate.h: zlib streams from ZlibCompress inflate (with zlib) back to the
+// input at every level, and Adler-32/CRC-32 match zlib's, also when computed
+// incrementally over an input-chosen split or combined (Adler32Combine).
+// parallel_deflate.h: the stream stitched from chunks deflated on several
+// threads (chunk size and thread count from the split) inflates the same.
+// Input: [level][split hi][split lo] payload...
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <zlib.h>
+
+#include "../deflate.h"
+#include "../parallel_deflate.h"
+#include "fuzz_common.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    fuzz::Reader in(data, size);
+    int level = in.Byte() % 10;
+    size_t split = in.U16();
+    const uint8_t* payload = in.Rest();
+    size_t len = in.Remaining();
+    if (split > len) split = len;
+
+    std::vector<uint8_t> compressed;
+    dwm::ZlibCompress(payload, len, level, compressed);
+    FUZZ_CHECK(compressed.size() >= 6);
+    // Header: CM 8, 32K window, FCHECK valid
+    FUZZ_CHECK((compressed[0] & 0x0f) == 8);
+    FUZZ_CHECK(((compressed[0] << 8) | compressed[1]) % 31 == 0);
+
+    std::vector<uint8_t> inflated(len + 1);
+    uLongf inflatedLen = (uLongf)inflated.size();
+    int rc = uncompress(inflated.data(), &inflatedLen, compressed.data(), (uLong)compressed.size());
+    FUZZ_CHECK(rc == Z_OK);
+    FUZZ_CHECK(inflatedLen == len);
+    FUZZ_CHECK(len == 0 || std::memcmp(inflated.data(), payload, len) == 0);
+
+    dwm::ParallelDeflateOptions parallel;
+    parallel.threads = 1 + split % 4;
+    parallel.minBytes = 0;
+    parallel.chunkBytes = 256 + split % 2048;
+    std::vector<uint8_t> stitched;
+    dwm::ParallelZlibCompress(payload, len, level, parallel, stitched);
+    FUZZ_CHECK(stitched[0] == compressed[0] && stitched[1] == compressed[1]);
+    if (!dwm::UseParallelDeflate(parallel, len)) FUZZ_CHECK(stitched == compressed);
+    inflatedLen = (uLongf)inflated.size();
+    rc = uncompress(inflated.data(), &inflatedLen, stitched.data(), (uLong)stitched.size());
+    FUZZ_CHECK(rc == Z_OK && inflatedLen == len);
+    FUZZ_CHECK(len == 0 || std::memcmp(inflated.data(), payload, len) == 0);
+
+    uint32_t adler = dwm::Adler32(1, payload, len);
+    FUZZ_CHECK(adler == (uint32_t)adler32(1, payload, (uInt)len));
+    FUZZ_CHECK(adler == dwm::Adler32(dwm::Adler32(1, payload, split), payload + split, len - split));
+    FUZZ_CHECK(adler == dwm::Adler32Combine(dwm::Adler32(1, payload, split), dwm::Adler32(1, payload + split, len - split), len - split));
+
+    uint32_t crc = dwm::Crc32(0, payload, len);
+    FUZZ_CHECK(crc == (uint32_t)crc32(0, payload, (uInt)len));
+    FUZZ_CHECK(crc == dwm::Crc32(dwm::Crc32(0, payload, split), payload + split, len - split));
+    return 0;
+}
@@ -0,0 +1,169 @@
+// focus_history.h replayed against focus sequences: the MRU lists, the
+// current desktop and SortByRecency agree with a reference model that keeps
+// the whole event log; a history with a small capacity keeps a most-recent
+// subsequence of the same lists. Alongside, a simulated prefetcher follows
+// PlanPrefetch on a virtual clock the way the addon's prefetch thread does
+// (wake on focus, close or restore, or when the plan says), and whenever the
+// switcher opens between settle and idle after the last focus change, every
+// non-minimized top-N window of the current desktop has an unexpired
+// thumbnail.
+// Input: [ttl][ahead][settle][idle][count] then ops of two bytes [op][arg]:
+// focus, close, toggle minimized, advance time, open switcher, sort check
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "../focus_history.h"
+#include "fuzz_common.h"
+
+namespace {
+
+using Ms = dwm::PrefetchDuration;
+
+constexpr size_t kWindows = 12;
+constexpr size_t kSmallCapacity = 3;
+
+dwm::DesktopId Desktop(uint8_t d) { return d ? dwm::DesktopId{ d, 0x1000u + d } : dwm::DesktopId{}; }
+
+// The whole log, most recent first: (window, desktop) of each live window's last focus
+struct Model {
+    std::vector<std::pair<dwm::WindowId, dwm::DesktopId>> order;
+    dwm::DesktopId current;
+
+    void Focus(dwm::WindowId w, const dwm::DesktopId& d) {
+        Remove(w);
+        order.insert(order.begin(), { w, d });
+        if (d.Known()) current = d;
+    }
+    void Remove(dwm::WindowId w) {
+        order.erase(std::remove_if(order.begin(), order.end(), [w](const auto& e) { return e.first == w; }), order.end());
+    }
+    std::vector<dwm::WindowId> Top(const dwm::DesktopId& d, size_t n) const {
+        std::vector<dwm::WindowId> out;
+        for (const auto& e : order) {
+            if (e.second == d && out.size() < n) out.push_back(e.first);
+        }
+        return out;
+    }
+    size_t Rank(dwm::WindowId w) const {
+        for (size_t i = 0; i < order.size(); ++i) if (order[i].first == w) return i;
+        return order.size();
+    }
+};
+
+bool IsSubsequence(const std::vector<dwm::WindowId>& sub, const std::vector<dwm::WindowId>& of) {
+    size_t j = 0;
+    for (dwm::WindowId w : of) if (j < sub.size() && sub[j] == w) ++j;
+    return j == sub.size();
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    fuzz::Reader in(data, size);
+    Ms ttl(200 + in.Byte() * 20);
+    dwm::PrefetchSettings settings;
+    settings.ahead = Ms(in.Byte() * 5);
+    settings.settle = Ms(in.Byte() * 2);
+    uint8_t idle = in.Byte();
+    settings.idle = Ms(idle < 32 ? 0 : idle * 100);
+    settings.count = in.Byte() % 6;
+
+    dwm::FocusHistory history;
+    dwm::FocusHistory small(kSmallCapacity);
+    Model model;
+
+    // Simulated prefetcher and thumbnail cache on a virtual clock
+    Ms now(0), lastFocus(0), nextWake = dwm::kPrefetchNever;
+    std::map<dwm::WindowId, Ms> capturedAt;
+    std::set<dwm::WindowId> minimized;
+    auto runPrefetcher = [&](Ms until) {
+        while (nextWake != dwm::kPrefetchNever && nextWake <= until) {
+            now = std::max(now, nextWake);
+            std::vector<dwm::WindowId> top = history.Top(history.CurrentDesktop(), settings.count);
+            std::vector<dwm::PrefetchCandidate> candidates;
+            for (dwm::WindowId w : top) {
+                auto it = capturedAt.find(w);
+                candidates.push_back({ w, it != capturedAt.end(), it != capturedAt.end() ? now - it->second : Ms(0), minimized.count(w) != 0 });
+            }
+            dwm::PrefetchPlan plan = dwm::PlanPrefetch(settings, ttl, now - lastFocus, candidates);
+            for (dwm::WindowId w : plan.capture) {
+                FUZZ_CHECK(std::find(top.begin(), top.end(), w) != top.end() && !minimized.count(w));
+                capturedAt[w] = now;
+            }
+            FUZZ_CHECK(plan.wakeIn.count() > 0);
+            nextWake = plan.wakeIn == dwm::kPrefetchNever ? dwm::kPrefetchNever : now + plan.wakeIn;
+        }
+        now = std::max(now, until);
+    };
+    auto wake = [&] { nextWake = now; runPrefetcher(now); };
+
+    while (in.Remaining() >= 2) {
+        uint8_t op = in.Byte() % 6;
+        uint8_t arg = in.Byte();
+        dwm::WindowId window = 1 + arg % kWindows;
+        switch (op) {
+            case 0: { // focus on desktop 0 (unknown) to 3
+                dwm::DesktopId desktop = Desktop((arg / kWindows) % 4);
+                history.Focus(window, desktop);
+                small.Focus(window, desktop);
+                model.Focus(window, desktop);
+                minimized.erase(window); // focusing restores it
+                FUZZ_CHECK(small.Top(desktop, 1) == std::vector<dwm::WindowId>{ window });
+                lastFocus = now;
+                wake();
+                break;
+            }
+            case 1: // closed
+                history.Remove(window);
+                small.Remove(window);
+                model.Remove(window);
+                capturedAt.erase(window);
+                minimized.erase(window);
+                wake();
+                break;
+            case 2: // minimized or restored
+                if (!minimized.erase(window)) minimized.insert(window);
+                else wake();
+                break;
+            case 3: // time passes
+                runPrefetcher(now + Ms(arg * 7));
+                break;
+            case 4: { // the switcher opens: the top-N are warm between settle and idle
+                Ms since = now - lastFocus;
+                bool active = since >= settings.settle && (settings.idle.count() == 0 || since < settings.idle);
+                if (!active) break;
+                for (dwm::WindowId w : history.Top(history.CurrentDesktop(), settings.count)) {
+                    if (minimized.count(w)) continue;
+                    auto it = capturedAt.find(w);
+                    FUZZ_CHECK(it != capturedAt.end() && now - it->second < ttl);
+                }
+                break;
+            }
+            case 5: { // SortByRecency over a window list in some z-order
+                std::vector<dwm::WindowId> items;
+                for (size_t i = 0; i < kWindows; ++i) items.push_back(1 + (i * (arg | 1) + arg) % kWindows);
+                std::vector<dwm::WindowId> original = items;
+                history.SortByRecency(items, [](dwm::WindowId w) { return w; });
+                std::vector<dwm::WindowId> expected = original;
+                std::stable_sort(expected.begin(), expected.end(),
+                                 [&](dwm::WindowId a, dwm::WindowId b) { return model.Rank(a) < model.Rank(b); });
+                FUZZ_CHECK(items == expected);
+                break;
+            }
+        }
+        // The lists match the log; the small history keeps a most-recent subsequence
+        FUZZ_CHECK(history.CurrentDesktop() == model.current);
+        FUZZ_CHECK(history.Size() == model.order.size());
+        for (uint8_t d = 0; d < 4; ++d) {
+            std::vector<dwm::WindowId> full = history.Top(Desktop(d), kWindows);
+            FUZZ_CHECK(full == model.Top(Desktop(d), kWindows));
+            std::vector<dwm::WindowId> kept = small.Top(Desktop(d), kWindows);
+            FUZZ_CHECK(kept.size() <= kSmallCapacity && IsSubsequence(kept, full));
+        }
+        if (!model.order.empty()) FUZZ_CHECK(history.LastFocus(model.order.front().first) > 0);
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+// frame_ring.h over a real shared mapping (memfd on Linux, POSIX shm
+// elsewhere), written through one view and read through a second, read-only
+// one: every handle among the last slotCount writes reads back exactly what was
+// written, older and made-up handles are refused, Latest() follows the writer,
+// and a reader attached to a corrupted header either refuses it or stays inside
+// the mapping.
+// Input: [slots][slot size] then ops: [0][w][h][fill][pad] write, [1][index hi lo]
+// read back, [2][slot hi lo][seq hi lo] made-up handle
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../frame_ring.h"
+#include "../shared_memory.h"
+#include "fuzz_common.h"
+
+namespace {
+
+struct Written {
+    dwm::FrameHandle handle;
+    uint32_t width, height;
+    uint8_t fill;
+};
+
+uint8_t PixelAt(const Written& w, size_t i) { return (uint8_t)(w.fill + i * 7); }
+
+// Two views of one mapping, as a writer and a consumer process would have
+bool MapTwice(size_t bytes, dwm::SharedMemory& writer, dwm::SharedMemory& reader) {
+#if defined(__linux__)
+    return writer.CreateAnonymous(bytes) && reader.OpenFd(dup(writer.Fd()), false);
+#else
+    static int counter = 0;
+    std::string name = "dwm-fuzz-ring-" + std::to_string(getpid()) + "-" + std::to_string(counter++);
+    return writer.Create(name, bytes) && reader.Open(name, false);
+#endif
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    fuzz::Reader in(data, size);
+    uint32_t slots = 1 + in.Byte() % 8;
+    size_t slotBytes = 64 + (size_t)(in.Byte() % 16) * 256;
+    size_t bytes = dwm::FrameRingBytes(slots, slotBytes);
+
+    dwm::SharedMemory writerMemory, readerMemory;
+    FUZZ_CHECK(MapTwice(bytes, writerMemory, readerMemory));
+    FUZZ_CHECK(readerMemory.Size() >= bytes);
+    dwm::FrameRingWriter writer;
+    FUZZ_CHECK(writer.Initialize(writerMemory.Data(), writerMemory.Size(), slots, slotBytes));
+    dwm::FrameRingReader reader;
+    FUZZ_CHECK(reader.Attach(readerMemory.Data(), readerMemory.Size()));
+    FUZZ_CHECK(!reader.Latest());
+
+    std::vector<Written> written;
+    std::vector<uint8_t> pixels;
+    while (in.Remaining() > 0) {
+        uint8_t op = in.Byte() % 3;
+        if (op == 0) {
+            Written w{ {}, 1u + in.Byte() % 40, 1u + in.Byte() % 40, in.Byte() };
+            uint32_t stride = w.width * 4 + (in.Byte() % 3) * 4;
+            pixels.assign((size_t)stride * w.height, 0xEE); // row padding must not be copied
+            for (uint32_t y = 0; y < w.height; ++y) {
+                for (uint32_t x = 0; x < w.width * 4; ++x) pixels[(size_t)y * stride + x] = PixelAt(w, (size_t)y * w.width * 4 + x);
+            }
+            uint64_t windowId = written.size() * 3 + 1;
+            w.handle = writer.Write(pixels.data(), w.width, w.height, stride, windowId, w.fill);
+            if (!w.handle) {
+                FUZZ_CHECK((size_t)w.width * 4 * w.height > slotBytes);
+                continue;
+            }
+            uint64_t expected = written.empty() ? 1 : written.back().handle.sequence + 1;
+            FUZZ_CHECK(w.handle.sequence == expected && w.handle.slot == (expected - 1) % slots);
+            // The slot's previous frame is gone
+            if (written.size() >= slots) FUZZ_CHECK(!reader.Validate(written[written.size() - slots].handle));
+            written.push_back(w);
+        } else if (op == 1 && !written.empty()) {
+            size_t index = in.U16() % written.size();
+            const Written& w = written[index];
+            bool live = index + slots >= written.size();
+            dwm::Frame copy;
+            FUZZ_CHECK(reader.Copy(w.handle, copy) == live);
+            dwm::FrameView view;
+            FUZZ_CHECK(reader.Acquire(w.handle, view) == live);
+            if (live) {
+                FUZZ_CHECK(view.width == w.width && view.height == w.height && view.stride == w.width * 4);
+                FUZZ_CHECK(view.windowId == index * 3 + 1 && view.timestampUs == w.fill);
+                FUZZ_CHECK(view.format == dwm::kFrameFormatBgra8);
+                FUZZ_CHECK(copy.width == (int)w.width && copy.height == (int)w.height);
+                for (size_t i = 0; i < copy.pixels.size(); ++i) FUZZ_CHECK(copy.pixels[i] == PixelAt(w, i));
+                FUZZ_CHECK(std::memcmp(view.pixels, copy.pixels.data(), copy.pixels.size()) == 0);
+                FUZZ_CHECK(reader.Validate(w.handle));
+            }
+        } else {
+            // Made-up handles only ever resolve to a live frame that really has them
+            dwm::FrameHandle made{ in.U16(), in.U16() };
+            dwm::FrameView view;
+            if (reader.Acquire(made, view)) {
+                FUZZ_CHECK(made.sequence >= 1 && made.sequence <= written.size());
+                FUZZ_CHECK(written[made.sequence - 1].handle.slot == made.slot);
+                FUZZ_CHECK(made.sequence + slots > written.size());
+            }
+        }
+        FUZZ_CHECK(reader.Latest().sequence == written.size());
+    }
+
+    // Corrupted header: refused, or every read stays inside the mapping (ASan)
+    std::vector<uint8_t> copy(readerMemory.Data(), readerMemory.Data() + readerMemory.Size());
+    for (size_t i = 0; i < 8 && i < size; ++i) copy[data[i] % sizeof(dwm::FrameRingHeader)] ^= data[size - 1 - i];
+    dwm::FrameRingReader corrupt;
+    if (corrupt.Attach(copy.data(), copy.size())) {
+        for (const Written& w : written) {
+            dwm::Frame f;
+            corrupt.Copy(w.handle, f);
+        }
+        dwm::Frame f;
+        corrupt.Copy(corrupt.Latest(), f);
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+// image_frame.h: FitWithin stays inside the box and keeps the aspect ratio,
+// ResampleArea/ResampleNearest/ScaleToFit write exactly the target size, a
+// uniform frame stays uniform (same colour) when scaled, every nearest-
+// neighbour pixel is a copy of a source pixel inside its footprint, and
+// IsUniform agrees with a scan.
+// Input: [srcW hi lo][srcH hi lo][maxW hi lo][maxH hi lo] pixel bytes...
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "../image_frame.h"
+#include "fuzz_common.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    fuzz::Reader in(data, size);
+    int srcW = 1 + in.U16() % 256;
+    int srcH = 1 + in.U16() % 256;
+    int maxW = 1 + in.U16() % 320;
+    int maxH = 1 + in.U16() % 320;
+
+    int w = 0, h = 0;
+    dwm::FitWithin(srcW, srcH, maxW, maxH, w, h);
+    FUZZ_CHECK(w >= 1 && h >= 1);
+    FUZZ_CHECK(w <= maxW && h <= maxH);
+    // The limiting side fills the box, give or take truncation
+    FUZZ_CHECK(w >= maxW - 1 || h >= maxH - 1);
+
+    dwm::Frame frame;
+    frame.Allocate(srcW, srcH);
+    const uint8_t* pixels = in.Rest();
+    size_t available = in.Remaining();
+    bool uniform = available < 2;
+    uint8_t fill = available ? pixels[0] : 0x80;
+    for (size_t i = 0; i < frame.pixels.size(); ++i) {
+        frame.pixels[i] = uniform ? fill : pixels[i % available];
+    }
+    bool scanned = true;
+    for (size_t p = 1; p < (size_t)srcW * srcH && scanned; ++p) {
+        for (int c = 0; c < 3; ++c) scanned = scanned && frame.pixels[p * 4 + c] == frame.pixels[c];
+    }
+    FUZZ_CHECK(dwm::IsUniform(frame) == scanned);
+
+    dwm::Frame dst;
+    dwm::ResampleArea(frame, w, h, dst);
+    FUZZ_CHECK(dst.width == w && dst.height == h && dst.pixels.size() == (size_t)w * h * 4);
+    if (scanned) {
+        FUZZ_CHECK(dwm::IsUniform(dst));
+        for (int c = 0; c < 3; ++c) FUZZ_CHECK(dst.pixels[c] == frame.pixels[c]);
+    }
+
+    dwm::Frame nearest;
+    dwm::ResampleNearest(frame, w, h, nearest);
+    FUZZ_CHECK(nearest.width == w && nearest.height == h && nearest.pixels.size() == (size_t)w * h * 4);
+    for (int dy = 0; dy < h; ++dy) {
+        for (int dx = 0; dx < w; ++dx) {
+            const uint8_t* p = &nearest.pixels[((size_t)dy * w + dx) * 4];
+            // Footprint: source pixels overlapping [dx, dx + 1) scaled by srcW / w
+            int x0 = dx * srcW / w, x1 = std::min(srcW, ((dx + 1) * srcW + w - 1) / w);
+            int y0 = dy * srcH / h, y1 = std::min(srcH, ((dy + 1) * srcH + h - 1) / h);
+            bool found = false;
+            for (int sy = y0; sy < std::max(y1, y0 + 1) && !found; ++sy) {
+                for (int sx = x0; sx < std::max(x1, x0 + 1) && !found; ++sx) {
+                    const uint8_t* s = &frame.pixels[((size_t)sy * srcW + sx) * 4];
+                    found = s[0] == p[0] && s[1] == p[1] && s[2] == p[2];
+                }
+            }
+            FUZZ_CHECK(found);
+        }
+    }
+
+    dwm::Frame scaled = frame;
+    dwm::ScaleToFit(scaled, maxW, maxH);
+    FUZZ_CHECK(scaled.width == w && scaled.height == h);
+    return 0;
+}
@@ -0,0 +1,66 @@
+// trace_writer.h AppendJsonEscaped over arbitrary window titles: the result
+// is a valid JSON string body (no raw control characters, only legal
+// escapes) and unescapes back to the input bytes.
+#include <cstdint>
+#include <string>
+
+#include "../trace_writer.h"
+#include "fuzz_common.h"
+
+namespace {
+
+int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Strict JSON string-body unescape limited to what a byte-preserving escaper needs.
+bool Unescape(const std::string& s, std::string& out) {
+    out.clear();
+    for (size_t i = 0; i < s.size(); ++i) {
+        unsigned char c = (unsigned char)s[i];
+        if (c < 0x20 || c == '"') return false;
+        if (c != '\\') { out += (char)c; continue; }
+        if (++i >= s.size()) return false;
+        switch (s[i]) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                if (i + 4 >= s.size()) return false;
+                int v = 0;
+                for (int k = 1; k <= 4; ++k) {
+                    int d = HexValue(s[i + k]);
+                    if (d < 0) return false;
+                    v = v * 16 + d;
+                }
+                if (v >= 0x80) return false; // the escaper only emits \u00XX for control bytes
+                out += (char)v;
+                i += 4;
+                break;
+            }
+            default: return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string input((const char*)data, size);
+    std::string escaped = "prefix";
+    dwm::AppendJsonEscaped(escaped, input);
+    FUZZ_CHECK(escaped.compare(0, 6, "prefix") == 0);
+    std::string roundTrip;
+    FUZZ_CHECK(Unescape(escaped.substr(6), roundTrip));
+    FUZZ_CHECK(roundTrip == input);
+    return 0;
+}
@@ -0,0 +1,113 @@
+// palette_quantizer.h and indexed PNGs: the quantized image decodes
+// (png_reference.h, PLTE + colour type 3) to exactly its palette and indices;
+// a frame with no more distinct colours than the palette comes back
+// lossless; without dithering every pixel lands in an octree cube it shares
+// with its palette colour, so the error per channel is bounded by the
+// palette size; dithering keeps the same palette.
+// Input: [w][h][max colours][dither][level][distinct] then bytes: with
+// distinct = 0 raw BGRA (repeated), otherwise that many colours followed by
+// one colour choice per pixel
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "../image_frame.h"
+#include "../palette_quantizer.h"
+#include "../png_encoder.h"
+#include "fuzz_common.h"
+#include "png_reference.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    fuzz::Reader in(data, size);
+    int width = 1 + in.Byte() % 96;
+    int height = 1 + in.Byte() % 96;
+    dwm::QuantizeOptions options;
+    options.maxColors = 8 + in.Byte() % 249;
+    options.dither = in.Bool();
+    dwm::PngEncodeOptions pngOptions;
+    pngOptions.level = in.Byte() % 10;
+    size_t distinct = in.Byte();
+
+    dwm::Frame frame;
+    frame.Allocate(width, height);
+    if (distinct == 0) {
+        const uint8_t* pixels = in.Rest();
+        size_t available = in.Remaining();
+        for (size_t i = 0; i < frame.pixels.size(); ++i) frame.pixels[i] = available ? pixels[i % available] : (uint8_t)(i * 13);
+    } else {
+        std::vector<uint32_t> colors(distinct);
+        for (uint32_t& c : colors) c = ((uint32_t)in.Byte() << 16) | ((uint32_t)in.Byte() << 8) | in.Byte();
+        for (size_t p = 0; p < (size_t)width * height; ++p) {
+            uint32_t c = colors[(in.Remaining() ? in.Byte() : p) % distinct];
+            frame.pixels[p * 4 + 0] = (uint8_t)c;
+            frame.pixels[p * 4 + 1] = (uint8_t)(c >> 8);
+            frame.pixels[p * 4 + 2] = (uint8_t)(c >> 16);
+            frame.pixels[p * 4 + 3] = 0xff;
+        }
+    }
+    const size_t n = (size_t)width * height;
+    std::set<uint32_t> colorsInFrame;
+    for (size_t p = 0; p < n; ++p) colorsInFrame.insert(dwm::palette_detail::PackRgb(&frame.pixels[p * 4]));
+
+    dwm::IndexedImage image;
+    FUZZ_CHECK(dwm::QuantizeFrame(frame, options, image));
+    FUZZ_CHECK(image.width == width && image.height == height && image.indices.size() == n);
+    FUZZ_CHECK(image.Colors() >= 1 && image.Colors() <= (size_t)options.maxColors && image.palette.size() % 3 == 0);
+    for (uint8_t index : image.indices) FUZZ_CHECK(index < image.Colors());
+
+    // Through the PNG container and an independent reader
+    std::vector<uint8_t> png;
+    FUZZ_CHECK(dwm::EncodeIndexedPng(image, pngOptions, png));
+    fuzz::DecodedPng decoded;
+    FUZZ_CHECK(fuzz::ReferencePngDecode(png, decoded));
+    FUZZ_CHECK(decoded.width == width && decoded.height == height);
+    FUZZ_CHECK(decoded.palette == image.palette && decoded.indices == image.indices);
+
+    bool exact = colorsInFrame.size() <= (size_t)options.maxColors;
+    if (exact) FUZZ_CHECK(image.Colors() == colorsInFrame.size());
+    // Leaves sit at depth d or deeper once maxColors >= 8^d
+    int depth = options.maxColors >= 64 ? 2 : 1;
+    int bound = (256 >> depth) - 1;
+    for (size_t p = 0; p < n; ++p) {
+        const uint8_t* bgra = &frame.pixels[p * 4];
+        const uint8_t* rgb = &decoded.rgb[p * 3];
+        if (exact) {
+            FUZZ_CHECK(rgb[0] == bgra[2] && rgb[1] == bgra[1] && rgb[2] == bgra[0]);
+        } else if (!options.dither) {
+            FUZZ_CHECK(std::abs(rgb[0] - bgra[2]) <= bound && std::abs(rgb[1] - bgra[1]) <= bound &&
+                       std::abs(rgb[2] - bgra[0]) <= bound);
+        }
+    }
+
+    // The other dithering mode: same palette, and same colours in, same index out without dithering
+    dwm::QuantizeOptions other = options;
+    other.dither = !options.dither;
+    dwm::IndexedImage otherImage;
+    FUZZ_CHECK(dwm::QuantizeFrame(frame, other, otherImage));
+    FUZZ_CHECK(otherImage.palette == image.palette);
+    const dwm::IndexedImage& plain = options.dither ? otherImage : image;
+    std::map<uint32_t, uint8_t> indexOf;
+    for (size_t p = 0; p < n; ++p) {
+        auto seen = indexOf.emplace(dwm::palette_detail::PackRgb(&frame.pixels[p * 4]), plain.indices[p]);
+        FUZZ_CHECK(seen.first->second == plain.indices[p]);
+    }
+
+    // EncodePng with palette set is this path with the default 256 colours
+    pngOptions.palette = true;
+    pngOptions.dither = options.dither;
+    FUZZ_CHECK(dwm::EncodePng(frame, pngOptions, png));
+    dwm::QuantizeOptions full;
+    full.dither = options.dither;
+    FUZZ_CHECK(dwm::QuantizeFrame(frame, full, image));
+    std::vector<uint8_t> expected;
+    FUZZ_CHECK(dwm::EncodeIndexedPng(image, pngOptions, expected));
+    FUZZ_CHECK(png == expected);
+
+    dwm::Frame empty;
+    FUZZ_CHECK(!dwm::QuantizeFrame(empty, options, image));
+    FUZZ_CHECK(!dwm::EncodePng(empty, pngOptions, png) && png.empty());
+    return 0;
+}
@@ -0,0 +1,42 @@
+// png_encoder.h: every filter/level combination produces a PNG that an
+// independent reader (png_reference.h, zlib inflate) accepts, with pixels
+// equal to the input frame's RGB.
+// Input: [w][h][level][filter] pixel bytes (repeated to fill the frame)...
+#include <cstdint>
+#include <vector>
+
+#include "../image_frame.h"
+#include "../png_encoder.h"
+#include "fuzz_common.h"
+#include "png_reference.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    fuzz::Reader in(data, size);
+    int width = 1 + in.Byte() % 64;
+    int height = 1 + in.Byte() % 64;
+    dwm::PngEncodeOptions options;
+    options.level = in.Byte() % 10;
+    options.filter = (dwm::PngFilter)(in.Byte() % 6);
+
+    dwm::Frame frame;
+    frame.Allocate(width, height);
+    const uint8_t* pixels = in.Rest();
+    size_t available = in.Remaining();
+    for (size_t i = 0; i < frame.pixels.size(); ++i) frame.pixels[i] = available ? pixels[i % available] : 0;
+
+    std::vector<uint8_t> png;
+    FUZZ_CHECK(dwm::EncodePng(frame, options, png));
+
+    fuzz::DecodedPng decoded;
+    FUZZ_CHECK(fuzz::ReferencePngDecode(png, decoded));
+    FUZZ_CHECK(decoded.width == width && decoded.height == height);
+    for (size_t p = 0; p < (size_t)width * height; ++p) {
+        const uint8_t* bgra = &frame.pixels[p * 4];
+        const uint8_t* rgb = &decoded.rgb[p * 3];
+        FUZZ_CHECK(rgb[0] == bgra[2] && rgb[1] == bgra[1] && rgb[2] == bgra[0]);
+    }
+
+    dwm::Frame empty;
+    FUZZ_CHECK(!dwm::EncodePng(empty, options, png) && png.empty());
+    return 0;
+}
@@ -0,0 +1,121 @@
+// png_stream.h: a frame fed to PngStreamEncoder in arbitrary bands decodes
+// (png_reference.h, zlib inflate across several IDAT chunks) to the frame's
+// pixels, also when bands are deflated on several threads; the encoder's
+// buffers stay within a bound set by the band size and not the image height,
+// and a sink that fails midway (directly or behind AsyncChunkWriter) stops
+// the encode with an error instead of a short file.
+// Input: [w][h:2][level][filter][band][fail at][4 rows per AddRows call]
+// then pixel bytes (repeated to fill the frame)
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "../image_frame.h"
+#include "../png_stream.h"
+#include "fuzz_common.h"
+#include "png_reference.h"
+
+namespace {
+
+// Feeds frame through encoder in the given band heights (cycled); false on the first failure
+bool Stream(dwm::PngStreamEncoder& encoder, const dwm::Frame& frame, const dwm::PngEncodeOptions& options,
+            const std::vector<int>& bands, dwm::PngSink sink) {
+    if (!encoder.Begin(frame.width, frame.height, options, std::move(sink))) return false;
+    int y = 0;
+    for (size_t i = 0; y < frame.height; ++i) {
+        int rows = std::min(bands[i % bands.size()], frame.height - y);
+        if (!encoder.AddRows(frame.pixels.data() + (size_t)y * frame.Stride(), frame.Stride(), rows)) return false;
+        y += rows;
+    }
+    return encoder.Finish();
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    fuzz::Reader in(data, size);
+    int width = 1 + in.Byte() % 96;
+    int height = 1 + in.U16() % 128;
+    dwm::PngEncodeOptions options;
+    options.level = in.Byte() % 10;
+    options.filter = (dwm::PngFilter)(in.Byte() % 6);
+    // 256 bytes to 64 KiB: from a flush every row or two to a single band
+    size_t bandBytes = (size_t)256 << (in.Byte() % 9);
+    uint8_t failAt = in.Byte();
+    // Bands deflated on 2-3 threads in three or four chunks (failAt's middle bits)
+    if (failAt & 0x40) {
+        options.parallel.threads = 2 + (failAt >> 5 & 1);
+        options.parallel.minBytes = 0;
+        options.parallel.chunkBytes = bandBytes / 3;
+    }
+    std::vector<int> bands;
+    for (int i = 0; i < 4; ++i) bands.push_back(1 + in.Byte() % 40);
+
+    dwm::Frame frame;
+    frame.Allocate(width, height);
+    const uint8_t* pixels = in.Rest();
+    size_t available = in.Remaining();
+    for (size_t i = 0; i < frame.pixels.size(); ++i) frame.pixels[i] = available ? pixels[i % available] : (uint8_t)(i / 7);
+
+    // Straight into memory, as many sink calls as bands
+    std::vector<uint8_t> png;
+    size_t sinkCalls = 0;
+    dwm::PngStreamEncoder encoder(bandBytes);
+    FUZZ_CHECK(Stream(encoder, frame, options, bands, [&](const uint8_t* p, size_t n) {
+        png.insert(png.end(), p, p + n);
+        sinkCalls++;
+        return true;
+    }));
+    FUZZ_CHECK(encoder.BytesWritten() == png.size() && encoder.RowsAdded() == height);
+    size_t rowLen = (size_t)width * 3;
+    size_t scanlineBytes = (size_t)height * (rowLen + 1);
+    FUZZ_CHECK(sinkCalls <= 3 + scanlineBytes / bandBytes);
+
+    fuzz::DecodedPng decoded;
+    FUZZ_CHECK(fuzz::ReferencePngDecode(png, decoded));
+    FUZZ_CHECK(decoded.width == width && decoded.height == height);
+    for (size_t p = 0; p < (size_t)width * height; ++p) {
+        const uint8_t* bgra = &frame.pixels[p * 4];
+        const uint8_t* rgb = &decoded.rgb[p * 3];
+        FUZZ_CHECK(rgb[0] == bgra[2] && rgb[1] == bgra[1] && rgb[2] == bgra[0]);
+    }
+
+    // Buffers: the window plus one band and a row of scanlines; compressed
+    // output of a band (stored at worst) twice, as IDAT data and as a chunk
+    size_t band = dwm::PngStreamEncoder::kWindowBytes + bandBytes + rowLen + 1;
+    FUZZ_CHECK(encoder.PeakBufferedBytes() <= band + 2 * (band + band / 8 + 1024) + 3 * rowLen);
+
+    // Through the async writer, with the destination failing after failAt chunks
+    std::mutex mutex;
+    std::vector<uint8_t> written;
+    size_t writes = 0;
+    size_t failAfter = failAt % 8;
+    bool failing = failAt >= 128;
+    dwm::AsyncChunkWriter writer(1 + failAt % 3, [&](const uint8_t* p, size_t n) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (failing && writes == failAfter) return false;
+        writes++;
+        written.insert(written.end(), p, p + n);
+        return true;
+    });
+    bool streamed = Stream(encoder, frame, options, bands, writer.Sink());
+    bool closed = writer.Close();
+    if (!failing || failAfter >= sinkCalls) {
+        FUZZ_CHECK(streamed && closed && written == png);
+    } else {
+        // The encode may finish before the failed write; either way the caller
+        // learns from Close, and what reached the destination is a prefix
+        FUZZ_CHECK(!closed && written.size() < png.size());
+        FUZZ_CHECK(std::equal(written.begin(), written.end(), png.begin()));
+    }
+
+    // Too many rows, Finish before the last row, an empty image
+    FUZZ_CHECK(encoder.Begin(width, height, options, [](const uint8_t*, size_t) { return true; }));
+    FUZZ_CHECK(!encoder.Finish());
+    FUZZ_CHECK(encoder.Begin(width, height, options, [](const uint8_t*, size_t) { return true; }));
+    std::vector<uint8_t> extra((size_t)(height + 1) * frame.Stride());
+    FUZZ_CHECK(!encoder.AddRows(extra.data(), frame.Stride(), height + 1));
+    FUZZ_CHECK(!encoder.Begin(0, height, options, [](const uint8_t*, size_t) { return true; }));
+    return 0;
+}
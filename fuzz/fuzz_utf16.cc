@@ -0,0 +1,59 @@
+// utf16.h: the SSE2 fast paths produce exactly what the scalar code does, both
+// directions; UTF-16 round-trips through UTF-8 (lone surrogates as U+FFFD);
+// and decoding is a fixed point (decode(encode(decode(x))) == decode(x)) for
+// arbitrary bytes.
+// The input is used both as UTF-8 bytes and as UTF-16 code units.
+#include <cstdint>
+#include <string>
+
+#include "../utf16.h"
+#include "fuzz_common.h"
+
+namespace {
+
+bool WellFormed(const std::u16string& s) {
+    for (size_t i = 0; i < s.size(); ++i) {
+        char16_t c = s[i];
+        if (c >= 0xD800 && c <= 0xDBFF) {
+            if (i + 1 >= s.size() || s[i + 1] < 0xDC00 || s[i + 1] > 0xDFFF) return false;
+            ++i;
+        } else if (c >= 0xDC00 && c <= 0xDFFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::u16string ReplaceLoneSurrogates(std::u16string s) {
+    for (size_t i = 0; i < s.size(); ++i) {
+        char16_t c = s[i];
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < s.size() && s[i + 1] >= 0xDC00 && s[i + 1] <= 0xDFFF) ++i;
+        else if (c >= 0xD800 && c <= 0xDFFF) s[i] = 0xFFFD;
+    }
+    return s;
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    // Bytes as UTF-8
+    std::u16string fast, scalar;
+    dwm::AppendUtf16((const char*)data, size, fast);
+    dwm::AppendUtf16Scalar((const char*)data, size, scalar);
+    FUZZ_CHECK(fast == scalar);
+    FUZZ_CHECK(WellFormed(fast));
+    std::string reencoded = dwm::Utf16ToUtf8(fast);
+    FUZZ_CHECK(dwm::Utf8ToUtf16(reencoded) == fast);
+
+    // Bytes as UTF-16 (little endian pairs)
+    std::u16string units;
+    for (size_t i = 0; i + 1 < size; i += 2) units += (char16_t)(data[i] | (data[i + 1] << 8));
+    std::string fast8 = "keep", scalar8 = "keep"; // appends after existing content
+    dwm::AppendUtf8(units.data(), units.size(), fast8);
+    dwm::AppendUtf8Scalar(units.data(), units.size(), scalar8);
+    FUZZ_CHECK(fast8 == scalar8);
+    FUZZ_CHECK(fast8.compare(0, 4, "keep") == 0);
+    // Round trip is exact except that lone surrogates come back as U+FFFD
+    FUZZ_CHECK(dwm::Utf8ToUtf16(fast8.substr(4)) == ReplaceLoneSurrogates(units));
+    return 0;
+}
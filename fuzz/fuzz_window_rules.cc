@@ -0,0 +1,81 @@
+// window_system.h rules over arbitrary titles, class names and exe paths (they
+// come from other processes, as UTF-16 that need not be well formed): the
+// allocation-free case-insensitive matchers agree with a lower-case-and-search
+// reference, and the Alt-Tab filter and DisplayTitle are consistent with each
+// other. Attributes live in an EnumerationArena as they do during an
+// enumeration.
+// Input: [flags hi lo][w hi lo][h hi lo] title, class, exe, child title (code
+// units, big endian), needle (bytes)...
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "../enumeration_arena.h"
+#include "../window_system.h"
+#include "fuzz_common.h"
+
+namespace {
+
+std::u16string Units(fuzz::Reader& in, size_t max) {
+    size_t n = in.Byte() % (max + 1);
+    std::u16string s;
+    for (size_t i = 0; i < n && in.Remaining() >= 2; ++i) s += (char16_t)in.U16();
+    return s;
+}
+
+std::u16string Lower(std::u16string_view s) {
+    std::u16string out(s);
+    for (char16_t& c : out) if (c >= u'A' && c <= u'Z') c = (char16_t)(c + 32);
+    return out;
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    fuzz::Reader in(data, size);
+    uint16_t flags = in.U16();
+    int w = in.U16() % 400, h = in.U16() % 400;
+    dwm::EnumerationArena arena;
+    dwm::WindowAttributes a(arena.Resource());
+    a.title = Units(in, 64);
+    a.className = Units(in, 32);
+    a.executablePath = Units(in, 96);
+    a.childTitle = Units(in, 32);
+    a.visible = flags & 1;
+    a.minimized = flags & 2;
+    a.cloaked = flags & 4;
+    a.toolWindow = flags & 8;
+    a.noActivate = flags & 16;
+    a.transparent = flags & 32;
+    a.child = flags & 64;
+    a.popup = flags & 128;
+    a.appWindow = flags & 256;
+    a.hasOwner = flags & 512;
+    a.hasRect = flags & 1024;
+    a.rect = dwm::WindowRect{ 0, 0, w, h };
+
+    // Needles are lower-case ASCII literals by contract
+    std::string needle = in.String(8);
+    std::u16string needle16;
+    for (char& c : needle) {
+        c = (char)(c & 0x7f);
+        if (c >= 'A' && c <= 'Z') c = (char)(c + 32);
+        needle16 += (char16_t)c;
+    }
+    if (!needle.empty() && needle.find('\0') == std::string::npos) {
+        std::u16string_view hay = a.executablePath;
+        std::u16string lowerHay = Lower(hay);
+        FUZZ_CHECK(dwm::window_rules::ContainsNoCase(hay, needle.c_str()) == (lowerHay.find(needle16) != std::u16string::npos));
+        bool ends = lowerHay.size() >= needle16.size() && lowerHay.compare(lowerHay.size() - needle16.size(), needle16.size(), needle16) == 0;
+        FUZZ_CHECK(dwm::window_rules::EndsWithNoCase(hay, needle.c_str()) == ends);
+        FUZZ_CHECK(dwm::window_rules::EqualsNoCase(hay, needle.c_str()) == (lowerHay == needle16));
+    }
+
+    bool candidate = dwm::IsAltTabCandidate(a);
+    std::u16string title = dwm::DisplayTitle(a);
+    if (!a.title.empty()) FUZZ_CHECK(std::u16string_view(title) == a.title);
+    // The only candidates without a title to show are UWP hosts with no titled child
+    if (candidate && title.empty()) FUZZ_CHECK(dwm::window_rules::IsAppFrameHost(a) && a.childTitle.empty());
+    if (candidate) FUZZ_CHECK(a.visible && !a.toolWindow && !a.child && a.hasRect && w >= 50 && h >= 50);
+    return 0;
+}
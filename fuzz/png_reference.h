@@ -0,0 +1,112 @@
+// Reference PNG reader for the round-trip harness: walks the chunk stream,
+// verifies CRCs and IHDR, inflates IDAT with zlib and undoes the row filters.
+// Handles exactly what png_encoder.h emits (8-bit RGB, or 8-bit indexed with
+// a PLTE before the data, no interlace) and rejects everything else; indexed
+// images come back expanded through the palette, with the indices kept.
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <zlib.h>
+
+namespace fuzz {
+
+struct DecodedPng {
+    int width{0};
+    int height{0};
+    std::vector<uint8_t> rgb; // width * height * 3
+    std::vector<uint8_t> palette; // RGB triples (indexed images only)
+    std::vector<uint8_t> indices; // width * height (indexed images only)
+};
+
+inline uint32_t ReadBigEndian32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+inline bool ReferencePngDecode(const std::vector<uint8_t>& png, DecodedPng& out) {
+    static const uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    if (png.size() < 8 || std::memcmp(png.data(), kSignature, 8) != 0) return false;
+    size_t pos = 8;
+    std::vector<uint8_t> idat;
+    bool sawHeader = false, sawEnd = false;
+    int colorType = 0;
+    out.palette.clear();
+    out.indices.clear();
+    while (pos + 12 <= png.size() && !sawEnd) {
+        uint32_t len = ReadBigEndian32(&png[pos]);
+        if (len > png.size() - pos - 12) return false;
+        const uint8_t* type = &png[pos + 4];
+        const uint8_t* data = type + 4;
+        uint32_t crc = (uint32_t)crc32(0, type, len + 4);
+        if (crc != ReadBigEndian32(data + len)) return false;
+        if (!std::memcmp(type, "IHDR", 4)) {
+            if (sawHeader || len != 13) return false;
+            out.width = (int)ReadBigEndian32(data);
+            out.height = (int)ReadBigEndian32(data + 4);
+            colorType = data[9];
+            if (out.width <= 0 || out.height <= 0 || data[8] != 8 || (colorType != 2 && colorType != 3)) return false;
+            if (data[10] != 0 || data[11] != 0 || data[12] != 0) return false;
+            sawHeader = true;
+        } else if (!std::memcmp(type, "PLTE", 4)) {
+            // Once, after IHDR and before the data, 1..256 entries
+            if (!sawHeader || !out.palette.empty() || !idat.empty() || len == 0 || len % 3 || len > 768) return false;
+            out.palette.assign(data, data + len);
+        } else if (!std::memcmp(type, "IDAT", 4)) {
+            if (colorType == 3 && out.palette.empty()) return false;
+            idat.insert(idat.end(), data, data + len);
+        } else if (!std::memcmp(type, "IEND", 4)) {
+            sawEnd = true;
+        }
+        pos += 12 + len;
+    }
+    if (!sawHeader || !sawEnd || pos != png.size()) return false;
+
+    const size_t bpp = colorType == 3 ? 1 : 3;
+    const size_t rowLen = (size_t)out.width * bpp;
+    std::vector<uint8_t> raw((rowLen + 1) * (size_t)out.height);
+    uLongf rawLen = (uLongf)raw.size();
+    if (uncompress(raw.data(), &rawLen, idat.data(), (uLong)idat.size()) != Z_OK || rawLen != raw.size()) return false;
+
+    std::vector<uint8_t> prior(rowLen, 0), cur(rowLen);
+    out.rgb.clear();
+    out.rgb.reserve((size_t)out.width * 3 * (size_t)out.height);
+    for (int y = 0; y < out.height; ++y) {
+        const uint8_t* line = &raw[(size_t)y * (rowLen + 1)];
+        int filter = line[0];
+        for (size_t i = 0; i < rowLen; ++i) {
+            int a = i >= bpp ? cur[i - bpp] : 0;
+            int b = prior[i];
+            int c = i >= bpp ? prior[i - bpp] : 0;
+            int pred;
+            switch (filter) {
+                case 0: pred = 0; break;
+                case 1: pred = a; break;
+                case 2: pred = b; break;
+                case 3: pred = (a + b) / 2; break;
+                case 4: {
+                    int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+                    pred = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+                    break;
+                }
+                default: return false;
+            }
+            cur[i] = (uint8_t)(line[1 + i] + pred);
+        }
+        if (colorType == 3) {
+            for (uint8_t index : cur) {
+                if ((size_t)index * 3 >= out.palette.size()) return false;
+                out.rgb.insert(out.rgb.end(), &out.palette[(size_t)index * 3], &out.palette[(size_t)index * 3 + 3]);
+            }
+            out.indices.insert(out.indices.end(), cur.begin(), cur.end());
+        } else {
+            out.rgb.insert(out.rgb.end(), cur.begin(), cur.end());
+        }
+        prior.swap(cur);
+    }
+    return true;
+}
+
+} // namespace fuzz
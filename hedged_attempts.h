@@ -0,0 +1,281 @@
+// Hedged execution of alternative attempts (e.g. capture methods): start the
+// primary, and if it has not produced a good result within its threshold, start
+// the next one in parallel. The first good result wins; attempts that fail
+// early hand over to the next one immediately. Attempts run on an
+// AttemptExecutor (a capped set of joinable threads) and an InFlightLimiter
+// caps the attempts running per key (e.g. per window) across calls, so a
+// target whose calls hang holds a bounded number of threads. Losing attempts
+// keep running until they finish; their results are discarded. The whole call
+// is bounded by HedgeOptions::timeout. When the primary cannot start there, the
+// attempts run one after another on the caller's thread, as without hedging:
+// hedging only ever adds attempts, it never drops the primary.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dwm {
+
+// Up to maxThreads worker threads, started on demand and kept for reuse.
+// TrySubmit never queues: a task starts now on an idle or new worker, or not
+// at all. Shutdown() refuses new tasks, lets accepted ones run, joins the
+// workers that return within the grace period and detaches the rest (a task
+// stuck in a call that never returns); detached workers only touch state
+// they share ownership of.
+class AttemptExecutor {
+public:
+    explicit AttemptExecutor(size_t maxThreads) : maxThreads_(maxThreads ? maxThreads : 1) {}
+    AttemptExecutor(const AttemptExecutor&) = delete;
+    AttemptExecutor& operator=(const AttemptExecutor&) = delete;
+    ~AttemptExecutor() { Shutdown(std::chrono::milliseconds(0)); }
+
+    bool TrySubmit(std::function<void()> task) {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        if (shared_->stopping) return false;
+        if (shared_->tasks.size() < shared_->idleWorkers) {
+            shared_->tasks.push_back(std::move(task));
+            shared_->wake.notify_one();
+            return true;
+        }
+        if (workers_.size() >= maxThreads_) return false;
+        auto exited = std::make_shared<bool>(false);
+        shared_->liveWorkers++;
+        workers_.push_back({ std::thread(WorkerLoop, shared_, exited, std::move(task)), exited });
+        return true;
+    }
+
+    // Returns the number of workers left running (detached)
+    size_t Shutdown(std::chrono::milliseconds grace) {
+        std::unique_lock<std::mutex> lock(shared_->mutex);
+        shared_->stopping = true; // accepted tasks still run
+        shared_->wake.notify_all();
+        shared_->exited.wait_for(lock, grace, [&] { return shared_->liveWorkers == 0; });
+        size_t detached = 0;
+        for (Worker& w : workers_) {
+            if (*w.exited) {
+                w.thread.join(); // returning from WorkerLoop, after its last use of the lock
+            } else {
+                w.thread.detach();
+                detached++;
+            }
+        }
+        workers_.clear();
+        return detached;
+    }
+
+    size_t Threads() const { std::lock_guard<std::mutex> lock(shared_->mutex); return workers_.size(); }
+    size_t MaxThreads() const { return maxThreads_; }
+
+private:
+    struct Shared {
+        std::mutex mutex;
+        std::condition_variable wake;   // idle workers wait for a task
+        std::condition_variable exited; // Shutdown waits for workers to return
+        std::deque<std::function<void()>> tasks; // never longer than idleWorkers
+        size_t idleWorkers{0};
+        size_t liveWorkers{0};
+        bool stopping{false};
+    };
+    struct Worker {
+        std::thread thread;
+        std::shared_ptr<bool> exited; // guarded by Shared::mutex
+    };
+
+    static void WorkerLoop(std::shared_ptr<Shared> shared, std::shared_ptr<bool> exited, std::function<void()> task) {
+        for (;;) {
+            try { task(); } catch (...) {}
+            task = nullptr;
+            std::unique_lock<std::mutex> lock(shared->mutex);
+            shared->idleWorkers++;
+            shared->wake.wait(lock, [&] { return shared->stopping || !shared->tasks.empty(); });
+            shared->idleWorkers--;
+            if (shared->tasks.empty()) {
+                shared->liveWorkers--;
+                *exited = true;
+                shared->exited.notify_all();
+                return;
+            }
+            task = std::move(shared->tasks.front());
+            shared->tasks.pop_front();
+        }
+    }
+
+    const size_t maxThreads_;
+    std::shared_ptr<Shared> shared_ = std::make_shared<Shared>();
+    std::vector<Worker> workers_; // guarded by shared_->mutex
+};
+
+// Attempts in flight per key, each key capped on acquire
+class InFlightLimiter {
+public:
+    bool TryAcquire(uint64_t key, size_t max) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t& n = counts_[key];
+        if (n >= max) return false;
+        n++;
+        return true;
+    }
+
+    void Release(uint64_t key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = counts_.find(key);
+        if (it == counts_.end()) return;
+        if (--it->second == 0) counts_.erase(it);
+    }
+
+    size_t InFlight(uint64_t key) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = counts_.find(key);
+        return it == counts_.end() ? 0 : it->second;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, size_t> counts_;
+};
+
+template <typename Result>
+struct HedgedAttempt {
+    int id{0};
+    std::function<bool(Result&)> run; // true = good result
+};
+
+struct HedgeOptions {
+    AttemptExecutor* executor{nullptr}; // required
+    InFlightLimiter* limiter{nullptr};  // optional; must outlive the attempts
+    uint64_t key{0};
+    size_t maxPerKey{2};
+    std::chrono::nanoseconds timeout{std::chrono::seconds(5)}; // RunHedged returns by then
+};
+
+struct HedgeOutcome {
+    int winner{-1};       // id of the attempt whose result was used, -1 if none succeeded
+    size_t launched{0};   // attempts started (1 = no hedge needed)
+    bool hedged{false};   // at least one attempt was started because a threshold expired
+    bool throttled{false}; // an attempt could not start: executor full or the key at its cap
+    bool inlined{false};  // the primary was throttled, so the attempts ran in turn on the caller's thread
+    bool timedOut{false}; // gave up at options.timeout with attempts still running
+};
+
+using HedgeThresholdFn = std::function<std::chrono::nanoseconds(int id)>;
+// Called once per attempt from its worker thread, possibly after RunHedged returned.
+using HedgeCompletionFn = std::function<void(int id, std::chrono::nanoseconds elapsed, bool ok)>;
+
+template <typename Result>
+HedgeOutcome RunHedged(std::vector<HedgedAttempt<Result>> attempts, const HedgeThresholdFn& threshold,
+                       HedgeCompletionFn onComplete, const HedgeOptions& options, Result& out) {
+    using Clock = std::chrono::steady_clock;
+    struct State {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool haveResult{false};
+        int winner{-1};
+        size_t finished{0};
+        Result result{};
+        HedgeCompletionFn onComplete;
+    };
+    HedgeOutcome outcome;
+    if (attempts.empty() || !options.executor) return outcome;
+    auto state = std::make_shared<State>();
+    state->onComplete = std::move(onComplete);
+    const auto giveUpAt = Clock::now() + options.timeout;
+
+    auto launch = [&](size_t i) {
+        InFlightLimiter* limiter = options.limiter;
+        uint64_t key = options.key;
+        if (limiter && !limiter->TryAcquire(key, options.maxPerKey)) return false;
+        HedgedAttempt<Result> attempt = attempts[i];
+        bool started = options.executor->TrySubmit([state, attempt, limiter, key]() {
+            Result local{};
+            auto t0 = Clock::now();
+            bool ok = false;
+            try { ok = attempt.run(local); } catch (...) { ok = false; }
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0);
+            if (limiter) limiter->Release(key);
+            if (state->onComplete) state->onComplete(attempt.id, elapsed, ok);
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->finished++;
+            if (ok && !state->haveResult) {
+                state->haveResult = true;
+                state->winner = attempt.id;
+                state->result = std::move(local);
+            }
+            state->cv.notify_all();
+        });
+        if (!started) {
+            if (limiter) limiter->Release(key);
+            return false;
+        }
+        outcome.launched++;
+        return true;
+    };
+
+    if (!launch(0)) {
+        outcome.throttled = true;
+        outcome.inlined = true;
+        for (const HedgedAttempt<Result>& attempt : attempts) {
+            Result local{};
+            auto t0 = Clock::now();
+            bool ok = false;
+            try { ok = attempt.run(local); } catch (...) { ok = false; }
+            outcome.launched++;
+            if (state->onComplete) state->onComplete(attempt.id, std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0), ok);
+            if (ok) {
+                outcome.winner = attempt.id;
+                out = std::move(local);
+                break;
+            }
+        }
+        return outcome;
+    }
+    size_t next = 1;
+    bool blocked = false; // a launch was refused; start nothing more
+    auto hedgeAt = Clock::now() + threshold(attempts[0].id);
+    std::unique_lock<std::mutex> lock(state->mutex);
+    for (;;) {
+        bool canStart = !blocked && next < attempts.size();
+        auto wakeAt = canStart ? std::min(hedgeAt, giveUpAt) : giveUpAt;
+        // Wake on a good result, when every started attempt has failed, at the hedge time or at the timeout
+        state->cv.wait_until(lock, wakeAt, [&]{ return state->haveResult || state->finished == outcome.launched; });
+        if (state->haveResult) break;
+        bool allFailed = state->finished == outcome.launched;
+        if (!canStart && allFailed) break;
+        if (Clock::now() >= giveUpAt) {
+            outcome.timedOut = true;
+            break;
+        }
+        if (!canStart) continue;
+        if (allFailed || Clock::now() >= hedgeAt) {
+            lock.unlock();
+            bool started = launch(next);
+            lock.lock();
+            if (!started) {
+                outcome.throttled = true;
+                blocked = true;
+                continue;
+            }
+            if (!allFailed) outcome.hedged = true;
+            hedgeAt = Clock::now() + threshold(attempts[next].id);
+            next++;
+        }
+    }
+    if (state->haveResult) {
+        outcome.winner = state->winner;
+        out = std::move(state->result);
+    }
+    return outcome;
+}
+
+} // namespace dwm
@@ -0,0 +1,133 @@
+// Raw pixel frames passed between capture, scale and encode stages.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace dwm {
+
+// 32bpp BGRA (alpha ignored), top-down, tightly packed rows (stride = width * 4).
+// This matches GetDIBits with a negative biHeight and 32 bits per pixel.
+struct Frame {
+    int width{0};
+    int height{0};
+    std::vector<uint8_t> pixels;
+
+    bool Empty() const { return width <= 0 || height <= 0 || pixels.empty(); }
+    size_t Stride() const { return (size_t)width * 4; }
+    void Allocate(int w, int h) {
+        width = w; height = h;
+        pixels.assign((size_t)w * (size_t)h * 4, 0);
+    }
+    void Clear() { width = height = 0; pixels.clear(); pixels.shrink_to_fit(); }
+};
+
+// Size of a srcW x srcH image scaled to fit maxW x maxH preserving aspect ratio
+// (truncating, never below 1 px).
+inline void FitWithin(int srcW, int srcH, int maxW, int maxH, int& outW, int& outH) {
+    if (srcW <= 0 || srcH <= 0) { outW = outH = 0; return; }
+    double sx = (double)maxW / (double)srcW;
+    double sy = (double)maxH / (double)srcH;
+    double s = std::min(sx, sy);
+    outW = std::max(1, (int)(srcW * s));
+    outH = std::max(1, (int)(srcH * s));
+}
+
+// Area-averaging resample (box filter over the source footprint of each
+// destination pixel). Degenerates to nearest-neighbour when enlarging.
+inline void ResampleArea(const Frame& src, int dstW, int dstH, Frame& dst) {
+    if (src.Empty() || dstW <= 0 || dstH <= 0) { dst.Clear(); return; }
+    if (dstW == src.width && dstH == src.height) { dst = src; return; }
+    dst.Allocate(dstW, dstH);
+    // Precompute source column spans once per call
+    std::vector<int> x0s((size_t)dstW), x1s((size_t)dstW);
+    for (int dx = 0; dx < dstW; ++dx) {
+        int a = (int)((int64_t)dx * src.width / dstW);
+        int b = (int)(((int64_t)(dx + 1) * src.width + dstW - 1) / dstW);
+        if (b <= a) b = a + 1;
+        if (b > src.width) b = src.width;
+        x0s[(size_t)dx] = a; x1s[(size_t)dx] = b;
+    }
+    std::vector<uint64_t> acc((size_t)dstW * 3);
+    const size_t srcStride = src.Stride();
+    for (int dy = 0; dy < dstH; ++dy) {
+        int y0 = (int)((int64_t)dy * src.height / dstH);
+        int y1 = (int)(((int64_t)(dy + 1) * src.height + dstH - 1) / dstH);
+        if (y1 <= y0) y1 = y0 + 1;
+        if (y1 > src.height) y1 = src.height;
+        std::fill(acc.begin(), acc.end(), (uint64_t)0);
+        for (int sy = y0; sy < y1; ++sy) {
+            const uint8_t* row = src.pixels.data() + (size_t)sy * srcStride;
+            for (int dx = 0; dx < dstW; ++dx) {
+                uint32_t b = 0, g = 0, r = 0;
+                for (int sx = x0s[(size_t)dx]; sx < x1s[(size_t)dx]; ++sx) {
+                    const uint8_t* p = row + (size_t)sx * 4;
+                    b += p[0]; g += p[1]; r += p[2];
+                }
+                uint64_t* a = &acc[(size_t)dx * 3];
+                a[0] += b; a[1] += g; a[2] += r;
+            }
+        }
+        uint8_t* out = dst.pixels.data() + (size_t)dy * dst.Stride();
+        const uint32_t rows = (uint32_t)(y1 - y0);
+        for (int dx = 0; dx < dstW; ++dx) {
+            uint64_t n = (uint64_t)rows * (uint64_t)(x1s[(size_t)dx] - x0s[(size_t)dx]);
+            const uint64_t* a = &acc[(size_t)dx * 3];
+            out[0] = (uint8_t)((a[0] + n / 2) / n);
+            out[1] = (uint8_t)((a[1] + n / 2) / n);
+            out[2] = (uint8_t)((a[2] + n / 2) / n);
+            out[3] = 255;
+            out += 4;
+        }
+    }
+}
+
+// Nearest-neighbour resample: each destination pixel copies the source pixel
+// at the centre of its footprint. One read per output pixel whatever the
+// source size, so a full-screen capture shrinks in a fraction of
+// ResampleArea's time, with aliasing (progressive thumbnail previews).
+inline void ResampleNearest(const Frame& src, int dstW, int dstH, Frame& dst) {
+    if (src.Empty() || dstW <= 0 || dstH <= 0) { dst.Clear(); return; }
+    if (dstW == src.width && dstH == src.height) { dst = src; return; }
+    dst.Allocate(dstW, dstH);
+    std::vector<size_t> offsets((size_t)dstW);
+    for (int dx = 0; dx < dstW; ++dx) offsets[(size_t)dx] = (size_t)(((int64_t)dx * 2 + 1) * src.width / ((int64_t)dstW * 2)) * 4;
+    for (int dy = 0; dy < dstH; ++dy) {
+        int sy = (int)(((int64_t)dy * 2 + 1) * src.height / ((int64_t)dstH * 2));
+        const uint8_t* row = src.pixels.data() + (size_t)sy * src.Stride();
+        uint8_t* out = dst.pixels.data() + (size_t)dy * dst.Stride();
+        for (int dx = 0; dx < dstW; ++dx) {
+            std::memcpy(out, row + offsets[(size_t)dx], 3);
+            out[3] = 255;
+            out += 4;
+        }
+    }
+}
+
+// Scale a frame in place so it fits within maxW x maxH.
+inline void ScaleToFit(Frame& frame, int maxW, int maxH) {
+    if (frame.Empty()) return;
+    int w = 0, h = 0;
+    FitWithin(frame.width, frame.height, maxW, maxH, w, h);
+    if (w == frame.width && h == frame.height) return;
+    Frame scaled;
+    ResampleArea(frame, w, h, scaled);
+    frame = std::move(scaled);
+}
+
+// True if every pixel has the same colour (blank or failed captures).
+inline bool IsUniform(const Frame& frame) {
+    if (frame.Empty()) return true;
+    const uint8_t* p = frame.pixels.data();
+    const size_t n = (size_t)frame.width * (size_t)frame.height;
+    for (size_t i = 1; i < n; ++i) {
+        const uint8_t* q = p + i * 4;
+        if (q[0] != p[0] || q[1] != p[1] || q[2] != p[2]) return false;
+    }
+    return true;
+}
+
+} // namespace dwm
@@ -0,0 +1,85 @@
+// Lock-free latency histogram with log-linear buckets (8 linear sub-buckets per
+// power of two, ~12% relative error) for cheap percentile queries.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace dwm {
+
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 3;
+    static constexpr int kSub = 1 << kSubBits;
+    static constexpr int kBuckets = 64 * kSub;
+
+    void Record(std::chrono::nanoseconds d) { RecordUs(d.count() > 0 ? (uint64_t)d.count() / 1000 : 0); }
+
+    void RecordUs(uint64_t us) {
+        buckets_[(size_t)BucketFor(us)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sumUs_.fetch_add(us, std::memory_order_relaxed);
+        uint64_t prev = maxUs_.load(std::memory_order_relaxed);
+        while (us > prev && !maxUs_.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t MaxUs() const { return maxUs_.load(std::memory_order_relaxed); }
+    double MeanUs() const {
+        uint64_t n = Count();
+        return n ? (double)sumUs_.load(std::memory_order_relaxed) / (double)n : 0.0;
+    }
+
+    // Upper bound of the bucket holding the p-th percentile (p in [0, 100]).
+    uint64_t PercentileUs(double p) const {
+        uint64_t n = Count();
+        if (n == 0) return 0;
+        if (p < 0) p = 0;
+        if (p > 100) p = 100;
+        uint64_t rank = (uint64_t)((p / 100.0) * (double)n + 0.5);
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            seen += buckets_[(size_t)i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                uint64_t upper = BucketUpperUs(i);
+                uint64_t mx = MaxUs();
+                return upper < mx ? upper : mx;
+            }
+        }
+        return MaxUs();
+    }
+
+    void Reset() {
+        for (auto& b : buckets_) b.store(0, std::memory_order_relaxed);
+        count_.store(0); sumUs_.store(0); maxUs_.store(0);
+    }
+
+    static int BucketFor(uint64_t us) {
+        if (us < (uint64_t)kSub) return (int)us;
+        int msb = 63;
+        while (!(us >> msb)) --msb;
+        int sub = (int)((us >> (msb - kSubBits)) & (kSub - 1));
+        int idx = (msb - kSubBits + 1) * kSub + sub;
+        return idx < kBuckets ? idx : kBuckets - 1;
+    }
+
+    static uint64_t BucketUpperUs(int idx) {
+        if (idx < kSub) return (uint64_t)idx;
+        int msb = idx / kSub + kSubBits - 1;
+        uint64_t sub = (uint64_t)(idx % kSub);
+        uint64_t lower = (1ull << msb) | (sub << (msb - kSubBits));
+        return lower + (1ull << (msb - kSubBits)) - 1;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sumUs_{0};
+    std::atomic<uint64_t> maxUs_{0};
+};
+
+} // namespace dwm
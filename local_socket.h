@@ -0,0 +1,323 @@
+// Local stream sockets (AF_UNIX) for the thumbnail daemon (daemon_server.h,
+// daemon_client.h). Windows has AF_UNIX since 10 1803 through Winsock, so the
+// same path-based socket and poll loop work on both sides; only the handle
+// type, startup and error calls differ. Sockets are RAII and movable.
+// Portable C++17; the sockets themselves come from the OS.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utf16.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <afunix.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace dwm {
+
+#if defined(_WIN32)
+using SocketHandle = SOCKET;
+constexpr SocketHandle kInvalidSocket = INVALID_SOCKET;
+using PollEntry = WSAPOLLFD;
+#else
+using SocketHandle = int;
+constexpr SocketHandle kInvalidSocket = -1;
+using PollEntry = pollfd;
+#endif
+
+namespace local_socket_detail {
+
+inline int LastError() {
+#if defined(_WIN32)
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+inline bool WouldBlock(int e) {
+#if defined(_WIN32)
+    return e == WSAEWOULDBLOCK;
+#else
+    return e == EAGAIN || e == EWOULDBLOCK;
+#endif
+}
+
+inline bool Interrupted(int e) {
+#if defined(_WIN32)
+    (void)e;
+    return false;
+#else
+    return e == EINTR;
+#endif
+}
+
+inline bool Fail(std::string* error, const char* what) {
+    if (error) {
+        *error = what;
+#if defined(_WIN32)
+        *error += " (error " + std::to_string(WSAGetLastError()) + ")";
+#else
+        *error += std::string(": ") + std::strerror(errno);
+#endif
+    }
+    return false;
+}
+
+// Winsock needs one WSAStartup per process; POSIX needs SIGPIPE ignored so a
+// vanished peer is an error return, not a dead process
+inline bool Startup() {
+#if defined(_WIN32)
+    static const bool ok = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return ok;
+#else
+    static const bool ok = [] {
+        signal(SIGPIPE, SIG_IGN);
+        return true;
+    }();
+    return ok;
+#endif
+}
+
+inline bool FillAddress(const std::string& path, sockaddr_un& addr, std::string* error) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        if (error) *error = "socket path is empty or too long";
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.data(), path.size());
+    return true;
+}
+
+} // namespace local_socket_detail
+
+enum class IoResult { Done, WouldBlock, Closed };
+
+class LocalSocket {
+public:
+    LocalSocket() = default;
+    explicit LocalSocket(SocketHandle handle) : handle_(handle) {}
+    ~LocalSocket() { Close(); }
+    LocalSocket(const LocalSocket&) = delete;
+    LocalSocket& operator=(const LocalSocket&) = delete;
+    LocalSocket(LocalSocket&& other) noexcept : handle_(std::exchange(other.handle_, kInvalidSocket)) {}
+    LocalSocket& operator=(LocalSocket&& other) noexcept {
+        if (this != &other) {
+            Close();
+            handle_ = std::exchange(other.handle_, kInvalidSocket);
+        }
+        return *this;
+    }
+
+    // Listens on path. A stale socket file left by a crashed daemon is
+    // replaced; a live daemon already listening there makes this fail.
+    bool Listen(const std::string& path, std::string* error = nullptr) {
+        using namespace local_socket_detail;
+        Close();
+        sockaddr_un addr;
+        if (!Startup() || !FillAddress(path, addr, error)) return false;
+        LocalSocket probe;
+        if (probe.Connect(path)) {
+            if (error) *error = "a daemon is already listening on " + path;
+            return false;
+        }
+        Unlink(path);
+        handle_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (handle_ == kInvalidSocket) return Fail(error, "socket failed");
+        if (bind(handle_, (const sockaddr*)&addr, sizeof(addr)) != 0) return CloseAndFail(error, "bind failed");
+        if (listen(handle_, 64) != 0) return CloseAndFail(error, "listen failed");
+        return true;
+    }
+
+    bool Connect(const std::string& path, std::string* error = nullptr) {
+        using namespace local_socket_detail;
+        Close();
+        sockaddr_un addr;
+        if (!Startup() || !FillAddress(path, addr, error)) return false;
+        handle_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (handle_ == kInvalidSocket) return Fail(error, "socket failed");
+        if (connect(handle_, (const sockaddr*)&addr, sizeof(addr)) != 0) return CloseAndFail(error, "connect failed");
+        return true;
+    }
+
+    // A pending connection, or an invalid socket if there is none
+    LocalSocket Accept() {
+        SocketHandle h = accept(handle_, nullptr, nullptr);
+        return LocalSocket(h);
+    }
+
+    bool SetNonBlocking() {
+#if defined(_WIN32)
+        u_long on = 1;
+        return ioctlsocket(handle_, FIONBIO, &on) == 0;
+#else
+        int flags = fcntl(handle_, F_GETFL, 0);
+        return flags >= 0 && fcntl(handle_, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+    }
+
+    // Sends as much of data as the socket takes; sent is how much that was
+    IoResult Send(const char* data, size_t size, size_t& sent) {
+        using namespace local_socket_detail;
+        sent = 0;
+        while (sent < size) {
+            int chunk = (int)std::min<size_t>(size - sent, 1 << 20);
+#if defined(_WIN32)
+            int n = send(handle_, data + sent, chunk, 0);
+#elif defined(MSG_NOSIGNAL)
+            long n = send(handle_, data + sent, (size_t)chunk, MSG_NOSIGNAL);
+#else
+            long n = send(handle_, data + sent, (size_t)chunk, 0);
+#endif
+            if (n > 0) {
+                sent += (size_t)n;
+                continue;
+            }
+            int e = LastError();
+            if (n < 0 && Interrupted(e)) continue;
+            if (n < 0 && WouldBlock(e)) return IoResult::WouldBlock;
+            return IoResult::Closed;
+        }
+        return IoResult::Done;
+    }
+
+    // Blocking sockets: everything or Closed
+    bool SendAll(const std::string& data) {
+        size_t sent = 0;
+        return Send(data.data(), data.size(), sent) == IoResult::Done;
+    }
+
+    // Up to size bytes into data; received is 0 unless the result is Done
+    IoResult Receive(char* data, size_t size, size_t& received) {
+        using namespace local_socket_detail;
+        received = 0;
+        for (;;) {
+#if defined(_WIN32)
+            int n = recv(handle_, data, (int)std::min<size_t>(size, 1 << 20), 0);
+#else
+            long n = recv(handle_, data, size, 0);
+#endif
+            if (n > 0) {
+                received = (size_t)n;
+                return IoResult::Done;
+            }
+            if (n == 0) return IoResult::Closed;
+            int e = LastError();
+            if (Interrupted(e)) continue;
+            return WouldBlock(e) ? IoResult::WouldBlock : IoResult::Closed;
+        }
+    }
+
+    // Unblocks a thread waiting in Receive on this socket (the client's reader)
+    void ShutdownBoth() {
+        if (handle_ == kInvalidSocket) return;
+#if defined(_WIN32)
+        shutdown(handle_, SD_BOTH);
+#else
+        shutdown(handle_, SHUT_RDWR);
+#endif
+    }
+
+    void Close() {
+        if (handle_ == kInvalidSocket) return;
+#if defined(_WIN32)
+        closesocket(handle_);
+#else
+        close(handle_);
+#endif
+        handle_ = kInvalidSocket;
+    }
+
+    bool IsOpen() const { return handle_ != kInvalidSocket; }
+    SocketHandle Handle() const { return handle_; }
+
+    static void Unlink(const std::string& path) {
+#if defined(_WIN32)
+        // Paths are UTF-8 like the rest of the daemon's strings
+        std::u16string wide = Utf8ToUtf16(path);
+        DeleteFileW(reinterpret_cast<const wchar_t*>(wide.c_str()));
+#else
+        unlink(path.c_str());
+#endif
+    }
+
+private:
+    bool CloseAndFail(std::string* error, const char* what) {
+        local_socket_detail::Fail(error, what);
+        Close();
+        return false;
+    }
+
+    SocketHandle handle_{kInvalidSocket};
+};
+
+// Waits until one of entries is ready or timeoutMs passes (-1: forever).
+// Returns the number of ready entries, 0 on timeout, -1 on error.
+inline int PollSockets(std::vector<PollEntry>& entries, int timeoutMs) {
+    for (;;) {
+#if defined(_WIN32)
+        int n = WSAPoll(entries.data(), (ULONG)entries.size(), timeoutMs);
+#else
+        int n = poll(entries.data(), (nfds_t)entries.size(), timeoutMs);
+#endif
+        if (n < 0 && local_socket_detail::Interrupted(local_socket_detail::LastError())) continue;
+        return n;
+    }
+}
+
+// A connected pair for waking a poll loop from another thread: the loop polls
+// Reader(), any thread calls Wake(). Built over a loopback listener because
+// Windows has no socketpair.
+class SocketWaker {
+public:
+    bool Open(const std::string& path, std::string* error = nullptr) {
+        LocalSocket listener;
+        if (!listener.Listen(path, error)) return false;
+        if (!writer_.Connect(path, error)) return false;
+        reader_ = listener.Accept();
+        listener.Close();
+        LocalSocket::Unlink(path);
+        if (!reader_.IsOpen()) return local_socket_detail::Fail(error, "accept failed");
+        return reader_.SetNonBlocking() && writer_.SetNonBlocking();
+    }
+
+    void Wake() {
+        char b = 1;
+        size_t sent;
+        writer_.Send(&b, 1, sent); // a full pipe already means "wake up"
+    }
+
+    // Empties the pipe after a wake-up
+    void Drain() {
+        char buf[64];
+        size_t n;
+        while (reader_.Receive(buf, sizeof(buf), n) == IoResult::Done) {}
+    }
+
+    const LocalSocket& Reader() const { return reader_; }
+
+private:
+    LocalSocket reader_;
+    LocalSocket writer_;
+};
+
+} // namespace dwm
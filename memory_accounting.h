@@ -0,0 +1,210 @@
+// Native memory accounting: bytes held per subsystem (caches, capture buffers,
+// queued event payloads, WGC surfaces), the peak transient allocation of each
+// capture attempt, and threshold monitoring for warnings. Owners hold a
+// MemoryCharge sized to what they keep alive; it follows moves and releases
+// itself on destruction, so no free path can forget to uncount.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dwm {
+
+enum class MemoryCategory : int {
+    ThumbnailCache = 0,
+    IconCache,
+    CaptureBuffers, // GDI bitmaps and frames while a capture or pipeline job holds them
+    EventPayloads,  // window events queued for the JS thread
+    WgcCapture,     // WGC frame pool, SoftwareBitmap and copy buffer of a running capture
+    StringTable,    // interned executable paths and class names
+    SharedFrames,   // the shared-memory frame ring, while enabled
+    Count
+};
+
+inline const char* MemoryCategoryName(MemoryCategory category) {
+    static const char* const names[(int)MemoryCategory::Count] = {
+        "thumbnailCache", "iconCache", "captureBuffers", "eventPayloads", "wgcCapture", "stringTable", "sharedFrames"
+    };
+    int i = (int)category;
+    return (i >= 0 && i < (int)MemoryCategory::Count) ? names[i] : "unknown";
+}
+
+class MemoryAccount {
+public:
+    void Add(int64_t bytes, int64_t allocations) {
+        int64_t now = bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        allocations_.fetch_add(allocations, std::memory_order_relaxed);
+        int64_t prev = peak_.load(std::memory_order_relaxed);
+        while (now > prev && !peak_.compare_exchange_weak(prev, now, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t Bytes() const { int64_t b = bytes_.load(std::memory_order_relaxed); return b > 0 ? (uint64_t)b : 0; }
+    uint64_t PeakBytes() const { return (uint64_t)peak_.load(std::memory_order_relaxed); }
+    // Live charges holding at least one byte
+    uint64_t Allocations() const { int64_t n = allocations_.load(std::memory_order_relaxed); return n > 0 ? (uint64_t)n : 0; }
+
+private:
+    std::atomic<int64_t> bytes_{0};
+    std::atomic<int64_t> peak_{0};
+    std::atomic<int64_t> allocations_{0};
+};
+
+inline MemoryAccount& AccountFor(MemoryCategory category) {
+    static std::array<MemoryAccount, (size_t)MemoryCategory::Count> accounts;
+    return accounts[(size_t)category];
+}
+
+inline uint64_t TotalAccountedBytes() {
+    uint64_t total = 0;
+    for (int c = 0; c < (int)MemoryCategory::Count; ++c) total += AccountFor((MemoryCategory)c).Bytes();
+    return total;
+}
+
+// Tracks the high-water mark of bytes charged on the current thread while it
+// is the innermost scope, e.g. everything one capture attempt allocates.
+// Strictly stack-bound; charges made on other threads are not seen.
+class AllocationScope {
+public:
+    AllocationScope() : outer_(Current()) { Current() = this; }
+    ~AllocationScope() { Current() = outer_; }
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+    void Add(int64_t bytes) {
+        current_ += bytes;
+        if (current_ > peak_) peak_ = current_;
+    }
+    uint64_t PeakBytes() const { return (uint64_t)peak_; }
+
+    static AllocationScope*& Current() {
+        static thread_local AllocationScope* scope = nullptr;
+        return scope;
+    }
+
+private:
+    AllocationScope* outer_;
+    int64_t current_{0};
+    int64_t peak_{0};
+};
+
+// Bytes held by one owner, charged to a category (and to the thread's current
+// AllocationScope). Copies charge again; moves transfer the charge.
+class MemoryCharge {
+public:
+    explicit MemoryCharge(MemoryCategory category, size_t bytes = 0) : category_(category) { Set(bytes); }
+    MemoryCharge(const MemoryCharge& o) : category_(o.category_) { Set(o.bytes_); }
+    MemoryCharge(MemoryCharge&& o) noexcept : category_(o.category_), bytes_(o.bytes_) { o.bytes_ = 0; }
+    MemoryCharge& operator=(const MemoryCharge& o) {
+        if (this != &o) { Set(0); category_ = o.category_; Set(o.bytes_); }
+        return *this;
+    }
+    MemoryCharge& operator=(MemoryCharge&& o) noexcept {
+        if (this != &o) { Set(0); category_ = o.category_; bytes_ = o.bytes_; o.bytes_ = 0; }
+        return *this;
+    }
+    ~MemoryCharge() { Set(0); }
+
+    void Set(size_t bytes) {
+        if (bytes == bytes_) return;
+        int64_t delta = (int64_t)bytes - (int64_t)bytes_;
+        int64_t allocations = (bytes_ == 0) ? 1 : (bytes == 0 ? -1 : 0);
+        AccountFor(category_).Add(delta, allocations);
+        if (AllocationScope* scope = AllocationScope::Current()) scope->Add(delta);
+        bytes_ = bytes;
+    }
+    void Release() { Set(0); }
+    size_t Bytes() const { return bytes_; }
+
+private:
+    MemoryCategory category_;
+    size_t bytes_{0};
+};
+
+// Max/mean of recorded sizes, e.g. the AllocationScope peak of every capture.
+class AllocationPeaks {
+public:
+    void Record(uint64_t bytes) {
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(bytes, std::memory_order_relaxed);
+        uint64_t prev = max_.load(std::memory_order_relaxed);
+        while (bytes > prev && !max_.compare_exchange_weak(prev, bytes, std::memory_order_relaxed)) {}
+    }
+    uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t MaxBytes() const { return max_.load(std::memory_order_relaxed); }
+    double MeanBytes() const {
+        uint64_t n = Count();
+        return n ? (double)sum_.load(std::memory_order_relaxed) / (double)n : 0.0;
+    }
+
+private:
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+struct ThresholdCrossing {
+    std::string metric;
+    uint64_t value{0};
+    uint64_t limit{0};
+};
+
+// Per-metric limits. A metric reports once when it reaches its limit and
+// re-arms after falling below 90% of it, so a value hovering at the limit
+// doesn't produce a warning per check.
+class ThresholdMonitor {
+public:
+    // limit 0 removes the metric
+    void SetLimit(const std::string& metric, uint64_t limit) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (limit == 0) limits_.erase(metric);
+        else limits_[metric] = Limit{ limit, true };
+        any_.store(!limits_.empty(), std::memory_order_relaxed);
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        limits_.clear();
+        any_.store(false, std::memory_order_relaxed);
+    }
+
+    bool HasLimits() const { return any_.load(std::memory_order_relaxed); }
+
+    bool Observe(const std::string& metric, uint64_t value, std::vector<ThresholdCrossing>& out) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = limits_.find(metric);
+        if (it == limits_.end()) return false;
+        Limit& l = it->second;
+        if (l.armed && value >= l.limit) {
+            l.armed = false;
+            out.push_back({ metric, value, l.limit });
+            return true;
+        }
+        if (!l.armed && value < l.limit - l.limit / 10) l.armed = true;
+        return false;
+    }
+
+    std::map<std::string, uint64_t> Limits() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<std::string, uint64_t> out;
+        for (auto& kv : limits_) out[kv.first] = kv.second.limit;
+        return out;
+    }
+
+private:
+    struct Limit {
+        uint64_t limit{0};
+        bool armed{true};
+    };
+    mutable std::mutex mutex_;
+    std::map<std::string, Limit> limits_;
+    std::atomic<bool> any_{false};
+};
+
+} // namespace dwm
@@ -0,0 +1,131 @@
+// Negative cache for operations that keep failing for the same key (e.g. a
+// capture method on a DRM-protected or elevated window). Each failure doubles
+// the time until the next attempt, up to a cap; a success forgets the key.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace dwm {
+
+// Window identity plus the operation that failed. pid guards against handle reuse.
+struct NegativeCacheKey {
+    uint64_t window{0};
+    uint32_t pid{0};
+    int method{0};
+
+    bool operator<(const NegativeCacheKey& o) const {
+        return std::tie(window, pid, method) < std::tie(o.window, o.pid, o.method);
+    }
+};
+
+struct NegativeCacheEntry {
+    NegativeCacheKey key;
+    uint32_t failures{0};                  // consecutive failures
+    std::chrono::milliseconds retryIn{0};  // remaining backoff, 0 if a retry is allowed
+};
+
+class NegativeCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    NegativeCache(std::chrono::milliseconds baseBackoff = std::chrono::milliseconds(2000),
+                  std::chrono::milliseconds maxBackoff = std::chrono::milliseconds(120000),
+                  size_t maxEntries = 4096)
+        : base_(baseBackoff), max_(maxBackoff), maxEntries_(maxEntries ? maxEntries : 1) {}
+
+    // True while the key is backing off; counts the skip.
+    bool ShouldSkip(const NegativeCacheKey& key, Clock::time_point now = Clock::now()) {
+        if (!IsBackingOff(key, now)) return false;
+        skipped_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool IsBackingOff(const NegativeCacheKey& key, Clock::time_point now = Clock::now()) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        return it != entries_.end() && now < it->second.retryAt;
+    }
+
+    void RecordFailure(const NegativeCacheKey& key, Clock::time_point now = Clock::now()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (entries_.size() >= maxEntries_ && entries_.find(key) == entries_.end()) {
+            PruneLocked(now, nullptr);
+            if (entries_.size() >= maxEntries_) return; // full of live backoffs; don't grow unbounded
+        }
+        State& s = entries_[key];
+        s.failures++;
+        // base * 2^(failures-1), capped
+        std::chrono::milliseconds backoff = base_;
+        for (uint32_t i = 1; i < s.failures && backoff < max_; ++i) backoff *= 2;
+        s.retryAt = now + std::min(backoff, max_);
+    }
+
+    void RecordSuccess(const NegativeCacheKey& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.erase(key);
+    }
+
+    // Drop entries whose backoff lapsed more than maxBackoff ago, and entries for
+    // windows the predicate reports as gone (if given).
+    void Prune(const std::function<bool(uint64_t window)>& alive = nullptr, Clock::time_point now = Clock::now()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        PruneLocked(now, alive ? &alive : nullptr);
+    }
+
+    std::vector<NegativeCacheEntry> Snapshot(Clock::time_point now = Clock::now()) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<NegativeCacheEntry> out;
+        out.reserve(entries_.size());
+        for (const auto& kv : entries_) {
+            NegativeCacheEntry e;
+            e.key = kv.first;
+            e.failures = kv.second.failures;
+            if (kv.second.retryAt > now) {
+                e.retryIn = std::chrono::duration_cast<std::chrono::milliseconds>(kv.second.retryAt - now);
+            }
+            out.push_back(e);
+        }
+        return out;
+    }
+
+    size_t Size() const { std::lock_guard<std::mutex> lock(mutex_); return entries_.size(); }
+    uint64_t Skipped() const { return skipped_.load(std::memory_order_relaxed); }
+
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+    }
+
+private:
+    struct State {
+        uint32_t failures{0};
+        Clock::time_point retryAt{};
+    };
+
+    void PruneLocked(Clock::time_point now, const std::function<bool(uint64_t)>* alive) {
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            bool stale = now >= it->second.retryAt + max_;
+            bool gone = alive && !(*alive)(it->first.window);
+            if (stale || gone) it = entries_.erase(it);
+            else ++it;
+        }
+    }
+
+    const std::chrono::milliseconds base_;
+    const std::chrono::milliseconds max_;
+    const size_t maxEntries_;
+    mutable std::mutex mutex_;
+    std::map<NegativeCacheKey, State> entries_;
+    std::atomic<uint64_t> skipped_{0};
+};
+
+} // namespace dwm
@@ -0,0 +1,256 @@
+// Reduces a frame to at most 256 colours for indexed (colour type 3) PNGs.
+// Frames with few distinct colours (flat UI) get an exact palette and lose
+// nothing. Others go through an octree: every pixel is counted into a tree
+// five levels deep (the top five bits of each channel), then the least
+// populated nodes of the deepest level are folded into their parents until
+// the leaves fit the palette, and each leaf's average colour is a palette
+// entry. Pixels map to their leaf, or with dithering to the nearest entry
+// after Floyd-Steinberg error diffusion; the nearest-entry search is a
+// branch-free loop over the palette, memoized per 15-bit colour.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "image_frame.h"
+
+namespace dwm {
+
+struct QuantizeOptions {
+    int maxColors{256}; // 8..256 (at least one colour per octant of the RGB cube)
+    bool dither{false}; // Floyd-Steinberg; smoother gradients, less compressible
+};
+
+struct IndexedImage {
+    int width{0};
+    int height{0};
+    std::vector<uint8_t> palette; // RGB triples
+    std::vector<uint8_t> indices; // width * height, row-major
+    size_t Colors() const { return palette.size() / 3; }
+};
+
+namespace palette_detail {
+
+inline uint32_t PackRgb(const uint8_t* bgra) { return ((uint32_t)bgra[2] << 16) | ((uint32_t)bgra[1] << 8) | bgra[0]; }
+
+// Palette of every distinct colour if there are at most maxColors; false otherwise
+inline bool ExactPalette(const Frame& frame, int maxColors, IndexedImage& out) {
+    const size_t kSlots = 1024; // power of two, > 2 * 256
+    uint32_t keys[kSlots];
+    int16_t values[kSlots];
+    std::fill(values, values + kSlots, (int16_t)-1);
+    const size_t n = (size_t)frame.width * (size_t)frame.height;
+    out.indices.resize(n);
+    out.palette.clear();
+    const uint8_t* p = frame.pixels.data();
+    uint32_t lastColor = 0;
+    int lastIndex = -1;
+    for (size_t i = 0; i < n; ++i, p += 4) {
+        uint32_t c = PackRgb(p);
+        if (c == lastColor && lastIndex >= 0) { out.indices[i] = (uint8_t)lastIndex; continue; } // runs are common
+        size_t slot = (c * 2654435761u) >> 22 & (kSlots - 1);
+        while (values[slot] >= 0 && keys[slot] != c) slot = (slot + 1) & (kSlots - 1);
+        if (values[slot] < 0) {
+            int colors = (int)out.palette.size() / 3;
+            if (colors == maxColors) return false;
+            keys[slot] = c;
+            values[slot] = (int16_t)colors;
+            out.palette.push_back(p[2]);
+            out.palette.push_back(p[1]);
+            out.palette.push_back(p[0]);
+        }
+        lastColor = c;
+        lastIndex = values[slot];
+        out.indices[i] = (uint8_t)lastIndex;
+    }
+    return true;
+}
+
+class Octree {
+public:
+    static constexpr int kDepth = 5;
+
+    explicit Octree(size_t pixels) {
+        nodes_.reserve(std::min<size_t>(pixels * 2 + 1, 40000));
+        nodes_.emplace_back();
+    }
+
+    void Add(uint8_t r, uint8_t g, uint8_t b) {
+        int32_t node = 0;
+        for (int level = 0; level < kDepth; ++level) {
+            Count(node, r, g, b);
+            int shift = 7 - level;
+            int child = (((r >> shift) & 1) << 2) | (((g >> shift) & 1) << 1) | ((b >> shift) & 1);
+            int32_t next = nodes_[(size_t)node].children[child];
+            if (next < 0) {
+                next = (int32_t)nodes_.size();
+                nodes_[(size_t)node].children[child] = next;
+                nodes_.emplace_back();
+                if (level + 1 == kDepth) leaves_++;
+                else levels_[level + 1].push_back(next);
+            }
+            node = next;
+        }
+        Count(node, r, g, b);
+    }
+
+    // Folds the least populated deepest nodes until at most maxColors leaves
+    // remain, then numbers the leaves and writes their average colours
+    void BuildPalette(int maxColors, std::vector<uint8_t>& palette) {
+        // Folding every node of a level leaves at most 8^level leaves, so with
+        // maxColors >= 8 the root is never folded
+        for (int level = kDepth - 1; level >= 1 && leaves_ > (size_t)maxColors; --level) {
+            std::vector<int32_t>& candidates = levels_[level];
+            std::stable_sort(candidates.begin(), candidates.end(),
+                             [this](int32_t a, int32_t b) { return nodes_[(size_t)a].count < nodes_[(size_t)b].count; });
+            for (size_t i = 0; i < candidates.size() && leaves_ > (size_t)maxColors; ++i) {
+                Node& node = nodes_[(size_t)candidates[i]];
+                size_t children = 0;
+                for (int32_t& c : node.children) {
+                    if (c >= 0) children++;
+                    c = -1;
+                }
+                leaves_ = leaves_ - children + 1;
+            }
+        }
+        palette.clear();
+        Number(0, palette);
+    }
+
+    // Palette index of the leaf r, g, b falls into (a colour added before BuildPalette)
+    uint8_t Lookup(uint8_t r, uint8_t g, uint8_t b) const {
+        int32_t node = 0;
+        for (int level = 0; level < kDepth; ++level) {
+            int shift = 7 - level;
+            int child = (((r >> shift) & 1) << 2) | (((g >> shift) & 1) << 1) | ((b >> shift) & 1);
+            int32_t next = nodes_[(size_t)node].children[child];
+            if (next < 0) break;
+            node = next;
+        }
+        return nodes_[(size_t)node].index;
+    }
+
+private:
+    struct Node {
+        uint64_t r{0}, g{0}, b{0};
+        uint32_t count{0};
+        int32_t children[8]{ -1, -1, -1, -1, -1, -1, -1, -1 };
+        uint8_t index{0};
+    };
+
+    void Count(int32_t node, uint8_t r, uint8_t g, uint8_t b) {
+        Node& n = nodes_[(size_t)node];
+        n.r += r; n.g += g; n.b += b;
+        n.count++;
+    }
+
+    void Number(int32_t node, std::vector<uint8_t>& palette) {
+        Node& n = nodes_[(size_t)node];
+        bool leaf = true;
+        for (int32_t c : n.children) {
+            if (c >= 0) { leaf = false; Number(c, palette); }
+        }
+        if (!leaf || n.count == 0) return;
+        n.index = (uint8_t)(palette.size() / 3);
+        palette.push_back((uint8_t)((n.r + n.count / 2) / n.count));
+        palette.push_back((uint8_t)((n.g + n.count / 2) / n.count));
+        palette.push_back((uint8_t)((n.b + n.count / 2) / n.count));
+    }
+
+    std::vector<Node> nodes_;
+    std::vector<int32_t> levels_[kDepth]; // inner nodes per level below the root
+    size_t leaves_{0};
+};
+
+// Nearest palette entry (squared RGB distance), memoized per 15-bit colour
+class NearestColor {
+public:
+    explicit NearestColor(const std::vector<uint8_t>& palette) : cache_(32768, -1) {
+        size_t n = palette.size() / 3;
+        r_.resize(n); g_.resize(n); b_.resize(n);
+        for (size_t i = 0; i < n; ++i) { r_[i] = palette[i * 3]; g_[i] = palette[i * 3 + 1]; b_[i] = palette[i * 3 + 2]; }
+    }
+
+    uint8_t Find(int r, int g, int b) {
+        size_t key = ((size_t)(r >> 3) << 10) | ((size_t)(g >> 3) << 5) | (size_t)(b >> 3);
+        if (cache_[key] >= 0) return (uint8_t)cache_[key];
+        // Centre of the 8x8x8 cell, so the memo does not depend on which colour came first
+        int cr = (r & ~7) | 4, cg = (g & ~7) | 4, cb = (b & ~7) | 4;
+        int32_t best = INT32_MAX;
+        size_t bestIndex = 0;
+        const size_t n = r_.size();
+        for (size_t i = 0; i < n; ++i) {
+            int32_t dr = r_[i] - cr, dg = g_[i] - cg, db = b_[i] - cb;
+            int32_t d = dr * dr + dg * dg + db * db;
+            bool closer = d < best;
+            best = closer ? d : best;
+            bestIndex = closer ? i : bestIndex;
+        }
+        cache_[key] = (int16_t)bestIndex;
+        return (uint8_t)bestIndex;
+    }
+
+private:
+    std::vector<int32_t> r_, g_, b_;
+    std::vector<int16_t> cache_;
+};
+
+} // namespace palette_detail
+
+// False for an empty frame. Exact when the frame has at most maxColors colours.
+inline bool QuantizeFrame(const Frame& frame, const QuantizeOptions& options, IndexedImage& out) {
+    using namespace palette_detail;
+    if (frame.Empty()) return false;
+    const int maxColors = std::clamp(options.maxColors, 8, 256);
+    out.width = frame.width;
+    out.height = frame.height;
+    if (ExactPalette(frame, maxColors, out)) return true;
+
+    const size_t n = (size_t)frame.width * (size_t)frame.height;
+    Octree tree(n);
+    const uint8_t* p = frame.pixels.data();
+    for (size_t i = 0; i < n; ++i, p += 4) tree.Add(p[2], p[1], p[0]);
+    tree.BuildPalette(maxColors, out.palette);
+    out.indices.resize(n);
+
+    if (!options.dither) {
+        p = frame.pixels.data();
+        for (size_t i = 0; i < n; ++i, p += 4) out.indices[i] = tree.Lookup(p[2], p[1], p[0]);
+        return true;
+    }
+    // Floyd-Steinberg: 7/16 right, 3/16 down-left, 5/16 down, 1/16 down-right.
+    // Errors in 1/16 units, two rows with a pixel of padding on each side.
+    NearestColor nearest(out.palette);
+    const size_t w = (size_t)frame.width;
+    std::vector<int32_t> errors(2 * (w + 2) * 3, 0);
+    for (int y = 0; y < frame.height; ++y) {
+        int32_t* cur = errors.data() + (size_t)(y & 1) * (w + 2) * 3;
+        int32_t* next = errors.data() + (size_t)((y + 1) & 1) * (w + 2) * 3;
+        std::fill(next, next + (w + 2) * 3, 0);
+        const uint8_t* row = frame.pixels.data() + (size_t)y * frame.Stride();
+        for (size_t x = 0; x < w; ++x) {
+            int32_t* e = cur + (x + 1) * 3;
+            int want[3] = {
+                std::clamp(row[x * 4 + 2] + e[0] / 16, 0, 255),
+                std::clamp(row[x * 4 + 1] + e[1] / 16, 0, 255),
+                std::clamp(row[x * 4 + 0] + e[2] / 16, 0, 255),
+            };
+            uint8_t index = nearest.Find(want[0], want[1], want[2]);
+            out.indices[(size_t)y * w + x] = index;
+            for (int c = 0; c < 3; ++c) {
+                int32_t err = want[c] - out.palette[(size_t)index * 3 + (size_t)c];
+                e[3 + c] += err * 7;
+                next[x * 3 + (size_t)c] += err * 3;
+                next[(x + 1) * 3 + (size_t)c] += err * 5;
+                next[(x + 2) * 3 + (size_t)c] += err;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace dwm
@@ -0,0 +1,113 @@
+// zlib streams compressed on several threads, the way pigz does it: the input
+// is cut into chunks, each chunk is deflated on its own (DeflateRange with the
+// 32 KiB before it as the preset window, so matches still reach across the
+// cut) and ends byte-aligned with a sync flush, and the pieces are joined in
+// order into one stream. Each chunk's Adler-32 is computed on the same thread
+// and the values are combined (Adler32Combine). Costs a few bytes per chunk
+// against ZlibCompress; inputs below minBytes take the single-threaded path
+// unchanged.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include "deflate.h"
+
+namespace dwm {
+
+struct ParallelDeflateOptions {
+    size_t threads{1};              // 1 compresses on the calling thread; 0 = one per hardware thread
+    size_t minBytes{1 << 20};       // smaller inputs are compressed on the calling thread
+    size_t chunkBytes{128 * 1024};  // work unit; each chunk is an independent run of DeflateRange
+};
+
+// Adler-32 of A followed by B, from adler(A), adler(B) and len(B) (zlib's adler32_combine)
+inline uint32_t Adler32Combine(uint32_t adler1, uint32_t adler2, size_t len2) {
+    const uint64_t kMod = 65521;
+    uint64_t rem = len2 % kMod;
+    uint64_t sum1 = adler1 & 0xffff;
+    uint64_t sum2 = (rem * sum1) % kMod;
+    sum1 += (adler2 & 0xffff) + kMod - 1;
+    sum2 += (adler1 >> 16) + (adler2 >> 16) + kMod - rem;
+    sum1 %= kMod;
+    sum2 %= kMod;
+    return (uint32_t)(sum1 | (sum2 << 16));
+}
+
+// Threads options asks for (0 resolved to the hardware count), at least 1
+inline size_t ParallelDeflateThreads(const ParallelDeflateOptions& options) {
+    size_t threads = options.threads ? options.threads : (size_t)std::thread::hardware_concurrency();
+    return std::max<size_t>(threads, 1);
+}
+
+// True when data of len bytes would be split across threads
+inline bool UseParallelDeflate(const ParallelDeflateOptions& options, size_t len) {
+    return len >= options.minBytes && len > std::max<size_t>(options.chunkBytes, 1) && ParallelDeflateThreads(options) > 1;
+}
+
+// DeflateRange(data, begin, end, level, final) split into chunks compressed
+// on up to options.threads threads (the caller's included), appended to out
+// whole bytes at a time, so out must not hold a partial byte. Returns the
+// Adler-32 of data[begin, end) (started from 1).
+inline uint32_t ParallelDeflateRange(const uint8_t* data, size_t begin, size_t end, int level, bool final,
+                                     const ParallelDeflateOptions& options, std::vector<uint8_t>& out) {
+    const size_t chunk = std::max<size_t>(options.chunkBytes, 1);
+    const size_t chunks = std::max<size_t>((end - begin + chunk - 1) / chunk, 1);
+    std::vector<std::vector<uint8_t>> pieces(chunks);
+    std::vector<uint32_t> adlers(chunks, 1);
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::atomic<bool> failed{false};
+    auto work = [&] {
+        try {
+            for (size_t i; !failed && (i = next++) < chunks;) {
+                size_t b = begin + i * chunk, e = std::min(end, b + chunk);
+                pieces[i].reserve((e - b) / 2 + 64);
+                BitWriter bw(pieces[i]);
+                DeflateRange(data, b, e, level, final && i + 1 == chunks, bw);
+                bw.AlignToByte();
+                adlers[i] = Adler32(1, data + b, e - b);
+            }
+        } catch (...) {
+            if (!failed.exchange(true)) error = std::current_exception();
+        }
+    };
+    std::vector<std::thread> helpers;
+    size_t threads = std::min(ParallelDeflateThreads(options), chunks);
+    for (size_t t = 1; t < threads; ++t) helpers.emplace_back(work);
+    work();
+    for (std::thread& t : helpers) t.join();
+    if (error) std::rethrow_exception(error);
+
+    size_t total = 0;
+    for (const auto& p : pieces) total += p.size();
+    out.reserve(out.size() + total);
+    uint32_t adler = 1;
+    for (size_t i = 0; i < chunks; ++i) {
+        out.insert(out.end(), pieces[i].begin(), pieces[i].end());
+        size_t b = begin + i * chunk;
+        adler = Adler32Combine(adler, adlers[i], std::min(end, b + chunk) - b);
+    }
+    return adler;
+}
+
+// zlib stream of data[0, len) appended to out: ZlibCompress, on several
+// threads when UseParallelDeflate says so
+inline void ParallelZlibCompress(const uint8_t* data, size_t len, int level, const ParallelDeflateOptions& options,
+                                 std::vector<uint8_t>& out) {
+    if (!UseParallelDeflate(options, len)) {
+        ZlibCompress(data, len, level, out);
+        return;
+    }
+    WriteZlibHeader(out, level);
+    uint32_t adler = ParallelDeflateRange(data, 0, len, level, true, options, out);
+    WriteBigEndian32(out, adler);
+}
+
+} // namespace dwm
@@ -0,0 +1,178 @@
+// PNG encoder for dwm::Frame (8-bit RGB, alpha dropped like the previous GDI+
+// PixelFormat32bppRGB path). Per-row filter selection follows libpng's
+// minimum-sum-of-absolute-differences heuristic; compression uses deflate.h.
+// With palette set, the frame is quantized (palette_quantizer.h) and written
+// as 8-bit indexed colour: a third of the bytes to deflate, exact for frames
+// of up to 256 colours. Large images can be deflated on several threads
+// (parallel_deflate.h, options.parallel).
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "deflate.h"
+#include "image_frame.h"
+#include "palette_quantizer.h"
+#include "parallel_deflate.h"
+
+namespace dwm {
+
+enum class PngFilter { None = 0, Sub = 1, Up = 2, Average = 3, Paeth = 4, Adaptive = 5 };
+
+struct PngEncodeOptions {
+    int level{6};                         // deflate level 0..9
+    PngFilter filter{PngFilter::Adaptive};
+    bool palette{false};                  // 8-bit indexed colour (colour type 3)
+    bool dither{false};                   // with palette: Floyd-Steinberg dithering
+    ParallelDeflateOptions parallel{};    // off (one thread) by default
+};
+
+// BGRA (alpha ignored) -> packed RGB.
+inline void BgraToRgb(const uint8_t* bgra, uint8_t* rgb, size_t pixels) {
+    for (size_t i = 0; i < pixels; ++i) {
+        rgb[0] = bgra[2];
+        rgb[1] = bgra[1];
+        rgb[2] = bgra[0];
+        bgra += 4;
+        rgb += 3;
+    }
+}
+
+inline uint8_t PaethPredictor(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return (uint8_t)a;
+    return (uint8_t)(pb <= pc ? b : c);
+}
+
+// Applies filter type f to row (prior may be all zeros for the first row); out has len bytes.
+// One loop per filter (the first bpp bytes have no left neighbour) so the
+// simple ones vectorize.
+inline void FilterPngRow(int f, const uint8_t* row, const uint8_t* prior, size_t len, size_t bpp, uint8_t* out) {
+    size_t head = std::min(bpp, len);
+    switch (f) {
+        case 1:
+            std::memcpy(out, row, head);
+            for (size_t i = bpp; i < len; ++i) out[i] = (uint8_t)(row[i] - row[i - bpp]);
+            break;
+        case 2:
+            for (size_t i = 0; i < len; ++i) out[i] = (uint8_t)(row[i] - prior[i]);
+            break;
+        case 3:
+            for (size_t i = 0; i < head; ++i) out[i] = (uint8_t)(row[i] - (prior[i] >> 1));
+            for (size_t i = bpp; i < len; ++i) out[i] = (uint8_t)(row[i] - ((row[i - bpp] + prior[i]) >> 1));
+            break;
+        case 4:
+            for (size_t i = 0; i < head; ++i) out[i] = (uint8_t)(row[i] - prior[i]); // Paeth(0, b, 0) = b
+            for (size_t i = bpp; i < len; ++i) out[i] = (uint8_t)(row[i] - PaethPredictor(row[i - bpp], prior[i], prior[i - bpp]));
+            break;
+        default:
+            std::memcpy(out, row, len);
+            break;
+    }
+}
+
+// One scanline (filter byte + filtered row) into line, which has rowLen + 1
+// bytes; trial is rowLen bytes of scratch for the adaptive choice.
+inline void FilterPngScanline(PngFilter filter, const uint8_t* cur, const uint8_t* prior, size_t rowLen,
+                              uint8_t* trial, uint8_t* line) {
+    int chosen = (int)filter;
+    if (filter == PngFilter::Adaptive) {
+        uint64_t best = UINT64_MAX;
+        for (int f = 0; f <= 4; ++f) {
+            FilterPngRow(f, cur, prior, rowLen, 3, trial);
+            uint64_t sum = 0;
+            for (size_t i = 0; i < rowLen && sum < best; ++i) sum += (uint64_t)std::abs((int)(int8_t)trial[i]);
+            if (sum < best) { best = sum; chosen = f; std::memcpy(line + 1, trial, rowLen); }
+        }
+    } else {
+        FilterPngRow(chosen, cur, prior, rowLen, 3, line + 1);
+    }
+    line[0] = (uint8_t)chosen;
+}
+
+// Filtered scanlines (filter byte + RGB row each) ready for deflate.
+inline void BuildPngScanlines(const Frame& frame, PngFilter filter, std::vector<uint8_t>& out) {
+    const size_t w = (size_t)frame.width, h = (size_t)frame.height;
+    const size_t rowLen = w * 3;
+    out.resize(h * (rowLen + 1));
+    std::vector<uint8_t> cur(rowLen), prior(rowLen, 0), trial(rowLen);
+    for (size_t y = 0; y < h; ++y) {
+        BgraToRgb(frame.pixels.data() + y * frame.Stride(), cur.data(), w);
+        FilterPngScanline(filter, cur.data(), prior.data(), rowLen, trial.data(), out.data() + y * (rowLen + 1));
+        cur.swap(prior);
+    }
+}
+
+inline void AppendPngChunk(std::vector<uint8_t>& out, const char type[4], const uint8_t* data, size_t len) {
+    WriteBigEndian32(out, (uint32_t)len);
+    size_t typeAt = out.size();
+    out.insert(out.end(), type, type + 4);
+    if (len) out.insert(out.end(), data, data + len);
+    WriteBigEndian32(out, Crc32(0, out.data() + typeAt, len + 4));
+}
+
+inline void AppendPngHeader(std::vector<uint8_t>& out, int width, int height, uint8_t colorType) {
+    static const uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    out.insert(out.end(), kSignature, kSignature + 8);
+    std::vector<uint8_t> ihdr;
+    WriteBigEndian32(ihdr, (uint32_t)width);
+    WriteBigEndian32(ihdr, (uint32_t)height);
+    ihdr.push_back(8);         // bit depth (8-bit indices for a palette)
+    ihdr.push_back(colorType); // 2 = RGB, 3 = palette
+    ihdr.push_back(0);         // deflate
+    ihdr.push_back(0);         // adaptive filtering
+    ihdr.push_back(0);         // no interlace
+    AppendPngChunk(out, "IHDR", ihdr.data(), ihdr.size());
+}
+
+// Indexed-colour PNG (IHDR, PLTE, IDAT, IEND) of image into out (replaced).
+// Rows are not filtered: index deltas mean nothing, so the PNG spec suggests
+// filter type None for palette images and deflate finds the repeats.
+inline bool EncodeIndexedPng(const IndexedImage& image, const PngEncodeOptions& options, std::vector<uint8_t>& out) {
+    out.clear();
+    if (image.width <= 0 || image.height <= 0 || image.Colors() == 0 || image.Colors() > 256) return false;
+    const size_t w = (size_t)image.width, h = (size_t)image.height;
+    std::vector<uint8_t> scanlines(h * (w + 1));
+    for (size_t y = 0; y < h; ++y) {
+        scanlines[y * (w + 1)] = 0;
+        std::memcpy(&scanlines[y * (w + 1) + 1], &image.indices[y * w], w);
+    }
+    std::vector<uint8_t> idat;
+    idat.reserve(scanlines.size() / 2 + 64);
+    ParallelZlibCompress(scanlines.data(), scanlines.size(), options.level, options.parallel, idat);
+    out.reserve(idat.size() + image.palette.size() + 80);
+    AppendPngHeader(out, image.width, image.height, 3);
+    AppendPngChunk(out, "PLTE", image.palette.data(), image.palette.size());
+    AppendPngChunk(out, "IDAT", idat.data(), idat.size());
+    AppendPngChunk(out, "IEND", nullptr, 0);
+    return true;
+}
+
+// Encodes frame as PNG into out (replaced). Returns false for an empty frame.
+inline bool EncodePng(const Frame& frame, const PngEncodeOptions& options, std::vector<uint8_t>& out) {
+    out.clear();
+    if (frame.Empty()) return false;
+    if (options.palette) {
+        QuantizeOptions quantize;
+        quantize.dither = options.dither;
+        IndexedImage image;
+        return QuantizeFrame(frame, quantize, image) && EncodeIndexedPng(image, options, out);
+    }
+    std::vector<uint8_t> scanlines;
+    BuildPngScanlines(frame, options.level == 0 ? PngFilter::None : options.filter, scanlines);
+    std::vector<uint8_t> idat;
+    idat.reserve(scanlines.size() / 2 + 64);
+    ParallelZlibCompress(scanlines.data(), scanlines.size(), options.level, options.parallel, idat);
+    out.reserve(idat.size() + 64);
+    AppendPngHeader(out, frame.width, frame.height, 2);
+    AppendPngChunk(out, "IDAT", idat.data(), idat.size());
+    AppendPngChunk(out, "IEND", nullptr, 0);
+    return true;
+}
+
+} // namespace dwm
@@ -0,0 +1,208 @@
+// Streaming PNG encoder for full-resolution captures: rows arrive in bands,
+// are filtered and deflated as they come, and each band leaves as its own
+// IDAT chunk through a sink, so neither the whole scanline buffer nor the
+// whole PNG is ever held. Each band is compressed with the previous 32 KiB of
+// scanlines as the preset window (DeflateRange) and ends with a sync flush;
+// the Adler-32 runs across bands. Memory is bounded by the band size plus the
+// window (and deflate's hash chains over them), whatever the image height.
+// Bands of at least options.parallel.minBytes are deflated on several threads
+// (ParallelDeflateRange). AsyncChunkWriter moves the writes to a thread of
+// their own, so encoding overlaps with disk or pipe I/O.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "capture_pipeline.h"
+#include "deflate.h"
+#include "parallel_deflate.h"
+#include "png_encoder.h"
+
+namespace dwm {
+
+// Receives the encoded bytes in order; false aborts the encode
+using PngSink = std::function<bool(const uint8_t* data, size_t len)>;
+
+class PngStreamEncoder {
+public:
+    static constexpr size_t kWindowBytes = 32768;
+
+    // bandBytes: scanline bytes collected before a band is compressed and
+    // written (at least one row); smaller bands cost a few bytes of flush each
+    explicit PngStreamEncoder(size_t bandBytes = 256 * 1024) : bandBytes_(bandBytes ? bandBytes : 1) {}
+
+    // Writes the signature and IHDR. False for an empty size or a failed sink.
+    // Always RGB: options.palette is ignored, a palette needs the whole image.
+    bool Begin(int width, int height, const PngEncodeOptions& options, PngSink sink) {
+        failed_ = true;
+        if (width <= 0 || height <= 0 || !sink) return false;
+        width_ = width;
+        height_ = height;
+        rows_ = 0;
+        options_ = options;
+        if (options_.level == 0) options_.filter = PngFilter::None;
+        sink_ = std::move(sink);
+        rowLen_ = (size_t)width * 3;
+        cur_.assign(rowLen_, 0);
+        prior_.assign(rowLen_, 0);
+        trial_.assign(rowLen_, 0);
+        scanlines_.clear();
+        // A band ends as soon as it reaches bandBytes, so this never grows
+        scanlines_.reserve(std::min(kWindowBytes + bandBytes_ + rowLen_ + 1, (size_t)height * (rowLen_ + 1)));
+        windowLen_ = 0;
+        zlibStarted_ = false;
+        adler_ = 1;
+        bytesWritten_ = 0;
+        peakBuffered_ = 0;
+        failed_ = false;
+        out_.clear();
+        AppendPngHeader(out_, width, height, 2);
+        return Emit(out_);
+    }
+
+    // Appends rows top-down: 32bpp BGRA, stride bytes apart. False once more
+    // rows than the height arrive or the sink fails.
+    bool AddRows(const uint8_t* bgra, size_t stride, int rows) {
+        if (failed_ || rows < 0 || rows > height_ - rows_) return Fail();
+        for (int r = 0; r < rows; ++r) {
+            BgraToRgb(bgra + (size_t)r * stride, cur_.data(), (size_t)width_);
+            size_t at = scanlines_.size();
+            scanlines_.resize(at + rowLen_ + 1);
+            FilterPngScanline(options_.filter, cur_.data(), prior_.data(), rowLen_, trial_.data(), scanlines_.data() + at);
+            cur_.swap(prior_);
+            ++rows_;
+            if (scanlines_.size() - windowLen_ >= bandBytes_ && !CompressBand(false)) return false;
+        }
+        return true;
+    }
+
+    // After the last row: the rest of the data, the Adler-32 and IEND
+    bool Finish() {
+        if (failed_ || rows_ != height_) return Fail();
+        if (!CompressBand(true)) return false;
+        out_.clear();
+        AppendPngChunk(out_, "IEND", nullptr, 0);
+        bool ok = Emit(out_);
+        failed_ = true; // Begin again before the next image
+        return ok;
+    }
+
+    int Width() const { return width_; }
+    int Height() const { return height_; }
+    int RowsAdded() const { return rows_; }
+    uint64_t BytesWritten() const { return bytesWritten_; }
+    // Largest capacity the encoder's own buffers reached during this image
+    size_t PeakBufferedBytes() const { return peakBuffered_; }
+
+private:
+    bool Fail() {
+        failed_ = true;
+        return false;
+    }
+
+    bool Emit(const std::vector<uint8_t>& bytes) {
+        peakBuffered_ = std::max(peakBuffered_, scanlines_.capacity() + out_.capacity() + idat_.capacity() + 3 * rowLen_);
+        if (!sink_(bytes.data(), bytes.size())) return Fail();
+        bytesWritten_ += bytes.size();
+        return true;
+    }
+
+    // Deflates the scanlines after the window into one IDAT chunk, then keeps
+    // the last kWindowBytes as the next band's window
+    bool CompressBand(bool final) {
+        size_t begin = windowLen_, end = scanlines_.size();
+        if (begin == end && !final) return true;
+        idat_.clear();
+        if (!zlibStarted_) WriteZlibHeader(idat_, options_.level);
+        zlibStarted_ = true;
+        if (UseParallelDeflate(options_.parallel, end - begin)) {
+            uint32_t band = ParallelDeflateRange(scanlines_.data(), begin, end, options_.level, final, options_.parallel, idat_);
+            adler_ = Adler32Combine(adler_, band, end - begin);
+        } else {
+            adler_ = Adler32(adler_, scanlines_.data() + begin, end - begin);
+            BitWriter bw(idat_);
+            DeflateRange(scanlines_.data(), begin, end, options_.level, final, bw);
+            bw.AlignToByte();
+        }
+        if (final) WriteBigEndian32(idat_, adler_);
+        out_.clear();
+        AppendPngChunk(out_, "IDAT", idat_.data(), idat_.size());
+        if (!Emit(out_)) return false;
+        size_t keep = std::min(end, kWindowBytes);
+        scanlines_.erase(scanlines_.begin(), scanlines_.end() - (std::ptrdiff_t)keep);
+        windowLen_ = keep;
+        return true;
+    }
+
+    size_t bandBytes_;
+    int width_{0}, height_{0}, rows_{0};
+    PngEncodeOptions options_;
+    PngSink sink_;
+    size_t rowLen_{0};
+    std::vector<uint8_t> cur_, prior_, trial_;
+    std::vector<uint8_t> scanlines_; // window (already compressed) + rows of the current band
+    size_t windowLen_{0};
+    bool zlibStarted_{false};
+    uint32_t adler_{1};
+    std::vector<uint8_t> idat_, out_;
+    uint64_t bytesWritten_{0};
+    size_t peakBuffered_{0};
+    bool failed_{true};
+};
+
+// Hands chunks to write() on a thread of its own, at most maxChunks queued,
+// so a slow disk or reader stalls the encoder instead of growing memory.
+// After a failed write, further Write calls fail and Close returns false.
+class AsyncChunkWriter {
+public:
+    using WriteFn = std::function<bool(const uint8_t* data, size_t len)>;
+
+    AsyncChunkWriter(size_t maxChunks, WriteFn write) : queue_(maxChunks), write_(std::move(write)) {
+        thread_ = std::thread([this] { Run(); });
+    }
+    ~AsyncChunkWriter() { Close(); }
+    AsyncChunkWriter(const AsyncChunkWriter&) = delete;
+    AsyncChunkWriter& operator=(const AsyncChunkWriter&) = delete;
+
+    bool Write(const uint8_t* data, size_t len) {
+        if (failed_) return false;
+        return queue_.Push(std::vector<uint8_t>(data, data + len));
+    }
+
+    // Waits for the queued chunks; true if every write succeeded
+    bool Close() {
+        queue_.Close();
+        if (thread_.joinable()) thread_.join();
+        return !failed_;
+    }
+
+    PngSink Sink() {
+        return [this](const uint8_t* data, size_t len) { return Write(data, len); };
+    }
+
+private:
+    void Run() {
+        std::vector<uint8_t> chunk;
+        while (queue_.Pop(chunk)) {
+            if (failed_) continue; // drain, so a blocked Write returns
+            if (!write_(chunk.data(), chunk.size())) {
+                failed_ = true;
+                queue_.Close();
+            }
+        }
+    }
+
+    BoundedQueue<std::vector<uint8_t>> queue_;
+    WriteFn write_;
+    std::atomic<bool> failed_{false};
+    std::thread thread_;
+};
+
+} // namespace dwm
@@ -0,0 +1,137 @@
+// Settings tunable at runtime through configure()/getConfig(): enabled capture
+// methods, thumbnail cache TTL, default size, PNG codec settings, pipeline
+// threads, queue/time budgets and the MRU prefetch policy. A configuration is an immutable snapshot:
+// configure() validates a complete candidate and swaps it in whole, and each
+// call reads one snapshot when it starts, so no call sees half an update and
+// in-flight calls finish with the settings they started with.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace dwm {
+
+// Capture methods in the addon's fallback order; bit i of a method mask is method i
+constexpr int kCaptureMethodCount = 6;
+inline constexpr const char* kCaptureMethodNames[kCaptureMethodCount] = {
+    "dwmThumbnail", "wgc", "printWindowFull", "printWindowClient", "printWindow", "desktopBlt"
+};
+constexpr uint32_t kAllCaptureMethods = (1u << kCaptureMethodCount) - 1;
+constexpr uint32_t kWgcCaptureMethod = 1u << 1;
+
+inline int CaptureMethodIndex(std::string_view name) {
+    for (int i = 0; i < kCaptureMethodCount; ++i) {
+        if (name == kCaptureMethodNames[i]) return i;
+    }
+    return -1;
+}
+
+struct RuntimeConfig {
+    uint32_t captureMethods{ kAllCaptureMethods & ~kWgcCaptureMethod }; // WGC is opt-in
+    uint32_t ttlMs{ 1200 }; // thumbnail cache lifetime; absorbs recomposition bursts
+    int defaultWidth{ 200 };
+    int defaultHeight{ 150 };
+    // Thumbnail and icon PNGs come from GDI+, as they always have, unless
+    // builtinPng selects the portable encoder (png_encoder.h). pngLevel,
+    // pngPalette and the parallel settings below apply to the portable encoder
+    // only; captureToFile/captureToStream always use it.
+    bool builtinPng{ false };
+    // zlib-style level for the portable encoder. Level 1 encodes UI-like frames
+    // ~1.6x faster than 6 for ~40% more bytes (bench/: png/ui 320x200).
+    int pngLevel{ 6 };
+    // 8-bit indexed thumbnail PNGs (palette_quantizer.h): flat UI stays exact
+    // at ~60% of the RGB bytes, gradients and photos drop to ~20% but band
+    // unless dithered (bench/: pngPalette).
+    bool pngPalette{ false };
+    bool pngDither{ false };
+    // PNGs whose filtered scanlines reach parallelPngBytes (full-screen
+    // overviews, captureToFile/captureToStream bands) are deflated on up to
+    // pngThreads threads (parallel_deflate.h); 0 = one per core, 1 = never.
+    // Thumbnails stay far below the threshold.
+    size_t pngThreads{ 4 };
+    size_t parallelPngBytes{ 1 << 20 };
+    // Capture waits on GDI/DWM and on the target window's message loop, so it
+    // gets more threads than the CPU-bound scale and encode stages.
+    size_t captureThreads{ 4 };
+    size_t scaleThreads{ 1 };
+    size_t encodeThreads{ 2 };
+    // Jobs waiting for capture hold only metadata, so enumeration gets a deep
+    // queue and is not throttled by slow captures.
+    size_t captureQueueCapacity{ 512 };
+    size_t stageQueueCapacity{ 8 };
+    // Captured frames are full-window BGRA until the scale stage (a 4K window
+    // is ~33 MB), so the scale stage's queue is also bounded by frame bytes.
+    size_t stageQueueBytes{ 64 << 20 };
+    double enumerationBudgetMs{ 8.0 }; // nextEnumeration() without an explicit budget
+    // Background refresh of the top MRU windows' thumbnails once focus is
+    // tracked (focus_history.h PrefetchSettings); count 0 turns it off
+    size_t prefetchCount{ 4 };
+    uint32_t prefetchAheadMs{ 250 };
+    uint32_t prefetchSettleMs{ 150 };
+    uint32_t prefetchIdleMs{ 30000 };
+};
+
+// Empty if valid, otherwise what is wrong with the first bad field
+inline std::string ValidateRuntimeConfig(const RuntimeConfig& c) {
+    auto range = [](const char* field, double v, double lo, double hi) -> std::string {
+        if (v >= lo && v <= hi) return {};
+        return std::string(field) + " must be between " + std::to_string((long long)lo) + " and " + std::to_string((long long)hi);
+    };
+    if ((c.captureMethods & kAllCaptureMethods) == 0) return "captureMethods must enable at least one method";
+    if (c.captureMethods & ~kAllCaptureMethods) return "captureMethods contains unknown methods";
+    std::string e;
+    if (!(e = range("ttlMs", c.ttlMs, 0, 600000)).empty()) return e;
+    if (!(e = range("defaultSize.width", c.defaultWidth, 16, 4096)).empty()) return e;
+    if (!(e = range("defaultSize.height", c.defaultHeight, 16, 4096)).empty()) return e;
+    if (!(e = range("codec.pngLevel", c.pngLevel, 0, 9)).empty()) return e;
+    if (c.pngPalette && !c.builtinPng) return "codec.palette needs codec.encoder 'builtin'";
+    if (!(e = range("codec.threads", (double)c.pngThreads, 0, 64)).empty()) return e;
+    if (!(e = range("codec.parallelMinBytes", (double)c.parallelPngBytes, 64 << 10, 1 << 30)).empty()) return e;
+    if (!(e = range("threads.capture", (double)c.captureThreads, 1, 32)).empty()) return e;
+    if (!(e = range("threads.scale", (double)c.scaleThreads, 1, 32)).empty()) return e;
+    if (!(e = range("threads.encode", (double)c.encodeThreads, 1, 32)).empty()) return e;
+    if (!(e = range("budgets.captureQueue", (double)c.captureQueueCapacity, 1, 65536)).empty()) return e;
+    if (!(e = range("budgets.stageQueue", (double)c.stageQueueCapacity, 1, 1024)).empty()) return e;
+    if (!(e = range("budgets.stageQueueBytes", (double)c.stageQueueBytes, 1 << 20, 1 << 30)).empty()) return e;
+    if (!(c.enumerationBudgetMs >= 0 && c.enumerationBudgetMs <= 1000)) return "budgets.enumerationMs must be between 0 and 1000";
+    if (!(e = range("prefetch.count", (double)c.prefetchCount, 0, 32)).empty()) return e;
+    if (!(e = range("prefetch.aheadMs", c.prefetchAheadMs, 0, 600000)).empty()) return e;
+    if (!(e = range("prefetch.settleMs", c.prefetchSettleMs, 0, 60000)).empty()) return e;
+    if (!(e = range("prefetch.idleMs", c.prefetchIdleMs, 0, 86400000)).empty()) return e;
+    return {};
+}
+
+class RuntimeConfigStore {
+public:
+    explicit RuntimeConfigStore(const RuntimeConfig& initial = RuntimeConfig())
+        : current_(std::make_shared<const RuntimeConfig>(initial)) {}
+
+    std::shared_ptr<const RuntimeConfig> Get() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return current_;
+    }
+
+    // Replaces the whole configuration, or nothing if it is invalid
+    bool Set(const RuntimeConfig& config, std::string* error = nullptr) {
+        std::string e = ValidateRuntimeConfig(config);
+        if (!e.empty()) {
+            if (error) *error = e;
+            return false;
+        }
+        auto next = std::make_shared<const RuntimeConfig>(config);
+        std::lock_guard<std::mutex> lock(mutex_);
+        current_ = std::move(next);
+        return true;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::shared_ptr<const RuntimeConfig> current_;
+};
+
+} // namespace dwm
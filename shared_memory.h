@@ -0,0 +1,217 @@
+// Named shared memory mappings for frames exported to other processes (see
+// frame_ring.h). Windows uses a pagefile-backed file mapping, POSIX systems
+// shm_open, and Linux can also create an anonymous memfd whose descriptor is
+// handed to the consumer. The creator owns the name: a POSIX name is unlinked
+// when the creating mapping is destroyed; readers that already mapped it keep
+// their view.
+// Portable C++17; the mapping itself comes from the OS.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dwm {
+
+class SharedMemory {
+public:
+    SharedMemory() = default;
+    ~SharedMemory() { Close(); }
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+    SharedMemory(SharedMemory&& other) noexcept { *this = std::move(other); }
+    SharedMemory& operator=(SharedMemory&& other) noexcept {
+        if (this != &other) {
+            Close();
+            std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
+            std::swap(name_, other.name_);
+            std::swap(owner_, other.owner_);
+#if defined(_WIN32)
+            std::swap(mapping_, other.mapping_);
+#else
+            std::swap(fd_, other.fd_);
+#endif
+        }
+        return *this;
+    }
+
+    // A new zero-filled mapping of `bytes`. Names are plain identifiers
+    // ("dwm-frames-1234"); the platform prefix ("Local\\", "/") is added here.
+    bool Create(const std::string& name, size_t bytes, std::string* error = nullptr) {
+        Close();
+#if defined(_WIN32)
+        std::wstring wide = WideName(name);
+        HANDLE h = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                      (DWORD)((uint64_t)bytes >> 32), (DWORD)bytes, wide.c_str());
+        if (!h) return Fail(error, "CreateFileMapping failed", GetLastError());
+        if (GetLastError() == ERROR_ALREADY_EXISTS) {
+            CloseHandle(h);
+            return Fail(error, "shared memory name already in use", 0);
+        }
+        mapping_ = h;
+        return MapView(name, bytes, true, error);
+#else
+        std::string path = "/" + name;
+        int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0) return Fail(error, "shm_open failed", errno);
+        if (ftruncate(fd, (off_t)bytes) != 0) {
+            int e = errno;
+            close(fd);
+            shm_unlink(path.c_str());
+            return Fail(error, "ftruncate failed", e);
+        }
+        fd_ = fd;
+        owner_ = true;
+        name_ = name;
+        return MapView(name, bytes, true, error);
+#endif
+    }
+
+    // Maps an existing mapping; its size is taken from the OS
+    bool Open(const std::string& name, bool writable, std::string* error = nullptr) {
+        Close();
+#if defined(_WIN32)
+        std::wstring wide = WideName(name);
+        HANDLE h = OpenFileMappingW(writable ? FILE_MAP_WRITE : FILE_MAP_READ, FALSE, wide.c_str());
+        if (!h) return Fail(error, "OpenFileMapping failed", GetLastError());
+        mapping_ = h;
+        return MapView(name, 0, writable, error);
+#else
+        std::string path = "/" + name;
+        int fd = shm_open(path.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+        if (fd < 0) return Fail(error, "shm_open failed", errno);
+        fd_ = fd;
+        return MapView(name, 0, writable, error);
+#endif
+    }
+
+#if defined(__linux__)
+    // An unnamed mapping; pass Fd() to the consumer (SCM_RIGHTS, fork) and map it with OpenFd
+    bool CreateAnonymous(size_t bytes, std::string* error = nullptr) {
+        Close();
+        int fd = memfd_create("dwm-frames", MFD_CLOEXEC);
+        if (fd < 0) return Fail(error, "memfd_create failed", errno);
+        if (ftruncate(fd, (off_t)bytes) != 0) {
+            int e = errno;
+            close(fd);
+            return Fail(error, "ftruncate failed", e);
+        }
+        fd_ = fd;
+        return MapView(std::string(), bytes, true, error);
+    }
+#endif
+
+#if !defined(_WIN32)
+    // Maps a descriptor received from the creator; takes ownership of fd
+    bool OpenFd(int fd, bool writable, std::string* error = nullptr) {
+        Close();
+        fd_ = fd;
+        return MapView(std::string(), 0, writable, error);
+    }
+    int Fd() const { return fd_; }
+#endif
+
+    void Close() {
+#if defined(_WIN32)
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        mapping_ = nullptr;
+#else
+        if (data_) munmap(data_, size_);
+        if (fd_ >= 0) close(fd_);
+        if (owner_ && !name_.empty()) shm_unlink(("/" + name_).c_str());
+        fd_ = -1;
+#endif
+        data_ = nullptr;
+        size_ = 0;
+        owner_ = false;
+        name_.clear();
+    }
+
+    uint8_t* Data() const { return static_cast<uint8_t*>(data_); }
+    size_t Size() const { return size_; }
+    bool IsOpen() const { return data_ != nullptr; }
+    const std::string& Name() const { return name_; }
+
+private:
+    static bool Fail(std::string* error, const char* what, unsigned long code) {
+        if (error) {
+            *error = what;
+#if !defined(_WIN32)
+            if (code) *error += std::string(": ") + std::strerror((int)code);
+#else
+            if (code) *error += " (error " + std::to_string(code) + ")";
+#endif
+        }
+        return false;
+    }
+
+#if defined(_WIN32)
+    static std::wstring WideName(const std::string& name) {
+        std::wstring wide = L"Local\\";
+        for (char c : name) wide += (wchar_t)(unsigned char)c;
+        return wide;
+    }
+
+    bool MapView(const std::string& name, size_t bytes, bool writable, std::string* error) {
+        void* p = MapViewOfFile(mapping_, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, bytes);
+        if (!p) {
+            unsigned long e = GetLastError();
+            Close();
+            return Fail(error, "MapViewOfFile failed", e);
+        }
+        MEMORY_BASIC_INFORMATION info{};
+        VirtualQuery(p, &info, sizeof(info));
+        data_ = p;
+        size_ = bytes ? bytes : (size_t)info.RegionSize;
+        name_ = name;
+        return true;
+    }
+
+    HANDLE mapping_{nullptr};
+#else
+    bool MapView(const std::string& name, size_t bytes, bool writable, std::string* error) {
+        if (!bytes) {
+            struct stat st{};
+            if (fstat(fd_, &st) != 0) {
+                int e = errno;
+                Close();
+                return Fail(error, "fstat failed", e);
+            }
+            bytes = (size_t)st.st_size;
+        }
+        void* p = bytes ? mmap(nullptr, bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd_, 0) : MAP_FAILED;
+        if (p == MAP_FAILED) {
+            int e = bytes ? errno : EINVAL;
+            Close();
+            return Fail(error, "mmap failed", e);
+        }
+        data_ = p;
+        size_ = bytes;
+        if (!owner_) name_ = name;
+        return true;
+    }
+
+    int fd_{-1};
+#endif
+
+    void* data_{nullptr};
+    size_t size_{0};
+    std::string name_;
+    bool owner_{false}; // POSIX: unlinks the name on Close
+};
+
+} // namespace dwm
@@ -0,0 +1,20 @@
+#!/usr/bin/env node
+// Runs the thumbnail daemon until interrupted: dwm-windows-daemon [socket path] [--workers N]
+import dwmWindows from './index.js';
+
+const args = process.argv.slice(2);
+const workersAt = args.indexOf('--workers');
+const workers = workersAt >= 0 ? Number(args.splice(workersAt, 2)[1]) : undefined;
+
+const info = dwmWindows.startDaemon({ path: args[0], workers });
+console.log(`dwm-windows daemon listening on ${info.path} (pid ${info.pid})`);
+
+// Hooks and the socket live on native threads; this keeps the process up
+const keepAlive = setInterval(() => {}, 1 << 30);
+const shutdown = () => {
+  clearInterval(keepAlive);
+  dwmWindows.stopDaemon();
+  process.exit(0);
+};
+process.on('SIGINT', shutdown);
+process.on('SIGTERM', shutdown);
@@ -1,50 +1,452 @@
 import { createRequire } from 'module';
 import { fileURLToPath } from 'url';
 import { dirname, join } from 'path';
+import { Readable } from 'stream';
 
 const __filename = fileURLToPath(import.meta.url);
 const __dirname = dirname(__filename);
 const require = createRequire(import.meta.url);
 
 // Load the native module
+const requireStart = performance.now();
 const nativeModule = require(join(__dirname, '../build/Release/dwm_windows.node'));
+const requireMs = performance.now() - requireStart;
 
 export interface WindowInfo {
   id: number; // equals hwnd (native window handle)
   title: string;
   executablePath: string;
+  executablePathId: number; // id in the string table (getStringTable)
+  className: string;
+  classNameId: number;
   isVisible: boolean;
   hwnd: number; // same as id
-  thumbnail: string; // data URL (PNG base64)
+  thumbnail: string; // data URL (PNG base64); '' when the capture went to the shared frame ring (frame)
   icon: string; // data URL (PNG base64)
+  pending?: boolean; // getWindowsAsync deadline hit: thumbnail is a stale cached frame or a placeholder
+  frame?: SharedFrameHandle; // only with { sharedFrames: true } and a fresh capture
+  timings?: WindowTimings; // only with { timings: true }
+}
+
+/**
+ * A frame in the shared-memory ring (enableSharedFrames). Send it to the consumer process as is;
+ * the consumer reads the BGRA pixels in place with frame_ring.h. Valid until the slot is reused,
+ * i.e. for the next `slots - 1` captures.
+ */
+export interface SharedFrameHandle {
+  slot: number;
+  sequence: number;
+  width: number;
+  height: number;
+}
+
+export interface SharedFramesOptions {
+  name?: string; // mapping name, default 'dwm-windows-frames-<pid>'
+  slots?: number; // default 32
+  slotBytes?: number; // largest frame, default defaultSize width * height * 4
+}
+
+export interface SharedFramesInfo {
+  name: string;
+  slots: number;
+  slotBytes: number;
+  bytes: number; // size of the whole mapping
+}
+
+export interface FullCaptureOptions {
+  level?: number; // PNG deflate level 0-9, default 6
+  bandRows?: number; // rows captured and encoded per step, 1-4096 (default 64)
+}
+
+export interface ThumbnailUpdateOptions {
+  progressive?: boolean; // deliver a coarse preview to onPreview before the final image, from the same capture
+  onPreview?: (thumbnail: string) => void; // nearest-neighbour, uncompressed PNG data URL; called before the promise settles
+}
+
+export interface CaptureFileInfo {
+  path: string;
+  width: number; // full window size in pixels
+  height: number;
+  bytes: number; // PNG file size
+}
+
+/** With { interned: true }: path and class only as string table ids. */
+export type InternedWindowInfo = Omit<WindowInfo, 'executablePath' | 'className'>;
+
+/** Per-window time spent in each stage (ms); stages the window did not go through are omitted. */
+export interface WindowTimings {
+  predicateMs?: number;
+  virtualDesktopMs?: number;
+  exePathMs?: number;
+  iconMs?: number; // includes encoding the icon
+  captureMs?: number;
+  scaleMs?: number;
+  pngEncodeMs?: number;
+  base64Ms?: number;
+  marshalMs?: number;
+}
+
+export interface GetWindowsOptions {
+  includeAllDesktops?: boolean;
+  /**
+   * Hedged capture: if a capture method has not finished within its usual latency
+   * (hedgePercentile of its recorded history, default 90), the next method is started in
+   * parallel and the first good frame wins. Trades extra capture work for lower tail latency.
+   */
+  hedge?: boolean;
+  hedgePercentile?: number;
+  /** Attach a per-window stage breakdown (WindowInfo.timings). No effect if built with stage_timing=0. */
+  timings?: boolean;
+  /**
+   * Leave out executablePath/className and return only their ids; resolve them with
+   * getStringTable()/resolveString(). Paths and class names repeat across many windows.
+   */
+  interned?: boolean;
+  /**
+   * Write fresh captures into the shared frame ring (enableSharedFrames) instead of encoding
+   * PNGs; such windows get `frame` and an empty thumbnail. Cache hits, minimized windows,
+   * placeholders and captures past the ring's slot count in one call still come as PNG data
+   * URLs. No effect while shared frames are disabled.
+   */
+  sharedFrames?: boolean;
+  /**
+   * 'mru': most recently focused first, like Alt-Tab. The first such call starts native focus
+   * tracking (seeded from the current z-order) and keeps the top MRU windows' thumbnails fresh
+   * in the background (RuntimeConfig.prefetch). Default 'enumeration': EnumWindows order.
+   */
+  orderBy?: 'enumeration' | 'mru';
+}
+
+export interface GetWindowsAsyncOptions extends GetWindowsOptions {
+  /**
+   * Hard latency bound in ms. When it passes, every window is returned anyway; windows whose
+   * capture has not finished get their cached (possibly stale) frame or a placeholder and
+   * pending: true. Their captures continue in the background and refresh the cache.
+   */
+  deadlineMs?: number;
+}
+
+export interface PipelineStageStats {
+  name: string; // 'capture' | 'scale' | 'encode'
+  concurrency: number;
+  queueCapacity: number;
+  queueDepth: number; // items currently waiting in front of the stage
+  maxQueueDepth: number;
+  queueBytes?: number; // frame bytes waiting, for the byte-bounded scale queue
+  queueBytesLimit?: number;
+  processed: number;
+  busyMs: number;
+  utilization: number; // busy time / (wall time * concurrency), 0..1
+}
+
+export interface CaptureMethodStats {
+  name: CaptureMethod;
+  attempts: number;
+  failures: number;
+  wins: number; // attempts whose frame was used
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+  hedgeThresholdMs: number; // current p90-based hedge threshold
+}
+
+export interface NegativeCacheEntry {
+  hwnd: number;
+  pid: number;
+  method: string; // capture method that keeps failing for this window
+  failures: number; // consecutive failures; the backoff doubles with each one
+  retryInMs: number; // 0 once the next attempt is allowed
+}
+
+export interface StageTimingStats {
+  name: string; // 'enumerate' | 'predicate' | 'virtualDesktop' | 'exePath' | 'icon' | 'capture' | 'scale' | 'pngEncode' | 'base64' | 'marshal'
+  count: number;
+  meanMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+}
+
+export interface CaptureStats {
+  pipeline: PipelineStageStats[];
+  stages: StageTimingStats[]; // empty when built with stage_timing=0
+  methods: CaptureMethodStats[];
+  hedging: { hedged: number; hedgeWins: number; throttled: number; timeouts: number };
+  negativeCache: { entries: NegativeCacheEntry[]; skipped: number };
+  prefetch: {
+    tracking: boolean; // focus tracking on (orderBy: 'mru' used, or the daemon runs)
+    trackedWindows: number; // windows in the MRU history
+    captures: number; // background captures of top MRU windows
+    hits: number; // requests served a prefetched thumbnail
+    // WGC captures the prefetcher started together: wallMs is what the batches took, captureMs
+    // the sum of their captures' own times; captureMs / wallMs is the overlap gained
+    wgcBatches: { batches: number; windows: number; wallMs: number; captureMs: number };
+  };
+}
+
+export interface MemoryCategoryStats {
+  bytes: number;
+  peakBytes: number;
+  allocations: number; // live cache entries, queued payloads, in-flight frames
+  entries?: number; // cache categories only
+}
+
+export type MemoryMetric =
+  | 'thumbnailCache' | 'iconCache' | 'captureBuffers' | 'eventPayloads' | 'wgcCapture' | 'stringTable' | 'sharedFrames'
+  | 'total' | 'privateBytes' | 'gdiObjects' | 'userObjects';
+
+export interface MemoryStats {
+  totalBytes: number; // sum of all categories
+  categories: {
+    thumbnailCache: MemoryCategoryStats;
+    iconCache: MemoryCategoryStats;
+    captureBuffers: MemoryCategoryStats; // GDI bitmaps and frames held by captures/pipeline jobs
+    eventPayloads: MemoryCategoryStats; // window events queued for the JS thread
+    wgcCapture: MemoryCategoryStats; // WGC frame pool/bitmap/buffer of running captures
+    stringTable: MemoryCategoryStats; // interned executable paths and class names
+    sharedFrames: MemoryCategoryStats; // the shared-memory frame ring, while enabled
+  };
+  capture: { attempts: number; peakBytes: number; meanPeakBytes: number }; // transient bytes per capture attempt
+  process: {
+    privateBytes: number;
+    workingSetBytes: number;
+    peakWorkingSetBytes: number;
+    gdiObjects: number;
+    gdiObjectsPeak: number;
+    userObjects: number;
+    userObjectsPeak: number;
+  };
+  thresholds: Partial<Record<MemoryMetric, number>>;
+}
+
+export interface MemoryWarning {
+  metric: MemoryMetric;
+  value: number;
+  threshold: number;
+}
+
+export interface FirstCallTiming {
+  name: string; // API, e.g. 'getWindows' or 'onWindowFocused'
+  latencyMs: number; // first call; for async APIs until the promise resolved
+  sinceLoadMs: number; // when the call started, relative to the start of the module load
+}
+
+export interface SubsystemInitTiming {
+  name: string; // 'winrtApartment' | 'captureWindowClass'
+  initMs: number; // first initialization
+  sinceLoadMs: number;
+  count: number; // initializations so far (WinRT: one per capturing thread)
+}
+
+export interface StartupStats {
+  requireMs: number; // loading the .node file, including native static init and module registration
+  loadMs: number; // native side only: static init through module registration
+  firstCalls: FirstCallTiming[]; // in order of first use
+  subsystems: SubsystemInitTiming[]; // initialized lazily, on the thread that first needs them
+}
+
+export type CaptureMethod = 'dwmThumbnail' | 'wgc' | 'printWindowFull' | 'printWindowClient' | 'printWindow' | 'desktopBlt';
+
+export interface RuntimeConfig {
+  captureMethods: CaptureMethod[]; // enabled methods; each window still tries them in the built-in order
+  ttlMs: number; // thumbnail cache lifetime
+  defaultSize: { width: number; height: number }; // thumbnail bounding box
+  codec: {
+    encoder: 'gdiplus' | 'builtin'; // thumbnail/icon PNG encoder; the settings below need 'builtin'
+    pngLevel: number; // 0-9, default 6; 1 trades ~40% larger PNGs for ~1.6x faster encoding
+    palette: boolean; // 8-bit indexed thumbnails: exact for flat UI, smaller but banded for photos
+    dither: boolean; // with palette: Floyd-Steinberg dithering against the banding
+    threads: number; // deflate threads for PNGs over parallelMinBytes of scanlines; 0 = one per core, 1 = never
+    parallelMinBytes: number; // full-screen overviews and captureToFile bands reach it, thumbnails do not
+  };
+  threads: { capture: number; scale: number; encode: number }; // getWindows pipeline stages
+  budgets: {
+    enumerationMs: number; // WindowEnumeration.next() without an explicit budget
+    captureQueue: number; // windows waiting for capture
+    stageQueue: number; // frames between the scale and encode stages
+    stageQueueBytes: number; // full-size frames waiting for the scale stage, in bytes
+  };
+  prefetch: {
+    count: number; // top MRU windows of the current desktop kept fresh; 0 turns prefetch off
+    aheadMs: number; // re-capture this long before a cached thumbnail expires
+    settleMs: number; // wait after a focus change, so rapid Alt-Tab cycling settles first
+    idleMs: number; // stop refreshing this long after the last focus change; 0 never stops
+  };
+}
+
+/** Any subset of RuntimeConfig; omitted fields keep their current value. */
+export interface ConfigureOptions {
+  captureMethods?: CaptureMethod[];
+  ttlMs?: number;
+  defaultSize?: Partial<RuntimeConfig['defaultSize']>;
+  codec?: Partial<RuntimeConfig['codec']>;
+  threads?: Partial<RuntimeConfig['threads']>;
+  budgets?: Partial<RuntimeConfig['budgets']>;
+  prefetch?: Partial<RuntimeConfig['prefetch']>;
+}
+
+export interface TraceSummary {
+  events: number; // events written to the trace file
+  dropped: number; // events dropped because the writer fell behind
+}
+
+export interface EnumerationChunk {
+  windows: WindowInfo[]; // windows completed during this call, in EnumWindows order
+  done: boolean; // true once every window has been processed
+}
+
+export interface DaemonOptions {
+  path?: string; // socket path; defaults to dwm-windows.sock in the temp directory
+  workers?: number; // request threads, 1-32 (default 2)
+}
+
+export interface DaemonInfo {
+  path: string;
+  pid: number; // process serving the socket
+}
+
+export interface DaemonWindowsOptions {
+  includeAllDesktops?: boolean;
+  width?: number; // thumbnail size, 16-4096; defaults to the configured defaultSize
+  height?: number;
+  orderBy?: 'enumeration' | 'mru'; // the daemon tracks focus for as long as it runs
+}
+
+/** A daemon window event, or { type: 'dropped', count } when this client fell behind and lost events */
+export type DaemonEvent =
+  | { type: 'created' | 'closed' | 'focused' | 'minimized' | 'restored'; id: number; hwnd: number; title: string; executablePath: string; className: string; isVisible: boolean }
+  | { type: 'dropped'; count: number };
+
+/**
+ * Time-budgeted synchronous enumeration. Each next(budgetMs) call does as much
+ * filtering/capture work as fits into the budget and returns what completed.
+ * An enumeration left idle for 60 s is released natively and reports done.
+ */
+export class WindowEnumeration {
+  private finished = false;
+
+  constructor(private readonly handle: number) {}
+
+  /** budgetMs defaults to the configured budgets.enumerationMs */
+  public next(budgetMs?: number): EnumerationChunk {
+    if (this.finished) return { windows: [], done: true };
+    try {
+      const chunk: EnumerationChunk = nativeModule.nextEnumeration(this.handle, budgetMs);
+      if (chunk.done) this.finished = true;
+      return chunk;
+    } catch (error) {
+      console.error('Error continuing enumeration:', error);
+      this.finished = true;
+      return { windows: [], done: true };
+    }
+  }
+
+  /** Abandon the enumeration early and release native state. */
+  public cancel(): void {
+    if (this.finished) return;
+    this.finished = true;
+    try { nativeModule.endEnumeration(this.handle); } catch { /* already released */ }
+  }
+}
+
+/**
+ * Connection to a thumbnail daemon (DwmWindows.startDaemon) in another process. Enumeration,
+ * hooks and captures happen in the daemon; requests from all its clients share its cache.
+ */
+export class DaemonClient {
+  private closed = false;
+
+  constructor(private readonly handle: number) {}
+
+  public getWindowsAsync(options: DaemonWindowsOptions = {}): Promise<WindowInfo[]> {
+    return nativeModule.daemonGetWindows(this.handle, options);
+  }
+
+  public updateThumbnailAsync(windowId: number, size?: { width?: number; height?: number }): Promise<string> {
+    return nativeModule.daemonUpdateThumbnail(this.handle, windowId, size);
+  }
+
+  /**
+   * The daemon's window events; null unsubscribes. Only one callback per connection.
+   * Resolves once the daemon confirmed the subscription.
+   */
+  public onWindowChange(callback: ((e: DaemonEvent) => void) | null): Promise<void> {
+    return nativeModule.daemonSubscribe(this.handle, callback);
+  }
+
+  public close(): void {
+    if (this.closed) return;
+    this.closed = true;
+    try { nativeModule.daemonClose(this.handle); } catch { /* already closed */ }
+  }
+}
+
+// Closes the native capture of a stream dropped without being read to the end or destroyed
+const captureStreams = new FinalizationRegistry<number>((handle) => {
+  try { nativeModule.captureStreamClose(handle); } catch { /* already closed */ }
+});
+
+function toNativeOptions(options: GetWindowsOptions): GetWindowsOptions {
+  const nativeOptions: GetWindowsOptions = { includeAllDesktops: !!options.includeAllDesktops };
+  if (options.hedge) nativeOptions.hedge = true;
+  if (typeof options.hedgePercentile === 'number') nativeOptions.hedgePercentile = options.hedgePercentile;
+  if (options.timings) nativeOptions.timings = true;
+  if (options.interned) nativeOptions.interned = true;
+  if (options.sharedFrames) nativeOptions.sharedFrames = true;
+  if (options.orderBy) nativeOptions.orderBy = options.orderBy;
+  return nativeOptions;
 }
 
 export class DwmWindows {
+  // Local copy of the native string table; ids are stable, so only new entries are fetched
+  // until the native side reports a sweep that freed entries
+  private strings: string[] = [];
+  private stringSweeps = 0;
+
   /**
    * Get all windows with their thumbnails
    * @returns Array of window information including base64-encoded thumbnails
    */
-  public getWindows(options?: { includeAllDesktops?: boolean } | boolean): WindowInfo[] {
+  public getWindows(options: GetWindowsOptions & { interned: true }): InternedWindowInfo[];
+  public getWindows(options?: GetWindowsOptions | boolean): WindowInfo[];
+  public getWindows(options?: GetWindowsOptions | boolean): WindowInfo[] | InternedWindowInfo[] {
     try {
       // Back-compat: no args -> current desktop only
       if (options === undefined) return nativeModule.getWindows();
       // Boolean shorthand
       if (typeof options === 'boolean') return nativeModule.getWindows(options);
-      return nativeModule.getWindows({ includeAllDesktops: !!options.includeAllDesktops });
+      return nativeModule.getWindows(toNativeOptions(options));
     } catch (error) {
       console.error('Error getting windows:', error);
       return [];
     }
   }
 
+  /**
+   * Start a chunked synchronous enumeration; call next(budgetMs) repeatedly (e.g. once per
+   * animation frame) until it reports done.
+   */
+  public beginEnumeration(options?: { includeAllDesktops?: boolean } | boolean): WindowEnumeration {
+    const handle: number = options === undefined
+      ? nativeModule.beginEnumeration()
+      : nativeModule.beginEnumeration(typeof options === 'boolean' ? options : { includeAllDesktops: !!options.includeAllDesktops });
+    return new WindowEnumeration(handle);
+  }
+
   /**
    * Async: Get all windows with their thumbnails without blocking the event loop
    */
-  public async getWindowsAsync(options?: { includeAllDesktops?: boolean } | boolean): Promise<WindowInfo[]> {
+  public async getWindowsAsync(options: GetWindowsAsyncOptions & { interned: true }): Promise<InternedWindowInfo[]>;
+  public async getWindowsAsync(options?: GetWindowsAsyncOptions | boolean): Promise<WindowInfo[]>;
+  public async getWindowsAsync(options?: GetWindowsAsyncOptions | boolean): Promise<WindowInfo[] | InternedWindowInfo[]> {
     try {
       if (options === undefined) return await nativeModule.getWindowsAsync();
       if (typeof options === 'boolean') return await nativeModule.getWindowsAsync(options);
-      return await nativeModule.getWindowsAsync({ includeAllDesktops: !!options.includeAllDesktops });
+      const nativeOptions: GetWindowsAsyncOptions = toNativeOptions(options);
+      if (typeof options.deadlineMs === 'number') nativeOptions.deadlineMs = options.deadlineMs;
+      return await nativeModule.getWindowsAsync(nativeOptions);
     } catch (error) {
       console.error('Error getting windows (async):', error);
       return [];
@@ -66,11 +468,25 @@ export class DwmWindows {
   }
 
   /**
-   * Async: Update thumbnail for a specific window without blocking
+   * Async: Update thumbnail for a specific window without blocking.
+   * With { progressive: true }, onPreview first receives a coarse preview of
+   * the same capture (a few ms), then the promise resolves with the final image.
    */
-  public async updateThumbnailAsync(windowId: number): Promise<string> {
+  public async updateThumbnailAsync(windowId: number, options: ThumbnailUpdateOptions = {}): Promise<string> {
     try {
-      return await nativeModule.updateThumbnailAsync(windowId);
+      if (!options.progressive) return await nativeModule.updateThumbnailAsync(windowId);
+      // The preview and the result arrive through different native queues; hold the result until the preview is out
+      let previewDone = () => {};
+      const previewed = new Promise<void>((resolve) => (previewDone = resolve));
+      const result = await nativeModule.updateThumbnailProgressive(windowId, (preview: string) => {
+        try {
+          options.onPreview?.(preview);
+        } finally {
+          previewDone();
+        }
+      });
+      if (result.preview) await previewed;
+      return result.thumbnail;
     } catch (error) {
       console.error('Error updating thumbnail (async):', error);
       return 'data:image/png;base64,';
@@ -133,7 +549,7 @@ export class DwmWindows {
    * Get only visible windows
    * @returns Array of visible windows only
    */
-  public getVisibleWindows(options?: { includeAllDesktops?: boolean } | boolean): WindowInfo[] {
+  public getVisibleWindows(options?: GetWindowsOptions | boolean): WindowInfo[] {
     const windows = this.getWindows(options);
     return windows.filter(window => window.isVisible);
   }
@@ -141,7 +557,7 @@ export class DwmWindows {
   /**
    * Async: Get only visible windows (non-blocking)
    */
-  public async getVisibleWindowsAsync(options?: { includeAllDesktops?: boolean } | boolean): Promise<WindowInfo[]> {
+  public async getVisibleWindowsAsync(options?: GetWindowsAsyncOptions | boolean): Promise<WindowInfo[]> {
     const windows = await this.getWindowsAsync(options);
     return windows.filter(window => window.isVisible);
   }
@@ -161,7 +577,7 @@ export class DwmWindows {
   }
 
   /**
-   * Subscribe to window created events. Callback receives a WindowInfo-like object (id, hwnd, title, executablePath, isVisible) and type: 'created'.
+   * Subscribe to window created events. Callback receives a WindowInfo-like object (id, hwnd, title, executablePath, className, their string table ids, isVisible) and type: 'created'.
    */
   public onWindowCreated(callback: (e: any) => void): void {
     try { nativeModule.onWindowCreated(callback); } catch (e) { console.error('onWindowCreated error:', e); }
@@ -205,6 +621,172 @@ export class DwmWindows {
     try { return !!nativeModule.isUsingFallbackEvents(); } catch { return false; }
   }
 
+  /**
+   * Interned executable paths and class names, indexed by id (executablePathId/classNameId in
+   * results and events; 0 is ''). Only entries added since the last call are fetched. Strings
+   * no window has used for a couple of minutes are freed natively and their ids read as ''.
+   */
+  public getStringTable(): readonly string[] {
+    try {
+      type Delta = { size: number; strings: string[]; sweeps: number };
+      let delta: Delta = nativeModule.getStringTable(this.strings.length);
+      if (delta.sweeps !== this.stringSweeps) {
+        // Entries were freed since the last fetch: refetch so they read as ''
+        delta = nativeModule.getStringTable(0);
+        this.strings = [];
+        this.stringSweeps = delta.sweeps;
+      }
+      for (const s of delta.strings) this.strings.push(s);
+    } catch (e) {
+      console.error('getStringTable error:', e);
+    }
+    return this.strings;
+  }
+
+  /** String for a string table id; fetches new table entries if the id is not known yet. */
+  public resolveString(id: number): string {
+    if (id >= this.strings.length) this.getStringTable();
+    return this.strings[id] ?? '';
+  }
+
+  /**
+   * Start writing native spans (per-window capture/scale/encode, capture method attempts,
+   * WinEvent hook callbacks, event delivery, poller ticks) to a Chrome/Perfetto trace file.
+   * Open the file in chrome://tracing or https://ui.perfetto.dev. Throws if already tracing.
+   */
+  public startTracing(path: string): void {
+    nativeModule.startTracing(path);
+  }
+
+  /** Stop tracing and finish the trace file. */
+  public stopTracing(): TraceSummary {
+    return nativeModule.stopTracing();
+  }
+
+  /** For diagnostics: per-stage queue depth and utilization of the most recent thumbnail pipeline run. */
+  public getCaptureStats(): CaptureStats {
+    try { return nativeModule.getCaptureStats(); } catch (e) { console.error('getCaptureStats error:', e); return { pipeline: [], stages: [], methods: [], hedging: { hedged: 0, hedgeWins: 0, throttled: 0, timeouts: 0 }, negativeCache: { entries: [], skipped: 0 }, prefetch: { tracking: false, trackedWindows: 0, captures: 0, hits: 0, wgcBatches: { batches: 0, windows: 0, wallMs: 0, captureMs: 0 } } }; }
+  }
+
+  /**
+   * Module load time and the latency of each API's first call. Subsystems such as the WinRT
+   * apartment used by WGC are initialized on first use, so their cost shows up there.
+   */
+  public getStartupStats(): StartupStats | null {
+    try { return { requireMs, ...nativeModule.getStartupStats() }; } catch (e) { console.error('getStartupStats error:', e); return null; }
+  }
+
+  /**
+   * Change runtime settings. Omitted fields keep their value; the new configuration is
+   * validated as a whole and applied atomically (TypeError/RangeError and no change otherwise).
+   * Calls already in flight finish with the settings they started with. Returns the result.
+   */
+  public configure(options: ConfigureOptions): RuntimeConfig {
+    return nativeModule.configure(options);
+  }
+
+  public getConfig(): RuntimeConfig {
+    return nativeModule.getConfig();
+  }
+
+  /**
+   * Create the shared-memory frame ring that getWindows({ sharedFrames: true }) writes into.
+   * Other processes map it by the returned name and read frames by handle, without copies
+   * through V8 or IPC. Replaces a previously enabled ring.
+   */
+  public enableSharedFrames(options: SharedFramesOptions = {}): SharedFramesInfo {
+    return nativeModule.enableSharedFrames(options);
+  }
+
+  public disableSharedFrames(): void {
+    nativeModule.disableSharedFrames();
+  }
+
+  /**
+   * Serve this process's windows, thumbnails and events to other processes over a local
+   * socket (AF_UNIX; Windows 10 1803+). Fails if a daemon is already listening on the path.
+   * The process must stay alive for the daemon to serve; see dist/daemon.js.
+   */
+  public startDaemon(options: DaemonOptions = {}): DaemonInfo {
+    return nativeModule.startDaemon(options);
+  }
+
+  /** Disconnect all clients and remove the socket. */
+  public stopDaemon(): void {
+    nativeModule.stopDaemon();
+  }
+
+  /**
+   * Full-resolution PNG of a window, written to path as it is encoded. Rows are encoded in
+   * bands and written from a background thread, so memory stays at the capture surface plus
+   * a few hundred KiB, whatever the window size. Rejects (and removes the partial file) if
+   * the window cannot be captured or the file cannot be written. Minimized windows are rejected.
+   */
+  public captureToFile(windowId: number, path: string, options: FullCaptureOptions = {}): Promise<CaptureFileInfo> {
+    return nativeModule.captureToFile(windowId, path, options);
+  }
+
+  /**
+   * captureToFile as a Readable of PNG bytes. Encoding waits for the consumer: a chunk is
+   * encoded only once the stream asks for it. Destroying the stream, or dropping it unread,
+   * stops the capture.
+   */
+  public captureToStream(windowId: number, options: FullCaptureOptions = {}): Readable {
+    // The native callback must not keep the stream reachable, or a dropped one is never collected
+    let stream: WeakRef<Readable> | undefined;
+    const token = {};
+    let open = true;
+    const close = () => {
+      if (!open) return;
+      open = false;
+      captureStreams.unregister(token);
+      nativeModule.captureStreamClose(handle);
+    };
+    const handle: number = nativeModule.captureStreamOpen(windowId, options, (chunk: Buffer | null, error?: string) => {
+      const target = stream?.deref();
+      if (!target) return;
+      if (chunk === null) close();
+      if (error !== undefined) target.destroy(new Error(error));
+      else target.push(chunk);
+    });
+    const readable = new Readable({
+      read() {
+        if (open) nativeModule.captureStreamRead(handle);
+      },
+      destroy(error, callback) {
+        close();
+        callback(error);
+      },
+    });
+    stream = new WeakRef(readable);
+    captureStreams.register(readable, handle, token);
+    return readable;
+  }
+
+  /** Connect to a running daemon as a thin client. path defaults to the daemon's default. */
+  public async connectDaemon(path?: string): Promise<DaemonClient> {
+    const handle: number = await nativeModule.daemonConnect(path);
+    return new DaemonClient(handle);
+  }
+
+  /** Bytes held per native subsystem, per-capture peak allocation, process memory and GDI/USER object counts. */
+  public getMemoryStats(): MemoryStats | null {
+    try { return nativeModule.getMemoryStats(); } catch (e) { console.error('getMemoryStats error:', e); return null; }
+  }
+
+  /**
+   * Replace the memory warning thresholds (bytes; object counts for gdiObjects/userObjects).
+   * Checked after each enumeration/thumbnail update and poller tick; null clears them.
+   */
+  public setMemoryThresholds(thresholds: Partial<Record<MemoryMetric, number>> | null): void {
+    nativeModule.setMemoryThresholds(thresholds);
+  }
+
+  /** Called once when a metric reaches its threshold; re-armed after it drops below 90% of it. null unsubscribes. */
+  public onMemoryWarning(callback: ((warning: MemoryWarning) => void) | null): void {
+    try { nativeModule.onMemoryWarning(callback); } catch (e) { console.error('onMemoryWarning error:', e); }
+  }
+
   /** Unified window change event: created/closed/focused/minimized/restored (e.type). */
   public onWindowChange(callback: (e: any) => void): void {
     try { nativeModule.onWindowChange(callback); } catch (e) { console.error('onWindowChange error:', e); }
@@ -213,4 +795,4 @@ export class DwmWindows {
 
 // Create and export default instance
 const dwmWindows = new DwmWindows();
-export default dwmWindows;
\ No newline at end of file
+export default dwmWindows;
\ No newline at end of file
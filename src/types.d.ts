@@ -2,10 +2,270 @@ export interface WindowInfo {
   id: number; // equals hwnd (native window handle)
   title: string;
   executablePath: string;
+  executablePathId: number; // string table id (getStringTable)
+  className: string;
+  classNameId: number;
   isVisible: boolean;
   hwnd: number; // same as id
-  thumbnail: string; // data URL (PNG base64)
+  thumbnail: string; // data URL (PNG base64); '' when the capture went to the shared frame ring
   icon: string; // data URL (PNG base64)
+  pending?: boolean; // getWindowsAsync deadline hit: thumbnail is a stale cached frame or a placeholder
+  frame?: SharedFrameHandle; // only with { sharedFrames: true } and a fresh capture
+  timings?: WindowTimings; // only with { timings: true }
+}
+
+/** A frame in the shared-memory ring; valid for the next slots - 1 captures */
+export interface SharedFrameHandle {
+  slot: number;
+  sequence: number;
+  width: number;
+  height: number;
+}
+
+export interface SharedFramesOptions {
+  name?: string;
+  slots?: number;
+  slotBytes?: number;
+}
+
+export interface SharedFramesInfo {
+  name: string;
+  slots: number;
+  slotBytes: number;
+  bytes: number;
+}
+
+export interface FullCaptureOptions {
+  level?: number; // PNG deflate level 0-9, default 6
+  bandRows?: number; // rows captured and encoded per step, 1-4096 (default 64)
+}
+
+export interface CaptureFileInfo {
+  path: string;
+  width: number;
+  height: number;
+  bytes: number;
+}
+
+export interface ThumbnailUpdateOptions {
+  /** Deliver a coarse preview to onPreview before the final image, from the same capture */
+  progressive?: boolean;
+  onPreview?: (thumbnail: string) => void;
+}
+
+/** With { interned: true }: path and class only as string table ids */
+export type InternedWindowInfo = Omit<WindowInfo, 'executablePath' | 'className'>;
+
+export interface WindowTimings {
+  predicateMs?: number;
+  virtualDesktopMs?: number;
+  exePathMs?: number;
+  iconMs?: number;
+  captureMs?: number;
+  scaleMs?: number;
+  pngEncodeMs?: number;
+  base64Ms?: number;
+  marshalMs?: number;
+}
+
+export interface GetWindowsOptions {
+  includeAllDesktops?: boolean;
+  hedge?: boolean; // start the next capture method in parallel when one runs past its usual latency
+  hedgePercentile?: number; // latency percentile used as the hedge threshold (default 90)
+  timings?: boolean; // attach WindowInfo.timings
+  interned?: boolean; // omit executablePath/className, keep only their string table ids
+  sharedFrames?: boolean; // fresh captures go to the shared frame ring (WindowInfo.frame)
+  orderBy?: 'enumeration' | 'mru'; // 'mru': most recently focused first; starts focus tracking and prefetch
+}
+
+export interface GetWindowsAsyncOptions extends GetWindowsOptions {
+  deadlineMs?: number; // hard latency bound; unfinished windows come back with pending: true
+}
+
+export interface PipelineStageStats {
+  name: string; // 'capture' | 'scale' | 'encode'
+  concurrency: number;
+  queueCapacity: number;
+  queueDepth: number;
+  maxQueueDepth: number;
+  queueBytes?: number;
+  queueBytesLimit?: number;
+  processed: number;
+  busyMs: number;
+  utilization: number; // busy time / (wall time * concurrency), 0..1
+}
+
+export interface CaptureMethodStats {
+  name: string;
+  attempts: number;
+  failures: number;
+  wins: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+  hedgeThresholdMs: number;
+}
+
+export interface NegativeCacheEntry {
+  hwnd: number;
+  pid: number;
+  method: string;
+  failures: number;
+  retryInMs: number;
+}
+
+export interface StageTimingStats {
+  name: string;
+  count: number;
+  meanMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+}
+
+export interface CaptureStats {
+  pipeline: PipelineStageStats[];
+  stages: StageTimingStats[];
+  methods: CaptureMethodStats[];
+  hedging: { hedged: number; hedgeWins: number; throttled: number; timeouts: number };
+  negativeCache: { entries: NegativeCacheEntry[]; skipped: number };
+  prefetch: { tracking: boolean; trackedWindows: number; captures: number; hits: number; wgcBatches: { batches: number; windows: number; wallMs: number; captureMs: number } };
+}
+
+export interface MemoryCategoryStats {
+  bytes: number;
+  peakBytes: number;
+  /** Live allocations (cache entries, queued payloads, in-flight frames) */
+  allocations: number;
+  /** Cache categories only */
+  entries?: number;
+}
+
+/** Metric names accepted by setMemoryThresholds */
+export type MemoryMetric =
+  | 'thumbnailCache' | 'iconCache' | 'captureBuffers' | 'eventPayloads' | 'wgcCapture' | 'stringTable' | 'sharedFrames'
+  | 'total' | 'privateBytes' | 'gdiObjects' | 'userObjects';
+
+export interface MemoryStats {
+  /** Sum of all categories */
+  totalBytes: number;
+  categories: {
+    thumbnailCache: MemoryCategoryStats;
+    iconCache: MemoryCategoryStats;
+    captureBuffers: MemoryCategoryStats;
+    eventPayloads: MemoryCategoryStats;
+    wgcCapture: MemoryCategoryStats;
+    stringTable: MemoryCategoryStats;
+    sharedFrames: MemoryCategoryStats;
+  };
+  /** Largest transient allocation (bitmaps + frame) per capture attempt */
+  capture: { attempts: number; peakBytes: number; meanPeakBytes: number };
+  process: {
+    privateBytes: number;
+    workingSetBytes: number;
+    peakWorkingSetBytes: number;
+    gdiObjects: number;
+    gdiObjectsPeak: number;
+    userObjects: number;
+    userObjectsPeak: number;
+  };
+  thresholds: Partial<Record<MemoryMetric, number>>;
+}
+
+export interface MemoryWarning {
+  metric: MemoryMetric;
+  value: number;
+  threshold: number;
+}
+
+export interface FirstCallTiming {
+  name: string;
+  latencyMs: number; // async APIs: until the promise resolved
+  sinceLoadMs: number;
+}
+
+export interface SubsystemInitTiming {
+  name: string; // 'winrtApartment' | 'captureWindowClass'
+  initMs: number;
+  sinceLoadMs: number;
+  count: number;
+}
+
+export interface StartupStats {
+  requireMs: number;
+  loadMs: number;
+  firstCalls: FirstCallTiming[];
+  subsystems: SubsystemInitTiming[];
+}
+
+export type CaptureMethod = 'dwmThumbnail' | 'wgc' | 'printWindowFull' | 'printWindowClient' | 'printWindow' | 'desktopBlt';
+
+export interface RuntimeConfig {
+  /** Enabled capture methods; each window still tries them in the built-in order */
+  captureMethods: CaptureMethod[];
+  ttlMs: number;
+  defaultSize: { width: number; height: number };
+  /** threads: deflate threads for PNGs with at least parallelMinBytes of scanlines (0 = one per core, 1 = never) */
+  codec: { encoder: 'gdiplus' | 'builtin'; pngLevel: number; palette: boolean; dither: boolean; threads: number; parallelMinBytes: number };
+  threads: { capture: number; scale: number; encode: number };
+  budgets: { enumerationMs: number; captureQueue: number; stageQueue: number; stageQueueBytes: number };
+  /** Background refresh of the top MRU thumbnails; count 0 turns it off, idleMs 0 never stops */
+  prefetch: { count: number; aheadMs: number; settleMs: number; idleMs: number };
+}
+
+export interface ConfigureOptions {
+  captureMethods?: CaptureMethod[];
+  ttlMs?: number;
+  defaultSize?: Partial<RuntimeConfig['defaultSize']>;
+  codec?: Partial<RuntimeConfig['codec']>;
+  threads?: Partial<RuntimeConfig['threads']>;
+  budgets?: Partial<RuntimeConfig['budgets']>;
+  prefetch?: Partial<RuntimeConfig['prefetch']>;
+}
+
+export interface TraceSummary {
+  events: number;
+  dropped: number;
+}
+
+export interface EnumerationChunk {
+  windows: WindowInfo[];
+  done: boolean;
+}
+
+export interface WindowEnumeration {
+  next(budgetMs?: number): EnumerationChunk;
+  cancel(): void;
+}
+
+export interface DaemonOptions {
+  path?: string;
+  workers?: number;
+}
+
+export interface DaemonInfo {
+  path: string;
+  pid: number;
+}
+
+export interface DaemonWindowsOptions {
+  includeAllDesktops?: boolean;
+  width?: number;
+  height?: number;
+  orderBy?: 'enumeration' | 'mru';
+}
+
+export type DaemonEvent =
+  | { type: 'created' | 'closed' | 'focused' | 'minimized' | 'restored'; id: number; hwnd: number; title: string; executablePath: string; className: string; isVisible: boolean }
+  | { type: 'dropped'; count: number };
+
+export interface DaemonClient {
+  getWindowsAsync(options?: DaemonWindowsOptions): Promise<WindowInfo[]>;
+  updateThumbnailAsync(windowId: number, size?: { width?: number; height?: number }): Promise<string>;
+  onWindowChange(callback: ((e: DaemonEvent) => void) | null): Promise<void>;
+  close(): void;
 }
 
 export interface DwmWindows {
@@ -14,9 +274,22 @@ export interface DwmWindows {
    * @returns Array of window information including base64-encoded thumbnails
    */
   getWindows(): WindowInfo[];
-  getWindows(options: { includeAllDesktops?: boolean } | boolean): WindowInfo[];
+  getWindows(options: GetWindowsOptions & { interned: true }): InternedWindowInfo[];
+  getWindows(options: GetWindowsOptions | boolean): WindowInfo[];
   getWindowsAsync(): Promise<WindowInfo[]>;
-  getWindowsAsync(options: { includeAllDesktops?: boolean } | boolean): Promise<WindowInfo[]>;
+  getWindowsAsync(options: GetWindowsAsyncOptions & { interned: true }): Promise<InternedWindowInfo[]>;
+  getWindowsAsync(options: GetWindowsAsyncOptions | boolean): Promise<WindowInfo[]>;
+
+  /**
+   * Interned executable paths and class names by id (0 is ''); fetches only new entries
+   */
+  getStringTable(): readonly string[];
+  resolveString(id: number): string;
+
+  /**
+   * Chunked synchronous enumeration: each next(budgetMs) call returns the windows completed within the budget
+   */
+  beginEnumeration(options?: { includeAllDesktops?: boolean } | boolean): WindowEnumeration;
 
   /**
    * Update thumbnail for a specific window
@@ -24,7 +297,7 @@ export interface DwmWindows {
    * @returns Updated base64-encoded thumbnail
    */
   updateThumbnail(windowId: number): string;
-  updateThumbnailAsync(windowId: number): Promise<string>;
+  updateThumbnailAsync(windowId: number, options?: ThumbnailUpdateOptions): Promise<string>;
 
   /**
    * Bring a window to the foreground and focus it
@@ -34,8 +307,8 @@ export interface DwmWindows {
   openWindow(windowId: number): boolean;
   openWindowAsync(windowId: number): Promise<boolean>;
 
-  getVisibleWindows(options?: { includeAllDesktops?: boolean } | boolean): WindowInfo[];
-  getVisibleWindowsAsync(options?: { includeAllDesktops?: boolean } | boolean): Promise<WindowInfo[]>;
+  getVisibleWindows(options?: GetWindowsOptions | boolean): WindowInfo[];
+  getVisibleWindowsAsync(options?: GetWindowsAsyncOptions | boolean): Promise<WindowInfo[]>;
   getWindowsAllDesktops(): WindowInfo[];
   getWindowsAllDesktopsAsync(): Promise<WindowInfo[]>;
 
@@ -48,9 +321,33 @@ export interface DwmWindows {
   onWindowChange(callback: (e: any) => void): void; // unified: e.type in {created,closed,focused,minimized,restored}
   stopWindowEvents(): void;
 
+  // Runtime configuration (atomic, validated as a whole)
+  configure(options: ConfigureOptions): RuntimeConfig;
+  getConfig(): RuntimeConfig;
+
+  // Shared-memory frame export (read in other processes with frame_ring.h)
+  enableSharedFrames(options?: SharedFramesOptions): SharedFramesInfo;
+  disableSharedFrames(): void;
+
+  // Full-resolution PNG, encoded in bands and written as it goes (bounded memory)
+  captureToFile(windowId: number, path: string, options?: FullCaptureOptions): Promise<CaptureFileInfo>;
+  captureToStream(windowId: number, options?: FullCaptureOptions): import('stream').Readable;
+
+  // Thumbnail daemon over a local socket: one process captures, many connect
+  startDaemon(options?: DaemonOptions): DaemonInfo;
+  stopDaemon(): void;
+  connectDaemon(path?: string): Promise<DaemonClient>;
+
   // Diagnostics
   isUsingFallbackEvents(): boolean;
+  getCaptureStats(): CaptureStats;
+  getMemoryStats(): MemoryStats;
+  getStartupStats(): StartupStats | null;
+  setMemoryThresholds(thresholds: Partial<Record<MemoryMetric, number>> | null): void;
+  onMemoryWarning(callback: ((warning: MemoryWarning) => void) | null): void;
+  startTracing(path: string): void;
+  stopTracing(): TraceSummary;
 }
 
 declare const dwmWindows: DwmWindows;
-export default dwmWindows;
\ No newline at end of file
+export default dwmWindows;
\ No newline at end of file
@@ -0,0 +1,99 @@
+// Per-stage timing instrumentation. Scoped timers feed a process-wide
+// histogram per stage and, when a breakdown is bound to the current thread,
+// a per-window total. Build with DWM_STAGE_TIMING=0 to compile every timer out.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#ifndef DWM_STAGE_TIMING
+#define DWM_STAGE_TIMING 1
+#endif
+
+#include <chrono>
+#include <cstdint>
+
+#include "latency_histogram.h"
+
+namespace dwm {
+
+constexpr bool kStageTimingEnabled = DWM_STAGE_TIMING != 0;
+
+enum class TimedStage : int {
+    Enumerate = 0,  // whole EnumWindows walk
+    Predicate,      // Alt-Tab eligibility filter
+    VirtualDesktop, // IVirtualDesktopManager checks
+    ExePath,        // process image path lookup
+    Icon,           // icon fetch, including its PNG encode
+    Capture,        // CaptureWindowFrame; per-method attempts are in the method stats
+    Scale,
+    PngEncode,
+    Base64,
+    Marshal,        // result -> JS object
+    Count
+};
+
+inline const char* TimedStageName(TimedStage stage) {
+    static const char* const names[(int)TimedStage::Count] = {
+        "enumerate", "predicate", "virtualDesktop", "exePath", "icon",
+        "capture", "scale", "pngEncode", "base64", "marshal"
+    };
+    int i = (int)stage;
+    return (i >= 0 && i < (int)TimedStage::Count) ? names[i] : "unknown";
+}
+
+inline LatencyHistogram& StageHistogram(TimedStage stage) {
+    static LatencyHistogram histograms[(int)TimedStage::Count];
+    return histograms[(int)stage];
+}
+
+// Per-window totals; a stage hit several times for one window is summed.
+struct StageBreakdown {
+    uint64_t ns[(int)TimedStage::Count]{};
+    void Add(TimedStage stage, uint64_t d) { ns[(int)stage] += d; }
+};
+
+#if DWM_STAGE_TIMING
+
+inline StageBreakdown*& CurrentBreakdown() {
+    static thread_local StageBreakdown* current = nullptr;
+    return current;
+}
+
+// Binds a breakdown to this thread for the scope (nullptr = none).
+class ScopedBreakdown {
+public:
+    explicit ScopedBreakdown(StageBreakdown* b) : prev_(CurrentBreakdown()) { CurrentBreakdown() = b; }
+    ~ScopedBreakdown() { CurrentBreakdown() = prev_; }
+    ScopedBreakdown(const ScopedBreakdown&) = delete;
+    ScopedBreakdown& operator=(const ScopedBreakdown&) = delete;
+private:
+    StageBreakdown* prev_;
+};
+
+class ScopedStageTimer {
+public:
+    explicit ScopedStageTimer(TimedStage stage) : stage_(stage), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedStageTimer() {
+        auto d = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_);
+        StageHistogram(stage_).Record(d);
+        if (StageBreakdown* b = CurrentBreakdown()) b->Add(stage_, (uint64_t)d.count());
+    }
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+private:
+    TimedStage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#define DWM_TIMING_CONCAT_(a, b) a##b
+#define DWM_TIMING_CONCAT(a, b) DWM_TIMING_CONCAT_(a, b)
+#define DWM_TIME_STAGE(stage) ::dwm::ScopedStageTimer DWM_TIMING_CONCAT(dwmStageTimer_, __LINE__)(::dwm::TimedStage::stage)
+#define DWM_BIND_BREAKDOWN(ptr) ::dwm::ScopedBreakdown DWM_TIMING_CONCAT(dwmBreakdown_, __LINE__)(ptr)
+
+#else
+
+#define DWM_TIME_STAGE(stage) ((void)0)
+#define DWM_BIND_BREAKDOWN(ptr) ((void)0)
+
+#endif
+
+} // namespace dwm
@@ -0,0 +1,114 @@
+// Module load time, first-call latency per API and lazy subsystem init cost.
+// Subsystems (WinRT apartments, the capture window class) are initialized on
+// first use, on the thread that needs them, so their cost moves out of
+// require() into the first call that needs them; this records both sides.
+// After its first call an entry point only pays one atomic load.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dwm {
+
+struct StartupEntry {
+    std::string name;
+    double latencyMs{0};   // first call (API) or first initialization (subsystem)
+    double sinceLoadMs{0}; // when it started, relative to the start of the module load
+    uint64_t count{0};     // subsystems: initializations so far (e.g. one per thread)
+};
+
+class StartupTiming {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static StartupTiming& Instance() {
+        static StartupTiming instance;
+        return instance;
+    }
+
+    // The load starts when Instance() is first used, i.e. during static initialization
+    Clock::time_point LoadStart() const { return loadStart_; }
+
+    void MarkLoaded() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loadMs_ = Ms(Clock::now() - loadStart_);
+    }
+    double LoadMs() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return loadMs_;
+    }
+
+    void RecordFirstCall(const char* api, Clock::time_point start, Clock::time_point end) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const StartupEntry& e : apis_) if (e.name == api) return;
+        apis_.push_back({ api, Ms(end - start), Ms(start - loadStart_), 1 });
+    }
+
+    // Every initialization counts; the first one's timing is kept
+    void RecordInit(const char* subsystem, Clock::time_point start, Clock::time_point end) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (StartupEntry& e : subsystems_) {
+            if (e.name == subsystem) { e.count++; return; }
+        }
+        subsystems_.push_back({ subsystem, Ms(end - start), Ms(start - loadStart_), 1 });
+    }
+
+    // In order of first use
+    std::vector<StartupEntry> Apis() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return apis_;
+    }
+    std::vector<StartupEntry> Subsystems() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return subsystems_;
+    }
+
+private:
+    StartupTiming() : loadStart_(Clock::now()) {}
+    static double Ms(Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); }
+
+    const Clock::time_point loadStart_;
+    mutable std::mutex mutex_;
+    double loadMs_{0};
+    std::vector<StartupEntry> apis_;
+    std::vector<StartupEntry> subsystems_;
+};
+
+// One per API entry point (a static), shared by all its calls
+struct FirstCallSite {
+    explicit FirstCallSite(const char* n) : name(n) {}
+    const char* name;
+    std::atomic<bool> seen{false};
+};
+
+// Times its own lifetime if it belongs to the first call of its site: the
+// scope of a sync call, or an async worker from the call until it resolves.
+class FirstCallTimer {
+public:
+    explicit FirstCallTimer(FirstCallSite& site)
+        : site_(site.seen.load(std::memory_order_relaxed) ? nullptr : &site) {
+        if (site_) start_ = StartupTiming::Clock::now();
+    }
+    ~FirstCallTimer() {
+        if (site_ && !site_->seen.exchange(true)) {
+            StartupTiming::Instance().RecordFirstCall(site_->name, start_, StartupTiming::Clock::now());
+        }
+    }
+    FirstCallTimer(const FirstCallTimer&) = delete;
+    FirstCallTimer& operator=(const FirstCallTimer&) = delete;
+
+private:
+    FirstCallSite* site_;
+    StartupTiming::Clock::time_point start_{};
+};
+
+#define DWM_FIRST_CALL(api) \
+    static ::dwm::FirstCallSite dwmFirstCallSite_(api); \
+    ::dwm::FirstCallTimer dwmFirstCallTimer_(dwmFirstCallSite_)
+
+} // namespace dwm
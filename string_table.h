@@ -0,0 +1,139 @@
+// Interned window strings. Executable paths and class names repeat across
+// dozens of windows and in every event payload, so each distinct value is
+// stored once and referred to by a small id. Ids are dense, never reused or
+// reassigned, and 0 is always the empty string: a consumer that has seen ids
+// [0, n) only ever needs the entries from n on, so the table is delivered
+// once and then only when it grows. Lookups take a view, so a hit
+// allocates nothing. Not every string is long-lived: WPF and other
+// frameworks put a GUID in their class names, one per process, so the owner
+// calls Sweep() periodically and entries not interned for a whole generation
+// are freed. A freed id then reads as the empty string; interning the same
+// string again hands out a new id. Memory is bounded by the strings of the
+// windows seen in the last two generations, plus nothing per freed id.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "memory_accounting.h"
+
+namespace dwm {
+
+using StringId = uint32_t;
+
+class StringTable {
+public:
+    static constexpr StringId kEmpty = 0;
+
+    StringTable() = default;
+    StringTable(const StringTable&) = delete;
+    StringTable& operator=(const StringTable&) = delete;
+
+    // One plain mutex: lookups are short and rarely contended (enumeration and
+    // the hook thread), and it measured cheaper than a shared_mutex here.
+    StringId Intern(std::u16string_view s) {
+        if (s.empty()) return kEmpty;
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = ids_.find(s);
+        if (it != ids_.end()) {
+            entries_.find(it->second)->second.generation = generation_;
+            return it->second;
+        }
+        StringId id = size_.load(std::memory_order_relaxed);
+        Entry& e = entries_[id];
+        e.value = s;
+        e.generation = generation_;
+        // Keys view the entries' strings; map nodes never move
+        ids_.emplace(std::u16string_view(e.value), id);
+        bytes_ += EntryBytes(e.value);
+        charge_.Set(bytes_);
+        size_.store(id + 1, std::memory_order_release);
+        return id;
+    }
+
+    // Unknown and freed ids read as the empty string
+    std::u16string Get(StringId id) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(id);
+        return it == entries_.end() ? std::u16string() : it->second.value;
+    }
+
+    // Entries [first, end) in id order under one lock; freed ids are empty
+    void Range(StringId first, StringId end, std::vector<std::u16string>& out) const {
+        out.clear();
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (StringId id = first; id < end; ++id) {
+            auto it = entries_.find(id);
+            out.push_back(it == entries_.end() ? std::u16string() : it->second.value);
+        }
+    }
+
+    // Ids handed out so far, i.e. the next id; grows by one per new string
+    StringId Size() const { return size_.load(std::memory_order_acquire); }
+
+    // Frees the entries not interned during this generation or the previous
+    // one, starts the next generation and returns the freed ids. An id
+    // interned just before a sweep therefore survives at least one more, so
+    // a result or event still being marshalled keeps resolving.
+    std::vector<StringId> Sweep() {
+        std::vector<StringId> freed;
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            if (it->second.generation + 1 < generation_) {
+                freed.push_back(it->first);
+                ids_.erase(std::u16string_view(it->second.value));
+                bytes_ -= EntryBytes(it->second.value);
+                it = entries_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        generation_++;
+        if (!freed.empty()) {
+            charge_.Set(bytes_);
+            sweeps_.fetch_add(1, std::memory_order_release);
+        }
+        return freed;
+    }
+
+    // Sweeps that freed at least one entry. A consumer that copied entries
+    // under an older count refetches from id 0 to drop the freed ones.
+    uint32_t Sweeps() const { return sweeps_.load(std::memory_order_acquire); }
+
+    // Entries currently held
+    size_t Live() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+private:
+    struct Entry {
+        std::u16string value;
+        uint64_t generation{0}; // last generation the string was interned in
+    };
+
+    // Two hash nodes, roughly
+    static constexpr size_t kEntryOverhead = 64;
+
+    static size_t EntryBytes(const std::u16string& s) {
+        return sizeof(Entry) + (s.size() + 1) * sizeof(char16_t) + kEntryOverhead;
+    }
+
+    mutable std::mutex mutex_;
+    std::unordered_map<StringId, Entry> entries_; // kEmpty is never stored
+    std::unordered_map<std::u16string_view, StringId> ids_;
+    std::atomic<StringId> size_{1};
+    std::atomic<uint32_t> sweeps_{0};
+    uint64_t generation_{0};
+    size_t bytes_{0};
+    MemoryCharge charge_{ MemoryCategory::StringTable };
+};
+
+} // namespace dwm
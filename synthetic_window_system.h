@@ -0,0 +1,351 @@
+// Simulated desktop implementing WindowSystem: N windows with deterministic
+// titles, sizes and content, a mix of windows the Alt-Tab filter must reject,
+// content changes, focus/minimize churn and event storms, plus configurable
+// capture latency and failures. Lets the addon's logic run headless (Linux CI,
+// benchmarks, load tests). All methods are thread-safe; events go to the sink
+// synchronously on the thread that caused them.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "base64.h"
+#include "image_frame.h"
+#include "png_encoder.h"
+#include "utf16.h"
+#include "window_system.h"
+
+namespace dwm {
+
+struct SyntheticDesktopConfig {
+    size_t windows{20};
+    uint64_t seed{1};
+    double ineligibleFraction{0.25};   // tool windows, owned popups, tiny and cloaked hosts
+    double minimizedFraction{0.1};
+    double otherDesktopFraction{0.1};
+    int minWidth{480}, maxWidth{1920};
+    int minHeight{360}, maxHeight{1080};
+    std::chrono::microseconds captureLatency{0}; // slept per Capture call
+    double captureFailureRate{0.0};    // fraction of windows that can never be captured (DRM-like)
+    bool manualClock{false};           // NowMs only moves with AdvanceClock
+};
+
+class SyntheticWindowSystem : public WindowSystem {
+public:
+    explicit SyntheticWindowSystem(const SyntheticDesktopConfig& config = SyntheticDesktopConfig())
+        : config_(config), rng_(config.seed ? config.seed : 1), start_(std::chrono::steady_clock::now()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < config_.windows; ++i) CreateLocked(RollEligible());
+        if (!order_.empty()) foreground_ = order_.front();
+    }
+
+    // ---- Simulation controls ----
+
+    WindowId OpenWindow(bool eligible = true) {
+        WindowId id;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            id = CreateLocked(eligible);
+        }
+        Emit({ WindowEventType::Created, id });
+        return id;
+    }
+
+    bool CloseWindow(WindowId id) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!windows_.erase(id)) return false;
+            order_.erase(std::remove(order_.begin(), order_.end(), id), order_.end());
+            if (foreground_ == id) foreground_ = order_.empty() ? 0 : order_.front();
+        }
+        Emit({ WindowEventType::Closed, id });
+        return true;
+    }
+
+    bool Focus(WindowId id) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = windows_.find(id);
+            if (it == windows_.end()) return false;
+            it->second.attrs.minimized = false;
+            order_.erase(std::remove(order_.begin(), order_.end(), id), order_.end());
+            order_.insert(order_.begin(), id);
+            foreground_ = id;
+        }
+        Emit({ WindowEventType::Focused, id });
+        return true;
+    }
+
+    bool SetMinimized(WindowId id, bool minimized) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = windows_.find(id);
+            if (it == windows_.end() || it->second.attrs.minimized == minimized) return false;
+            it->second.attrs.minimized = minimized;
+            if (minimized && foreground_ == id) foreground_ = 0;
+        }
+        Emit({ minimized ? WindowEventType::Minimized : WindowEventType::Restored, id });
+        return true;
+    }
+
+    // New content for the window (the next capture differs).
+    bool TouchContent(WindowId id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = windows_.find(id);
+        if (it == windows_.end()) return false;
+        it->second.version++;
+        return true;
+    }
+
+    // Changes the content of `count` random windows.
+    void ChangeContent(size_t count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (order_.empty()) return;
+        for (size_t i = 0; i < count; ++i) windows_[order_[NextLocked() % order_.size()]].version++;
+    }
+
+    // `count` random create/close/focus/minimize/restore events, as fast as possible.
+    // The window count stays around its current value.
+    void EventStorm(size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            WindowId target = 0;
+            uint64_t roll;
+            size_t live;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                roll = NextLocked() % 100;
+                live = order_.size();
+                if (live) target = order_[NextLocked() % live];
+            }
+            if (!target || roll < 10) {
+                WindowId id = OpenWindow(RollEligibleUnlocked());
+                if (live >= config_.windows) CloseWindow(target ? target : id);
+            } else if (roll < 20) {
+                CloseWindow(target);
+                OpenWindow(RollEligibleUnlocked());
+            } else if (roll < 70) {
+                Focus(target);
+            } else {
+                bool minimized;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    auto it = windows_.find(target);
+                    minimized = it != windows_.end() && it->second.attrs.minimized;
+                }
+                SetMinimized(target, !minimized);
+            }
+        }
+    }
+
+    void AdvanceClock(std::chrono::milliseconds d) { manualMs_.fetch_add((uint64_t)d.count()); }
+
+    uint64_t ContentVersion(WindowId id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = windows_.find(id);
+        return it == windows_.end() ? 0 : it->second.version;
+    }
+
+    size_t WindowCount() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return order_.size();
+    }
+
+    uint64_t Captures() const { return captures_.load(); }
+
+    // ---- WindowSystem ----
+
+    void EnumerateTopLevel(std::vector<WindowId>& out) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out = order_;
+    }
+
+    bool IsAlive(WindowId window) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return windows_.count(window) != 0;
+    }
+
+    bool GetAttributes(WindowId window, WindowAttributes& out) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = windows_.find(window);
+        if (it == windows_.end()) return false;
+        out = it->second.attrs;
+        return true;
+    }
+
+    bool GetRect(WindowId window, WindowRect& out) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = windows_.find(window);
+        if (it == windows_.end()) return false;
+        out = it->second.attrs.rect;
+        return true;
+    }
+
+    bool IsMinimized(WindowId window) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = windows_.find(window);
+        return it != windows_.end() && it->second.attrs.minimized;
+    }
+
+    bool IsOnCurrentDesktop(WindowId window) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = windows_.find(window);
+        return it != windows_.end() && it->second.onCurrentDesktop;
+    }
+
+    WindowId Foreground() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return foreground_;
+    }
+
+    bool Capture(WindowId window, int maxW, int maxH, Frame& out) override {
+        SimWindow w;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = windows_.find(window);
+            if (it == windows_.end()) return false;
+            w = it->second;
+        }
+        captures_.fetch_add(1);
+        if (config_.captureLatency.count() > 0) std::this_thread::sleep_for(config_.captureLatency);
+        if (w.captureFails) return false;
+        int tw = 0, th = 0;
+        FitWithin(w.attrs.rect.Width(), w.attrs.rect.Height(), maxW, maxH, tw, th);
+        RenderContent(w, tw, th, out);
+        return true;
+    }
+
+    std::string IconDataUrl(WindowId window, int size) override {
+        uint32_t color;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = windows_.find(window);
+            if (it == windows_.end() || size <= 0) return "data:image/png;base64,";
+            color = it->second.color;
+        }
+        Frame icon;
+        icon.Allocate(size, size);
+        for (size_t i = 0; i < icon.pixels.size(); i += 4) {
+            icon.pixels[i] = (uint8_t)color; icon.pixels[i + 1] = (uint8_t)(color >> 8);
+            icon.pixels[i + 2] = (uint8_t)(color >> 16); icon.pixels[i + 3] = 255;
+        }
+        std::vector<uint8_t> png;
+        EncodePng(icon, PngEncodeOptions{ 1 }, png);
+        return Base64DataUrl("image/png", png.data(), png.size());
+    }
+
+    bool SetEventSink(WindowEventSink sink) override {
+        std::lock_guard<std::mutex> lock(sinkMutex_);
+        sink_ = std::move(sink);
+        return true;
+    }
+
+    uint64_t NowMs() override {
+        if (config_.manualClock) return manualMs_.load();
+        return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    struct SimWindow {
+        WindowAttributes attrs;
+        bool onCurrentDesktop{true};
+        bool captureFails{false};
+        uint64_t version{0};
+        uint32_t color{0};
+        uint64_t seed{0};
+    };
+
+    static constexpr const char* kApps[] = { "editor", "browser", "terminal", "mail", "chat", "music", "files", "spreadsheet" };
+
+    uint64_t NextLocked() { // xorshift64*
+        rng_ ^= rng_ >> 12; rng_ ^= rng_ << 25; rng_ ^= rng_ >> 27;
+        return rng_ * 2685821657736338717ull;
+    }
+    double UnitLocked() { return (double)(NextLocked() >> 11) / (double)(1ull << 53); }
+    bool RollEligible() { return UnitLocked() >= config_.ineligibleFraction; }
+    bool RollEligibleUnlocked() { std::lock_guard<std::mutex> lock(mutex_); return RollEligible(); }
+
+    WindowId CreateLocked(bool eligible) {
+        WindowId id = nextId_;
+        nextId_ += 4; // HWND-like spacing; ids are never reused
+        SimWindow w;
+        w.seed = NextLocked();
+        w.color = (uint32_t)(w.seed >> 8) & 0xffffff;
+        const char* app = kApps[w.seed % (sizeof(kApps) / sizeof(kApps[0]))];
+        WindowAttributes& a = w.attrs;
+        a.pid = 1000 + (uint32_t)(id >> 2) % 50000;
+        a.title = Utf8ToUtf16(std::string(app) + " - document " + std::to_string(id >> 2));
+        a.className = Utf8ToUtf16(std::string("Synthetic_") + app);
+        a.executablePath = Utf8ToUtf16(std::string("/opt/") + app + "/" + app);
+        a.visible = true;
+        a.hasRect = true;
+        int width = config_.minWidth + (int)(NextLocked() % (uint64_t)std::max(1, config_.maxWidth - config_.minWidth + 1));
+        int height = config_.minHeight + (int)(NextLocked() % (uint64_t)std::max(1, config_.maxHeight - config_.minHeight + 1));
+        int x = (int)(NextLocked() % 400), y = (int)(NextLocked() % 300);
+        a.rect = WindowRect{ x, y, x + width, y + height };
+        a.minimized = UnitLocked() < config_.minimizedFraction;
+        w.onCurrentDesktop = UnitLocked() >= config_.otherDesktopFraction;
+        w.captureFails = UnitLocked() < config_.captureFailureRate;
+        if (!eligible) {
+            switch (NextLocked() % 4) {
+                case 0: a.toolWindow = true; break;
+                case 1: a.hasOwner = true; a.popup = true; break;
+                case 2: a.rect.right = a.rect.left + 32; a.rect.bottom = a.rect.top + 20; break;
+                default: a.className = u"ApplicationFrameWindow"; a.cloaked = true; break;
+            }
+        }
+        windows_[id] = w;
+        order_.insert(order_.begin(), id);
+        return id;
+    }
+
+    // UI-like content that depends on the window and its content version.
+    static void RenderContent(const SimWindow& w, int width, int height, Frame& out) {
+        out.Allocate(width, height);
+        uint8_t cr = (uint8_t)(w.color >> 16), cg = (uint8_t)(w.color >> 8), cb = (uint8_t)w.color;
+        int titleH = std::max(1, height / 12);
+        int lineH = std::max(1, height / 40);
+        uint64_t s = w.seed ^ (w.version * 0x9E3779B97F4A7C15ull);
+        for (int y = 0; y < height; ++y) {
+            uint8_t* row = out.pixels.data() + (size_t)y * out.Stride();
+            bool title = y < titleH;
+            bool textLine = !title && ((y - titleH) / lineH) % 2 == 1;
+            if (textLine) { s ^= s >> 12; s ^= s << 25; s ^= s >> 27; }
+            int textEnd = textLine ? (int)(((s * 2685821657736338717ull) >> 40) % (uint64_t)std::max(1, width)) : 0;
+            for (int x = 0; x < width; ++x) {
+                uint8_t* p = row + (size_t)x * 4;
+                if (title) { p[0] = cb; p[1] = cg; p[2] = cr; }
+                else if (x < textEnd && x > width / 10) { p[0] = p[1] = p[2] = 60; }
+                else { p[0] = p[1] = p[2] = 245; }
+                p[3] = 255;
+            }
+        }
+    }
+
+    void Emit(const WindowEvent& e) {
+        std::lock_guard<std::mutex> lock(sinkMutex_);
+        if (sink_) sink_(e);
+    }
+
+    const SyntheticDesktopConfig config_;
+    std::mutex mutex_; // guards everything below up to sinkMutex_
+    uint64_t rng_;
+    std::unordered_map<WindowId, SimWindow> windows_;
+    std::vector<WindowId> order_; // z-order, topmost first
+    WindowId foreground_{0};
+    WindowId nextId_{0x10000};
+    std::mutex sinkMutex_; // serializes sink calls and SetEventSink
+    WindowEventSink sink_;
+    std::atomic<uint64_t> captures_{0};
+    std::atomic<uint64_t> manualMs_{0};
+    const std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace dwm
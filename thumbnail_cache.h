@@ -0,0 +1,162 @@
+// Thumbnail cache: the last thumbnail per window with the rect, size and time
+// it was captured for. A request is served from it while the window has not
+// moved or resized and the entry is younger than the TTL; a minimized window
+// is served its last good thumbnail at any age, the way Alt-Tab shows it, and
+// a minimized capture never replaces a good one. Whether a thumbnail is good
+// is judged on the frame it was encoded from (IsUsefulThumbnailFrame), not on
+// its PNG size, so it holds for any encoder, palette or level. The addon, the
+// daemon's WindowSystemBackend and dwm_loadgen share this policy.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "image_frame.h"
+#include "memory_accounting.h"
+#include "window_system.h"
+
+namespace dwm {
+
+inline constexpr const char* kEmptyPngDataUrl = "data:image/png;base64,";
+
+inline bool IsEmptyDataUrl(const std::string& dataUrl) { return dataUrl.size() <= std::strlen(kEmptyPngDataUrl); }
+
+struct ThumbnailCachePolicy {
+    uint64_t ttlMs{1200};
+};
+
+// A thumbnail worth keeping for a minimized window: not blank, and not a
+// title-bar-only sliver (what PrintWindow and some DWM previews give for
+// minimized windows) covering under a quarter of the maxWidth x maxHeight box
+inline bool IsUsefulThumbnailFrame(const Frame& frame, int maxWidth, int maxHeight) {
+    if (frame.Empty()) return false;
+    if ((int64_t)frame.width * frame.height * 4 < (int64_t)maxWidth * maxHeight) return false;
+    return !IsUniform(frame);
+}
+
+struct ThumbnailCacheEntry {
+    std::string dataUrl;
+    WindowRect rect;
+    uint64_t timestampMs{0};
+    int width{0}, height{0};
+    bool good{false};       // encoded from a useful frame, not a placeholder
+    bool prefetched{false}; // captured ahead of a request (MRU prefetch)
+    MemoryCharge charge{ MemoryCategory::ThumbnailCache };
+};
+
+class ThumbnailCache {
+public:
+    // Cache half of a thumbnail request. True if `out` was served without a
+    // capture; *prefetched tells whether the served entry was a prefetch.
+    bool TryServe(WindowId window, int width, int height, const WindowRect& rect, bool minimized, uint64_t nowMs,
+                  const ThumbnailCachePolicy& policy, std::string& out, bool* prefetched = nullptr) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(window);
+        if (it == entries_.end()) return false;
+        const ThumbnailCacheEntry& e = it->second;
+        bool fresh = e.width == width && e.height == height && e.rect == rect && nowMs - e.timestampMs < policy.ttlMs;
+        if (!fresh && !(minimized && e.good)) return false;
+        if (prefetched) *prefetched = fresh && e.prefetched;
+        out = e.dataUrl;
+        return true;
+    }
+
+    // Store half: decides between the fresh capture (taken for rect at nowMs;
+    // freshGood per IsUsefulThumbnailFrame on its frame), an older good entry
+    // and a placeholder, updates the cache and returns what to serve.
+    // placeholder (may be empty) makes a stand-in thumbnail, e.g. the
+    // app icon; it is asked for when the capture failed and the window's
+    // capture methods are backing off, or when a minimized window has no good
+    // entry. Called without the cache lock held.
+    std::string Commit(WindowId window, const std::string& fresh, bool freshGood, int width, int height,
+                       const WindowRect& rect, uint64_t nowMs, bool minimized, bool backedOff,
+                       const std::function<std::string()>& placeholder = nullptr) {
+        if (IsEmptyDataUrl(fresh) && backedOff && placeholder) {
+            // Known-failing window: cache the placeholder so the next calls are
+            // served from the cache until a capture is retried
+            std::string p = placeholder();
+            if (!IsEmptyDataUrl(p)) {
+                Store(window, p, false, rect, nowMs, width, height);
+                return p;
+            }
+        }
+        if (minimized && !freshGood) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = entries_.find(window);
+                if (it != entries_.end() && it->second.good) return it->second.dataUrl;
+            }
+            std::string p = placeholder ? placeholder() : std::string();
+            return IsEmptyDataUrl(p) ? fresh : p;
+        }
+        Store(window, fresh, freshGood, rect, nowMs, width, height);
+        return fresh;
+    }
+
+    void Store(WindowId window, const std::string& dataUrl, bool good, const WindowRect& rect, uint64_t nowMs, int width,
+               int height, bool prefetched = false) {
+        ThumbnailCacheEntry e;
+        e.dataUrl = dataUrl;
+        e.rect = rect;
+        e.timestampMs = nowMs;
+        e.width = width;
+        e.height = height;
+        e.good = good;
+        e.prefetched = prefetched;
+        e.charge.Set(sizeof(WindowId) + sizeof(ThumbnailCacheEntry) + e.dataUrl.capacity());
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_[window] = std::move(e);
+    }
+
+    // Marks the entry stored at nowMs (by Commit) as prefetched
+    void MarkPrefetched(WindowId window, uint64_t nowMs) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(window);
+        if (it != entries_.end() && it->second.timestampMs == nowMs) it->second.prefetched = true;
+    }
+
+    // Age of the entry a width x height request at rect would be served, if any (TTL aside)
+    bool Age(WindowId window, int width, int height, const WindowRect& rect, uint64_t nowMs, uint64_t& ageMs) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(window);
+        if (it == entries_.end()) return false;
+        const ThumbnailCacheEntry& e = it->second;
+        if (e.width != width || e.height != height || e.rect != rect) return false;
+        ageMs = nowMs > e.timestampMs ? nowMs - e.timestampMs : 0;
+        return true;
+    }
+
+    // Any non-empty thumbnail for the window, whatever its age, size or rect
+    bool TryGetStale(WindowId window, std::string& out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(window);
+        if (it == entries_.end() || IsEmptyDataUrl(it->second.dataUrl)) return false;
+        out = it->second.dataUrl;
+        return true;
+    }
+
+    size_t Size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+    // Bytes of cached data URLs
+    size_t Bytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t bytes = 0;
+        for (const auto& kv : entries_) bytes += kv.second.dataUrl.size();
+        return bytes;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<WindowId, ThumbnailCacheEntry> entries_;
+};
+
+} // namespace dwm
@@ -0,0 +1,303 @@
+// Chrome/Perfetto trace-event export ("JSON Array Format", load in
+// chrome://tracing or ui.perfetto.dev). Events are buffered in memory and a
+// background thread formats and writes them, so recording a span costs a clock
+// read and a short locked push. Disabled tracing costs one atomic load.
+// Portable C++17; thread/process ids come from the OS where available.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace dwm {
+
+inline uint32_t CurrentTraceThreadId() {
+#if defined(_WIN32)
+    return (uint32_t)GetCurrentThreadId();
+#elif defined(__linux__)
+    return (uint32_t)syscall(SYS_gettid);
+#else
+    static std::atomic<uint32_t> next{1};
+    static thread_local uint32_t id = next.fetch_add(1);
+    return id;
+#endif
+}
+
+inline uint32_t CurrentTraceProcessId() {
+#if defined(_WIN32)
+    return (uint32_t)GetCurrentProcessId();
+#else
+    return (uint32_t)getpid();
+#endif
+}
+
+inline void AppendJsonEscaped(std::string& out, const std::string& s) {
+    static const char hex[] = "0123456789abcdef";
+    for (unsigned char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) { out += "\\u00"; out += hex[c >> 4]; out += hex[c & 15]; }
+                else out += (char)c; // UTF-8 passes through
+        }
+    }
+}
+
+class TraceWriter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static TraceWriter& Instance() {
+        static TraceWriter writer;
+        return writer;
+    }
+
+    ~TraceWriter() { Stop(); }
+
+    bool Enabled() const { return enabled_.load(std::memory_order_acquire); }
+
+    // Opens the file and starts the flush thread. Fails if already tracing.
+    bool Start(const std::string& path, std::string* error = nullptr) {
+        std::lock_guard<std::mutex> control(controlMutex_);
+        if (file_) { if (error) *error = "tracing already started"; return false; }
+        FILE* f = OpenFile(path);
+        if (!f) { if (error) *error = "cannot open " + path; return false; }
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+        file_ = f;
+        firstWritten_ = false;
+        written_ = 0;
+        dropped_.store(0);
+        pid_ = CurrentTraceProcessId();
+        origin_ = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.clear();
+            namedThreads_.clear();
+            stopping_ = false;
+        }
+        flusher_ = std::thread([this]{ FlushLoop(); });
+        enabled_.store(true);
+        return true;
+    }
+
+    // Stops recording, writes everything still buffered and closes the file.
+    // Returns the number of events written (0 if tracing was not active).
+    uint64_t Stop() {
+        std::lock_guard<std::mutex> control(controlMutex_);
+        if (!file_) return 0;
+        enabled_.store(false);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        if (flusher_.joinable()) flusher_.join();
+        std::fputs("\n]}\n", file_);
+        std::fclose(file_);
+        file_ = nullptr;
+        return written_;
+    }
+
+    uint64_t Dropped() const { return dropped_.load(); }
+
+    // Complete event ("ph":"X"). name/cat must be string literals or outlive the trace;
+    // args is a preformatted JSON object body without braces (e.g. "\"hwnd\":123").
+    void Complete(const char* cat, const char* name, Clock::time_point start, Clock::time_point end, std::string args = std::string()) {
+        if (!Enabled()) return;
+        Event e;
+        e.ph = 'X';
+        e.cat = cat;
+        e.name = name;
+        e.tid = CurrentTraceThreadId();
+        e.tsUs = ToUs(start);
+        e.durUs = std::chrono::duration<double, std::micro>(end - start).count();
+        e.args = std::move(args);
+        Push(std::move(e));
+    }
+
+    void Instant(const char* cat, const char* name, std::string args = std::string()) {
+        if (!Enabled()) return;
+        Event e;
+        e.ph = 'i';
+        e.cat = cat;
+        e.name = name;
+        e.tid = CurrentTraceThreadId();
+        e.tsUs = ToUs(Clock::now());
+        e.args = std::move(args);
+        Push(std::move(e));
+    }
+
+    // Labels the calling thread in the trace viewer (once per thread per trace).
+    void NameCurrentThread(const char* threadName) {
+        if (!Enabled()) return;
+        uint32_t tid = CurrentTraceThreadId();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (uint32_t t : namedThreads_) if (t == tid) return;
+            namedThreads_.push_back(tid);
+        }
+        Event e;
+        e.ph = 'M';
+        e.cat = "__metadata";
+        e.name = "thread_name";
+        e.tid = tid;
+        e.args = "\"name\":\"";
+        AppendJsonEscaped(e.args, threadName);
+        e.args += "\"";
+        Push(std::move(e));
+    }
+
+private:
+    struct Event {
+        char ph{'X'};
+        const char* cat{""};
+        const char* name{""};
+        uint32_t tid{0};
+        double tsUs{0};
+        double durUs{0};
+        std::string args;
+    };
+
+    // Bound on buffered events if the writer falls behind (~100 MB worst case)
+    static constexpr size_t kMaxPending = 1u << 20;
+    static constexpr std::chrono::milliseconds kFlushInterval{ 200 };
+
+    TraceWriter() = default;
+
+    // path is UTF-8
+    static FILE* OpenFile(const std::string& path) {
+#if defined(_WIN32)
+        int n = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+        if (n <= 0) return nullptr;
+        std::wstring wpath((size_t)n, L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wpath[0], n);
+        return _wfopen(wpath.c_str(), L"wb");
+#else
+        return std::fopen(path.c_str(), "wb");
+#endif
+    }
+
+    double ToUs(Clock::time_point t) const {
+        return std::chrono::duration<double, std::micro>(t - origin_).count();
+    }
+
+    void Push(Event&& e) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.size() >= kMaxPending) { dropped_.fetch_add(1); return; }
+        pending_.push_back(std::move(e));
+    }
+
+    void FlushLoop() {
+        std::vector<Event> batch;
+        std::string text;
+        for (;;) {
+            bool stop;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait_for(lock, kFlushInterval, [&]{ return stopping_; });
+                stop = stopping_;
+                batch.swap(pending_);
+            }
+            text.clear();
+            for (const Event& e : batch) Format(e, text);
+            if (!text.empty()) std::fwrite(text.data(), 1, text.size(), file_);
+            written_ += batch.size();
+            batch.clear();
+            if (stop) break;
+        }
+        std::fflush(file_);
+    }
+
+    void Format(const Event& e, std::string& out) {
+        char buf[160];
+        if (firstWritten_) out += ",\n";
+        firstWritten_ = true;
+        out += "{\"name\":\"";
+        AppendJsonEscaped(out, e.name);
+        out += "\",\"cat\":\"";
+        AppendJsonEscaped(out, e.cat);
+        if (e.ph == 'X') {
+            std::snprintf(buf, sizeof(buf), "\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", pid_, e.tid, e.tsUs, e.durUs);
+        } else if (e.ph == 'i') {
+            std::snprintf(buf, sizeof(buf), "\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f", pid_, e.tid, e.tsUs);
+        } else {
+            std::snprintf(buf, sizeof(buf), "\",\"ph\":\"%c\",\"pid\":%u,\"tid\":%u,\"ts\":0", e.ph, pid_, e.tid);
+        }
+        out += buf;
+        if (!e.args.empty()) {
+            out += ",\"args\":{";
+            out += e.args;
+            out += "}";
+        }
+        out += "}";
+    }
+
+    std::atomic<bool> enabled_{false};
+    std::mutex controlMutex_; // serializes Start/Stop
+    std::mutex mutex_;        // guards pending_, namedThreads_, stopping_
+    std::condition_variable cv_;
+    std::vector<Event> pending_;
+    std::vector<uint32_t> namedThreads_;
+    bool stopping_{false};
+    std::thread flusher_;
+    FILE* file_{nullptr};
+    bool firstWritten_{false}; // flush thread only
+    uint64_t written_{0};      // flush thread only until joined
+    std::atomic<uint64_t> dropped_{0};
+    uint32_t pid_{0};
+    Clock::time_point origin_{};
+};
+
+// Records a complete event for its scope (or until End()).
+class TraceSpan {
+public:
+    TraceSpan(const char* cat, const char* name)
+        : cat_(cat), name_(name), active_(TraceWriter::Instance().Enabled()) {
+        if (active_) start_ = TraceWriter::Clock::now();
+    }
+    ~TraceSpan() { End(); }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    bool Active() const { return active_; }
+    // JSON object body, e.g. "\"hwnd\":123"; only build it when Active().
+    void SetArgs(std::string args) { args_ = std::move(args); }
+
+    void End() {
+        if (!active_) return;
+        active_ = false;
+        TraceWriter::Instance().Complete(cat_, name_, start_, TraceWriter::Clock::now(), std::move(args_));
+    }
+
+private:
+    const char* cat_;
+    const char* name_;
+    bool active_;
+    TraceWriter::Clock::time_point start_{};
+    std::string args_;
+};
+
+#define DWM_TRACE_CONCAT_(a, b) a##b
+#define DWM_TRACE_CONCAT(a, b) DWM_TRACE_CONCAT_(a, b)
+#define DWM_TRACE_SPAN(cat, name) ::dwm::TraceSpan DWM_TRACE_CONCAT(dwmTraceSpan_, __LINE__)(cat, name)
+
+} // namespace dwm
@@ -0,0 +1,171 @@
+// UTF-16 <-> UTF-8 transcoding. Window strings stay UTF-16 from the Win32 API
+// to the JS engine (napi_create_string_utf16); these are for the few places
+// that need UTF-8 (trace files, the synthetic backend's literals). Runs of
+// ASCII, by far the common case in titles and paths, are converted 8/16 code
+// units at a time with SSE2 where available; everything else goes through the
+// scalar code, which is also exported for comparison. Invalid input (lone
+// surrogates, malformed UTF-8) becomes U+FFFD, like WideCharToMultiByte.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DWM_UTF16_SSE2 1
+#endif
+
+namespace dwm {
+
+namespace utf_detail {
+
+// One code point starting at s[i] (advances i); lone surrogates become U+FFFD
+inline size_t EncodeUtf8At(const char16_t* s, size_t n, size_t& i, char* out) {
+    uint32_t c = s[i++];
+    if (c < 0x80) { out[0] = (char)c; return 1; }
+    if (c < 0x800) {
+        out[0] = (char)(0xC0 | (c >> 6));
+        out[1] = (char)(0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c >= 0xD800 && c <= 0xDFFF) {
+        if (c <= 0xDBFF && i < n && s[i] >= 0xDC00 && s[i] <= 0xDFFF) {
+            uint32_t cp = 0x10000 + ((c - 0xD800) << 10) + (uint32_t)(s[i++] - 0xDC00);
+            out[0] = (char)(0xF0 | (cp >> 18));
+            out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+            out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+            out[3] = (char)(0x80 | (cp & 0x3F));
+            return 4;
+        }
+        c = 0xFFFD;
+    }
+    out[0] = (char)(0xE0 | (c >> 12));
+    out[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (c & 0x3F));
+    return 3;
+}
+
+// One code point starting at s[i] (advances i); malformed sequences yield
+// U+FFFD and skip one byte, so decoding always makes progress
+inline size_t DecodeUtf8At(const unsigned char* s, size_t n, size_t& i, char16_t* out) {
+    uint32_t b0 = s[i];
+    uint32_t cp = 0xFFFD;
+    size_t len = 1;
+    auto cont = [&](size_t k) { return i + k < n && (s[i + k] & 0xC0) == 0x80; };
+    if (b0 < 0x80) {
+        cp = b0;
+    } else if (b0 >= 0xC2 && b0 <= 0xDF && cont(1)) {
+        cp = ((b0 & 0x1F) << 6) | (s[i + 1] & 0x3F);
+        len = 2;
+    } else if (b0 >= 0xE0 && b0 <= 0xEF && cont(1) && cont(2)) {
+        uint32_t v = ((b0 & 0x0F) << 12) | ((uint32_t)(s[i + 1] & 0x3F) << 6) | (s[i + 2] & 0x3F);
+        if (v >= 0x800 && (v < 0xD800 || v > 0xDFFF)) { cp = v; len = 3; }
+    } else if (b0 >= 0xF0 && b0 <= 0xF4 && cont(1) && cont(2) && cont(3)) {
+        uint32_t v = ((b0 & 0x07) << 18) | ((uint32_t)(s[i + 1] & 0x3F) << 12) | ((uint32_t)(s[i + 2] & 0x3F) << 6) | (s[i + 3] & 0x3F);
+        if (v >= 0x10000 && v <= 0x10FFFF) { cp = v; len = 4; }
+    }
+    i += len;
+    if (cp < 0x10000) { out[0] = (char16_t)cp; return 1; }
+    cp -= 0x10000;
+    out[0] = (char16_t)(0xD800 + (cp >> 10));
+    out[1] = (char16_t)(0xDC00 + (cp & 0x3FF));
+    return 2;
+}
+
+} // namespace utf_detail
+
+// Appends the UTF-8 form of s[0..n) to out (any std::basic_string<char>, e.g. pmr)
+template <class Str>
+void AppendUtf8Scalar(const char16_t* s, size_t n, Str& out) {
+    size_t pos = out.size();
+    out.resize(pos + n * 3); // every code unit needs at most 3 bytes (pairs: 4 for 2)
+    char* dst = &out[0];
+    for (size_t i = 0; i < n;) pos += utf_detail::EncodeUtf8At(s, n, i, dst + pos);
+    out.resize(pos);
+}
+
+template <class Str>
+void AppendUtf8(const char16_t* s, size_t n, Str& out) {
+#if DWM_UTF16_SSE2
+    size_t pos = out.size();
+    out.resize(pos + n * 3);
+    char* dst = &out[0];
+    const __m128i nonAscii = _mm_set1_epi16((short)0xFF80);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0, scalarSpan = 8;
+    while (i < n) {
+        while (i + 8 <= n) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, nonAscii), zero)) != 0xFFFF) break;
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + pos), _mm_packus_epi16(v, v));
+            i += 8;
+            pos += 8;
+            scalarSpan = 8;
+        }
+        // Scalar over the rest of the block (or the tail), for longer after each
+        // consecutive miss, so non-Latin text doesn't pay for the vector check
+        for (size_t end = i + scalarSpan; i < n && i < end;) pos += utf_detail::EncodeUtf8At(s, n, i, dst + pos);
+        scalarSpan = std::min<size_t>(scalarSpan * 2, 256);
+    }
+    out.resize(pos);
+#else
+    AppendUtf8Scalar(s, n, out);
+#endif
+}
+
+// Appends the UTF-16 form of s[0..n) to out (any std::basic_string<char16_t>, e.g. pmr)
+template <class Str>
+void AppendUtf16Scalar(const char* s, size_t n, Str& out) {
+    size_t pos = out.size();
+    out.resize(pos + n); // every byte yields at most one code unit
+    char16_t* dst = &out[0];
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(s);
+    for (size_t i = 0; i < n;) pos += utf_detail::DecodeUtf8At(u, n, i, dst + pos);
+    out.resize(pos);
+}
+
+template <class Str>
+void AppendUtf16(const char* s, size_t n, Str& out) {
+#if DWM_UTF16_SSE2
+    size_t pos = out.size();
+    out.resize(pos + n);
+    char16_t* dst = &out[0];
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(s);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0, scalarSpan = 16;
+    while (i < n) {
+        while (i + 16 <= n) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + i));
+            if (_mm_movemask_epi8(v) != 0) break;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos), _mm_unpacklo_epi8(v, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos + 8), _mm_unpackhi_epi8(v, zero));
+            i += 16;
+            pos += 16;
+            scalarSpan = 16;
+        }
+        for (size_t end = i + scalarSpan; i < n && i < end;) pos += utf_detail::DecodeUtf8At(u, n, i, dst + pos);
+        scalarSpan = std::min<size_t>(scalarSpan * 2, 512);
+    }
+    out.resize(pos);
+#else
+    AppendUtf16Scalar(s, n, out);
+#endif
+}
+
+inline std::string Utf16ToUtf8(std::u16string_view s) {
+    std::string out;
+    AppendUtf8(s.data(), s.size(), out);
+    return out;
+}
+
+inline std::u16string Utf8ToUtf16(std::string_view s) {
+    std::u16string out;
+    AppendUtf16(s.data(), s.size(), out);
+    return out;
+}
+
+} // namespace dwm
@@ -0,0 +1,67 @@
+// Turns periodic snapshots of the window list into created/closed/focused/
+// minimized/restored events, for backends (or situations) without push events.
+// Used by the addon's fallback poller and by the synthetic backend's consumers.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "window_system.h"
+
+namespace dwm {
+
+struct WindowSnapshotEntry {
+    WindowId window{0};
+    bool minimized{false};
+};
+
+class WindowEventTracker {
+public:
+    // Diffs against the previous snapshot and appends the events to out (cleared
+    // first). With emit = false the state is still updated but nothing is
+    // reported, e.g. while hooks already deliver the same events. A window's
+    // first sighting records its minimized state without an event.
+    void Update(WindowId foreground, const std::vector<WindowSnapshotEntry>& windows, bool emit, std::vector<WindowEvent>& out) {
+        out.clear();
+        if (emit && foreground && foreground != lastForeground_) out.push_back({ WindowEventType::Focused, foreground });
+        lastForeground_ = foreground;
+
+        ++generation_;
+        for (const WindowSnapshotEntry& w : windows) {
+            auto it = known_.find(w.window);
+            if (it == known_.end()) {
+                known_.emplace(w.window, State{ w.minimized, generation_ });
+                if (emit) out.push_back({ WindowEventType::Created, w.window });
+                continue;
+            }
+            it->second.seen = generation_;
+            if (it->second.minimized != w.minimized) {
+                it->second.minimized = w.minimized;
+                if (emit) out.push_back({ w.minimized ? WindowEventType::Minimized : WindowEventType::Restored, w.window });
+            }
+        }
+        for (auto it = known_.begin(); it != known_.end();) {
+            if (it->second.seen != generation_) {
+                if (emit) out.push_back({ WindowEventType::Closed, it->first });
+                it = known_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    size_t KnownWindows() const { return known_.size(); }
+
+private:
+    struct State {
+        bool minimized{false};
+        uint64_t seen{0};
+    };
+
+    std::unordered_map<WindowId, State> known_;
+    WindowId lastForeground_{0};
+    uint64_t generation_{0};
+};
+
+} // namespace dwm
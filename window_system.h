@@ -0,0 +1,187 @@
+// Window-system abstraction: what the addon needs from the desktop (enumerate,
+// attributes, capture, icons, foreground/events, clock) behind one interface.
+// The Win32 implementation lives in dwm_thumbnail.cc; synthetic_window_system.h
+// simulates a desktop so filtering, caching, scheduling and event logic can run
+// and be profiled anywhere. Also holds the Alt-Tab filter rules, expressed over
+// WindowAttributes so every backend shares them.
+// Portable C++17, no Win32 dependencies.
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "image_frame.h"
+
+namespace dwm {
+
+// Opaque window handle (an HWND on Windows). 0 is never a valid window.
+using WindowId = uint64_t;
+
+struct WindowRect {
+    int left{0}, top{0}, right{0}, bottom{0};
+    int Width() const { return right - left; }
+    int Height() const { return bottom - top; }
+    bool operator==(const WindowRect& o) const {
+        return left == o.left && top == o.top && right == o.right && bottom == o.bottom;
+    }
+    bool operator!=(const WindowRect& o) const { return !(*this == o); }
+};
+
+// Everything the Alt-Tab filter and the window listing read, gathered in one pass.
+// Strings are UTF-16 as the OS reports them and JS receives them (utf16.h
+// converts where UTF-8 is needed). They are scratch data for the filter;
+// enumerations allocate them from an EnumerationArena (enumeration_arena.h)
+// and copy out only what they list.
+struct WindowAttributes {
+    WindowAttributes() = default;
+    explicit WindowAttributes(std::pmr::memory_resource* mr) : title(mr), className(mr), executablePath(mr), childTitle(mr) {}
+
+    std::pmr::u16string title;
+    std::pmr::u16string className;
+    std::pmr::u16string executablePath;
+    std::pmr::u16string childTitle; // first titled child; only filled when title is empty
+    uint32_t pid{0};
+    bool visible{false};
+    bool minimized{false};
+    bool cloaked{false};         // only queried for ApplicationFrameWindow hosts
+    bool toolWindow{false};      // WS_EX_TOOLWINDOW
+    bool noActivate{false};      // WS_EX_NOACTIVATE
+    bool transparent{false};     // layered with alpha 0
+    bool child{false};           // WS_CHILD
+    bool popup{false};           // WS_POPUP
+    bool appWindow{false};       // WS_EX_APPWINDOW
+    bool hasOwner{false};
+    bool hasRect{false};
+    WindowRect rect;             // restored (normal) rect for minimized windows
+};
+
+enum class WindowEventType { Created, Closed, Focused, Minimized, Restored };
+
+inline const char* WindowEventTypeName(WindowEventType type) {
+    switch (type) {
+        case WindowEventType::Created: return "created";
+        case WindowEventType::Closed: return "closed";
+        case WindowEventType::Focused: return "focused";
+        case WindowEventType::Minimized: return "minimized";
+        case WindowEventType::Restored: return "restored";
+    }
+    return "unknown";
+}
+
+struct WindowEvent {
+    WindowEventType type{WindowEventType::Created};
+    WindowId window{0};
+};
+
+using WindowEventSink = std::function<void(const WindowEvent&)>;
+
+class WindowSystem {
+public:
+    virtual ~WindowSystem() = default;
+
+    // Top-level windows in z-order (topmost first), unfiltered.
+    virtual void EnumerateTopLevel(std::vector<WindowId>& out) = 0;
+    virtual bool IsAlive(WindowId window) = 0;
+    virtual bool GetAttributes(WindowId window, WindowAttributes& out) = 0;
+    // Current rect and minimized state, without the rest of GetAttributes
+    // (thumbnail cache checks run for every listed window)
+    virtual bool GetRect(WindowId window, WindowRect& out) = 0;
+    virtual bool IsMinimized(WindowId window) = 0;
+    virtual bool IsOnCurrentDesktop(WindowId window) = 0;
+    virtual WindowId Foreground() = 0;
+    // Frame scaled to fit maxW x maxH (implementations may return it larger;
+    // callers scale). False if the window could not be captured.
+    virtual bool Capture(WindowId window, int maxW, int maxH, Frame& out) = 0;
+    // PNG data URL of the window's icon ("data:image/png;base64," if none).
+    virtual std::string IconDataUrl(WindowId window, int size) = 0;
+    // Pushes window events to sink from a backend thread; nullptr unsubscribes.
+    // False if the backend has no push events (poll with WindowEventTracker instead).
+    virtual bool SetEventSink(WindowEventSink sink) = 0;
+    // Monotonic milliseconds
+    virtual uint64_t NowMs() = 0;
+};
+
+namespace window_rules {
+
+// ASCII case-insensitive helpers over UTF-16; needles must be lower-case
+// ASCII. These run for every window on every enumeration, so they avoid
+// lower-cased copies.
+inline char16_t AsciiLower(char16_t c) { return (c >= u'A' && c <= u'Z') ? (char16_t)(c + (u'a' - u'A')) : c; }
+
+inline bool EqualsNoCase(std::u16string_view s, const char* lower) {
+    size_t i = 0;
+    for (; lower[i]; ++i) {
+        if (i >= s.size() || AsciiLower(s[i]) != (unsigned char)lower[i]) return false;
+    }
+    return i == s.size();
+}
+
+inline bool MatchesAt(std::u16string_view s, size_t pos, const char* lower, size_t n) {
+    for (size_t j = 0; j < n; ++j) {
+        if (AsciiLower(s[pos + j]) != (unsigned char)lower[j]) return false;
+    }
+    return true;
+}
+
+inline bool ContainsNoCase(std::u16string_view s, const char* lower) {
+    size_t n = std::char_traits<char>::length(lower);
+    for (size_t i = 0; i + n <= s.size(); ++i) if (MatchesAt(s, i, lower, n)) return true;
+    return false;
+}
+
+inline bool EndsWithNoCase(std::u16string_view s, const char* lower) {
+    size_t n = std::char_traits<char>::length(lower);
+    return s.size() >= n && MatchesAt(s, s.size() - n, lower, n);
+}
+
+inline bool IsAppFrameHost(const WindowAttributes& a) { return EqualsNoCase(a.className, "applicationframewindow"); }
+
+inline bool IsPowerToysCommandPalette(const WindowAttributes& a) {
+    if (ContainsNoCase(a.title, "befehlspalette") || ContainsNoCase(a.title, "command palette")) return true;
+    return ContainsNoCase(a.executablePath, "microsoft.cmdpal.ui.exe");
+}
+
+inline bool IsExplorer(const WindowAttributes& a) {
+    return EqualsNoCase(a.className, "cabinetwclass") || ContainsNoCase(a.executablePath, "explorer.exe");
+}
+
+inline bool IsWhatsApp(const WindowAttributes& a) {
+    return ContainsNoCase(a.title, "whatsapp") || ContainsNoCase(a.executablePath, "\\whatsapp.exe") ||
+           EndsWithNoCase(a.executablePath, "whatsapp.exe");
+}
+
+} // namespace window_rules
+
+// Alt-Tab / Task View eligibility (virtual-desktop membership is checked separately).
+inline bool IsAltTabCandidate(const WindowAttributes& a) {
+    using namespace window_rules;
+    if (IsPowerToysCommandPalette(a)) return false;
+    if (!a.visible) return false; // minimized windows stay visible and are listed
+    if (a.toolWindow || a.noActivate || a.transparent) return false;
+    // Untitled windows only for UWP hosts, Explorer and WhatsApp
+    if (a.title.empty() && !IsAppFrameHost(a) && !IsExplorer(a) && !IsWhatsApp(a)) return false;
+    // Child/popup/owned windows are not listed unless they are app windows
+    if (a.child) return false;
+    if (a.popup && !a.appWindow && !IsWhatsApp(a)) return false;
+    if (!a.appWindow && a.hasOwner) return false;
+    // Cloaked ApplicationFrameWindow hosts are duplicate/invisible UWP shells
+    if (IsAppFrameHost(a) && a.cloaked) return false;
+    if (!a.hasRect || a.rect.Width() < 50 || a.rect.Height() < 50) return false;
+    return true;
+}
+
+// Title to list the window under; empty means the window is not listed.
+inline std::u16string DisplayTitle(const WindowAttributes& a) {
+    using namespace window_rules;
+    if (!a.title.empty()) return std::u16string(a.title);
+    if (IsAppFrameHost(a) && !a.childTitle.empty()) return std::u16string(a.childTitle);
+    if (IsExplorer(a)) return a.childTitle.empty() ? std::u16string(u"Datei-Explorer") : std::u16string(a.childTitle);
+    if (IsWhatsApp(a)) return u"WhatsApp";
+    return std::u16string();
+}
+
+} // namespace dwm